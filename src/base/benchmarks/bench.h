@@ -0,0 +1,32 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+// Benchmarks of base, built into the base_benchmarks executable, which isn't run by ctest. A
+// benchmark is a function declared with TS_BENCHMARK, called with the count of keys, jobs or
+// zones it times, which defaults to 'default_count'.
+#define TS_BENCHMARK_CONCAT_(a, b) a##b
+#define TS_BENCHMARK_CONCAT(a, b) TS_BENCHMARK_CONCAT_(a, b)
+
+#define TS_BENCHMARK(name, default_count)                                                           \
+    static void name(size_t);                                                                       \
+    static const bool TS_BENCHMARK_CONCAT(name, _registered) =                                      \
+        ::base::bench::add(#name, name, default_count);                                             \
+    static void name(size_t count)
+
+namespace base::bench {
+    // registers a benchmark, always returns true so it can initialize a static.
+    bool add(const char* name, void (*fn)(size_t), size_t count);
+
+    // time of running 'fn' once, in nanoseconds.
+    template<typename Fn>
+    double ns(Fn&& fn)
+    {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+        return elapsed.count();
+    }
+}
@@ -0,0 +1,96 @@
+#include "bench.h"
+
+#include "hash_map.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+    struct Timing {
+        double insert_ns = 0;
+        double find_ns = 0;
+        size_t found = 0;
+    };
+
+    // inserts 'inserted' and looks for 'looked_for', per key.
+    template<typename Map, typename Key>
+    Timing time_map(const std::vector<Key>& inserted, const std::vector<Key>& looked_for)
+    {
+        Map map;
+        Timing timing;
+
+        timing.insert_ns = base::bench::ns([&] {
+            for (size_t i = 0; i < inserted.size(); i++)
+                map[inserted[i]] = i;
+        }) / inserted.size();
+
+        timing.find_ns = base::bench::ns([&] {
+            for (auto& key : looked_for)
+                timing.found += map.find(key) != map.end();
+        }) / inserted.size();
+
+        return timing;
+    }
+
+    // the keys found are printed so the lookups aren't optimized out.
+    void report(const char* keys_of, const Timing& base, const Timing& std, size_t keys)
+    {
+        std::printf(
+            "%s: insert %.1f ns, std %.1f ns; find %.1f ns, std %.1f ns; found %zu and %zu of %zu\n",
+            keys_of,
+            base.insert_ns,
+            std.insert_ns,
+            base.find_ns,
+            std.find_ns,
+            base.found,
+            std.found,
+            2 * keys
+        );
+    }
+}
+
+// Times base::HashMap inserting and finding 'count' integers and strings against
+// std::unordered_map.
+TS_BENCHMARK(hash_map_against_unordered_map, 100000)
+{
+    std::mt19937_64 random { 1 };
+
+    std::vector<uint64_t> ints(count);
+    std::vector<std::string> strings(count);
+
+    for (size_t i = 0; i < count; i++) {
+        ints[i] = random();
+        strings[i] = "identifier_" + std::to_string(ints[i] % (count * 4));
+    }
+
+    // the keys looked for are the ones inserted, in another order, then as many missing ones.
+    auto lookups = ints;
+    std::shuffle(lookups.begin(), lookups.end(), random);
+
+    for (size_t i = 0; i < count; i++)
+        lookups.push_back(random());
+
+    auto string_lookups = strings;
+    std::shuffle(string_lookups.begin(), string_lookups.end(), random);
+
+    for (size_t i = 0; i < count; i++)
+        string_lookups.push_back("missing_" + std::to_string(i));
+
+    report(
+        "integers",
+        time_map<base::HashMap<uint64_t, size_t>>(ints, lookups),
+        time_map<std::unordered_map<uint64_t, size_t>>(ints, lookups),
+        count
+    );
+
+    report(
+        "strings",
+        time_map<base::HashMap<std::string, size_t>>(strings, string_lookups),
+        time_map<std::unordered_map<std::string, size_t>>(strings, string_lookups),
+        count
+    );
+}
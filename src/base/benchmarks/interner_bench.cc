@@ -0,0 +1,53 @@
+#include "bench.h"
+
+#include "interner.h"
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Times base::Interner interning 'count' names from several threads against a
+// std::unordered_map filled from one.
+TS_BENCHMARK(interner_against_unordered_map, 100000)
+{
+    std::mt19937_64 random { 1 };
+    std::vector<std::string> strings(count);
+
+    for (auto& string : strings)
+        string = "identifier_" + std::to_string(random() % (count * 4));
+
+    base::Interner interner;
+    std::vector<std::vector<uint32_t>> ids(4);
+
+    auto interned = base::bench::ns([&] {
+        std::vector<std::thread> threads;
+
+        for (auto& thread_ids : ids)
+            threads.emplace_back([&] {
+                for (auto& string : strings)
+                    thread_ids.push_back(interner.id(string));
+            });
+
+        for (auto& thread : threads)
+            thread.join();
+    }) / count;
+
+    std::unordered_map<std::string, uint32_t> copies;
+
+    auto copied = base::bench::ns([&] {
+        for (size_t i = 0; i < ids.size(); i++)
+            for (auto& string : strings)
+                copies.try_emplace(string, static_cast<uint32_t>(copies.size()));
+    }) / count;
+
+    std::printf(
+        "interning %zu names from %zu threads: %.1f ns, std::unordered_map from one thread %.1f ns\n",
+        interner.size(),
+        ids.size(),
+        interned,
+        copied
+    );
+}
@@ -0,0 +1,81 @@
+#include "bench.h"
+
+#include "jobs.h"
+
+#include <cstdio>
+#include <vector>
+
+// Times queuing 'count' empty jobs on base::jobs, from outside the scheduler and from a job,
+// on one thread per hardware thread.
+TS_BENCHMARK(jobs_empty, 100000)
+{
+    base::jobs::Scheduler scheduler;
+
+    // from outside the scheduler jobs go through its shared queue, from a job to its own deque.
+    auto from_outside = base::bench::ns([&] {
+        base::jobs::Counter counter;
+
+        for (size_t i = 0; i < count; i++)
+            scheduler.run([] {}, &counter);
+
+        scheduler.wait(counter);
+    }) / count;
+
+    auto from_job = base::bench::ns([&] {
+        base::jobs::Counter outer;
+        base::jobs::Counter counter;
+
+        scheduler.run([&] {
+            for (size_t i = 0; i < count; i++)
+                scheduler.run([] {}, &counter);
+        }, &outer);
+
+        scheduler.wait(outer);
+        scheduler.wait(counter);
+    }) / count;
+
+    std::printf(
+        "%zu threads: %.1f ns queued from outside, %.1f ns queued from a job\n",
+        scheduler.num_threads(),
+        from_outside,
+        from_job
+    );
+}
+
+// Times a parallel_for over 'count' indices against a plain loop, on one thread per hardware
+// thread.
+TS_BENCHMARK(jobs_parallel_for_against_loop, 100000)
+{
+    base::jobs::Scheduler scheduler;
+
+    auto work = [](size_t i) {
+        auto x = static_cast<double>(i);
+
+        for (size_t k = 0; k < 256; k++)
+            x = x * 0.999 + 1.0;
+
+        return x;
+    };
+
+    std::vector<double> serial(count);
+    std::vector<double> parallel(count);
+
+    auto loop = base::bench::ns([&] {
+        for (size_t i = 0; i < count; i++)
+            serial[i] = work(i);
+    }) / count;
+
+    auto parallel_loop = base::bench::ns([&] {
+        scheduler.parallel_for(0, count, [&](size_t i) {
+            parallel[i] = work(i);
+        });
+    }) / count;
+
+    std::printf(
+        "%zu threads: %.1f ns per index, loop %.1f ns, %.2fx\n",
+        scheduler.num_threads(),
+        parallel_loop,
+        loop,
+        loop / parallel_loop
+    );
+}
@@ -0,0 +1,48 @@
+#include "bench.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace base::bench {
+    namespace {
+        struct Benchmark {
+            const char* name;
+            void (*fn)(size_t);
+            size_t count;
+        };
+
+        // a function-local static, benchmarks register themselves before main runs.
+        std::vector<Benchmark>& benchmarks()
+        {
+            static std::vector<Benchmark> benchmarks;
+            return benchmarks;
+        }
+    }
+
+    bool add(const char* name, void (*fn)(size_t), size_t count)
+    {
+        benchmarks().push_back(Benchmark { name, fn, count });
+        return true;
+    }
+}
+
+// runs every benchmark, or those whose name contains the first argument, with their own count
+// or the second argument.
+int main(int argc, char* argv[])
+{
+    using namespace base::bench;
+
+    size_t count = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 0;
+
+    for (auto& benchmark : benchmarks()) {
+        if (argc > 1 && !std::strstr(benchmark.name, argv[1]))
+            continue;
+
+        std::printf("%s\n", benchmark.name);
+        benchmark.fn(count ? count : benchmark.count);
+    }
+
+    return 0;
+}
@@ -0,0 +1,70 @@
+#include "bench.h"
+
+#include "trace.h"
+
+#include <cstdio>
+#include <sstream>
+
+// Times 'count' zones while tracing is started, stopped and compiled out against the loop
+// they're in, then exporting the zones recorded.
+TS_BENCHMARK(trace_zones, 1000000)
+{
+    // the loop of each zone, kept by the volatile.
+    volatile size_t sink = 0;
+
+    auto ns_per_zone = [&](auto&& fn) {
+        return base::bench::ns([&] {
+            for (size_t i = 0; i < count; i++)
+                fn(i);
+        }) / count;
+    };
+
+    auto loop = ns_per_zone([&](size_t i) { sink = sink + i; });
+
+    base::trace::stop();
+
+    auto stopped = ns_per_zone([&](size_t i) {
+        base::trace::Zone zone("bench");
+        sink = sink + i;
+    });
+
+    base::trace::start();
+
+    auto recording = ns_per_zone([&](size_t i) {
+        base::trace::Zone zone("bench");
+        sink = sink + i;
+    });
+
+    auto macro = ns_per_zone([&](size_t i) {
+        TS_TRACE_ZONE("bench macro");
+        sink = sink + i;
+    });
+
+    base::trace::stop();
+
+    std::ostringstream json;
+
+    auto exported = base::bench::ns([&] { base::trace::write_chrome_json(json); });
+
+#if defined(TS_TRACE)
+    constexpr const char* kMacro = "compiled in";
+#else
+    constexpr const char* kMacro = "compiled out";
+#endif
+
+    std::printf(
+        "zone: %.1f ns recording, %.1f ns stopped, %.1f ns TS_TRACE_ZONE %s, over a %.1f ns loop\n",
+        recording - loop,
+        stopped - loop,
+        macro - loop,
+        kMacro,
+        loop
+    );
+
+    std::printf(
+        "exported %zu zones in %.1f ms, %zu bytes\n",
+        base::trace::snapshot().size(),
+        exported / 1e6,
+        json.str().size()
+    );
+}
@@ -0,0 +1,507 @@
+#pragma once
+
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TS_HASH_MAP_SSE2 1
+#endif
+
+namespace base {
+    // Hashes with their bits mixed, the map takes the low bits of a hash for the position of a
+    // key and the high ones for its control byte, so both must vary. Strings hash the same as
+    // their views so maps keyed by strings are looked up with views.
+    template<typename T>
+    struct Hash {
+        size_t operator()(const T& value) const
+        {
+            return mix(std::hash<T>()(value));
+        }
+
+        static size_t mix(uint64_t h)
+        {
+            h ^= h >> 32;
+            h *= 0x9e3779b97f4a7c15ull;
+            h ^= h >> 29;
+
+            return static_cast<size_t>(h);
+        }
+    };
+
+    template<>
+    struct Hash<std::string_view> {
+        using is_transparent = void;
+
+        size_t operator()(std::string_view value) const
+        {
+            return Hash<size_t>::mix(std::hash<std::string_view>()(value));
+        }
+    };
+
+    template<>
+    struct Hash<std::string> : Hash<std::string_view> {
+    };
+
+    namespace hash_map_detail {
+        // state of a slot, a full one holds the 7 high bits of the hash of its key.
+        enum Ctrl : int8_t {
+            kEmpty = -128,
+            kDeleted = -2
+        };
+
+#if defined(TS_HASH_MAP_SSE2)
+        // 16 control bytes compared at once.
+        struct Group {
+            static constexpr size_t kWidth = 16;
+
+            explicit Group(const int8_t* ctrl)
+                : m_ctrl { _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl)) }
+            {
+            }
+
+            // a bit for each slot holding 'h2'.
+            uint32_t match(int8_t h2) const
+            {
+                return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), m_ctrl));
+            }
+
+            uint32_t match_empty() const
+            {
+                return match(kEmpty);
+            }
+
+            // empty and deleted slots are the only ones with their sign bit set.
+            uint32_t match_free() const
+            {
+                return _mm_movemask_epi8(m_ctrl);
+            }
+        private:
+            __m128i m_ctrl;
+        };
+#else
+        // 8 control bytes compared at once in a 64-bit word.
+        struct Group {
+            static constexpr size_t kWidth = 8;
+
+            explicit Group(const int8_t* ctrl)
+            {
+                std::memcpy(&m_ctrl, ctrl, sizeof(m_ctrl));
+            }
+
+            uint32_t match(int8_t h2) const
+            {
+                constexpr uint64_t kLsbs = 0x0101010101010101ull;
+                constexpr uint64_t kMsbs = 0x8080808080808080ull;
+
+                auto x = m_ctrl ^ (kLsbs * static_cast<uint8_t>(h2));
+
+                // may report a false match past a true one, which comparing the keys rejects.
+                return compress((x - kLsbs) & ~x & kMsbs);
+            }
+
+            // empty slots have their sign bit set and the next one clear, unlike deleted ones,
+            // which 'match' might not tell apart.
+            uint32_t match_empty() const
+            {
+                return compress(m_ctrl & (~m_ctrl << 6) & 0x8080808080808080ull);
+            }
+
+            uint32_t match_free() const
+            {
+                return compress(m_ctrl & 0x8080808080808080ull);
+            }
+        private:
+            // a bit for each byte from the high bit of the bytes of 'bits'.
+            static uint32_t compress(uint64_t bits)
+            {
+                uint32_t mask = 0;
+
+                for (; bits; bits &= bits - 1)
+                    mask |= 1u << (std::countr_zero(bits) / 8);
+
+                return mask;
+            }
+
+            uint64_t m_ctrl;
+        };
+#endif
+    }
+
+    // Open addressing hash map after Abseil's SwissTable. A control byte per slot tells whether
+    // it's empty, deleted or holds a key, with 7 bits of its hash, and a group of control bytes
+    // is compared at once so most lookups touch the keys of the slots that likely match only.
+    //
+    // Elements are held in one array, they move when the map grows and keys must not be
+    // modified through iterators. Erased slots are marked deleted until the map is rehashed.
+    template<typename K, typename V, typename H = Hash<K>, typename Eq = std::equal_to<>>
+    class HashMap {
+        using Ctrl = hash_map_detail::Ctrl;
+        using Group = hash_map_detail::Group;
+    public:
+        using key_type = K;
+        using mapped_type = V;
+        using value_type = std::pair<K, V>;
+
+        template<bool Const>
+        class Iterator {
+        public:
+            using value_type = HashMap::value_type;
+            using reference = std::conditional_t<Const, const value_type&, value_type&>;
+            using pointer = std::conditional_t<Const, const value_type*, value_type*>;
+
+            Iterator() = default;
+
+            Iterator(const int8_t* ctrl, pointer slot, pointer end)
+                : m_ctrl { ctrl },
+                  m_slot { slot },
+                  m_end { end }
+            {
+                skip();
+            }
+
+            operator Iterator<true>() const requires (!Const)
+            {
+                return Iterator<true>(m_ctrl, m_slot, m_end);
+            }
+
+            reference operator*() const { return *m_slot; }
+            pointer operator->() const { return m_slot; }
+
+            Iterator& operator++()
+            {
+                m_ctrl++;
+                m_slot++;
+                skip();
+
+                return *this;
+            }
+
+            bool operator==(const Iterator& rhs) const
+            {
+                return m_slot == rhs.m_slot;
+            }
+        private:
+            friend class HashMap;
+
+            void skip()
+            {
+                while (m_slot != m_end && *m_ctrl < 0) {
+                    m_ctrl++;
+                    m_slot++;
+                }
+            }
+
+            const int8_t* m_ctrl = nullptr;
+            pointer m_slot = nullptr;
+            pointer m_end = nullptr;
+        };
+
+        using iterator = Iterator<false>;
+        using const_iterator = Iterator<true>;
+
+        HashMap() = default;
+
+        HashMap(const HashMap&) = delete;
+
+        HashMap(HashMap&& rhs) noexcept
+        {
+            swap(rhs);
+        }
+
+        ~HashMap()
+        {
+            destroy();
+        }
+
+        HashMap& operator=(const HashMap&) = delete;
+
+        HashMap& operator=(HashMap&& rhs) noexcept
+        {
+            if (&rhs != this) {
+                destroy();
+                swap(rhs);
+            }
+
+            return *this;
+        }
+
+        iterator begin() { return iterator(m_ctrl, m_slots, m_slots + m_capacity); }
+        iterator end() { return iterator(nullptr, m_slots + m_capacity, m_slots + m_capacity); }
+        const_iterator begin() const { return const_iterator(m_ctrl, m_slots, m_slots + m_capacity); }
+        const_iterator end() const { return const_iterator(nullptr, m_slots + m_capacity, m_slots + m_capacity); }
+
+        size_t size() const { return m_size; }
+        bool empty() const { return m_size == 0; }
+        size_t capacity() const { return m_capacity; }
+
+        template<typename Q>
+        iterator find(const Q& key)
+        {
+            auto index = find_index(key);
+
+            return index == kNone ? end() : at(index);
+        }
+
+        template<typename Q>
+        const_iterator find(const Q& key) const
+        {
+            return const_cast<HashMap*>(this)->find(key);
+        }
+
+        template<typename Q>
+        bool contains(const Q& key) const
+        {
+            return find_index(key) != kNone;
+        }
+
+        // constructs the value from 'args' only when 'key' isn't in the map yet.
+        template<typename Q, typename... Args>
+        std::pair<iterator, bool> try_emplace(Q&& key, Args&&... args)
+        {
+            auto hash = H()(key);
+            auto index = find_index(key, hash);
+
+            if (index != kNone)
+                return { at(index), false };
+
+            index = prepare_insert(hash);
+
+            std::construct_at(
+                m_slots + index,
+                std::piecewise_construct,
+                std::forward_as_tuple(std::forward<Q>(key)),
+                std::forward_as_tuple(std::forward<Args>(args)...)
+            );
+
+            return { at(index), true };
+        }
+
+        template<typename Q>
+        V& operator[](Q&& key)
+        {
+            return try_emplace(std::forward<Q>(key)).first->second;
+        }
+
+        template<typename Q>
+        size_t erase(const Q& key)
+        {
+            auto index = find_index(key);
+
+            if (index == kNone) return 0;
+
+            erase_index(index);
+            return 1;
+        }
+
+        void erase(iterator it)
+        {
+            erase_index(it.m_slot - m_slots);
+        }
+
+        void erase(const_iterator it)
+        {
+            erase_index(it.m_slot - m_slots);
+        }
+
+        void clear()
+        {
+            for (size_t i = 0; i < m_capacity; i++)
+                if (m_ctrl[i] >= 0)
+                    std::destroy_at(m_slots + i);
+
+            if (m_capacity)
+                reset_ctrl();
+
+            m_size = 0;
+        }
+
+        // makes room for 'count' elements without growing again.
+        void reserve(size_t count)
+        {
+            if (count > max_load(m_capacity))
+                rehash(capacity_for(count));
+        }
+    private:
+        static constexpr size_t kNone = ~size_t(0);
+
+        // slots filled up to 7/8 of the capacity, groups keep finding a free slot early.
+        static size_t max_load(size_t capacity)
+        {
+            return capacity - capacity / 8;
+        }
+
+        static size_t capacity_for(size_t count)
+        {
+            size_t capacity = Group::kWidth;
+
+            while (max_load(capacity) < count)
+                capacity *= 2;
+
+            return capacity;
+        }
+
+        static size_t h1(size_t hash) { return hash; }
+        static int8_t h2(size_t hash) { return static_cast<int8_t>(hash >> (sizeof(size_t) * 8 - 7)); }
+
+        iterator at(size_t index)
+        {
+            return iterator(m_ctrl + index, m_slots + index, m_slots + m_capacity);
+        }
+
+        template<typename Q>
+        size_t find_index(const Q& key) const
+        {
+            return find_index(key, H()(key));
+        }
+
+        // probes groups at triangular offsets, which visit each group once as the capacity is
+        // a power of two, until one with an empty slot.
+        template<typename Q>
+        size_t find_index(const Q& key, size_t hash) const
+        {
+            if (!m_capacity) return kNone;
+
+            auto mask = m_capacity - 1;
+            auto offset = h1(hash) & mask;
+
+            for (size_t step = Group::kWidth; ; step += Group::kWidth) {
+                Group group(m_ctrl + offset);
+
+                for (auto bits = group.match(h2(hash)); bits; bits &= bits - 1) {
+                    auto index = (offset + std::countr_zero(bits)) & mask;
+
+                    if (Eq()(m_slots[index].first, key))
+                        return index;
+                }
+
+                if (group.match_empty())
+                    return kNone;
+
+                offset = (offset + step) & mask;
+            }
+        }
+
+        // index of the free slot taking a new key of hash 'hash', growing the map if needed.
+        size_t prepare_insert(size_t hash)
+        {
+            if (m_growth_left == 0)
+                // many deleted slots are reused by rehashing in place rather than growing.
+                rehash(m_size + 1 <= max_load(m_capacity) / 2 ? std::max(m_capacity, Group::kWidth) : capacity_for(m_size + 1));
+
+            auto index = find_free(hash);
+
+            if (m_ctrl[index] == Ctrl::kEmpty)
+                m_growth_left--;
+
+            set_ctrl(index, h2(hash));
+            m_size++;
+
+            return index;
+        }
+
+        size_t find_free(size_t hash) const
+        {
+            auto mask = m_capacity - 1;
+            auto offset = h1(hash) & mask;
+
+            for (size_t step = Group::kWidth; ; step += Group::kWidth) {
+                if (auto bits = Group(m_ctrl + offset).match_free())
+                    return (offset + std::countr_zero(bits)) & mask;
+
+                offset = (offset + step) & mask;
+            }
+        }
+
+        void erase_index(size_t index)
+        {
+            std::destroy_at(m_slots + index);
+            set_ctrl(index, Ctrl::kDeleted);
+            m_size--;
+        }
+
+        // the first group is mirrored past the last slot, so a group may be read from any slot.
+        void set_ctrl(size_t index, int8_t value)
+        {
+            m_ctrl[index] = value;
+
+            if (index < Group::kWidth)
+                m_ctrl[m_capacity + index] = value;
+        }
+
+        void reset_ctrl()
+        {
+            std::memset(m_ctrl, Ctrl::kEmpty, m_capacity + Group::kWidth);
+            m_growth_left = max_load(m_capacity);
+        }
+
+        void rehash(size_t capacity)
+        {
+            auto old_ctrl = m_ctrl;
+            auto old_slots = m_slots;
+            auto old_capacity = m_capacity;
+
+            m_capacity = capacity;
+            m_ctrl = new int8_t[capacity + Group::kWidth];
+            m_slots = std::allocator<value_type>().allocate(capacity);
+            reset_ctrl();
+
+            for (size_t i = 0; i < old_capacity; i++) {
+                if (old_ctrl[i] < 0) continue;
+
+                auto hash = H()(old_slots[i].first);
+                auto index = find_free(hash);
+
+                set_ctrl(index, h2(hash));
+                m_growth_left--;
+
+                std::construct_at(m_slots + index, std::move(old_slots[i]));
+                std::destroy_at(old_slots + i);
+            }
+
+            if (old_capacity) {
+                delete[] old_ctrl;
+                std::allocator<value_type>().deallocate(old_slots, old_capacity);
+            }
+        }
+
+        void destroy()
+        {
+            if (!m_capacity) return;
+
+            clear();
+
+            delete[] m_ctrl;
+            std::allocator<value_type>().deallocate(m_slots, m_capacity);
+
+            m_ctrl = nullptr;
+            m_slots = nullptr;
+            m_capacity = 0;
+            m_growth_left = 0;
+        }
+
+        void swap(HashMap& rhs)
+        {
+            std::swap(m_ctrl, rhs.m_ctrl);
+            std::swap(m_slots, rhs.m_slots);
+            std::swap(m_capacity, rhs.m_capacity);
+            std::swap(m_size, rhs.m_size);
+            std::swap(m_growth_left, rhs.m_growth_left);
+        }
+
+        int8_t* m_ctrl = nullptr;
+        value_type* m_slots = nullptr;
+        size_t m_capacity = 0;
+        size_t m_size = 0;
+        size_t m_growth_left = 0;
+    };
+}
\ No newline at end of file
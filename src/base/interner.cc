@@ -0,0 +1,92 @@
+#include "interner.h"
+
+#include <cstring>
+#include <mutex>
+
+namespace base {
+    std::string_view Interner::intern(std::string_view str)
+    {
+        return insert(str).first;
+    }
+
+    uint32_t Interner::id(std::string_view str)
+    {
+        return insert(str).second;
+    }
+
+    std::string_view Interner::str(uint32_t id) const
+    {
+        auto& shard = m_shards[id % kShards];
+        std::shared_lock lock(shard.mutex);
+
+        return shard.strings[id / kShards];
+    }
+
+    size_t Interner::size() const
+    {
+        size_t size = 0;
+
+        for (auto& shard : m_shards) {
+            std::shared_lock lock(shard.mutex);
+            size += shard.strings.size();
+        }
+
+        return size;
+    }
+
+    std::pair<std::string_view, uint32_t> Interner::insert(std::string_view str)
+    {
+        // the low bits of the hash place the string in the map of the shard, the high ones pick
+        // the shard.
+        auto index = static_cast<uint32_t>(Hash<std::string_view>()(str) >> 32) % kShards;
+        auto& shard = m_shards[index];
+
+        {
+            std::shared_lock lock(shard.mutex);
+
+            auto it = shard.ids.find(str);
+
+            if (it != shard.ids.end())
+                return { it->first, it->second };
+        }
+
+        std::unique_lock lock(shard.mutex);
+
+        // another thread may have interned it between the locks.
+        auto it = shard.ids.find(str);
+
+        if (it != shard.ids.end())
+            return { it->first, it->second };
+
+        auto interned = copy(shard, str);
+        auto id = static_cast<uint32_t>(shard.strings.size()) * kShards + index;
+
+        shard.ids.try_emplace(interned, id);
+        shard.strings.push_back(interned);
+
+        return { interned, id };
+    }
+
+    std::string_view Interner::copy(Shard& shard, std::string_view str)
+    {
+        if (str.empty()) return {};
+
+        if (str.size() > kChunkSize / 4) {
+            auto& chunk = shard.chunks.emplace_back(std::make_unique<char[]>(str.size()));
+            std::memcpy(chunk.get(), str.data(), str.size());
+
+            return { chunk.get(), str.size() };
+        }
+
+        if (shard.chunk_used + str.size() > kChunkSize) {
+            shard.chunk = shard.chunks.emplace_back(std::make_unique<char[]>(kChunkSize)).get();
+            shard.chunk_used = 0;
+        }
+
+        auto data = shard.chunk + shard.chunk_used;
+        std::memcpy(data, str.data(), str.size());
+        shard.chunk_used += str.size();
+
+        return { data, str.size() };
+    }
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "hash_map.h"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string_view>
+#include <vector>
+
+namespace base {
+    // Keeps a single copy of each string given to it, as a view which stays valid as long as
+    // the interner, and gives each a small integer id. Interned views of equal strings are the
+    // same, so they compare by their data pointer.
+    //
+    // Safe to use from several threads: strings are spread over shards by their hash, each with
+    // a lock of its own, and strings already interned are found under a shared lock.
+    class Interner {
+    public:
+        Interner() = default;
+
+        Interner(const Interner&) = delete;
+
+        // the interned copy of 'str'.
+        std::string_view intern(std::string_view str);
+
+        // id of 'str', interning it first if needed. Ids are dense within each shard, so they
+        // stay close to the number of strings interned.
+        uint32_t id(std::string_view str);
+
+        // the string of 'id', which was given by 'id'.
+        std::string_view str(uint32_t id) const;
+
+        size_t size() const;
+    private:
+        static constexpr uint32_t kShards = 16;
+
+        // strings are copied into chunks which never move, one longer than a quarter of a chunk
+        // gets one of its own.
+        static constexpr size_t kChunkSize = 16 * 1024;
+
+        struct Shard {
+            mutable std::shared_mutex mutex;
+
+            HashMap<std::string_view, uint32_t> ids;
+            std::vector<std::string_view> strings;
+
+            std::vector<std::unique_ptr<char[]>> chunks;
+            char* chunk = nullptr;
+            size_t chunk_used = kChunkSize;
+        };
+
+        std::pair<std::string_view, uint32_t> insert(std::string_view str);
+
+        static std::string_view copy(Shard& shard, std::string_view str);
+
+        std::array<Shard, kShards> m_shards;
+    };
+}
\ No newline at end of file
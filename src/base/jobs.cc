@@ -0,0 +1,354 @@
+#include "jobs.h"
+#include "trace.h"
+
+#include <functional>
+#include <thread>
+
+namespace base::jobs {
+    namespace {
+        // Chase-Lev deque: its owner pushes and takes at the bottom without locking, thieves
+        // take from the top racing on it with a compare-and-swap. Rings outgrown by the deque
+        // are kept until it goes since thieves may still be reading them.
+        class Deque {
+        public:
+            Deque()
+            {
+                m_ring.store(m_rings.emplace_back(std::make_unique<Ring>(kInitialSize)).get());
+            }
+
+            void push(Job* job)
+            {
+                auto bottom = m_bottom.load(std::memory_order_relaxed);
+                auto top = m_top.load(std::memory_order_acquire);
+                auto ring = m_ring.load(std::memory_order_relaxed);
+
+                if (bottom - top > ring->mask)
+                    ring = grow(ring, top, bottom);
+
+                ring->put(bottom, job);
+
+                std::atomic_thread_fence(std::memory_order_release);
+                m_bottom.store(bottom + 1, std::memory_order_relaxed);
+            }
+
+            Job* take()
+            {
+                auto bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+                auto ring = m_ring.load(std::memory_order_relaxed);
+
+                m_bottom.store(bottom, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+
+                auto top = m_top.load(std::memory_order_relaxed);
+
+                if (top > bottom) {
+                    m_bottom.store(bottom + 1, std::memory_order_relaxed);
+                    return nullptr;
+                }
+
+                auto job = ring->get(bottom);
+
+                // the last job, thieves may be taking it as well.
+                if (top == bottom) {
+                    if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                        job = nullptr;
+
+                    m_bottom.store(bottom + 1, std::memory_order_relaxed);
+                }
+
+                return job;
+            }
+
+            // fails when another thread takes the top job first, even if jobs are left.
+            Job* steal()
+            {
+                auto top = m_top.load(std::memory_order_acquire);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                auto bottom = m_bottom.load(std::memory_order_acquire);
+
+                if (top >= bottom) return nullptr;
+
+                auto job = m_ring.load(std::memory_order_acquire)->get(top);
+
+                if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                    return nullptr;
+
+                return job;
+            }
+
+            bool empty() const
+            {
+                return m_bottom.load(std::memory_order_relaxed) <= m_top.load(std::memory_order_relaxed);
+            }
+        private:
+            static constexpr int64_t kInitialSize = 256;
+
+            struct Ring {
+                explicit Ring(int64_t size)
+                    : mask { size - 1 }
+                    , slots { std::make_unique<std::atomic<Job*>[]>(size) }
+                {
+                }
+
+                Job* get(int64_t index) const
+                {
+                    return slots[index & mask].load(std::memory_order_relaxed);
+                }
+
+                void put(int64_t index, Job* job)
+                {
+                    slots[index & mask].store(job, std::memory_order_relaxed);
+                }
+
+                int64_t mask;
+                std::unique_ptr<std::atomic<Job*>[]> slots;
+            };
+
+            Ring* grow(Ring* ring, int64_t top, int64_t bottom)
+            {
+                auto grown = m_rings.emplace_back(std::make_unique<Ring>(2 * (ring->mask + 1))).get();
+
+                for (auto i = top; i < bottom; i++)
+                    grown->put(i, ring->get(i));
+
+                m_ring.store(grown, std::memory_order_release);
+
+                return grown;
+            }
+
+            // apart so thieves on 'm_top' don't slow the owner down on 'm_bottom'.
+            alignas(64) std::atomic<int64_t> m_top = 0;
+            alignas(64) std::atomic<int64_t> m_bottom = 0;
+            alignas(64) std::atomic<Ring*> m_ring;
+
+            std::vector<std::unique_ptr<Ring>> m_rings;
+        };
+
+        // xorshift, picking the first worker a thread steals from.
+        uint64_t next_random(uint64_t& state)
+        {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+
+            return state;
+        }
+
+        thread_local uint64_t t_random = 0x9e3779b97f4a7c15ull ^ std::hash<std::thread::id>()(std::this_thread::get_id());
+    }
+
+    struct Scheduler::Worker {
+        Scheduler* scheduler;
+        Deque deque;
+        std::thread thread;
+    };
+
+    thread_local Scheduler::Worker* Scheduler::t_worker = nullptr;
+
+    Scheduler::Scheduler(size_t num_threads)
+    {
+        if (num_threads == 0)
+            num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+        for (size_t i = 1; i < num_threads; i++) {
+            auto& worker = m_workers.emplace_back(std::make_unique<Worker>());
+            worker->scheduler = this;
+        }
+
+        // started once all are there, since they steal from each other.
+        for (auto& worker : m_workers)
+            worker->thread = std::thread([this, self = worker.get()] { work(self); });
+    }
+
+    Scheduler::~Scheduler()
+    {
+        {
+            std::lock_guard lock(m_sleep_mutex);
+            m_stop.store(true);
+        }
+
+        m_sleep.notify_all();
+
+        for (auto& worker : m_workers)
+            worker->thread.join();
+
+        for (auto& worker : m_workers)
+            while (auto job = worker->deque.take())
+                delete job;
+
+        for (auto job : m_injected)
+            delete job;
+    }
+
+    void Scheduler::wait(Counter& counter)
+    {
+        auto self = current();
+        size_t idle = 0;
+
+        while (!counter.done()) {
+            if (auto job = find(self)) {
+                execute(job);
+                idle = 0;
+            } else if (++idle > 64) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    void Scheduler::push(Job* job)
+    {
+        if (auto self = current()) {
+            self->deque.push(job);
+        } else {
+            std::lock_guard lock(m_injected_mutex);
+
+            m_injected.push_back(job);
+            m_injected_size.fetch_add(1, std::memory_order_release);
+        }
+
+        wake();
+    }
+
+    void Scheduler::depend(Counter& dependency, Job* job)
+    {
+        {
+            std::lock_guard lock(dependency.m_mutex);
+
+            // the job finishing the dependency takes the continuations under the lock after
+            // getting it to 0, so either it sees this one or this sees 0.
+            if (dependency.m_pending.load(std::memory_order_acquire) != 0) {
+                dependency.m_continuations.push_back(job);
+                return;
+            }
+        }
+
+        push(job);
+    }
+
+    Job* Scheduler::find(Worker* self)
+    {
+        if (self)
+            if (auto job = self->deque.take())
+                return job;
+
+        if (m_injected_size.load(std::memory_order_acquire) > 0) {
+            std::lock_guard lock(m_injected_mutex);
+
+            if (!m_injected.empty()) {
+                auto job = m_injected.front();
+
+                m_injected.pop_front();
+                m_injected_size.fetch_sub(1, std::memory_order_relaxed);
+
+                return job;
+            }
+        }
+
+        if (m_workers.empty()) return nullptr;
+
+        auto first = next_random(t_random) % m_workers.size();
+
+        for (size_t i = 0; i < m_workers.size(); i++) {
+            auto& victim = m_workers[(first + i) % m_workers.size()];
+
+            if (victim.get() == self) continue;
+
+            if (auto job = victim->deque.steal())
+                return job;
+        }
+
+        return nullptr;
+    }
+
+    void Scheduler::execute(Job* job)
+    {
+        (*job)();
+
+        auto counter = job->counter();
+        delete job;
+
+        if (counter)
+            finish(*counter);
+    }
+
+    void Scheduler::finish(Counter& counter)
+    {
+        // seen by waiters along with the decrement, so they don't destroy the counter under us.
+        counter.m_finishing.fetch_add(1, std::memory_order_relaxed);
+
+        std::vector<Job*> continuations;
+
+        if (counter.m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::lock_guard lock(counter.m_mutex);
+            continuations.swap(counter.m_continuations);
+        }
+
+        counter.m_finishing.fetch_sub(1, std::memory_order_release);
+
+        for (auto continuation : continuations)
+            push(continuation);
+    }
+
+    bool Scheduler::has_work() const
+    {
+        if (m_injected_size.load(std::memory_order_relaxed) > 0) return true;
+
+        for (auto& worker : m_workers)
+            if (!worker->deque.empty())
+                return true;
+
+        return false;
+    }
+
+    void Scheduler::wake()
+    {
+        // pairs with the fence of a worker going to sleep: either it sees the job or this sees it
+        // sleeping.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (m_sleepers.load(std::memory_order_relaxed) == 0) return;
+
+        std::lock_guard lock(m_sleep_mutex);
+        m_sleep.notify_one();
+    }
+
+    void Scheduler::work(Worker* self)
+    {
+        t_worker = self;
+
+        TS_TRACE_THREAD_NAME("jobs worker");
+
+        while (!m_stop.load(std::memory_order_acquire)) {
+            Job* job = nullptr;
+
+            // spins a little before sleeping, jobs often come in bursts.
+            for (size_t i = 0; i < 64 && !job; i++) {
+                job = find(self);
+
+                if (!job) std::this_thread::yield();
+            }
+
+            if (job) {
+                execute(job);
+                continue;
+            }
+
+            std::unique_lock lock(m_sleep_mutex);
+
+            m_sleepers.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            if (!has_work() && !m_stop.load(std::memory_order_relaxed))
+                m_sleep.wait(lock);
+
+            m_sleepers.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        t_worker = nullptr;
+    }
+
+    Scheduler::Worker* Scheduler::current() const
+    {
+        return (t_worker && t_worker->scheduler == this) ? t_worker : nullptr;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace base::jobs {
+    class Counter;
+    class Scheduler;
+
+    // A callable queued on a scheduler, with the counter it counts for. Callables up to the
+    // size of six pointers are held in the job itself, larger ones on the heap.
+    class Job {
+    public:
+        template<typename F>
+        Job(F&& fn, Counter* counter)
+            : m_counter { counter }
+        {
+            using Fn = std::decay_t<F>;
+
+            if constexpr (sizeof(Fn) <= sizeof(m_storage) && alignof(Fn) <= alignof(std::max_align_t)) {
+                ::new (m_storage) Fn(std::forward<F>(fn));
+
+                m_invoke = [](Job& job) { (*std::launder(reinterpret_cast<Fn*>(job.m_storage)))(); };
+                m_destroy = [](Job& job) { std::destroy_at(std::launder(reinterpret_cast<Fn*>(job.m_storage))); };
+            } else {
+                ::new (m_storage) Fn*(new Fn(std::forward<F>(fn)));
+
+                m_invoke = [](Job& job) { (**std::launder(reinterpret_cast<Fn**>(job.m_storage)))(); };
+                m_destroy = [](Job& job) { delete *std::launder(reinterpret_cast<Fn**>(job.m_storage)); };
+            }
+        }
+
+        Job(const Job&) = delete;
+
+        ~Job()
+        {
+            m_destroy(*this);
+        }
+
+        void operator()()
+        {
+            m_invoke(*this);
+        }
+
+        Counter* counter() const { return m_counter; }
+    private:
+        void (*m_invoke)(Job&);
+        void (*m_destroy)(Job&);
+        Counter* m_counter;
+        alignas(std::max_align_t) std::byte m_storage[6 * sizeof(void*)];
+    };
+
+    // Jobs left to finish, e.g. to wait on them or to queue jobs depending on them. A counter
+    // may be reused once done, it counts again from the next job queued on it.
+    class Counter {
+    public:
+        Counter() = default;
+
+        Counter(const Counter&) = delete;
+
+        // none of its jobs is left, and none is still finishing with the counter, so it can be
+        // destroyed.
+        bool done() const
+        {
+            return m_pending.load(std::memory_order_acquire) == 0
+                && m_finishing.load(std::memory_order_acquire) == 0;
+        }
+    private:
+        friend class Scheduler;
+
+        std::atomic<size_t> m_pending = 0;
+
+        // jobs between finishing and their last use of the counter.
+        std::atomic<uint32_t> m_finishing = 0;
+
+        // jobs queued once 'm_pending' gets to 0.
+        std::mutex m_mutex;
+        std::vector<Job*> m_continuations;
+    };
+
+    // Runs jobs on a set of threads, each taking the jobs it queues from the back of its own
+    // deque and stealing from the front of the others' once it runs out, so related jobs stay on
+    // one thread and the largest pieces of work are the ones moving. Jobs queued from threads of
+    // other schedulers go to a shared queue.
+    //
+    // Waiting runs queued jobs rather than blocking, so jobs may wait on others without taking a
+    // thread from the scheduler, and dependent work may instead be queued with 'run_after' so no
+    // job waits at all.
+    class Scheduler {
+    public:
+        // 'num_threads' counts the threads waiting on jobs, which run them too, so one less
+        // worker is started: a single thread runs jobs only while they're waited on. 0 uses one
+        // thread per hardware thread.
+        explicit Scheduler(size_t num_threads = 0);
+
+        Scheduler(const Scheduler&) = delete;
+
+        // jobs which were never waited on are dropped without running.
+        ~Scheduler();
+
+        size_t num_threads() const { return m_workers.size() + 1; }
+
+        // queues 'fn', counted by 'counter' if any until it's finished.
+        template<typename F>
+        void run(F&& fn, Counter* counter = nullptr)
+        {
+            if (counter) counter->m_pending.fetch_add(1, std::memory_order_relaxed);
+
+            push(new Job(std::forward<F>(fn), counter));
+        }
+
+        // queues 'fn' once 'dependency' has no jobs left, right away if it has none now.
+        template<typename F>
+        void run_after(Counter& dependency, F&& fn, Counter* counter = nullptr)
+        {
+            if (counter) counter->m_pending.fetch_add(1, std::memory_order_relaxed);
+
+            depend(dependency, new Job(std::forward<F>(fn), counter));
+        }
+
+        // runs jobs until 'counter' is done.
+        void wait(Counter& counter);
+
+        // calls 'fn(i)' for each 'i' in [begin, end) and waits for them. The range is halved until
+        // the halves are at most 'grain' indices, the upper halves being queued for other threads
+        // to steal, so a thread running out of work takes the largest range left. A 'grain' of 0
+        // makes about eight ranges per thread.
+        template<typename F>
+        void parallel_for(size_t begin, size_t end, F&& fn, size_t grain = 0)
+        {
+            if (begin >= end) return;
+
+            if (grain == 0)
+                grain = std::max<size_t>((end - begin) / (8 * num_threads()), 1);
+
+            Counter counter;
+
+            split(begin, end, grain, fn, counter);
+            wait(counter);
+        }
+    private:
+        struct Worker;
+
+        template<typename F>
+        void split(size_t begin, size_t end, size_t grain, F& fn, Counter& counter)
+        {
+            while (end - begin > grain) {
+                auto middle = begin + (end - begin) / 2;
+
+                run([this, middle, end, grain, &fn, &counter] {
+                    split(middle, end, grain, fn, counter);
+                }, &counter);
+
+                end = middle;
+            }
+
+            for (auto i = begin; i < end; i++)
+                fn(i);
+        }
+
+        void push(Job* job);
+
+        void depend(Counter& dependency, Job* job);
+
+        // a queued job, from the deque of 'self' first if it's a worker of this scheduler.
+        Job* find(Worker* self);
+
+        void execute(Job* job);
+
+        void finish(Counter& counter);
+
+        bool has_work() const;
+
+        void wake();
+
+        void work(Worker* self);
+
+        // the worker running on this thread, if it's one of this scheduler.
+        Worker* current() const;
+
+        static thread_local Worker* t_worker;
+
+        std::vector<std::unique_ptr<Worker>> m_workers;
+
+        std::mutex m_injected_mutex;
+        std::deque<Job*> m_injected;
+        std::atomic<size_t> m_injected_size = 0;
+
+        std::mutex m_sleep_mutex;
+        std::condition_variable m_sleep;
+        std::atomic<uint32_t> m_sleepers = 0;
+        std::atomic<bool> m_stop = false;
+    };
+}
\ No newline at end of file
@@ -50,6 +50,13 @@ namespace base {
         return !cmp_less(t, u);
     }
 
+    // rounds 'value' up to the next multiple of 'alignment'.
+    template<class T>
+    constexpr T align_up(T value, T alignment) noexcept
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
     template<class R, class T>
     constexpr bool in_range(T t) noexcept
     {
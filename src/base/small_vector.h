@@ -0,0 +1,315 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace base {
+    // Vector holding its first 'N' elements in itself rather than on the heap, for lists which
+    // are mostly short. Past 'N' elements they're moved to the heap as in a std::vector, moving
+    // a vector steals its heap elements but moves inline ones one by one.
+    template<typename T, size_t N>
+    class SmallVector {
+        static_assert(N > 0, "a SmallVector holds at least one element inline.");
+    public:
+        using value_type = T;
+        using size_type = size_t;
+        using difference_type = std::ptrdiff_t;
+        using reference = T&;
+        using const_reference = const T&;
+        using iterator = T*;
+        using const_iterator = const T*;
+        using reverse_iterator = std::reverse_iterator<iterator>;
+        using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+        SmallVector() = default;
+
+        explicit SmallVector(size_t count)
+        {
+            resize(count);
+        }
+
+        template<typename It>
+        SmallVector(It first, It last)
+        {
+            append(first, last);
+        }
+
+        SmallVector(const SmallVector& rhs) requires std::is_copy_constructible_v<T>
+        {
+            append(rhs.begin(), rhs.end());
+        }
+
+        SmallVector(SmallVector&& rhs) noexcept
+        {
+            take(rhs);
+        }
+
+        ~SmallVector()
+        {
+            clear();
+            deallocate();
+        }
+
+        SmallVector& operator=(const SmallVector& rhs) requires std::is_copy_constructible_v<T>
+        {
+            if (&rhs == this) return *this;
+
+            clear();
+            append(rhs.begin(), rhs.end());
+
+            return *this;
+        }
+
+        SmallVector& operator=(SmallVector&& rhs) noexcept
+        {
+            if (&rhs == this) return *this;
+
+            clear();
+            deallocate();
+            take(rhs);
+
+            return *this;
+        }
+
+        T* data() { return m_data; }
+        const T* data() const { return m_data; }
+
+        iterator begin() { return m_data; }
+        iterator end() { return m_data + m_size; }
+        const_iterator begin() const { return m_data; }
+        const_iterator end() const { return m_data + m_size; }
+
+        reverse_iterator rbegin() { return reverse_iterator(end()); }
+        reverse_iterator rend() { return reverse_iterator(begin()); }
+        const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+        const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+        size_t size() const { return m_size; }
+        size_t capacity() const { return m_capacity; }
+        bool empty() const { return m_size == 0; }
+
+        // the elements are held in the vector itself, not on the heap.
+        bool is_inline() const { return m_data == inline_data(); }
+
+        T& operator[](size_t index)
+        {
+            assert(index < m_size);
+            return m_data[index];
+        }
+
+        const T& operator[](size_t index) const
+        {
+            assert(index < m_size);
+            return m_data[index];
+        }
+
+        T& front() { return (*this)[0]; }
+        const T& front() const { return (*this)[0]; }
+        T& back() { return (*this)[m_size - 1]; }
+        const T& back() const { return (*this)[m_size - 1]; }
+
+        void reserve(size_t capacity)
+        {
+            if (capacity > m_capacity)
+                grow(capacity);
+        }
+
+        void resize(size_t size)
+        {
+            reserve(size);
+
+            if (size < m_size)
+                std::destroy(begin() + size, end());
+            else
+                std::uninitialized_value_construct(end(), begin() + size);
+
+            m_size = static_cast<uint32_t>(size);
+        }
+
+        // 'args' may refer to elements of the vector, e.g. 'v.push_back(v[0])'.
+        template<typename... Args>
+        T& emplace_back(Args&&... args)
+        {
+            if (m_size == m_capacity)
+                return grow_and_emplace_back(std::forward<Args>(args)...);
+
+            auto element = std::construct_at(end(), std::forward<Args>(args)...);
+            m_size++;
+
+            return *element;
+        }
+
+        void push_back(const T& value) requires std::is_copy_constructible_v<T>
+        {
+            emplace_back(value);
+        }
+
+        void push_back(T&& value)
+        {
+            emplace_back(std::move(value));
+        }
+
+        void pop_back()
+        {
+            assert(m_size > 0);
+            std::destroy_at(end() - 1);
+            m_size--;
+        }
+
+        iterator insert(const_iterator pos, T&& value)
+        {
+            auto index = pos - begin();
+
+            emplace_back(std::move(value));
+            std::rotate(begin() + index, end() - 1, end());
+
+            return begin() + index;
+        }
+
+        iterator insert(const_iterator pos, const T& value) requires std::is_copy_constructible_v<T>
+        {
+            auto index = pos - begin();
+
+            emplace_back(value);
+            std::rotate(begin() + index, end() - 1, end());
+
+            return begin() + index;
+        }
+
+        // the range is appended then rotated into place, so it may be made of input iterators,
+        // but not of elements of the vector, which growing it moves.
+        template<typename It>
+        iterator insert(const_iterator pos, It first, It last)
+        {
+            auto index = pos - begin();
+            auto old_size = m_size;
+
+            append(first, last);
+            std::rotate(begin() + index, begin() + old_size, end());
+
+            return begin() + index;
+        }
+
+        iterator erase(const_iterator pos)
+        {
+            return erase(pos, pos + 1);
+        }
+
+        iterator erase(const_iterator first, const_iterator last)
+        {
+            auto from = begin() + (first - begin());
+            auto to = begin() + (last - begin());
+            auto new_end = std::move(to, end(), from);
+
+            std::destroy(new_end, end());
+            m_size = static_cast<uint32_t>(new_end - begin());
+
+            return from;
+        }
+
+        void clear()
+        {
+            std::destroy(begin(), end());
+            m_size = 0;
+        }
+
+        bool operator==(const SmallVector& rhs) const
+        {
+            return std::equal(begin(), end(), rhs.begin(), rhs.end());
+        }
+    private:
+        T* inline_data()
+        {
+            return reinterpret_cast<T*>(m_inline);
+        }
+
+        const T* inline_data() const
+        {
+            return reinterpret_cast<const T*>(m_inline);
+        }
+
+        template<typename It>
+        void append(It first, It last)
+        {
+            if constexpr (std::is_base_of_v<std::forward_iterator_tag, typename std::iterator_traits<It>::iterator_category>)
+                reserve(m_size + std::distance(first, last));
+
+            for (; first != last; ++first)
+                emplace_back(*first);
+        }
+
+        // moves the elements to the heap with room for at least 'capacity' of them.
+        void grow(size_t capacity)
+        {
+            capacity = std::max<size_t>(capacity, 2 * m_capacity);
+
+            relocate(std::allocator<T>().allocate(capacity), capacity);
+        }
+
+        // the new element is constructed before the elements are moved out of the old buffer,
+        // which 'args' may point into.
+        template<typename... Args>
+        T& grow_and_emplace_back(Args&&... args)
+        {
+            auto capacity = std::max<size_t>(m_size + 1, 2 * m_capacity);
+            auto data = std::allocator<T>().allocate(capacity);
+            auto element = std::construct_at(data + m_size, std::forward<Args>(args)...);
+
+            relocate(data, capacity);
+            m_size++;
+
+            return *element;
+        }
+
+        // moves the elements to 'data', which has room for 'capacity' of them, and frees the
+        // old ones.
+        void relocate(T* data, size_t capacity)
+        {
+            std::uninitialized_move(begin(), end(), data);
+            std::destroy(begin(), end());
+            deallocate();
+
+            m_data = data;
+            m_capacity = static_cast<uint32_t>(capacity);
+        }
+
+        void deallocate()
+        {
+            if (!is_inline())
+                std::allocator<T>().deallocate(m_data, m_capacity);
+
+            m_data = inline_data();
+            m_capacity = N;
+        }
+
+        // takes the elements of 'rhs', which is left empty and inline.
+        void take(SmallVector& rhs)
+        {
+            if (rhs.is_inline()) {
+                std::uninitialized_move(rhs.begin(), rhs.end(), begin());
+                m_size = rhs.m_size;
+                rhs.clear();
+                return;
+            }
+
+            m_data = rhs.m_data;
+            m_size = rhs.m_size;
+            m_capacity = rhs.m_capacity;
+
+            rhs.m_data = rhs.inline_data();
+            rhs.m_size = 0;
+            rhs.m_capacity = N;
+        }
+
+        T* m_data = inline_data();
+        uint32_t m_size = 0;
+        uint32_t m_capacity = N;
+        alignas(T) std::byte m_inline[N * sizeof(T)];
+    };
+}
\ No newline at end of file
@@ -0,0 +1,178 @@
+#include "test.h"
+
+#include "hash_map.h"
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace {
+    // every key in the same group, so lookups go through the probing and the key comparisons.
+    struct Colliding {
+        size_t operator()(uint64_t) const { return 42; }
+    };
+
+    template<typename Map>
+    bool same(Map& map, const std::unordered_map<uint64_t, uint64_t>& expected)
+    {
+        size_t iterated = 0;
+
+        for (auto& [key, value] : map) {
+            auto it = expected.find(key);
+
+            if (it == expected.end() || it->second != value)
+                return false;
+
+            iterated++;
+        }
+
+        return iterated == expected.size() && map.size() == expected.size();
+    }
+}
+
+TS_TEST(hash_map_matches_unordered_map_after_random_inserts_and_erases)
+{
+    std::mt19937_64 random { 1 };
+
+    base::HashMap<uint64_t, uint64_t> map;
+    std::unordered_map<uint64_t, uint64_t> expected;
+
+    constexpr size_t kKeys = 10000;
+
+    for (size_t i = 0; i < 4 * kKeys; i++) {
+        auto key = random() % kKeys;
+
+        if (random() % 3 == 0) {
+            TS_CHECK(map.erase(key) == expected.erase(key));
+        } else {
+            map[key] = i;
+            expected[key] = i;
+        }
+    }
+
+    TS_CHECK(same(map, expected));
+
+    for (uint64_t key = 0; key < kKeys; key++)
+        TS_CHECK(map.contains(key) == expected.contains(key));
+}
+
+TS_TEST(hash_map_with_colliding_hashes)
+{
+    base::HashMap<uint64_t, uint64_t, Colliding> map;
+    std::unordered_map<uint64_t, uint64_t> expected;
+
+    for (uint64_t key = 0; key < 200; key++) {
+        map[key] = key * 2;
+        expected[key] = key * 2;
+    }
+
+    for (uint64_t key = 0; key < 200; key += 3) {
+        map.erase(key);
+        expected.erase(key);
+    }
+
+    TS_CHECK(same(map, expected));
+    TS_CHECK(map.find(3) == map.end());
+    TS_CHECK(map.find(4)->second == 8);
+}
+
+TS_TEST(hash_map_finds_string_keys_by_view)
+{
+    base::HashMap<std::string, int> map;
+
+    map["position"] = 1;
+    map[std::string_view("normal")] = 2;
+
+    std::string_view key = "position";
+
+    TS_CHECK(map.find(key) != map.end() && map.find(key)->second == 1);
+    TS_CHECK(map.find(std::string_view("normal"))->second == 2);
+    TS_CHECK(!map.contains(std::string_view("uv")));
+}
+
+TS_TEST(hash_map_try_emplace_keeps_the_existing_value)
+{
+    base::HashMap<int, std::unique_ptr<int>> map;
+
+    auto [first, inserted] = map.try_emplace(1, std::make_unique<int>(10));
+
+    TS_CHECK(inserted && *first->second == 10);
+
+    auto [again, inserted_again] = map.try_emplace(1, std::make_unique<int>(20));
+
+    TS_CHECK(!inserted_again && *again->second == 10);
+    TS_CHECK(map.size() == 1);
+}
+
+TS_TEST(hash_map_erase_by_iterator_and_clear)
+{
+    base::HashMap<int, int> map;
+
+    for (int i = 0; i < 100; i++)
+        map[i] = i;
+
+    for (auto it = map.begin(); it != map.end(); ++it)
+        if (it->first % 2)
+            map.erase(it);
+
+    TS_CHECK(map.size() == 50);
+    TS_CHECK(!map.contains(1) && map.contains(2));
+
+    auto capacity = map.capacity();
+    map.clear();
+
+    TS_CHECK(map.empty() && map.begin() == map.end());
+    TS_CHECK(map.capacity() == capacity);
+
+    map[7] = 7;
+
+    TS_CHECK(map.size() == 1 && map.find(7)->second == 7);
+}
+
+TS_TEST(hash_map_reserve_and_erased_slots_dont_grow_it)
+{
+    base::HashMap<int, int> map;
+
+    map.reserve(1000);
+
+    auto capacity = map.capacity();
+
+    for (int i = 0; i < 1000; i++)
+        map[i] = i;
+
+    TS_CHECK(map.capacity() == capacity);
+
+    // erased slots are reused by rehashing in place rather than growing.
+    for (int i = 1000; i < 100000; i++) {
+        map.erase(i - 1000);
+        map[i] = i;
+    }
+
+    TS_CHECK(map.capacity() == capacity);
+    TS_CHECK(map.size() == 1000);
+    TS_CHECK(map.contains(99999) && !map.contains(98999));
+}
+
+TS_TEST(hash_map_move_leaves_the_source_empty)
+{
+    base::HashMap<std::string, int> map;
+
+    for (int i = 0; i < 20; i++)
+        map[std::to_string(i)] = i;
+
+    base::HashMap<std::string, int> moved(std::move(map));
+
+    TS_CHECK(map.empty() && map.begin() == map.end() && !map.contains(std::string_view("1")));
+    TS_CHECK(moved.size() == 20 && moved.find(std::string_view("19"))->second == 19);
+
+    map = std::move(moved);
+
+    TS_CHECK(map.size() == 20 && moved.empty());
+
+    map[std::string_view("20")] = 20;
+
+    TS_CHECK(map.size() == 21);
+}
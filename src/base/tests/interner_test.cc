@@ -0,0 +1,89 @@
+#include "test.h"
+
+#include "interner.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+TS_TEST(interner_keeps_one_copy_of_each_string)
+{
+    base::Interner interner;
+
+    std::string position = "position";
+
+    auto first = interner.intern(position);
+    auto second = interner.intern(std::string("position"));
+
+    TS_CHECK(first == "position");
+    TS_CHECK(first.data() == second.data());
+    TS_CHECK(first.data() != position.data());
+    TS_CHECK(interner.intern("normal").data() != first.data());
+    TS_CHECK(interner.size() == 2);
+
+    TS_CHECK(interner.intern("").empty());
+    TS_CHECK(interner.size() == 3);
+}
+
+TS_TEST(interner_ids_give_back_their_strings)
+{
+    base::Interner interner;
+
+    std::vector<uint32_t> ids;
+
+    for (int i = 0; i < 1000; i++)
+        ids.push_back(interner.id("name_" + std::to_string(i)));
+
+    for (int i = 0; i < 1000; i++) {
+        TS_CHECK(interner.str(ids[i]) == "name_" + std::to_string(i));
+        TS_CHECK(interner.id("name_" + std::to_string(i)) == ids[i]);
+    }
+
+    TS_CHECK(interner.size() == 1000);
+}
+
+TS_TEST(interner_views_stay_valid_as_it_grows)
+{
+    base::Interner interner;
+
+    // longer than a quarter of a chunk, so it gets one of its own.
+    std::string long_string(8 * 1024, 'x');
+
+    auto short_view = interner.intern("short");
+    auto long_view = interner.intern(long_string);
+
+    for (int i = 0; i < 20000; i++)
+        interner.intern("filler_" + std::to_string(i));
+
+    TS_CHECK(short_view == "short");
+    TS_CHECK(long_view == long_string);
+    TS_CHECK(interner.intern(long_string).data() == long_view.data());
+}
+
+TS_TEST(interner_gives_one_id_to_names_interned_from_several_threads)
+{
+    base::Interner interner;
+
+    std::vector<std::string> strings;
+
+    for (int i = 0; i < 5000; i++)
+        strings.push_back("identifier_" + std::to_string(i % 3000));
+
+    std::vector<std::vector<uint32_t>> ids(4);
+    std::vector<std::thread> threads;
+
+    for (auto& thread_ids : ids)
+        threads.emplace_back([&] {
+            for (auto& string : strings)
+                thread_ids.push_back(interner.id(string));
+        });
+
+    for (auto& thread : threads)
+        thread.join();
+
+    for (size_t i = 0; i < strings.size(); i++)
+        for (auto& thread_ids : ids)
+            TS_CHECK(thread_ids[i] == ids[0][i] && interner.str(ids[0][i]) == strings[i]);
+
+    TS_CHECK(interner.size() == 3000);
+}
@@ -0,0 +1,208 @@
+#include "test.h"
+
+#include "jobs.h"
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+TS_TEST(jobs_parallel_for_runs_each_index_once)
+{
+    for (size_t num_threads : { 1, 4 }) {
+        base::jobs::Scheduler scheduler(num_threads);
+
+        for (size_t grain : { 0, 1, 1000 }) {
+            std::vector<std::atomic<uint32_t>> visits(10000);
+
+            scheduler.parallel_for(0, visits.size(), [&](size_t i) {
+                visits[i].fetch_add(1, std::memory_order_relaxed);
+            }, grain);
+
+            bool once = true;
+
+            for (auto& visit : visits)
+                once = once && visit.load() == 1;
+
+            TS_CHECK(once);
+        }
+
+        bool ran = false;
+        scheduler.parallel_for(5, 5, [&](size_t) { ran = true; });
+
+        TS_CHECK(!ran);
+    }
+}
+
+TS_TEST(jobs_parallel_for_computes_the_same_values_as_a_loop)
+{
+    base::jobs::Scheduler scheduler(4);
+
+    auto work = [](size_t i) {
+        auto x = static_cast<double>(i);
+
+        for (size_t k = 0; k < 64; k++)
+            x = x * 0.999 + 1.0;
+
+        return x;
+    };
+
+    std::vector<double> serial(5000);
+    std::vector<double> parallel(serial.size());
+
+    for (size_t i = 0; i < serial.size(); i++)
+        serial[i] = work(i);
+
+    scheduler.parallel_for(0, parallel.size(), [&](size_t i) {
+        parallel[i] = work(i);
+    });
+
+    TS_CHECK(serial == parallel);
+}
+
+TS_TEST(jobs_run_after_the_jobs_they_depend_on)
+{
+    base::jobs::Scheduler scheduler(4);
+
+    // two jobs depending on the same ones, and one more on both of them.
+    base::jobs::Counter produced;
+    base::jobs::Counter summed;
+    base::jobs::Counter checked;
+
+    std::atomic<size_t> sum = 0;
+    std::array<size_t, 2> sums {};
+
+    for (size_t i = 0; i < 64; i++)
+        scheduler.run([&sum, i] { sum += i; }, &produced);
+
+    for (auto& s : sums)
+        scheduler.run_after(produced, [&sum, &s] { s = sum.load(); }, &summed);
+
+    bool ordered = false;
+
+    scheduler.run_after(summed, [&] { ordered = sums[0] == 64 * 63 / 2 && sums[1] == sums[0]; }, &checked);
+    scheduler.wait(checked);
+
+    TS_CHECK(ordered);
+    TS_CHECK(produced.done() && summed.done() && checked.done());
+}
+
+TS_TEST(jobs_run_after_a_done_counter_runs_right_away)
+{
+    base::jobs::Scheduler scheduler(2);
+
+    base::jobs::Counter none;
+    base::jobs::Counter counter;
+
+    bool ran = false;
+
+    scheduler.run_after(none, [&] { ran = true; }, &counter);
+    scheduler.wait(counter);
+
+    TS_CHECK(ran);
+}
+
+TS_TEST(jobs_wait_on_the_jobs_they_queue)
+{
+    // far more jobs waiting than threads, on one thread only waiting runs them.
+    for (size_t num_threads : { 1, 4 }) {
+        base::jobs::Scheduler scheduler(num_threads);
+
+        std::function<size_t(size_t)> fib = [&](size_t n) -> size_t {
+            if (n < 2) return n;
+
+            size_t first = 0;
+            base::jobs::Counter counter;
+
+            scheduler.run([&] { first = fib(n - 1); }, &counter);
+
+            auto second = fib(n - 2);
+            scheduler.wait(counter);
+
+            return first + second;
+        };
+
+        TS_CHECK(fib(18) == 2584);
+    }
+}
+
+TS_TEST(jobs_counter_is_reused_once_done)
+{
+    base::jobs::Scheduler scheduler(4);
+    base::jobs::Counter counter;
+
+    std::atomic<int> runs = 0;
+
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < 100; i++)
+            scheduler.run([&] { runs++; }, &counter);
+
+        scheduler.wait(counter);
+
+        TS_CHECK(counter.done());
+        TS_CHECK(runs.load() == 100 * (round + 1));
+    }
+}
+
+TS_TEST(jobs_hold_large_callables_on_the_heap)
+{
+    base::jobs::Scheduler scheduler(2);
+    base::jobs::Counter counter;
+
+    auto owned = std::make_shared<int>(0);
+    std::array<size_t, 16> values {};
+    size_t sum = 0;
+
+    for (size_t i = 0; i < values.size(); i++)
+        values[i] = i;
+
+    scheduler.run([owned, values, &sum] {
+        for (auto value : values)
+            sum += value;
+    }, &counter);
+
+    scheduler.wait(counter);
+
+    TS_CHECK(sum == 16 * 15 / 2);
+    TS_CHECK(owned.use_count() == 1);
+}
+
+TS_TEST(jobs_queued_from_other_threads)
+{
+    base::jobs::Scheduler scheduler(2);
+    base::jobs::Counter counter;
+
+    std::atomic<int> runs = 0;
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < 4; t++)
+        threads.emplace_back([&] {
+            for (int i = 0; i < 100; i++)
+                scheduler.run([&] { runs++; }, &counter);
+        });
+
+    for (auto& thread : threads)
+        thread.join();
+
+    scheduler.wait(counter);
+
+    TS_CHECK(runs.load() == 400);
+}
+
+TS_TEST(jobs_never_waited_on_are_dropped)
+{
+    auto owned = std::make_shared<int>(0);
+    bool ran = false;
+
+    {
+        // no worker thread, jobs only run while they're waited on.
+        base::jobs::Scheduler scheduler(1);
+
+        scheduler.run([owned, &ran] { ran = true; });
+    }
+
+    TS_CHECK(!ran);
+    TS_CHECK(owned.use_count() == 1);
+}
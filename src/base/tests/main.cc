@@ -0,0 +1,63 @@
+#include "test.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace base::test {
+    namespace {
+        struct Test {
+            const char* name;
+            void (*fn)();
+        };
+
+        // a function-local static, tests register themselves before main runs.
+        std::vector<Test>& tests()
+        {
+            static std::vector<Test> tests;
+            return tests;
+        }
+
+        size_t g_failures = 0;
+    }
+
+    bool add(const char* name, void (*fn)())
+    {
+        tests().push_back(Test { name, fn });
+        return true;
+    }
+
+    void fail(const char* file, int line, const char* expr)
+    {
+        std::printf("  %s:%d: %s\n", file, line, expr);
+        g_failures++;
+    }
+}
+
+// runs every test, or those whose name contains the first argument.
+int main(int argc, char* argv[])
+{
+    using namespace base::test;
+
+    size_t failed = 0;
+    size_t run = 0;
+
+    for (auto& test : tests()) {
+        if (argc > 1 && !std::strstr(test.name, argv[1]))
+            continue;
+
+        auto failures = g_failures;
+
+        test.fn();
+        run++;
+
+        bool passed = g_failures == failures;
+        failed += !passed;
+
+        std::printf("%s %s\n", passed ? "PASS" : "FAIL", test.name);
+    }
+
+    std::printf("%zu tests, %zu failed\n", run, failed);
+
+    return failed ? 1 : 0;
+}
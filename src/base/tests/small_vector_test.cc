@@ -0,0 +1,183 @@
+#include "test.h"
+
+#include "small_vector.h"
+
+#include <string>
+#include <vector>
+
+namespace {
+    // counts the live instances, to check each element constructed is destroyed once.
+    struct Counted {
+        static inline int live = 0;
+
+        int value;
+
+        Counted(int value = 0) : value { value } { live++; }
+        Counted(const Counted& rhs) : value { rhs.value } { live++; }
+        Counted(Counted&& rhs) noexcept : value { rhs.value } { live++; }
+        ~Counted() { live--; }
+
+        Counted& operator=(const Counted&) = default;
+        Counted& operator=(Counted&&) noexcept = default;
+
+        bool operator==(const Counted&) const = default;
+    };
+
+    // strings long enough to live on the heap, so reading one that was freed shows.
+    std::string name(int i)
+    {
+        return "a name too long for the small string buffer " + std::to_string(i);
+    }
+
+    template<typename T, size_t N>
+    std::vector<T> elements(const base::SmallVector<T, N>& v)
+    {
+        return std::vector<T>(v.begin(), v.end());
+    }
+}
+
+TS_TEST(small_vector_moves_to_the_heap_past_its_inline_elements)
+{
+    base::SmallVector<int, 4> v;
+
+    for (int i = 0; i < 4; i++)
+        v.push_back(i);
+
+    TS_CHECK(v.is_inline());
+    TS_CHECK(v.capacity() == 4);
+
+    v.push_back(4);
+
+    TS_CHECK(!v.is_inline());
+    TS_CHECK(v.capacity() >= 5);
+    TS_CHECK(elements(v) == (std::vector<int> { 0, 1, 2, 3, 4 }));
+    TS_CHECK(v.front() == 0 && v.back() == 4);
+}
+
+TS_TEST(small_vector_push_back_of_its_own_element_when_growing)
+{
+    base::SmallVector<std::string, 2> v;
+
+    v.push_back(name(0));
+    v.push_back(name(1));
+
+    // the inline elements move to the heap.
+    v.push_back(v[0]);
+
+    // the heap elements move to a larger buffer.
+    while (v.size() < v.capacity())
+        v.push_back(name(static_cast<int>(v.size())));
+
+    v.push_back(v[1]);
+
+    TS_CHECK(v[2] == name(0));
+    TS_CHECK(v.back() == name(1));
+    TS_CHECK(v[0] == name(0) && v[1] == name(1));
+}
+
+TS_TEST(small_vector_emplace_back_and_insert_of_their_own_elements_when_growing)
+{
+    base::SmallVector<std::string, 2> v;
+
+    v.push_back(name(0));
+    v.push_back(name(1));
+    v.emplace_back(v.back());
+
+    TS_CHECK(v.size() == 3 && v[2] == name(1));
+
+    while (v.size() < v.capacity())
+        v.push_back(name(static_cast<int>(v.size())));
+
+    v.insert(v.begin(), v.back());
+
+    TS_CHECK(v.front() == v.back());
+    TS_CHECK(v[1] == name(0));
+
+    while (v.size() < v.capacity())
+        v.push_back(name(static_cast<int>(v.size())));
+
+    v.insert(v.begin() + 1, std::move(v[1]));
+
+    TS_CHECK(v[1] == name(0));
+}
+
+TS_TEST(small_vector_insert_and_erase)
+{
+    base::SmallVector<int, 2> v;
+
+    v.insert(v.end(), 3);
+    v.insert(v.begin(), 0);
+
+    std::vector<int> middle { 1, 2 };
+    v.insert(v.begin() + 1, middle.begin(), middle.end());
+
+    TS_CHECK(elements(v) == (std::vector<int> { 0, 1, 2, 3 }));
+
+    auto next = v.erase(v.begin() + 1);
+
+    TS_CHECK(*next == 2);
+    TS_CHECK(elements(v) == (std::vector<int> { 0, 2, 3 }));
+
+    v.erase(v.begin(), v.end() - 1);
+
+    TS_CHECK(elements(v) == (std::vector<int> { 3 }));
+}
+
+TS_TEST(small_vector_destroys_each_element_once)
+{
+    Counted::live = 0;
+
+    {
+        base::SmallVector<Counted, 3> v;
+
+        for (int i = 0; i < 10; i++)
+            v.emplace_back(i);
+
+        TS_CHECK(Counted::live == 10);
+
+        v.resize(4);
+        TS_CHECK(Counted::live == 4);
+
+        v.resize(6);
+        TS_CHECK(Counted::live == 6 && v[5].value == 0);
+
+        v.pop_back();
+        v.erase(v.begin());
+        TS_CHECK(Counted::live == 4);
+
+        auto copy = v;
+        TS_CHECK(Counted::live == 8 && copy == v);
+
+        v.clear();
+        TS_CHECK(Counted::live == 4 && v.empty());
+    }
+
+    TS_CHECK(Counted::live == 0);
+}
+
+TS_TEST(small_vector_move_steals_the_heap_and_moves_inline_elements)
+{
+    base::SmallVector<Counted, 2> heap;
+
+    for (int i = 0; i < 3; i++)
+        heap.emplace_back(i);
+
+    auto data = heap.data();
+    base::SmallVector<Counted, 2> stolen(std::move(heap));
+
+    TS_CHECK(stolen.data() == data);
+    TS_CHECK(heap.empty() && heap.is_inline());
+
+    base::SmallVector<Counted, 2> inline_elements;
+    inline_elements.emplace_back(7);
+
+    base::SmallVector<Counted, 2> moved;
+    moved = std::move(inline_elements);
+
+    TS_CHECK(moved.is_inline() && moved.size() == 1 && moved[0].value == 7);
+    TS_CHECK(inline_elements.empty());
+
+    moved = std::move(stolen);
+
+    TS_CHECK(moved.size() == 3 && moved.data() == data);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+// Unit tests of base, built into the base_tests executable and run by ctest. A test is a
+// function declared with TS_TEST, its TS_CHECKs report the failed expressions and let it go on.
+#define TS_TEST_CONCAT_(a, b) a##b
+#define TS_TEST_CONCAT(a, b) TS_TEST_CONCAT_(a, b)
+
+#define TS_TEST(name)                                                                               \
+    static void name();                                                                             \
+    static const bool TS_TEST_CONCAT(name, _registered) = ::base::test::add(#name, name);           \
+    static void name()
+
+#define TS_CHECK(expr)                                                                              \
+    do {                                                                                            \
+        if (!(expr))                                                                                \
+            ::base::test::fail(__FILE__, __LINE__, #expr);                                          \
+    } while (0)
+
+namespace base::test {
+    // registers a test, always returns true so it can initialize a static.
+    bool add(const char* name, void (*fn)());
+
+    // reports a failed check of the running test.
+    void fail(const char* file, int line, const char* expr);
+}
@@ -0,0 +1,174 @@
+#include "test.h"
+
+#include "trace.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <latch>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace {
+    // the buffers outlive the tests, so each test looks for zones of its own names.
+    std::vector<base::trace::Event> events_named(const char* name)
+    {
+        std::vector<base::trace::Event> events;
+
+        for (auto& event : base::trace::snapshot())
+            if (std::strcmp(event.name, name) == 0)
+                events.push_back(event);
+
+        return events;
+    }
+}
+
+TS_TEST(trace_records_zones_only_while_started)
+{
+    base::trace::stop();
+
+    {
+        base::trace::Zone zone("trace_test stopped");
+    }
+
+    base::trace::start();
+
+    {
+        base::trace::Zone zone("trace_test started");
+    }
+
+    base::trace::stop();
+
+    auto started = events_named("trace_test started");
+
+    TS_CHECK(events_named("trace_test stopped").empty());
+    TS_CHECK(started.size() == 1);
+    TS_CHECK(started.size() == 1 && started[0].begin <= started[0].end);
+}
+
+TS_TEST(trace_nested_zones_are_inside_each_other)
+{
+    base::trace::start();
+
+    {
+        base::trace::Zone outer("trace_test outer");
+        base::trace::Zone inner("trace_test inner");
+    }
+
+    base::trace::stop();
+
+    auto outer = events_named("trace_test outer");
+    auto inner = events_named("trace_test inner");
+
+    TS_CHECK(outer.size() == 1 && inner.size() == 1);
+
+    if (outer.size() == 1 && inner.size() == 1) {
+        TS_CHECK(inner[0].begin >= outer[0].begin && inner[0].end <= outer[0].end);
+        TS_CHECK(inner[0].thread == outer[0].thread);
+    }
+}
+
+TS_TEST(trace_macro_records_only_when_compiled_in)
+{
+    base::trace::start();
+
+    {
+        TS_TRACE_ZONE("trace_test macro");
+    }
+
+    base::trace::stop();
+
+#if defined(TS_TRACE)
+    TS_CHECK(events_named("trace_test macro").size() == 1);
+#else
+    TS_CHECK(events_named("trace_test macro").empty());
+#endif
+}
+
+TS_TEST(trace_records_the_zones_of_each_thread_on_its_own_track)
+{
+    constexpr size_t kThreads = 4;
+    constexpr size_t kZones = 1000;
+
+    base::trace::start();
+
+    std::vector<std::thread> threads;
+
+    // no thread exits before all are done, or the next would take over its buffer.
+    std::latch done(kThreads);
+
+    for (size_t t = 0; t < kThreads; t++)
+        threads.emplace_back([&] {
+            base::trace::set_thread_name("trace_test thread");
+
+            for (size_t i = 0; i < kZones; i++)
+                base::trace::Zone zone("trace_test threaded");
+
+            done.arrive_and_wait();
+        });
+
+    for (auto& thread : threads)
+        thread.join();
+
+    base::trace::stop();
+
+    auto events = events_named("trace_test threaded");
+
+    std::vector<uint32_t> tracks;
+
+    for (auto& event : events)
+        if (std::find(tracks.begin(), tracks.end(), event.thread) == tracks.end())
+            tracks.push_back(event.thread);
+
+    TS_CHECK(events.size() == kThreads * kZones);
+    TS_CHECK(tracks.size() == kThreads);
+}
+
+TS_TEST(trace_buffer_keeps_the_last_zones)
+{
+    constexpr uint64_t kExtra = 10;
+
+    // on a thread of its own, so the zones of the other tests aren't overwritten.
+    std::thread([] {
+        for (uint64_t i = 1; i <= base::trace::Buffer::kCapacity + kExtra; i++)
+            base::trace::record("trace_test wrapped", i, i);
+    }).join();
+
+    auto events = events_named("trace_test wrapped");
+
+    TS_CHECK(events.size() == base::trace::Buffer::kCapacity);
+    TS_CHECK(!events.empty() && events.front().begin == kExtra + 1);
+    TS_CHECK(!events.empty() && events.back().begin == base::trace::Buffer::kCapacity + kExtra);
+}
+
+TS_TEST(trace_exports_chrome_json)
+{
+    base::trace::set_thread_name("trace_test \"main\"");
+    base::trace::start();
+
+    {
+        base::trace::Zone zone("trace_test exported");
+    }
+
+    base::trace::stop();
+
+    std::ostringstream out;
+    base::trace::write_chrome_json(out);
+
+    auto json = out.str();
+
+    TS_CHECK(json.starts_with("{\"displayTimeUnit\""));
+    TS_CHECK(json.find("{\"name\":\"trace_test exported\",\"ph\":\"X\"") != std::string::npos);
+    TS_CHECK(json.find("\"args\":{\"name\":\"trace_test \\\"main\\\"\"}") != std::string::npos);
+    TS_CHECK(json.ends_with("]}\n"));
+
+    auto path = std::filesystem::temp_directory_path() / "base_tests_trace.json";
+
+    TS_CHECK(base::trace::write_chrome_json(path));
+    TS_CHECK(std::filesystem::file_size(path) > 0);
+
+    std::filesystem::remove(path);
+
+    TS_CHECK(!base::trace::write_chrome_json(path / "missing" / "trace.json"));
+}
@@ -0,0 +1,252 @@
+#include "trace.h"
+
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace base::trace {
+    namespace {
+        struct Thread {
+            std::unique_ptr<Buffer> buffer;
+            std::string name;
+            bool attached = false;
+        };
+
+        // times of the first start, turning ticks into time relative to it.
+        struct Origin {
+            uint64_t ticks = 0;
+            std::chrono::steady_clock::time_point time;
+        };
+
+        struct Registry {
+            std::mutex mutex;
+            std::vector<Thread> threads;
+            Origin origin;
+        };
+
+        Registry& registry()
+        {
+            static Registry registry;
+            return registry;
+        }
+
+        Thread& thread_of(Registry& registry, const Buffer* buffer)
+        {
+            return registry.threads[buffer->thread() - 1];
+        }
+
+        // gives the buffer of the thread back when it exits, so the next one reuses it.
+        struct Detach {
+            ~Detach()
+            {
+                if (!detail::t_buffer) return;
+
+                auto& r = registry();
+                std::lock_guard lock(r.mutex);
+
+                thread_of(r, detail::t_buffer).attached = false;
+                detail::t_buffer = nullptr;
+            }
+        };
+
+        thread_local Detach t_detach;
+
+        void escape(std::ostream& out, const char* str)
+        {
+            for (; *str; str++) {
+                if (*str == '"' || *str == '\\')
+                    out << '\\' << *str;
+                else if (static_cast<unsigned char>(*str) < 0x20)
+                    out << ' ';
+                else
+                    out << *str;
+            }
+        }
+    }
+
+    void Buffer::copy(std::vector<Event>& events) const
+    {
+        auto committed = m_committed.load(std::memory_order_acquire);
+        auto first = committed > kCapacity ? committed - kCapacity : 0;
+        auto size = events.size();
+
+        for (auto i = first; i < committed; i++) {
+            auto& slot = m_slots[i & (kCapacity - 1)];
+
+            events.push_back(
+                Event {
+                    .name = slot.name.load(std::memory_order_relaxed),
+                    .thread = m_thread,
+                    .begin = slot.begin.load(std::memory_order_relaxed),
+                    .end = slot.end.load(std::memory_order_relaxed)
+                }
+            );
+        }
+
+        // slots claimed while copying may hold halves of two events.
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        auto claimed = m_claimed.load(std::memory_order_relaxed);
+
+        if (claimed > first + kCapacity) {
+            auto torn = std::min(claimed - first - kCapacity, committed - first);
+            events.erase(events.begin() + size, events.begin() + size + torn);
+        }
+    }
+
+    namespace detail {
+        Buffer* attach()
+        {
+            auto& r = registry();
+            std::lock_guard lock(r.mutex);
+
+            Thread* thread = nullptr;
+
+            for (auto& t : r.threads)
+                if (!t.attached) {
+                    thread = &t;
+                    break;
+                }
+
+            if (!thread) {
+                auto id = static_cast<uint32_t>(r.threads.size() + 1);
+
+                thread = &r.threads.emplace_back(
+                    Thread {
+                        .buffer = std::make_unique<Buffer>(id),
+                        .name = "thread " + std::to_string(id)
+                    }
+                );
+            }
+
+            thread->attached = true;
+
+            // constructs the thread's Detach, which only the slow path touches.
+            static_cast<void>(&t_detach);
+
+            return t_buffer = thread->buffer.get();
+        }
+    }
+
+    void start()
+    {
+        auto& r = registry();
+
+        {
+            std::lock_guard lock(r.mutex);
+
+            if (r.origin.ticks == 0)
+                r.origin = Origin {
+                    .ticks = now(),
+                    .time = std::chrono::steady_clock::now()
+                };
+        }
+
+        detail::g_started.store(true, std::memory_order_relaxed);
+    }
+
+    void stop()
+    {
+        detail::g_started.store(false, std::memory_order_relaxed);
+    }
+
+    void set_thread_name(const char* name)
+    {
+        auto buffer = detail::t_buffer;
+
+        if (!buffer) buffer = detail::attach();
+
+        auto& r = registry();
+        std::lock_guard lock(r.mutex);
+
+        thread_of(r, buffer).name = name;
+    }
+
+    std::vector<Event> snapshot()
+    {
+        auto& r = registry();
+        std::lock_guard lock(r.mutex);
+
+        std::vector<Event> events;
+
+        for (auto& thread : r.threads)
+            thread.buffer->copy(events);
+
+        return events;
+    }
+
+    void write_chrome_json(std::ostream& out)
+    {
+        auto events = snapshot();
+
+        Origin origin;
+        std::vector<std::string> names;
+
+        {
+            auto& r = registry();
+            std::lock_guard lock(r.mutex);
+
+            origin = r.origin;
+
+            for (auto& thread : r.threads)
+                names.push_back(thread.name);
+        }
+
+        // the rate of the ticks is measured from the first start, over at least 10ms.
+        auto end = std::chrono::steady_clock::now();
+
+        while (end - origin.time < std::chrono::milliseconds(10))
+            end = std::chrono::steady_clock::now();
+
+        std::chrono::duration<double, std::micro> elapsed = end - origin.time;
+        auto us_per_tick = elapsed.count() / static_cast<double>(now() - origin.ticks);
+
+        auto us = [&](uint64_t ticks) {
+            return static_cast<double>(static_cast<int64_t>(ticks - origin.ticks)) * us_per_tick;
+        };
+
+        out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+        char number[64];
+        bool first = true;
+
+        auto separate = [&] {
+            if (!first) out << ",";
+            out << "\n";
+            first = false;
+        };
+
+        for (size_t i = 0; i < names.size(); i++) {
+            separate();
+            out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << i + 1 << ",\"args\":{\"name\":\"";
+            escape(out, names[i].c_str());
+            out << "\"}}";
+        }
+
+        for (auto& event : events) {
+            separate();
+            out << "{\"name\":\"";
+            escape(out, event.name);
+            out << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread;
+
+            std::snprintf(number, sizeof(number), ",\"ts\":%.3f,\"dur\":%.3f}", us(event.begin), us(event.end) - us(event.begin));
+            out << number;
+        }
+
+        out << "\n]}\n";
+    }
+
+    bool write_chrome_json(const std::filesystem::path& path)
+    {
+        std::ofstream out(path);
+
+        if (!out) return false;
+
+        write_chrome_json(out);
+
+        return static_cast<bool>(out);
+    }
+}
\ No newline at end of file
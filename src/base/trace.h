@@ -0,0 +1,155 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Scoped zones recorded while tracing is started, e.g. 'TS_TRACE_ZONE("resolve");' times the
+// rest of the enclosing block. They're compiled out unless TS_TRACE is defined, the zone names
+// must be string literals.
+#if defined(TS_TRACE)
+#define TS_TRACE_CONCAT_(a, b) a##b
+#define TS_TRACE_CONCAT(a, b) TS_TRACE_CONCAT_(a, b)
+#define TS_TRACE_ZONE(name) ::base::trace::Zone TS_TRACE_CONCAT(ts_trace_zone_, __LINE__) { name }
+#define TS_TRACE_THREAD_NAME(name) ::base::trace::set_thread_name(name)
+#else
+#define TS_TRACE_ZONE(name) static_cast<void>(0)
+#define TS_TRACE_THREAD_NAME(name) static_cast<void>(0)
+#endif
+
+namespace base::trace {
+    // a zone, its times in ticks of 'now'.
+    struct Event {
+        const char* name;
+        uint32_t thread;
+        uint64_t begin;
+        uint64_t end;
+    };
+
+    // rdtsc on x86, the cntvct_el0 virtual counter on aarch64 and steady_clock elsewhere. The
+    // counters are read in a few nanoseconds, their ticks are only turned into time when
+    // exporting.
+    inline uint64_t now()
+    {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#elif defined(__aarch64__)
+        uint64_t ticks;
+        asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+        return ticks;
+#else
+        return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+    }
+
+    // Zones a thread recorded, the oldest being overwritten once it holds 'kCapacity' of them.
+    // Only its thread writes it, without locking: an event is written between moving 'm_claimed'
+    // and 'm_committed' past it, so a reader knows which of the events it copied may have been
+    // overwritten meanwhile.
+    class Buffer {
+    public:
+        static constexpr uint64_t kCapacity = 1 << 16;
+
+        explicit Buffer(uint32_t thread)
+            : m_thread { thread }
+        {
+        }
+
+        void record(const char* name, uint64_t begin, uint64_t end)
+        {
+            auto index = m_committed.load(std::memory_order_relaxed);
+            auto& slot = m_slots[index & (kCapacity - 1)];
+
+            m_claimed.store(index + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            slot.name.store(name, std::memory_order_relaxed);
+            slot.begin.store(begin, std::memory_order_relaxed);
+            slot.end.store(end, std::memory_order_relaxed);
+
+            m_committed.store(index + 1, std::memory_order_release);
+        }
+
+        uint32_t thread() const { return m_thread; }
+
+        // appends the events of the buffer to 'events', from the oldest.
+        void copy(std::vector<Event>& events) const;
+    private:
+        struct Slot {
+            std::atomic<const char*> name;
+            std::atomic<uint64_t> begin;
+            std::atomic<uint64_t> end;
+        };
+
+        uint32_t m_thread;
+        std::atomic<uint64_t> m_claimed = 0;
+        std::atomic<uint64_t> m_committed = 0;
+        Slot m_slots[kCapacity] {};
+    };
+
+    namespace detail {
+        inline std::atomic<bool> g_started = false;
+        inline thread_local Buffer* t_buffer = nullptr;
+
+        // takes a buffer for the thread, one left by a thread which exited if any.
+        Buffer* attach();
+    }
+
+    // records the zones from now on, the first start being the origin of the exported times.
+    void start();
+
+    void stop();
+
+    inline bool started()
+    {
+        return detail::g_started.load(std::memory_order_relaxed);
+    }
+
+    inline void record(const char* name, uint64_t begin, uint64_t end)
+    {
+        auto buffer = detail::t_buffer;
+
+        if (!buffer) buffer = detail::attach();
+
+        buffer->record(name, begin, end);
+    }
+
+    // names the track of the current thread in exported traces.
+    void set_thread_name(const char* name);
+
+    // the events of all threads, those written while copying them being dropped.
+    std::vector<Event> snapshot();
+
+    // writes the events in the Chrome trace event format, which Perfetto opens as well.
+    void write_chrome_json(std::ostream& out);
+
+    bool write_chrome_json(const std::filesystem::path& path);
+
+    class Zone {
+    public:
+        explicit Zone(const char* name)
+            : m_name { name }
+            , m_begin { started() ? now() : 0 }
+        {
+        }
+
+        Zone(const Zone&) = delete;
+
+        ~Zone()
+        {
+            if (m_begin) record(m_name, m_begin, now());
+        }
+    private:
+        const char* m_name;
+        uint64_t m_begin;
+    };
+}
\ No newline at end of file
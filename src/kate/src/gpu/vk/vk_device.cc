@@ -5,6 +5,8 @@
 #include "vk_swapchain.h"
 #include "vk_queue.h"
 
+#include "base/trace.h"
+
 #include <limits>
 
 namespace kate::gpu {
@@ -16,6 +18,8 @@ namespace kate::gpu {
 
   void VkDeviceObject::initialize()
   {
+    TS_TRACE_ZONE("VkDeviceObject::initialize");
+
     auto& vk_instance = m_adapter->getInstance();
 
     auto physical_devices = vk_instance.enumeratePhysicalDevices();
@@ -92,19 +96,23 @@ namespace kate::gpu {
       ),
     };
 
-    m_device = physical_device.createDevice(
-      vk::DeviceCreateInfo(
-        vk::DeviceCreateFlags { 0u },
-        queue_create_infos.size(),      // Queue create info count.
-        queue_create_infos.data(),      // Queue create pointer.
-        vulkan_validation_layers.size(),// Device layer count.
-        vulkan_validation_layers.data(),// Device layer pointer.
-        vulkan_device_extensions.size(),// Extension count.
-        vulkan_device_extensions.data(),// Extension list.
-        nullptr,                        // Enabled features.
-        nullptr                         // pNext.
-      )
-    );
+    {
+      TS_TRACE_ZONE("vkCreateDevice");
+
+      m_device = physical_device.createDevice(
+        vk::DeviceCreateInfo(
+          vk::DeviceCreateFlags { 0u },
+          queue_create_infos.size(),      // Queue create info count.
+          queue_create_infos.data(),      // Queue create pointer.
+          vulkan_validation_layers.size(),// Device layer count.
+          vulkan_validation_layers.data(),// Device layer pointer.
+          vulkan_device_extensions.size(),// Extension count.
+          vulkan_device_extensions.data(),// Extension list.
+          nullptr,                        // Enabled features.
+          nullptr                         // pNext.
+        )
+      );
+    }
 
     m_queues.push_back(
       std::make_shared<VkQueueObject>(
@@ -4,6 +4,8 @@
 #include "vk_config.h"
 #include "vk_queue.h"
 
+#include "base/trace.h"
+
 #ifdef __linux
 #   include <X11/Xlib.h>
 #   include <vulkan/vulkan_xlib.h>
@@ -20,6 +22,8 @@ namespace kate::gpu {
     const SwapchainFlags& flags
   ) : m_device { device }
   {
+    TS_TRACE_ZONE("VkSwapChainObject::VkSwapChainObject");
+
     auto& instance = m_device->getAdapter()->getInstance();
 
 #     ifdef __linux
@@ -164,7 +168,11 @@ namespace kate::gpu {
       nullptr
     );
 
-    m_swapchain = m_device->getDevice().createSwapchainKHR(swapchain_ci);
+    {
+      TS_TRACE_ZONE("vkCreateSwapchainKHR");
+
+      m_swapchain = m_device->getDevice().createSwapchainKHR(swapchain_ci);
+    }
 
     m_swapchainImages = m_device->getDevice().getSwapchainImagesKHR(m_swapchain);
 
@@ -1,6 +1,8 @@
 #include "vk_texture.h"
 #include "vk_device.h"
 
+#include "base/trace.h"
+
 namespace kate::gpu {
   VkTextureObject::VkTextureObject(
     std::shared_ptr<VkDeviceObject> device,
@@ -10,6 +12,8 @@ namespace kate::gpu {
     uint16_t layers
   ) : m_device { device }
   {
+    TS_TRACE_ZONE("VkTextureObject::VkTextureObject");
+
     auto vk_device = device->getDevice();
 
     vk::ImageType vktype;
@@ -10,20 +10,217 @@ namespace kate::tlr::ast {
     return nctx;
   }
 
-  uint64_t ASTContext::getID()
+  base::Interner& names()
   {
-    static uint64_t id = 0;
-    return id++;
+    static base::Interner interner;
+    return interner;
   }
 
-  void Decl::setSem(std::unique_ptr<sem::Decl>&& sem)
+  ASTContext::~ASTContext()
   {
-    m_sem = std::move(sem);
+    // nodes destroyed with the slots find none to remove their children from.
+    auto slots = std::move(m_slots);
+    m_slots.clear();
   }
 
-  sem::Decl* Decl::sem()
+  uint64_t ASTContext::add(std::unique_ptr<TreeNode>&& node)
   {
-    return m_sem.get();
+    uint32_t index;
+
+    if (!m_free.empty()) {
+      index = m_free.back();
+      m_free.pop_back();
+    } else {
+      index = m_slots.size();
+      m_slots.emplace_back();
+
+      m_sem.types.push_back(nullptr);
+      m_sem.decls.push_back(nullptr);
+      m_sem.resolved.push_back(false);
+    }
+
+    auto& slot = m_slots[index];
+    slot.node = std::move(node);
+    slot.refs = 1;
+    slot.arena = m_arena;
+
+    m_size++;
+
+    link(index);
+
+    slot.node->m_handle = (uint64_t(slot.generation) << 32) | index;
+
+    return slot.node->m_handle;
+  }
+
+  void ASTContext::remove(uint64_t id)
+  {
+    auto index = static_cast<uint32_t>(id);
+
+    if (index >= m_slots.size()) return;
+
+    auto& slot = m_slots[index];
+
+    if (!slot.node || slot.generation != static_cast<uint32_t>(id >> 32)) return;
+
+    if (--slot.refs > 0) return;
+
+    unlink(index);
+
+    m_sem.types[index] = nullptr;
+    m_sem.decls[index] = nullptr;
+    m_sem.resolved[index] = false;
+
+    // the slot is free before the node is destroyed, which removes its children in turn.
+    m_dying.push_back(std::move(slot.node));
+    slot.generation++;
+    m_free.push_back(index);
+    m_size--;
+
+    if (m_destroying) return;
+
+    m_destroying = true;
+
+    while (!m_dying.empty()) {
+      auto node = std::move(m_dying.back());
+      m_dying.pop_back();
+    }
+
+    m_destroying = false;
+
+    // once the context is empty the next nodes take the slots from the first one, rather
+    // than in the order the last ones were removed, so nodes made one after the other, e.g.
+    // by a compile or a load, are next to each other in the slots and the columns.
+    if (m_size == 0) {
+      m_free.clear();
+
+      for (auto index = uint32_t(m_slots.size()); index-- > 0;)
+        m_free.push_back(index);
+    }
+  }
+
+  void ASTContext::link(uint32_t index)
+  {
+    auto& slot = m_slots[index];
+    auto metadata = slot.node->type_metadata;
+
+    // every node made looks its kind up, the recent kinds are checked before the map.
+    auto& recent = m_recent_kinds[(reinterpret_cast<uintptr_t>(metadata) / sizeof(*metadata)) % m_recent_kinds.size()];
+
+    if (recent.metadata != metadata) {
+      // 'try_emplace' only allocates for a new kind, 'emplace' would for every node.
+      auto [it, inserted] = m_kind_indices.try_emplace(metadata, m_kinds.size());
+
+      if (inserted)
+        m_kinds.push_back(Kind { .metadata = metadata });
+
+      recent = RecentKind { .metadata = metadata, .index = it->second };
+    }
+
+    auto& kind = m_kinds[recent.index];
+
+    slot.kind = recent.index;
+    slot.prev_of_kind = kind.last;
+    slot.next_of_kind = kNoSlot;
+
+    if (kind.last != kNoSlot)
+      m_slots[kind.last].next_of_kind = index;
+    else
+      kind.first = index;
+
+    kind.last = index;
+    kind.size++;
+  }
+
+  void ASTContext::unlink(uint32_t index)
+  {
+    auto& slot = m_slots[index];
+    auto& kind = m_kinds[slot.kind];
+
+    if (slot.prev_of_kind != kNoSlot)
+      m_slots[slot.prev_of_kind].next_of_kind = slot.next_of_kind;
+    else
+      kind.first = slot.next_of_kind;
+
+    if (slot.next_of_kind != kNoSlot)
+      m_slots[slot.next_of_kind].prev_of_kind = slot.prev_of_kind;
+    else
+      kind.last = slot.prev_of_kind;
+
+    kind.size--;
+
+    slot.kind = kNoSlot;
+    slot.prev_of_kind = kNoSlot;
+    slot.next_of_kind = kNoSlot;
+  }
+
+  void ASTContext::copy_sem(uint32_t from, uint32_t to)
+  {
+    m_sem.types[to] = m_sem.types[from];
+    m_sem.resolved[to] = m_sem.resolved[from];
+
+    // a declaration refers to itself.
+    auto decl = m_sem.decls[from];
+    m_sem.decls[to] = decl == m_slots[from].node.get() ? static_cast<Decl*>(m_slots[to].node.get()) : decl;
+  }
+
+  void ASTContext::reset()
+  {
+    for (uint32_t i = 0; i < m_slots.size(); i++)
+      if (m_slots[i].node) {
+        // whoever else shares it.
+        m_slots[i].refs = 1;
+        remove((uint64_t(m_slots[i].generation) << 32) | i);
+      }
+  }
+
+  size_t ASTContext::size() const
+  {
+    return m_size;
+  }
+
+  size_t ASTContext::capacity() const
+  {
+    return m_slots.size();
+  }
+
+  ASTContext::Arena::Arena()
+    : m_id { ++context().m_num_arenas },
+      m_parent { context().m_arena }
+  {
+    context().m_arena = m_id;
+  }
+
+  ASTContext::Arena::~Arena()
+  {
+    release();
+    context().m_arena = m_parent;
+  }
+
+  void ASTContext::Arena::release()
+  {
+    auto& ctx = context();
+
+    for (uint32_t i = 0; i < ctx.m_slots.size(); i++)
+      if (ctx.m_slots[i].node && ctx.m_slots[i].arena == m_id) {
+        ctx.m_slots[i].refs = 1;
+        ctx.remove((uint64_t(ctx.m_slots[i].generation) << 32) | i);
+      }
+  }
+
+  void Decl::setSem(types::Type* type)
+  {
+    auto& columns = context().sem();
+    auto row = ASTContext::row(this);
+
+    columns.types[row] = type;
+    columns.decls[row] = this;
+    columns.resolved[row] = true;
+  }
+
+  sem::Decl Decl::sem()
+  {
+    return sem::Decl(context().sem().resolved[ASTContext::row(this)] ? this : nullptr);
   }
 
   const std::string& Decl::name() const
@@ -31,7 +228,7 @@ namespace kate::tlr::ast {
     return m_name;
   }
 
-  Module::Module(std::vector<CRef<Decl>>&& declaration_list)
+  Module::Module(List<Decl>&& declaration_list)
     : m_global_declarations { std::move(declaration_list) }
   {
   }
@@ -43,7 +240,7 @@ namespace kate::tlr::ast {
     );
   }
 
-  std::vector<CRef<Decl>>& Module::global_declarations()
+  List<Decl>& Module::global_declarations()
   {
     return m_global_declarations;
   }
@@ -58,14 +255,19 @@ namespace kate::tlr::ast {
     m_sem = std::move(sem);
   }
 
-  sem::Expr* Expr::sem()
+  sem::Expr Expr::sem()
   {
-    return m_sem.get();
+    return sem::Expr(context().sem().resolved[ASTContext::row(this)] ? this : nullptr);
   }
 
-  void Expr::setSem(std::unique_ptr<sem::Expr>&& sem)
+  void Expr::setSem(types::Type* type)
   {
-    m_sem = std::move(sem);
+    auto& columns = context().sem();
+    auto row = ASTContext::row(this);
+
+    columns.types[row] = type;
+    columns.decls[row] = nullptr;
+    columns.resolved[row] = true;
   }
 
   LitExpr::LitExpr(const Value& value)
@@ -86,7 +288,7 @@ namespace kate::tlr::ast {
   }
 
   ArrayExpr::ArrayExpr(
-    std::vector<CRef<Expr>>&& items
+    List<Expr>&& items
   ) : m_items { std::move(items) }
   {
   }
@@ -98,13 +300,13 @@ namespace kate::tlr::ast {
     );
   }
 
-  std::vector<CRef<Expr>>& ArrayExpr::items()
+  List<Expr>& ArrayExpr::items()
   {
     return m_items;
   }
 
-  IdExpr::IdExpr(const std::string& ident) 
-    : m_ident { ident }
+  IdExpr::IdExpr(std::string_view ident) 
+    : m_ident { names().intern(ident) }
   {
   }
 
@@ -115,7 +317,7 @@ namespace kate::tlr::ast {
     );
   }
 
-  const std::string& IdExpr::ident() const
+  std::string_view IdExpr::ident() const
   {
     return m_ident;
   }
@@ -207,7 +409,7 @@ namespace kate::tlr::ast {
     return m_expr;
   }
 
-  Attr::Attr(Attr::Type type, std::vector<CRef<Expr>>&& args)
+  Attr::Attr(Attr::Type type, List<Expr>&& args)
       : m_type { type },
           m_args { std::move(args) }
   {
@@ -221,10 +423,20 @@ namespace kate::tlr::ast {
     );
   }
 
+  Attr::Type Attr::type() const
+  {
+    return m_type;
+  }
+
+  List<Expr>& Attr::args()
+  {
+    return m_args;
+  }
+
   FuncArg::FuncArg(
     const std::string& name,
     CRef<Type>&& type,
-    std::vector<CRef<Attr>>&& attrs
+    List<Attr>&& attrs
   ) : m_attrs { std::move(attrs) },
       m_type { std::move(type) }
   {
@@ -245,7 +457,7 @@ namespace kate::tlr::ast {
     );
   }
 
-  std::vector<CRef<Attr>>& FuncArg::attrs()
+  List<Attr>& FuncArg::attrs()
   {
     return m_attrs;
   }
@@ -254,8 +466,8 @@ namespace kate::tlr::ast {
     CRef<Type>&& type,
     const std::string& name,
     CRef<BlockStat>&& block,
-    std::vector<CRef<FuncArg>>&& args,
-    std::vector<CRef<Attr>>&& attributes
+    List<FuncArg>&& args,
+    List<Attr>&& attributes
   ) : m_attrs { std::move(attributes) },
       m_args { std::move(args) },
       m_block { std::move(block) },
@@ -274,7 +486,7 @@ namespace kate::tlr::ast {
     return m_block;
   }
 
-  std::vector<CRef<FuncArg>>& FuncDecl::args()
+  List<FuncArg>& FuncDecl::args()
   {
     return m_args;
   }
@@ -290,7 +502,7 @@ namespace kate::tlr::ast {
     );
   }
 
-  std::vector<CRef<Attr>>& FuncDecl::attrs()
+  List<Attr>& FuncDecl::attrs()
   {
     return m_attrs;
   }
@@ -316,6 +528,35 @@ namespace kate::tlr::ast {
     );
   }
 
+  ConstDecl::ConstDecl(
+    const std::string& name,
+    CRef<Type>&& type,
+    CRef<Expr>&& initializer
+  ) : m_type { std::move(type) },
+      m_initializer { std::move(initializer) }
+  {
+    m_name = name;
+  }
+
+  CRef<Type>& ConstDecl::type()
+  {
+    return m_type;
+  }
+
+  CRef<Expr>& ConstDecl::expr()
+  {
+    return m_initializer;
+  }
+
+  CRef<TreeNode> ConstDecl::clone()
+  {
+    return context().make<ConstDecl>(
+      m_name,
+      context().clone(m_type),
+      context().clone(m_initializer)
+    );
+  }
+
   VarStat::VarStat(
     CRef<VarDecl>&& vardecl,
     CRef<Expr>&& initializer
@@ -343,8 +584,8 @@ namespace kate::tlr::ast {
     );
   }
 
-  TypeId::TypeId(const std::string& id) 
-    : m_id { id }
+  TypeId::TypeId(std::string_view id) 
+    : m_id { names().intern(id) }
   {
   }
 
@@ -353,7 +594,7 @@ namespace kate::tlr::ast {
     return context().make<TypeId>(m_id);
   }
 
-  std::string& TypeId::id()
+  std::string_view TypeId::id()
   {
     return m_id;
   }
@@ -387,7 +628,7 @@ namespace kate::tlr::ast {
   StructMember::StructMember(
     CRef<Type>&& type,
     const std::string& name,
-    std::vector<CRef<Attr>>&& attrs
+    List<Attr>&& attrs
   ) : m_type { std::move(type) },
       m_attrs { std::move(attrs) }
   {
@@ -413,13 +654,13 @@ namespace kate::tlr::ast {
     return m_name;
   }
 
-  std::vector<CRef<Attr>>& StructMember::attrs()
+  List<Attr>& StructMember::attrs()
   {
     return m_attrs;
   }
 
   BlockStat::BlockStat(
-      std::vector<CRef<Stat>>&& stats
+      List<Stat>&& stats
   ) : m_stats { std::move(stats) }
   {
   }
@@ -431,7 +672,7 @@ namespace kate::tlr::ast {
     );
   }
 
-  std::vector<CRef<Stat>>& BlockStat::stats()
+  List<Stat>& BlockStat::stats()
   {
     return m_stats;
   }
@@ -499,7 +740,7 @@ namespace kate::tlr::ast {
 
   CallExpr::CallExpr(
     CRef<IdExpr>&& id,
-    std::vector<CRef<Expr>>&& args
+    List<Expr>&& args
   ) : m_id { std::move(id) },
       m_args { std::move(args) }
   {
@@ -518,13 +759,13 @@ namespace kate::tlr::ast {
     return m_id;
   }
 
-  std::vector<CRef<Expr>>& CallExpr::args()
+  List<Expr>& CallExpr::args()
   {
     return m_args;
   }
 
   ForStat::ForStat(
-    CRef<ExprStat>&& initializer,
+    CRef<Stat>&& initializer,
     CRef<Expr>&& condition,
     CRef<ExprStat>&& continuing,
     CRef<BlockStat>&& block
@@ -545,7 +786,7 @@ namespace kate::tlr::ast {
     );
   }
 
-  CRef<ExprStat>& ForStat::initializer()
+  CRef<Stat>& ForStat::initializer()
   {
     return m_initializer;
   }
@@ -596,8 +837,8 @@ namespace kate::tlr::ast {
 
   StructDecl::StructDecl(
     const std::string& name,
-    std::vector<CRef<StructMember>>&& members,
-    std::vector<CRef<Attr>>&& attrs
+    List<StructMember>&& members,
+    List<Attr>&& attrs
   ) : m_members { std::move(members) },
       m_attrs { std::move(attrs) }
   {
@@ -613,12 +854,12 @@ namespace kate::tlr::ast {
     );
   }
 
-  std::vector<CRef<StructMember>>& StructDecl::members()
+  List<StructMember>& StructDecl::members()
   {
     return m_members;
   }
 
-  std::vector<CRef<Attr>>& StructDecl::attrs()
+  List<Attr>& StructDecl::attrs()
   {
     return m_attrs;
   }
@@ -627,7 +868,7 @@ namespace kate::tlr::ast {
     const std::string& name,
     BufferArgs args,
     CRef<Type>&& type,
-    std::vector<CRef<Attr>>&& attributes
+    List<Attr>&& attributes
   ) : m_args { std::move(args) },
     m_type { std::move(type) },
     m_attributes { std::move(attributes) }
@@ -635,7 +876,7 @@ namespace kate::tlr::ast {
     m_name = name;
   }
 
-  std::vector<CRef<Attr>>& BufferDecl::attributes()
+  List<Attr>& BufferDecl::attributes()
   {
     return m_attributes;
   }
@@ -658,11 +899,11 @@ namespace kate::tlr::ast {
   UniformDecl::UniformDecl(
     CRef<Type>&& type,
     const std::string& name,
-    std::vector<CRef<Attr>>&& attributes
+    List<Attr>&& attributes
   ) : m_type { std::move(type) },
-      m_name { name },
       m_attributes { std::move(attributes) }
   {
+    m_name = name;
   }
 
   CRef<TreeNode> UniformDecl::clone()
@@ -674,17 +915,12 @@ namespace kate::tlr::ast {
     );
   }
 
-  const std::string& UniformDecl::name() const
-  {
-    return m_name;
-  }
-
   CRef<Type>& UniformDecl::type()
   {
     return m_type;
   }
 
-  std::vector<CRef<Attr>>& UniformDecl::attributes()
+  List<Attr>& UniformDecl::attributes()
   {
     return m_attributes;
   }
@@ -693,6 +929,21 @@ namespace kate::tlr::ast {
   {
     return m_args;
   }
+
+  ImportDecl::ImportDecl(const std::string& path)
+    : m_path { path }
+  {
+  }
+
+  CRef<TreeNode> ImportDecl::clone()
+  {
+    return context().make<ImportDecl>(m_path);
+  }
+
+  const std::string& ImportDecl::path() const
+  {
+    return m_path;
+  }
 }
 
 using namespace kate::tlr;
@@ -719,6 +970,7 @@ TS_RTTI_TYPE(ast::ExprStat)
 TS_RTTI_TYPE(ast::ReturnStat)
 TS_RTTI_TYPE(ast::BreakStat)
 TS_RTTI_TYPE(ast::VarDecl)
+TS_RTTI_TYPE(ast::ConstDecl)
 TS_RTTI_TYPE(ast::VarStat)
 TS_RTTI_TYPE(ast::Module)
 TS_RTTI_TYPE(ast::Type)
@@ -726,4 +978,5 @@ TS_RTTI_TYPE(ast::BufferDecl)
 TS_RTTI_TYPE(ast::CallExpr)
 TS_RTTI_TYPE(ast::ArrayType)
 TS_RTTI_TYPE(ast::TypeId)
-TS_RTTI_TYPE(ast::UniformDecl)
\ No newline at end of file
+TS_RTTI_TYPE(ast::UniformDecl)
+TS_RTTI_TYPE(ast::ImportDecl)
\ No newline at end of file
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <limits>
 #include <vector>
 #include <unordered_map>
@@ -11,7 +13,10 @@
 #include <cstdint>
 #include <fmt/format.h>
 
+#include "base/hash_map.h"
+#include "base/interner.h"
 #include "base/rtti.h"
+#include "base/small_vector.h"
 
 namespace kate::tlr::sem {
   class Decl;
@@ -25,13 +30,33 @@ namespace kate::tlr::sem {
   class Type;
 }
 
+namespace kate::tlr::types {
+  class Type;
+}
+
 namespace kate::tlr::ast {
+  class ASTContext;
+
+  class Decl;
+
+  ASTContext& context();
+
+  // Names of identifiers and types, each held once however many nodes use it, so nodes hold
+  // views of them and copying a node doesn't copy its name.
+  base::Interner& names();
+
+  // Owning handle to a node of the context, the node is removed when its handle goes away.
+  //
+  // The id is the index of the node's slot with the generation of the slot, so a handle
+  // kept past the removal of its node doesn't reach the node reusing the slot.
   template<typename T>
   class CRef {
   public:
+    static constexpr uint64_t kNone = std::numeric_limits<uint64_t>::max();
+
     CRef()
     {
-      m_id = std::numeric_limits<uint64_t>::max();
+      m_id = kNone;
     }
 
     CRef(uint64_t id) 
@@ -44,20 +69,26 @@ namespace kate::tlr::ast {
     CRef(CRef<T>&& rhs)
     {
       m_id = rhs.m_id;
-      rhs.m_id = std::numeric_limits<uint64_t>::max();
+      rhs.m_id = kNone;
     }
     
     template<typename U>
     CRef(CRef<U>&& rhs)
     {
       m_id = rhs.m_id;
-      rhs.m_id = std::numeric_limits<uint64_t>::max();
+      rhs.m_id = kNone;
     }
 
+    ~CRef();
+
     void operator=(CRef<T>&& rhs)
     {
+      if (&rhs == this) return;
+
+      release();
+
       m_id = rhs.m_id;
-      rhs.m_id = std::numeric_limits<uint64_t>::max();
+      rhs.m_id = kNone;
     }
 
     void operator=(const CRef<T>&) = delete;
@@ -71,7 +102,7 @@ namespace kate::tlr::ast {
     CRef<U> convertTo()
     {
       auto id = m_id;
-      m_id = std::numeric_limits<uint64_t>::max();
+      m_id = kNone;
       return CRef<U>(id);
     }
 
@@ -79,12 +110,19 @@ namespace kate::tlr::ast {
 
     operator bool() const
     {
-      return m_id != std::numeric_limits<uint64_t>::max();
+      return m_id != kNone;
     }
 
     uint64_t m_id;
+  private:
+    void release();
   };
 
+  // Children of a node, the first few held in the node itself as most lists of children are
+  // short, e.g. the arguments of a call or the attributes of a declaration.
+  template<typename T>
+  using List = base::SmallVector<CRef<T>, 4>;
+
   class TreeNode : public base::rtti::Castable<TreeNode, base::rtti::Base> {
   public:
     TreeNode() = default;
@@ -93,78 +131,108 @@ namespace kate::tlr::ast {
 
     TreeNode(const TreeNode&) = delete;
 
+    // copies the node, its children are shared with the copy.
     virtual CRef<TreeNode> clone() = 0;
+
+    // id of the handle owning the node.
+    uint64_t handle() const
+    {
+      return m_handle;
+    }
+  private:
+    friend class ASTContext;
+
+    uint64_t m_handle = std::numeric_limits<uint64_t>::max();
   };
 
   class ASTContext {
   public:
-    ASTContext() = default;
+    // Nodes made while an arena is the current one belong to it, and the ones still alive are
+    // removed with the arena, e.g. everything a compile made, whoever holds them.
+    class Arena {
+    public:
+      Arena();
 
-    template<typename _Ty, typename... _Types, std::enable_if_t<!std::is_array_v<_Ty>, int> = 0>
-    inline CRef<_Ty> make(_Types&&... _Args) {
-      auto id = getID();
+      ~Arena();
 
-      m_ctx[id] = std::make_unique<_Ty>(std::forward<_Types>(_Args)...);
+      Arena(const Arena&) = delete;
 
-      return CRef<_Ty>(id);
-    }
+      // removes the nodes of the arena, it stays the current one.
+      void release();
+    private:
+      uint32_t m_id;
+      uint32_t m_parent;
+    };
 
-    void remove(uint64_t id)
-    {
-      /*auto it = m_ctx.find(id);
+    ASTContext() = default;
 
-      if (it == m_ctx.end()) return;
+    ~ASTContext();
 
-      m_ctx.erase(it);*/
+    template<typename _Ty, typename... _Types, std::enable_if_t<!std::is_array_v<_Ty>, int> = 0>
+    inline CRef<_Ty> make(_Types&&... _Args) {
+      return CRef<_Ty>(add(std::make_unique<_Ty>(std::forward<_Types>(_Args)...)));
     }
 
+    // drops a handle of the node, which is destroyed and its slot freed with the last one. Ids
+    // of removed nodes are ignored.
+    void remove(uint64_t id);
+
+    // Exchanges the nodes owned by the handles of 'src' and 'dst'. Nodes shared by clones
+    // aren't swapped, the clones would see the change, they're taken through 'mutate' first.
     bool swap(TreeNode* src, TreeNode* dst) 
     {
-      uint64_t whichId { 
-        std::numeric_limits<uint64_t>::max()
-      };
-
-      uint64_t withId {
-        std::numeric_limits<uint64_t>::max()
-      };
+      if (!src || !dst || !owns(src) || !owns(dst) || shared(src) || shared(dst))
+        return false;
 
-      for (auto& [id, node] : m_ctx) {
-        if (node.get() == src) 
-          whichId = id;
+      auto which = static_cast<uint32_t>(src->m_handle);
+      auto with = static_cast<uint32_t>(dst->m_handle);
 
-        if (node.get() == dst) 
-          withId = id;
+      unlink(which);
+      unlink(with);
 
-        if (whichId != std::numeric_limits<uint64_t>::max() && 
-          withId != std::numeric_limits<uint64_t>::max())
-          break;
-      }
+      std::swap(m_slots[which].node, m_slots[with].node);
+      std::swap(src->m_handle, dst->m_handle);
 
-      if (whichId == std::numeric_limits<uint64_t>::max() || 
-        withId == std::numeric_limits<uint64_t>::max())
-        return false;
+      std::swap(m_sem.types[which], m_sem.types[with]);
+      std::swap(m_sem.decls[which], m_sem.decls[with]);
+      std::swap(m_sem.resolved[which], m_sem.resolved[with]);
 
-      std::swap(m_ctx[whichId], m_ctx[withId]);
+      link(which);
+      link(with);
 
       return true;
     }
 
+    // puts 'with' in 'slot' and returns the node it held, e.g. for a pass to reuse its
+    // children, it's removed otherwise when the returned handle goes away.
+    template<typename T, typename U>
+    CRef<T> replace(CRef<T>& slot, CRef<U>&& with)
+    {
+      CRef<T> old(slot.m_id);
+
+      slot.m_id = with.m_id;
+      with.m_id = CRef<U>::kNone;
+
+      return old;
+    }
+
     TreeNode* get(uint64_t id)
     {
-      auto it = m_ctx.find(id);
+      auto index = static_cast<uint32_t>(id);
 
-      if (it == m_ctx.end()) {
-        assert(false); 
-        return nullptr;
-      }
+      // a stale handle, its node was removed.
+      assert(index < m_slots.size() && m_slots[index].generation == static_cast<uint32_t>(id >> 32));
 
-      return it->second.get();
+      return m_slots[index].node.get();
     }
 
+    // Clones are handles sharing the node, and through it the whole subtree, so cloning takes
+    // constant time. Shared nodes are modified through 'mutate', which copies them first.
     template<typename T, typename... Args>
-    std::vector<CRef<T>> clone(std::vector<CRef<T>>& nodes)
+    List<T> clone(List<T>& nodes)
     {
-      std::vector<CRef<T>> v;
+      List<T> v;
+      v.reserve(nodes.size());
 
       for (auto& node : nodes)
         v.push_back(clone(node));
@@ -177,8 +245,7 @@ namespace kate::tlr::ast {
     {
       if (!node) return {};
 
-      auto n = node->clone();
-      return n.template convertTo<Type>();
+      return CRef<Type>(share(node.m_id));
     }
 
     template<typename Type>
@@ -186,43 +253,206 @@ namespace kate::tlr::ast {
     {
       if (!node) return {};
 
-      auto n = node->clone();
-      return n.template convertTo<Type>();
+      return CRef<Type>(share(node->m_handle));
+    }
+
+    // whether other handles share the node of 'ref'.
+    template<typename T>
+    bool shared(const CRef<T>& ref) const
+    {
+      return ref.m_id != CRef<T>::kNone && m_slots[static_cast<uint32_t>(ref.m_id)].refs > 1;
     }
 
+    bool shared(const TreeNode* node) const
+    {
+      return m_slots[row(node)].refs > 1;
+    }
+
+    // Returns the node of 'ref' to modify it, after pointing 'ref' to a copy of the node when
+    // other handles share it. The copy shares the children of the node, a child is modified by
+    // mutating its handle in the copy in turn, so a change copies the path to it and no more.
     template<typename T>
-    void foreach(std::function<void(T&)> cb)
+    T* mutate(CRef<T>& ref)
     {
-      std::vector<TreeNode*> nodes;
+      if (shared(ref)) {
+        auto from = static_cast<uint32_t>(ref.m_id);
+        auto copy = ref->clone();
+
+        copy_sem(from, static_cast<uint32_t>(copy.m_id));
 
-      for (auto& [_, ptr] : m_ctx) 
-        nodes.push_back(ptr.get());
+        ref = copy.template convertTo<T>();
+      }
 
-      for (auto& ptr : nodes) {        
-        if (T* cptr = ptr->as<T>()) {
-          cb(*cptr);
+      return ref.get();
+    }
+
+    // Calls 'cb' with each node of type 'T', subclasses included. Only the lists of the kinds
+    // of nodes matching 'T' are walked, kinds in the order they were first made and nodes of a
+    // kind in the order they were made. 'cb' may make nodes but not remove any.
+    template<typename T, typename Fn>
+    void foreach(Fn&& cb)
+    {
+      for (auto& kind : m_kinds) {
+        if (!kind.metadata->template match<T>()) continue;
+
+        for (auto index = kind.first; index != kNoSlot;) {
+          auto next = m_slots[index].next_of_kind;
+
+          cb(*static_cast<T*>(m_slots[index].node.get()));
+
+          index = next;
         }
       }
     }
 
-    void reset()
+    // kind of the node, an index in the kinds of the context given to each concrete type of
+    // node the first time one is made, e.g. to index tables of handlers.
+    uint32_t kind(const TreeNode* node) const
+    {
+      return m_slots[row(node)].kind;
+    }
+
+    const base::rtti::TypeMetadata* metadata(uint32_t kind) const
+    {
+      return m_kinds[kind].metadata;
+    }
+
+    // number of nodes of type 'T', subclasses included.
+    template<typename T>
+    size_t count() const
+    {
+      size_t n = 0;
+
+      for (auto& kind : m_kinds)
+        if (kind.metadata->template match<T>())
+          n += kind.size;
+
+      return n;
+    }
+
+    // Semantic information of the nodes, a column per field indexed like the slots, so passes
+    // reading the types of expressions go through contiguous memory. 'sem::Expr' and
+    // 'sem::Decl' are views of a row.
+    struct SemColumns {
+      std::vector<types::Type*> types;
+      // declaration an identifier resolves to, a declaration itself.
+      std::vector<Decl*> decls;
+      std::vector<uint8_t> resolved;
+    };
+
+    SemColumns& sem()
+    {
+      return m_sem;
+    }
+
+    // row of the node in the slots and the columns.
+    static uint32_t row(const TreeNode* node)
     {
-      m_ctx = std::unordered_map<uint64_t, std::unique_ptr<TreeNode>>();
+      return static_cast<uint32_t>(node->handle());
     }
+
+    // removes every node.
+    void reset();
+
+    // number of nodes alive.
+    size_t size() const;
+
+    // number of slots, alive or free.
+    size_t capacity() const;
   private:
-    uint64_t getID();
+    static constexpr uint32_t kNoSlot = std::numeric_limits<uint32_t>::max();
+
+    struct Slot {
+      std::unique_ptr<TreeNode> node;
+      uint32_t generation = 0;
+      // handles sharing the node.
+      uint32_t refs = 0;
+      uint32_t arena = 0;
+      // kind of the node, and its neighbours in the list of the nodes of that kind.
+      uint32_t kind = kNoSlot;
+      uint32_t prev_of_kind = kNoSlot;
+      uint32_t next_of_kind = kNoSlot;
+    };
+
+    // nodes of a concrete type, linked through their slots.
+    struct Kind {
+      const base::rtti::TypeMetadata* metadata;
+      uint32_t first = kNoSlot;
+      uint32_t last = kNoSlot;
+      size_t size = 0;
+    };
+
+    uint64_t add(std::unique_ptr<TreeNode>&& node);
+
+    uint64_t share(uint64_t id)
+    {
+      m_slots[static_cast<uint32_t>(id)].refs++;
+      return id;
+    }
+
+    void copy_sem(uint32_t from, uint32_t to);
+
+    void link(uint32_t index);
+
+    void unlink(uint32_t index);
 
-    std::unordered_map<uint64_t, std::unique_ptr<TreeNode>> m_ctx;
+    bool owns(const TreeNode* node) const
+    {
+      auto index = static_cast<uint32_t>(node->m_handle);
+
+      return index < m_slots.size() && m_slots[index].node.get() == node;
+    }
+
+    std::vector<Slot> m_slots;
+    // free slots, the last one is taken first. A stack rather than a list through the slots,
+    // taking a slot doesn't wait on reading the one freed before it.
+    std::vector<uint32_t> m_free;
+    size_t m_size = 0;
+
+    SemColumns m_sem;
+
+    std::vector<Kind> m_kinds;
+    base::HashMap<const base::rtti::TypeMetadata*, uint32_t> m_kind_indices;
+
+    struct RecentKind {
+      const base::rtti::TypeMetadata* metadata = nullptr;
+      uint32_t index = 0;
+    };
+
+    // kinds last looked up, by the address of their metadata.
+    std::array<RecentKind, 32> m_recent_kinds;
+
+    // nodes being destroyed, those of a subtree are destroyed one after the other rather than
+    // each by its parent, however deep the subtree.
+    std::vector<std::unique_ptr<TreeNode>> m_dying;
+    bool m_destroying = false;
+
+    // 0 is the arena of nodes made outside of any.
+    uint32_t m_arena = 0;
+    uint32_t m_num_arenas = 0;
   };
 
-  ASTContext& context();
+  template<typename T>
+  CRef<T>::~CRef()
+  {
+    release();
+  }
+
+  template<typename T>
+  void CRef<T>::release()
+  {
+    if (m_id != kNone)
+      context().remove(m_id);
+
+    m_id = kNone;
+  }
 
   template<typename T>
   T* CRef<T>::get()
   {
-    assert(m_id != std::numeric_limits<uint64_t>::max());
+    assert(m_id != kNone);
 
-    if (m_id == std::numeric_limits<uint64_t>::max()) return nullptr;
+    if (m_id == kNone) return nullptr;
 
     return static_cast<T*>(context().get(m_id));
   }
@@ -233,64 +463,64 @@ namespace kate::tlr::ast {
 
     const std::string& name() const;
 
-    void setSem(std::unique_ptr<sem::Decl>&& sem);
+    // marks the declaration resolved, of type 'type'.
+    void setSem(types::Type* type);
 
-    sem::Decl* sem();
+    // empty until the declaration is resolved.
+    sem::Decl sem();
   protected:
     std::string m_name;
-  private:
-    std::unique_ptr<sem::Decl> m_sem;
   };
 
   class Module : public base::rtti::Castable<Module, TreeNode> {
   public:
     Module(
-      std::vector<CRef<Decl>>&& declaration_list
+      List<Decl>&& declaration_list
     );
 
     CRef<TreeNode> clone() override;
 
-    std::vector<CRef<Decl>>& global_declarations();
+    List<Decl>& global_declarations();
 
     sem::Module* sem();
 
     void setSem(std::unique_ptr<sem::Module>&& sem);
   private:
-    std::vector<CRef<Decl>> m_global_declarations;
+    List<Decl> m_global_declarations;
     std::unique_ptr<sem::Module> m_sem;
   };
 
   class Expr : public base::rtti::Castable<Expr, TreeNode> {
   public:
-    sem::Expr* sem();
-  
-    void setSem(std::unique_ptr<sem::Expr>&& sem);
-  private:
-    std::unique_ptr<sem::Expr> m_sem;
+    // empty until the expression is resolved.
+    sem::Expr sem();
+
+    // marks the expression resolved, of type 'type'.
+    void setSem(types::Type* type = nullptr);
   };
 
   class ArrayExpr : public base::rtti::Castable<ArrayExpr, Expr> {
   public:
     ArrayExpr(
-      std::vector<CRef<Expr>>&& items
+      List<Expr>&& items
     );
 
     ast::CRef<ast::TreeNode> clone() override;
 
-    std::vector<CRef<Expr>>& items();
+    List<Expr>& items();
   private:
-    std::vector<CRef<Expr>> m_items;
+    List<Expr> m_items;
   };
 
   class IdExpr : public base::rtti::Castable<IdExpr, Expr> {
   public:
-    IdExpr(const std::string& ident);
+    IdExpr(std::string_view ident);
 
     ast::CRef<ast::TreeNode> clone() override;
 
-    const std::string& ident() const;
+    std::string_view ident() const;
   private:
-    std::string m_ident;
+    std::string_view m_ident;
   };
 
   class LitExpr : public base::rtti::Castable<LitExpr, Expr> {
@@ -444,15 +674,22 @@ namespace kate::tlr::ast {
       kLocation,
       kInput,
       kBuiltin,
+      // marks functions run by 'ksc --test', see 'TestRunner'.
+      kTest,
+      kCase,
       kCount
     };
 
-    Attr(Type type, std::vector<CRef<Expr>>&& args = {});
+    Attr(Type type, List<Expr>&& args = {});
 
     CRef<TreeNode> clone() override;
+
+    Type type() const;
+
+    List<Expr>& args();
   private:
     Type m_type;
-    std::vector<CRef<Expr>> m_args;
+    List<Expr> m_args;
   };
 
   class Type;
@@ -462,17 +699,17 @@ namespace kate::tlr::ast {
     FuncArg(
       const std::string& name,
       CRef<Type>&& type,
-      std::vector<CRef<Attr>>&& attrs = {}
+      List<Attr>&& attrs = {}
     );
 
     CRef<TreeNode> clone() override;
 
     CRef<Type>& type();
 
-    std::vector<CRef<Attr>>& attrs();
+    List<Attr>& attrs();
   private:
     CRef<Type> m_type;
-    std::vector<CRef<Attr>> m_attrs;
+    List<Attr> m_attrs;
   };
 
   class BlockStat;
@@ -483,23 +720,23 @@ namespace kate::tlr::ast {
       CRef<Type>&& type,
       const std::string& name,
       CRef<BlockStat>&& block,
-      std::vector<CRef<FuncArg>>&& args = {},
-      std::vector<CRef<Attr>>&& attributes = {}
+      List<FuncArg>&& args = {},
+      List<Attr>&& attributes = {}
     );
 
     CRef<TreeNode> clone() override;
 
-    std::vector<CRef<Attr>>& attrs();
+    List<Attr>& attrs();
 
     CRef<BlockStat>& block();
 
-    std::vector<CRef<FuncArg>>& args();
+    List<FuncArg>& args();
 
     CRef<Type>& type();
   private:
-    std::vector<CRef<FuncArg>> m_args;
+    List<FuncArg> m_args;
 
-    std::vector<CRef<Attr>> m_attrs;
+    List<Attr> m_attrs;
 
     CRef<BlockStat> m_block;
 
@@ -520,19 +757,37 @@ namespace kate::tlr::ast {
     CRef<Type> m_type;
   };
 
+  class ConstDecl final : public base::rtti::Castable<ConstDecl, Decl> {
+  public:
+    ConstDecl(
+      const std::string& name,
+      CRef<Type>&& type,
+      CRef<Expr>&& initializer
+    );
+
+    CRef<TreeNode> clone() override;
+
+    CRef<Type>& type();
+
+    CRef<Expr>& expr();
+  private:
+    CRef<Type> m_type;
+    CRef<Expr> m_initializer;
+  };
+
   class Type : public base::rtti::Castable<Type, Expr> {
   public:
   };
 
   class TypeId final : public base::rtti::Castable<TypeId, Type> {
   public:
-    TypeId(const std::string& id);
+    TypeId(std::string_view id);
 
     CRef<TreeNode> clone() override;
 
-    std::string& id();
+    std::string_view id();
   private:
-    std::string m_id;
+    std::string_view m_id;
   };
 
   class ArrayType final : public base::rtti::Castable<ArrayType, Type> {
@@ -554,7 +809,7 @@ namespace kate::tlr::ast {
     StructMember(
       CRef<Type>&& type,
       const std::string& name,
-      std::vector<CRef<Attr>>&& attrs = {}
+      List<Attr>&& attrs = {}
     );
 
     CRef<TreeNode> clone() override;
@@ -563,21 +818,21 @@ namespace kate::tlr::ast {
 
     const std::string& name();
 
-    std::vector<CRef<Attr>>& attrs();
+    List<Attr>& attrs();
   private:
     CRef<Type> m_type;
-    std::vector<CRef<Attr>> m_attrs;
+    List<Attr> m_attrs;
   };
 
   class Stat : public base::rtti::Castable<Stat, TreeNode> {};
 
   class BlockStat final : public base::rtti::Castable<BlockStat, Stat> {
   public:
-    BlockStat(std::vector<CRef<Stat>>&& stats);
+    BlockStat(List<Stat>&& stats);
 
     CRef<TreeNode> clone() override;
 
-    std::vector<CRef<Stat>>& stats();
+    List<Stat>& stats();
 
     sem::BlockStat* sem();
 
@@ -585,7 +840,7 @@ namespace kate::tlr::ast {
   private:
     std::unique_ptr<sem::BlockStat> m_sem;
 
-    std::vector<CRef<Stat>> m_stats;
+    List<Stat> m_stats;
   };
 
   class VarStat final : public base::rtti::Castable<VarStat, Stat> {
@@ -663,7 +918,7 @@ namespace kate::tlr::ast {
   class ForStat final : public base::rtti::Castable<ForStat, Stat> {
   public:
     ForStat(
-      CRef<ExprStat>&& initializer,
+      CRef<Stat>&& initializer,
       CRef<Expr>&& condition,
       CRef<ExprStat>&& continuing,
       CRef<BlockStat>&& block
@@ -671,7 +926,7 @@ namespace kate::tlr::ast {
 
     CRef<TreeNode> clone() override;
 
-    CRef<ExprStat>& initializer();
+    CRef<Stat>& initializer();
 
     CRef<Expr>& condition();
 
@@ -679,7 +934,7 @@ namespace kate::tlr::ast {
 
     CRef<BlockStat>& block();
   private:
-    CRef<ExprStat> m_initializer;
+    CRef<Stat> m_initializer;
     CRef<Expr> m_condition;
     CRef<ExprStat> m_continuing;
     CRef<BlockStat> m_block;
@@ -689,17 +944,17 @@ namespace kate::tlr::ast {
   public:
     CallExpr(
       CRef<IdExpr>&& id,
-      std::vector<CRef<Expr>>&& args
+      List<Expr>&& args
     );
 
     CRef<TreeNode> clone() override;
 
     CRef<IdExpr>& id();
 
-    std::vector<CRef<Expr>>& args();
+    List<Expr>& args();
   private:
     CRef<IdExpr> m_id;
-    std::vector<CRef<Expr>> m_args;
+    List<Expr> m_args;
   };
 
   class WhileStat final : public base::rtti::Castable<WhileStat, Stat> {
@@ -720,18 +975,18 @@ namespace kate::tlr::ast {
   public:
     StructDecl(
       const std::string& name,
-      std::vector<CRef<StructMember>>&& members,
-      std::vector<CRef<Attr>>&& attrs = {}
+      List<StructMember>&& members,
+      List<Attr>&& attrs = {}
     );
 
     CRef<TreeNode> clone() override;
 
-    std::vector<CRef<StructMember>>& members();
+    List<StructMember>& members();
 
-    std::vector<CRef<Attr>>& attrs();
+    List<Attr>& attrs();
   private:
-    std::vector<CRef<StructMember>> m_members;
-    std::vector<CRef<Attr>> m_attrs;
+    List<StructMember> m_members;
+    List<Attr> m_attrs;
   };
 
   enum class AccessMode {
@@ -751,7 +1006,7 @@ namespace kate::tlr::ast {
       const std::string& name,
       BufferArgs args,
       CRef<Type>&& type,
-      std::vector<CRef<Attr>>&& attributes
+      List<Attr>&& attributes
     );
 
     CRef<TreeNode> clone() override;
@@ -760,11 +1015,11 @@ namespace kate::tlr::ast {
 
     const BufferArgs& args() const;
     
-    std::vector<CRef<Attr>>& attributes();
+    List<Attr>& attributes();
   private:
     BufferArgs m_args;
     CRef<Type> m_type;
-    std::vector<CRef<Attr>> m_attributes;
+    List<Attr> m_attributes;
   };
 
   class UniformDecl final : public base::rtti::Castable<UniformDecl, Decl> {
@@ -772,19 +1027,29 @@ namespace kate::tlr::ast {
     UniformDecl(
       CRef<Type>&& type,
       const std::string& name,
-      std::vector<CRef<Attr>>&& attributes
+      List<Attr>&& attributes
     );
 
     CRef<TreeNode> clone() override;
 
-    const std::string& name() const;
-
     CRef<Type>& type();
 
-    std::vector<CRef<Attr>>& attributes();
+    List<Attr>& attributes();
   private:
-    std::string m_name;
-    std::vector<CRef<Attr>> m_attributes;
+    List<Attr> m_attributes;
     CRef<Type> m_type;
   };
+
+  // 'import "FILE";', replaced by the declarations it brings in before the module is resolved.
+  class ImportDecl final : public base::rtti::Castable<ImportDecl, Decl> {
+  public:
+    ImportDecl(const std::string& path);
+
+    CRef<TreeNode> clone() override;
+
+    // path of the imported file, relative to the file importing it.
+    const std::string& path() const;
+  private:
+    std::string m_path;
+  };
 }
\ No newline at end of file
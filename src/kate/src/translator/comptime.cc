@@ -0,0 +1,263 @@
+#include "comptime.h"
+
+namespace kate::tlr::comptime {
+  template<typename T>
+  std::optional<T> binary_expr_eval(ast::BinaryExpr::Type type, T lhs, T rhs) {
+    switch (type) {
+      case ast::BinaryExpr::Type::kAdd:
+        return lhs + rhs;
+      case ast::BinaryExpr::Type::KSub:
+      case ast::BinaryExpr::Type::kSubtract:
+        return lhs - rhs;
+      case ast::BinaryExpr::Type::kMul:
+      case ast::BinaryExpr::Type::kMultiply:
+        return lhs * rhs;
+      case ast::BinaryExpr::Type::kDiv:
+      case ast::BinaryExpr::Type::kDivide:
+        if constexpr (std::is_integral_v<T>)
+          if (rhs == 0)
+            return std::nullopt;
+
+        return lhs / rhs;
+      default:
+        if constexpr (std::is_integral_v<T>) {
+          switch (type) {
+            case ast::BinaryExpr::Type::kMod:
+            case ast::BinaryExpr::Type::kModulus:
+              if (rhs == 0)
+                return std::nullopt;
+
+              return lhs % rhs;
+            case ast::BinaryExpr::Type::kBitXor:
+              return lhs ^ rhs;
+            case ast::BinaryExpr::Type::kBitOr:
+              return lhs | rhs;
+            case ast::BinaryExpr::Type::kBitAnd:
+              return lhs & rhs;
+            default:
+              break;
+          }
+        }
+
+        return std::nullopt;
+    }
+  }
+
+  template<typename T>
+  std::optional<bool> compare_expr_eval(ast::BinaryExpr::Type type, T lhs, T rhs) {
+    switch (type) {
+      case ast::BinaryExpr::Type::kEqualEqual:
+        return lhs == rhs;
+      case ast::BinaryExpr::Type::kNotEqual:
+        return lhs != rhs;
+      case ast::BinaryExpr::Type::kGreaterThan:
+        return lhs > rhs;
+      case ast::BinaryExpr::Type::kGreaterThanEqual:
+        return lhs >= rhs;
+      case ast::BinaryExpr::Type::kLessThan:
+        return lhs < rhs;
+      case ast::BinaryExpr::Type::kLessThanEqual:
+        return lhs <= rhs;
+      case ast::BinaryExpr::Type::kAndAnd:
+        return lhs && rhs;
+      case ast::BinaryExpr::Type::kOrOr:
+        return lhs || rhs;
+      default:
+        return std::nullopt;
+    }
+  }
+
+  ast::LitExpr::Value make_bool(bool value)
+  {
+    return ast::LitExpr::Value {
+      .type = ast::LitExpr::Value::kI32,
+      .value.i64 = value ? 1 : 0
+    };
+  }
+
+  std::optional<ast::LitExpr::Value> eval(
+    ast::Expr* expr,
+    const Bindings* bindings
+  )
+  {
+    if (auto bexpr = expr->as<ast::BinaryExpr>())
+      return eval(bexpr, bindings);
+    else if (auto uexpr = expr->as<ast::UnaryExpr>())
+      return eval(uexpr, bindings);
+    else if (auto litexpr = expr->as<ast::LitExpr>())
+      return litexpr->value();
+    else if (auto idexpr = expr->as<ast::IdExpr>(); idexpr && bindings) {
+      auto it = bindings->find(idexpr->ident());
+
+      if (it != bindings->end())
+        return it->second;
+    }
+
+    return std::nullopt;
+  }
+
+  std::optional<ast::LitExpr::Value> eval(
+    ast::UnaryExpr* uexpr,
+    const Bindings* bindings
+  )
+  {
+    auto val = eval(uexpr->operand().get(), bindings);
+
+    if (!val)
+      return std::nullopt;
+
+    switch (uexpr->type()) {
+      case ast::UnaryExpr::Type::kPlus:
+        return val;
+      case ast::UnaryExpr::Type::kMinus:
+        if (val->type & ast::LitExpr::Value::Type::kFloatMask)
+          val->value.f64 = -val->value.f64;
+        else if (val->type & ast::LitExpr::Value::Type::kSignedIntMask)
+          val->value.i64 = -val->value.i64;
+        else
+          return std::nullopt;
+
+        return val;
+      case ast::UnaryExpr::Type::kFlip:
+        if (!(val->type & ast::LitExpr::Value::Type::kIntMask))
+          return std::nullopt;
+
+        val->value.u64 = ~val->value.u64;
+        return val;
+      case ast::UnaryExpr::Type::kNot:
+        if (val->type & ast::LitExpr::Value::Type::kFloatMask)
+          return make_bool(val->value.f64 == 0.0);
+
+        return make_bool(val->value.u64 == 0);
+      default:
+        return std::nullopt;
+    }
+  }
+
+  std::optional<ast::LitExpr::Value> eval(
+    ast::BinaryExpr* bexpr,
+    const Bindings* bindings
+  )
+  {
+    auto lhs_val = eval(bexpr->lhs().get(), bindings);
+
+    if (!lhs_val)
+      return std::nullopt;
+
+    auto rhs_val = eval(bexpr->rhs().get(), bindings);
+
+    if (!rhs_val)
+      return std::nullopt;
+
+    // comparisons between a float and a float, or between integers.
+    std::optional<bool> cmp;
+
+    if ((lhs_val->type & ast::LitExpr::Value::Type::kFloatMask) &&
+          (rhs_val->type & ast::LitExpr::Value::Type::kFloatMask))
+      cmp = compare_expr_eval(bexpr->type(), lhs_val->value.f64, rhs_val->value.f64);
+    else if ((lhs_val->type & ast::LitExpr::Value::Type::kUnsignedIntMask) &&
+          (rhs_val->type & ast::LitExpr::Value::Type::kUnsignedIntMask))
+      cmp = compare_expr_eval(bexpr->type(), lhs_val->value.u64, rhs_val->value.u64);
+    else if ((lhs_val->type & ast::LitExpr::Value::Type::kIntMask) &&
+          (rhs_val->type & ast::LitExpr::Value::Type::kIntMask))
+      cmp = compare_expr_eval(bexpr->type(), lhs_val->value.i64, rhs_val->value.i64);
+
+    if (cmp)
+      return make_bool(cmp.value());
+
+    ast::LitExpr::Value::Type type;
+
+    // if it's a 'float <expr> float' binary expression
+    if ((lhs_val->type & ast::LitExpr::Value::Type::kFloatMask) &&
+          (rhs_val->type & ast::LitExpr::Value::Type::kFloatMask))
+    {
+      // then we check if types are equal
+      if (lhs_val->type == rhs_val->type)
+        type = lhs_val->type;
+      else
+        // if types are not equal then we assume one of them is a 64 bit floating point value.
+        type = ast::LitExpr::Value::kF64;
+
+      auto result = binary_expr_eval(bexpr->type(), lhs_val->value.f64, rhs_val->value.f64);
+
+      if (!result)
+        return std::nullopt;
+
+      return ast::LitExpr::Value {
+        .type = type,
+        .value.f64 = result.value()
+      };
+    }
+    // if it's a 'uint <expr> uint' binary expression
+    else if ((lhs_val->type & ast::LitExpr::Value::Type::kUnsignedIntMask) &&
+          (rhs_val->type & ast::LitExpr::Value::Type::kUnsignedIntMask))
+    {
+      // then we check if types are equal
+      if (lhs_val->type == rhs_val->type)
+        type = lhs_val->type;
+      else
+        // if types are not equal then we assume one of them is a 64 unsigned integer value.
+        type = ast::LitExpr::Value::kU64;
+
+      auto result = binary_expr_eval(bexpr->type(), lhs_val->value.u64, rhs_val->value.u64);
+
+      if (!result)
+        return std::nullopt;
+
+      return ast::LitExpr::Value {
+        .type = type,
+        .value.u64 = result.value()
+      };
+    }
+    // if it's a 'int <expr> int' binary expression
+    else if ((lhs_val->type & ast::LitExpr::Value::Type::kIntMask) &&
+          (rhs_val->type & ast::LitExpr::Value::Type::kIntMask))
+    {
+      // then we check if types are equal
+      if (lhs_val->type == rhs_val->type)
+        type = lhs_val->type;
+      else
+        // if types are not equal then we assume one of them is a 64 bit signed integer value.
+        type = ast::LitExpr::Value::kI64;
+
+      auto result = binary_expr_eval(bexpr->type(), lhs_val->value.i64, rhs_val->value.i64);
+
+      if (!result)
+        return std::nullopt;
+
+      return ast::LitExpr::Value {
+        .type = type,
+        .value.i64 = result.value()
+      };
+    }
+
+    // compile time evaluation failed.
+    return std::nullopt;
+  }
+
+  Bindings consts(
+    ast::Module* module,
+    const Bindings* specialization
+  )
+  {
+    Bindings consts;
+
+    for (auto& decl : module->global_declarations()) {
+      auto* const_decl = decl->as<ast::ConstDecl>();
+
+      if (!const_decl) continue;
+
+      if (specialization) {
+        if (auto it = specialization->find(const_decl->name()); it != specialization->end()) {
+          consts[const_decl->name()] = it->second;
+          continue;
+        }
+      }
+
+      if (auto value = eval(const_decl->expr().get(), &consts))
+        consts[const_decl->name()] = value.value();
+    }
+
+    return consts;
+  }
+}
\ No newline at end of file
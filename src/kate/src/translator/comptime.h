@@ -0,0 +1,40 @@
+#pragma once
+
+#include "ast.h"
+
+#include "base/hash_map.h"
+
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace kate::tlr::comptime {
+  // values of identifiers known at compile time, like constants of a shader variant.
+  using Bindings = std::unordered_map<std::string, ast::LitExpr::Value, base::Hash<std::string>, std::equal_to<>>;
+
+  // Evaluates an expression at compile time, returns std::nullopt when
+  // the expression can't be folded into a literal.
+  //
+  // Comparisons and logical operators evaluate to an 'int' holding 0 or 1.
+  std::optional<ast::LitExpr::Value> eval(
+    ast::Expr* expr,
+    const Bindings* bindings = nullptr
+  );
+
+  std::optional<ast::LitExpr::Value> eval(
+    ast::BinaryExpr* bexpr,
+    const Bindings* bindings = nullptr
+  );
+
+  std::optional<ast::LitExpr::Value> eval(
+    ast::UnaryExpr* uexpr,
+    const Bindings* bindings = nullptr
+  );
+
+  // Values of the global constants of 'module', each evaluated with the ones declared before
+  // it. Constants of 'specialization' take its values, and those using them follow.
+  Bindings consts(
+    ast::Module* module,
+    const Bindings* specialization = nullptr
+  );
+}
\ No newline at end of file
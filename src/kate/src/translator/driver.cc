@@ -0,0 +1,124 @@
+#include "driver.h"
+#include "modules.h"
+#include "reflection.h"
+#include "resolver.h"
+#include "serialize.h"
+
+#include "passes/unroll.h"
+#include "passes/vectorize.h"
+#include "printers/cpp.h"
+#include "printers/cpp_structs.h"
+#include "printers/glsl.h"
+#include "printers/hlsl.h"
+
+#include "base/trace.h"
+
+#include <algorithm>
+#include <array>
+
+namespace kate::tlr {
+  namespace {
+    constexpr std::array<std::string_view, 7> kTargets = {
+      "glsl", "hlsl", "reflect", "reflect-json", "cpp", "cpp-structs", "ast"
+    };
+  }
+
+  bool is_target(std::string_view target)
+  {
+    return std::find(kTargets.begin(), kTargets.end(), target) != kTargets.end();
+  }
+
+  std::span<const std::string_view> targets()
+  {
+    return kTargets;
+  }
+
+  ast::CRef<ast::Module> compile(
+    std::string_view source,
+    const ParserOptions& options,
+    const std::filesystem::path& path,
+    const std::vector<std::string>& specialized
+  )
+  {
+    TS_TRACE_ZONE("compile");
+
+    Parser parser(options);
+
+    auto module = parser.parse(source);
+
+    if (!module) return module;
+
+    if (!link_imports(module.get(), path.parent_path(), options)) return {};
+
+    LoopUnroller unroller(UnrollOptions { .specialized = specialized });
+    unroller.run(module.get());
+
+    Resolver resolver;
+    resolver.resolve(module.get());
+
+    Vectorizer vectorizer;
+    vectorizer.run(module.get());
+
+    return module;
+  }
+
+  std::unordered_map<std::string, std::string> emit(
+    ast::Module* module,
+    const std::vector<std::string>& targets
+  )
+  {
+    TS_TRACE_ZONE("emit");
+
+    auto wants = [&](std::string_view target) {
+      return std::find(targets.begin(), targets.end(), target) != targets.end();
+    };
+
+    std::vector<const Dialect*> dialects;
+    std::vector<std::string> sources;
+
+    for (auto [target, dialect] : { std::pair("glsl", &glsl()), std::pair("hlsl", &hlsl()) })
+      if (wants(target)) {
+        sources.push_back(target);
+        dialects.push_back(dialect);
+      }
+
+    std::unordered_map<std::string, std::string> generated;
+
+    if (!dialects.empty()) {
+      Printer printer(std::move(dialects));
+      printer.print(module);
+
+      for (size_t i = 0; i < sources.size(); i++)
+        generated[sources[i]] = printer.str(i);
+    }
+
+    if (wants("reflect") || wants("reflect-json")) {
+      auto reflection = Reflector(module).reflect();
+
+      if (wants("reflect")) {
+        auto blob = to_binary(reflection);
+        generated["reflect"].assign(blob.begin(), blob.end());
+      }
+
+      if (wants("reflect-json"))
+        generated["reflect-json"] = to_json(reflection);
+    }
+
+    if (wants("cpp-structs")) {
+      CppStructPrinter printer;
+      printer.print(module);
+      generated["cpp-structs"] = printer.str();
+    }
+
+    if (wants("cpp")) {
+      CppPrinter printer;
+      printer.print(module);
+      generated["cpp"] = printer.str();
+    }
+
+    if (wants("ast"))
+      generated["ast"] = serialize(module);
+
+    return generated;
+  }
+}
\ No newline at end of file
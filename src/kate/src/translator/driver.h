@@ -0,0 +1,36 @@
+#pragma once
+
+#include "ast.h"
+#include "parser.h"
+
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace kate::tlr {
+  // targets 'emit' is able to generate.
+  bool is_target(std::string_view target);
+
+  std::span<const std::string_view> targets();
+
+  // lexes and parses 'source', links the modules it imports, relative to the directory of
+  // 'path', then runs the passes and the resolver over it. Returns an empty ref when the
+  // source or its imports don't parse. Loops bounded by the 'specialized' constants, which
+  // variants give other values, aren't unrolled.
+  ast::CRef<ast::Module> compile(
+    std::string_view source,
+    const ParserOptions& options,
+    const std::filesystem::path& path = {},
+    const std::vector<std::string>& specialized = {}
+  );
+
+  // Generates each of 'targets' for a resolved module, glsl and hlsl come out of the same
+  // walk of the module. Returns the output of each target.
+  std::unordered_map<std::string, std::string> emit(
+    ast::Module* module,
+    const std::vector<std::string>& targets
+  );
+}
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include <cstdio>
 #include <charconv>
 #include <stdexcept>
+#include <string>
 #include <iostream>
 #include <utility>
 
@@ -43,7 +44,10 @@ namespace kate::tlr {
   {
   }
 
-  void Lexer::tokenize(const std::string_view& source)
+  void Lexer::tokenize(
+    const std::string_view& source,
+    const std::function<void(const std::string_view& error)>& error_callback
+  )
   {
     size_t offset = 0;
 
@@ -95,7 +99,12 @@ namespace kate::tlr {
     };
 
     auto show_error_and_die = [&](std::string_view str) {
-      std::cerr << "ERROR (" << loc.line << ":" << loc.column << "): " << str << std::endl;
+      auto message = "LEXER ERROR (" + std::to_string(loc.line) + ":" + std::to_string(loc.column) + "): " + std::string(str);
+
+      if (error_callback)
+        error_callback(message);
+      else
+        std::cerr << message << std::endl;
 
       std::exit(1);
     };
@@ -217,7 +226,7 @@ namespace kate::tlr {
 
             m_tokens.emplace_back(
               Token::Type::kUint32,
-              static_cast<int64_t>(value),
+              static_cast<uint64_t>(value),
               loc
             );
           } else if (matches(0, 's')) {
@@ -226,7 +235,7 @@ namespace kate::tlr {
             if (base::in_range<uint16_t>(value)) {
               m_tokens.emplace_back(
                 Token::Type::kUint16,
-                static_cast<int64_t>(value),
+                static_cast<uint64_t>(value),
                 loc
               );
             } else show_error_and_die("Value overflows u16 limits.");
@@ -234,7 +243,7 @@ namespace kate::tlr {
             if (base::in_range<uint32_t>(value)) {
               m_tokens.emplace_back(
                 Token::Type::kUint32,
-                static_cast<int64_t>(value),
+                static_cast<uint64_t>(value),
                 loc
               );
             } else show_error_and_die("Value overflows u32 limits.");
@@ -296,11 +305,22 @@ namespace kate::tlr {
 
       switch (c) {
         case '=':
-          m_tokens.emplace_back(
-            Token::Type::kEqual,
-            std::string_view { &source[offset], 1 },
-            loc
-          );
+          if (matches(1, '=')) {
+            m_tokens.emplace_back(
+              Token::Type::kEqEq,
+              std::string_view { &source[offset], 2 },
+              loc
+            );
+
+            advance();
+          } else {
+            m_tokens.emplace_back(
+              Token::Type::kEqual,
+              std::string_view { &source[offset], 1 },
+              loc
+            );
+          }
+
           advance();
           break;
         case '?':
@@ -499,11 +519,22 @@ namespace kate::tlr {
           }
           break;
         case '!':
-          m_tokens.emplace_back(
-            Token::Type::kExclamation,
-            std::string_view { &source[offset], 1 },
-            loc
-          );
+          if (matches(1, '=')) {
+            m_tokens.emplace_back(
+              Token::Type::kNotEq,
+              std::string_view { &source[offset], 2 },
+              loc
+            );
+
+            advance();
+          } else {
+            m_tokens.emplace_back(
+              Token::Type::kExclamation,
+              std::string_view { &source[offset], 1 },
+              loc
+            );
+          }
+
           advance();
           break;
         case ')':
@@ -629,6 +660,28 @@ namespace kate::tlr {
         case '\n':
           advance();
           break;
+        case '"': {
+          auto location = loc;
+
+          advance(); // "
+
+          auto start = offset;
+
+          while (can_peek(0) && !matches(0, '"') && !matches(0, '\n'))
+            advance();
+
+          if (!matches(0, '"'))
+            show_error_and_die("Missing '\"' at the end of a string.");
+
+          m_tokens.emplace_back(
+            Token::Type::kString,
+            std::string_view { &source[start], offset - start },
+            location
+          );
+
+          advance(); // "
+          break;
+        }
         case '{':
           m_tokens.emplace_back(
             Token::Type::kLBrace,
@@ -686,9 +739,7 @@ namespace kate::tlr {
           advance();
           break;
         default:
-          static auto err = std::string { "ERROR: Unhandled token '" } + peek(0) + "'";
-          
-          show_error_and_die(err);
+          show_error_and_die(std::string { "Unhandled token '" } + peek(0) + "'");
       }
     }
 
@@ -700,14 +751,6 @@ namespace kate::tlr {
         loc
       );
     }
-
-    for (auto& tok : m_tokens) {
-      std::visit([](auto& v) {
-        std::cerr << v << " ";
-      }, tok.value());
-    }
-
-    std::cerr << std::endl;
   }
 
   const std::vector<Token>& Lexer::tokens()
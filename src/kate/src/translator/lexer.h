@@ -1,5 +1,6 @@
 #pragma once
 
+#include <functional>
 #include <string_view>
 #include <vector>
 #include <variant>
@@ -67,6 +68,7 @@ namespace kate::tlr {
       kRightParen,// )
       kAt,        // @
       kIdent,     // identifier
+      kString,    // "...", the value excludes the quotes
       kEOF,
       kCount
     };
@@ -101,7 +103,11 @@ namespace kate::tlr {
   public:
     Lexer();
 
-    void tokenize(const std::string_view& source);
+    // errors are given to 'error_callback', or printed to stderr without one, and exit.
+    void tokenize(
+      const std::string_view& source,
+      const std::function<void(const std::string_view& error)>& error_callback = {}
+    );
 
     const std::vector<Token>& tokens();
 
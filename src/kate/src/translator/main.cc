@@ -1,21 +1,70 @@
-#include "parser.h"
-#include "resolver.h"
+#include "driver.h"
+#include "modules.h"
+#include "permutation.h"
+#include "sem.h"
+#include "serialize.h"
+#include "server.h"
+#include "testing.h"
+#include "watch.h"
 
-#include "printers/glsl.h"
+#include "passes/rewrite.h"
+#include "passes/traverse.h"
+
+#include "vm/compiler.h"
+#include "vm/machine.h"
+
+#include "base/trace.h"
 
 #include <fmt/format.h>
 
-namespace kate::tlr {
-  void error_callback(const std::string_view& message) {
-    fmt::println("PARSER ERROR: {}", message);
-  };
+#include <unistd.h>
 
-  int start(int argc, char* argv[]) {
-    tlr::Parser parser(tlr::ParserOptions {
-      .error_callback = error_callback
-    });
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <new>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+#if defined(KSC_COUNT_ALLOCATIONS)
+namespace {
+  // heap allocations of the process, e.g. for --bench-parse to count those of a parse.
+  std::atomic<size_t> g_allocations = 0;
+}
+
+void* operator new(size_t size)
+{
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+
+  if (auto p = std::malloc(size ? size : 1))
+    return p;
+
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+  std::free(p);
+}
 
-    auto module = parser.parse(R"(struct VertexOutput {
+void operator delete(void* p, size_t) noexcept
+{
+  std::free(p);
+}
+#endif
+
+namespace kate::tlr {
+  // shader translated when no input file is given.
+  const char* kSampleSource = R"(struct VertexOutput {
       @location(0) position : float4,
       @location(1) normal: float3
     }
@@ -59,13 +108,885 @@ namespace kate::tlr {
         fragment_input.normal.xxx,
         mymat[3]
       );
-    })");
+    })";
+
+  void error_callback(const std::string_view& message) {
+    fmt::println("PARSER ERROR: {}", message);
+  };
+
+  struct Output {
+    std::string target;
+    // '-' writes to stdout.
+    std::string path;
+  };
+
+  // writes the trace of the run to 'path' once ksc is done.
+  struct TraceOutput {
+    std::string path;
+
+    ~TraceOutput() {
+      if (path.empty()) return;
+
+      base::trace::stop();
+
+      if (!base::trace::write_chrome_json(path))
+        fmt::println("Unable to write the trace to '{}'.", path);
+    }
+  };
+
+  void usage() {
+    fmt::println("usage: ksc [options] [file.ksl]");
+    fmt::println("  --emit TARGET=FILE        write a target to FILE, '-' for stdout, may be repeated. Targets are");
+    fmt::println("                            glsl, hlsl, reflect, reflect-json, cpp, cpp-structs and ast, the");
+    fmt::println("                            resolved module saved as a '.ksla' file ksc reads back as input.");
+    fmt::println("  --permute NAME=v0,v1,...  emit a variant for each value of constant NAME.");
+    fmt::println("  -j N                      number of threads used to emit variants.");
+    fmt::println("  --reflect FILE            write the binary reflection of bindings and entry points to FILE.");
+    fmt::println("  --reflect-json FILE       write the reflection as JSON to FILE.");
+    fmt::println("  --cpp-structs FILE        write C++ structs matching the std140 and std430 layouts to FILE.");
+    fmt::println("  --hlsl FILE               write HLSL to FILE, printed in the same pass as the GLSL output.");
+    fmt::println("  --cpp FILE                write the compute entry points as C++ running on a thread pool to FILE.");
+    fmt::println("  --run ENTRY               run a compute entry point on the vm and print its invocations per second.");
+    fmt::println("  --workgroups X,Y,Z        number of workgroups dispatched by --run, defaults to 1,1,1.");
+    fmt::println("  --bytecode                print the bytecode of the entry point given to --run.");
+    fmt::println("  --test                    run the functions marked '@test' on the vm and report failures.");
+    fmt::println("  --trace FILE              write the zones of the run to FILE as a Chrome trace, Perfetto opens");
+    fmt::println("                            it too. Zones are compiled in by building with TS_TRACE.");
+    fmt::println("  --server PATH             compile requests sent to a unix domain socket at PATH, '-' for stdin.");
+    fmt::println("                            -j sets the number of requests compiled at once.");
+    fmt::println("  --load PATH               send the input file to the server at PATH and measure requests per");
+    fmt::println("                            second, with the targets of --emit or glsl.");
+    fmt::println("  --requests N              number of requests sent by --load, defaults to 1000.");
+    fmt::println("  --connections N           number of connections opened by --load, defaults to 4.");
+    fmt::println("  --cached                  send the same source with --load, so the server answers from its cache.");
+    fmt::println("  --interface FILE          print the declarations exported by the '.ksli' interface FILE.");
+    fmt::println("  --watch DIR               build the shaders of DIR and rebuild them as they change, the FILE of");
+    fmt::println("                            each --emit is the directory of its outputs, glsl next to them if none.");
+    fmt::println("  --check-repro N           compile the input file N times and check each target, and each variant");
+    fmt::println("                            of --permute with 1 to as many threads as cores, is the same every time.");
+    fmt::println("  --soak N                  recompile the input file N times, with an edit each time, and print");
+    fmt::println("                            the nodes, types and memory held along the way.");
+    fmt::println("  --bench-rewrite N         time a pass doing N rewrites, then a tenth and a hundredth of them.");
+    fmt::println("  --bench-clone N           time cloning a block of N nodes and replacing one of them, then of");
+    fmt::println("                            a tenth and a hundredth of them.");
+    fmt::println("  --bench-traverse N        time walking a sum of N nodes, balanced and as deep as it gets, then");
+    fmt::println("                            of a tenth and a hundredth of them.");
+    fmt::println("  --bench-parse N           parse the input file N times and print the time and the heap");
+    fmt::println("                            allocations of each parse, counted when building with");
+    fmt::println("                            KSC_COUNT_ALLOCATIONS.");
+    fmt::println("  --bench-ast N             compile the input file N times, then load it N times from a '.ksla'");
+    fmt::println("                            file, and print the time of each, not counting the removal of the module.");
+  }
+
+  std::optional<Output> parse_output(std::string_view str) {
+    auto eq = str.find('=');
+
+    if (eq == std::string_view::npos || eq + 1 == str.size()) return std::nullopt;
+
+    auto target = str.substr(0, eq);
+
+    if (!is_target(target)) return std::nullopt;
+
+    return Output { std::string(target), std::string(str.substr(eq + 1)) };
+  }
+
+  void write_output(const Output& output, std::string_view data) {
+    if (output.path == "-") {
+      fmt::print("{}", data);
+      return;
+    }
+
+    std::ofstream file { output.path, std::ios::binary };
+    file.write(data.data(), data.size());
+  }
+
+  std::optional<std::array<uint32_t, 3>> parse_workgroups(std::string_view str) {
+    std::array<uint32_t, 3> workgroups = { 1, 1, 1 };
+
+    for (size_t i = 0; i < workgroups.size() && !str.empty(); i++) {
+      auto comma = str.find(',');
+      auto value = str.substr(0, comma);
+
+      auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), workgroups[i]);
+
+      if (ec != std::errc() || ptr != value.data() + value.size()) return std::nullopt;
+
+      str = (comma == std::string_view::npos) ? std::string_view() : str.substr(comma + 1);
+    }
+
+    return str.empty() ? std::optional(workgroups) : std::nullopt;
+  }
+
+  // Writes inputs for 'type' at 'offset' of 'memory': integers hold 'invocations', so
+  // bounds such as 'if id.x >= params.n' let every invocation through, and floats hold
+  // small values which differ from one element to the next.
+  void fill_binding(
+    std::vector<uint8_t>& memory,
+    types::Type* type,
+    types::Layout layout,
+    uint64_t offset,
+    uint64_t invocations
+  ) {
+    if (offset >= memory.size()) return;
+
+    if (auto scalar = type->as<types::Scalar>()) {
+      uint32_t bits;
+
+      if (scalar->mangledName() == "float")
+        bits = std::bit_cast<uint32_t>(1.0f + static_cast<float>(offset / 4 % 8) * 0.25f);
+      else if (scalar->size(layout) == 4)
+        bits = static_cast<uint32_t>(invocations);
+      else
+        return;
+
+      if (offset + sizeof(bits) <= memory.size())
+        std::memcpy(memory.data() + offset, &bits, sizeof(bits));
+    } else if (auto vec = type->as<types::Vec>()) {
+      auto component = vec->type();
+
+      for (size_t c = 0; c < vec->columns(); c++)
+        fill_binding(memory, component, layout, offset + c * component->size(layout), invocations);
+    } else if (auto mat = type->as<types::Mat>()) {
+      auto component = mat->type();
+
+      for (size_t c = 0; c < mat->columns(); c++)
+        for (size_t r = 0; r < mat->rows(); r++)
+          fill_binding(memory, component, layout, offset + c * mat->stride(layout) + r * component->size(layout), invocations);
+    } else if (auto array = type->as<types::Array>()) {
+      auto count = array->count() ? array->count() : invocations;
+
+      for (uint64_t i = 0; i < count; i++)
+        fill_binding(memory, array->type(), layout, offset + i * array->stride(layout), invocations);
+    } else if (auto custom = type->as<types::Custom>()) {
+      for (size_t i = 0; i < custom->members().size(); i++)
+        fill_binding(memory, custom->members()[i].type(), layout, offset + custom->offset(i, layout), invocations);
+    }
+  }
+
+  // Dispatches a compute entry point on the vm with the inputs of 'fill_binding', arrays
+  // without a size get one element per invocation.
+  void run_program(
+    const vm::Program& program,
+    std::array<uint32_t, 3> num_workgroups
+  ) {
+    auto& size = program.workgroup_size;
+    uint64_t invocations = uint64_t(size[0]) * size[1] * size[2] *
+      num_workgroups[0] * num_workgroups[1] * num_workgroups[2];
+
+    vm::Machine machine(program);
+    std::vector<std::vector<uint8_t>> memory;
+
+    for (auto& binding : program.bindings) {
+      auto bytes = binding.type->size(binding.layout);
+
+      if (auto array = binding.type->as<types::Array>(); array && array->count() == 0)
+        bytes = array->stride(binding.layout) * invocations;
+
+      memory.emplace_back(bytes);
+      fill_binding(memory.back(), binding.type, binding.layout, 0, invocations);
+
+      machine.bind(binding.name, memory.back().data(), bytes);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    machine.dispatch(num_workgroups);
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    fmt::println(
+      "{}: {} invocations in {:.3f} ms, {:.0f} invocations/s",
+      program.entry,
+      invocations,
+      elapsed.count() * 1000.0,
+      invocations / std::max(elapsed.count(), 1e-9)
+    );
+  }
+
+  // Compares compiling a module with loading it back from its serialized form.
+  void bench_ast(const std::string& source, const std::string& path, size_t iterations) {
+    ParserOptions options {
+      .error_callback = error_callback
+    };
+
+    auto module = compile(source, options, path);
+
+    if (!module) std::exit(1);
+
+    auto ast_path = std::filesystem::temp_directory_path() / fmt::format("ksc-bench-{}.ksla", getpid());
+
+    write_output(Output { "ast", ast_path.string() }, serialize(module.get()));
+
+    // both start from the same empty context.
+    module = {};
+
+    // the module is removed out of the measure, it's the same tree either way.
+    auto time = [&](auto&& fn) {
+      std::chrono::duration<double, std::milli> elapsed {};
+
+      for (size_t i = 0; i < iterations; i++) {
+        auto start = std::chrono::steady_clock::now();
+        auto result = fn();
+        elapsed += std::chrono::steady_clock::now() - start;
+      }
+
+      return elapsed.count() / iterations;
+    };
+
+    auto compile_ms = time([&] { return compile(source, options, path); });
+
+    auto load_ms = time([&] {
+      auto serialized = SerializedModule::map(ast_path);
+      auto loaded = serialized ? serialized->load() : ast::CRef<ast::Module>();
+
+      if (!loaded) {
+        fmt::println("Unable to load '{}'.", ast_path.string());
+        std::exit(1);
+      }
+
+      return loaded;
+    });
+
+    std::filesystem::remove(ast_path);
+
+    fmt::println(
+      "compile: {:.3f} ms, load: {:.3f} ms, {:.1f}x faster",
+      compile_ms,
+      load_ms,
+      compile_ms / std::max(load_ms, 1e-9)
+    );
+  }
+
+  // Compiles the input 'iterations' times in this process, so after other modules were made
+  // and at other addresses, and checks every target and variant comes out byte for byte the
+  // same, variants with each thread count up to the number of cores.
+  int check_repro(
+    const std::string& source,
+    const std::string& path,
+    const std::vector<PermutationOption>& permutations,
+    size_t iterations
+  ) {
+    ParserOptions options {
+      .error_callback = error_callback
+    };
+
+    std::vector<std::string> all_targets(targets().begin(), targets().end());
+
+    std::unordered_map<std::string, std::string> first;
+    std::vector<std::string> first_variants;
+
+    auto max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+    for (size_t i = 0; i < iterations; i++) {
+      auto module = compile(source, options, path, names(permutations));
+
+      if (!module) return 1;
+
+      auto generated = emit(module.get(), all_targets);
+
+      if (i == 0)
+        first = generated;
+
+      for (auto& target : all_targets)
+        if (generated[target] != first[target]) {
+          fmt::println("Run {} differs from the first one in {}.", i + 1, target);
+          return 1;
+        }
+
+      if (permutations.empty()) continue;
+
+      auto num_threads = 1 + i % max_threads;
+      std::vector<std::string> variants;
+
+      for (auto& variant : PermutationCompiler(module.get()).compile(permutations, num_threads))
+        variants.push_back(variant.glsl);
+
+      if (i == 0)
+        first_variants = variants;
+
+      if (variants != first_variants) {
+        fmt::println("Run {} differs from the first one in its variants, with {} threads.", i + 1, num_threads);
+        return 1;
+      }
+    }
+
+    fmt::println(
+      "{} runs of {} targets and {} variants are identical.",
+      iterations,
+      all_targets.size(),
+      first_variants.size()
+    );
+
+    return 0;
+  }
+
+  // resident memory of the process in KiB.
+  size_t resident_kib() {
+    std::ifstream statm { "/proc/self/statm" };
+    size_t pages = 0, resident = 0;
+    statm >> pages >> resident;
+
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+  }
+
+  // Recompiles the input 'iterations' times as an editor or a server would, a struct of the
+  // module changing between compiles, and prints how many nodes, types and how much memory
+  // the process holds along the way.
+  void soak(const std::string& source, const std::string& path, size_t iterations) {
+    ParserOptions options {
+      .error_callback = error_callback
+    };
+
+    auto& ctx = ast::context();
+
+    auto sample = [&](size_t i) {
+      fmt::println(
+        "{:>8} compiles: {} nodes in {} slots, {} types, {} KiB resident",
+        i,
+        ctx.size(),
+        ctx.capacity(),
+        types::system().size(),
+        resident_kib()
+      );
+    };
+
+    sample(0);
+
+    for (size_t i = 1; i <= iterations; i++) {
+      {
+        ast::ASTContext::Arena arena;
+
+        auto edited = source + fmt::format("\nstruct SoakEdit {{ values: [{}]float }}\n", i % 8 + 1);
+
+        if (!compile(edited, options, path)) std::exit(1);
+      }
+
+      types::system().collect();
+
+      if (i % std::max<size_t>(iterations / 10, 1) == 0)
+        sample(i);
+    }
+  }
+
+  // Times a pass rewriting a function of 'statements' statements 'x = x + 1.0f;': each sum
+  // is replaced by '1.0f + x' and each statement is spliced into two copies of itself.
+  void bench_rewrite(size_t statements) {
+    std::string source = "fn bench(a: float) : float {\n  var x = a;\n";
+
+    for (size_t i = 0; i < statements; i++)
+      source += "  x = x + 1.0f;\n";
+
+    source += "  return x;\n}\n";
+
+    auto module = Parser(ParserOptions { .error_callback = error_callback }).parse(source);
+
+    if (!module) std::exit(1);
+
+    auto& ctx = ast::context();
+    auto block = module->global_declarations()[0]->as<ast::FuncDecl>()->block().get();
+    auto& stats = block->stats();
+
+    auto start = std::chrono::steady_clock::now();
+
+    Rewriter rewriter;
 
-    Resolver resolver;
-    resolver.resolve(module.get());
+    for (size_t i = 1; i + 1 < stats.size(); i++) {
+      auto assign = ctx.mutate(ctx.mutate(stats[i])->as<ast::ExprStat>()->expr())->as<ast::BinaryExpr>();
+      auto add = ctx.mutate(assign->rhs())->as<ast::BinaryExpr>();
 
-    GLSLPrinter printer;
-    printer.print(module.get());
+      rewriter.replace(
+        assign,
+        assign->rhs(),
+        ctx.make<ast::BinaryExpr>(std::move(add->rhs()), ast::BinaryExpr::Type::kAdd, std::move(add->lhs()))
+      );
+
+      ast::List<ast::Stat> twice;
+      twice.push_back(ctx.clone(stats[i]));
+      twice.push_back(std::move(stats[i]));
+
+      rewriter.splice(block, i, std::move(twice));
+    }
+
+    rewriter.commit();
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+    fmt::println(
+      "{} rewrites in {:.3f} ms, {:.1f} ns each, {} nodes",
+      rewriter.num_rewrites(),
+      elapsed.count(),
+      elapsed.count() * 1e6 / std::max<size_t>(rewriter.num_rewrites(), 1),
+      ctx.size()
+    );
+  }
+
+  // Times cloning a block returning a balanced sum of 'leaves' reads of 'a', then replacing the
+  // leftmost read by '1.0f'. Clones share the block, only the path from it to the replaced read
+  // is copied.
+  void bench_clone(size_t leaves, size_t clones) {
+    auto& ctx = ast::context();
+    auto before = ctx.size();
+
+    std::function<ast::CRef<ast::Expr>(size_t)> sum = [&](size_t n) -> ast::CRef<ast::Expr> {
+      if (n == 1)
+        return ctx.make<ast::IdExpr>("a");
+
+      return ctx.make<ast::BinaryExpr>(sum(n / 2), ast::BinaryExpr::Type::kAdd, sum(n - n / 2));
+    };
+
+    ast::List<ast::Stat> stats;
+    stats.push_back(ctx.make<ast::ReturnStat>(sum(leaves)));
+
+    auto block = ctx.make<ast::BlockStat>(std::move(stats));
+    auto nodes = ctx.size() - before;
+
+    std::vector<ast::CRef<ast::BlockStat>> copies;
+    copies.reserve(clones);
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < clones; i++) {
+      auto& copy = copies.emplace_back(ctx.clone(block));
+      auto ret = ctx.mutate(ctx.mutate(copy)->stats()[0])->as<ast::ReturnStat>();
+      auto slot = &ret->expr();
+
+      while ((*slot)->is<ast::BinaryExpr>())
+        slot = &ctx.mutate(*slot)->as<ast::BinaryExpr>()->lhs();
+
+      *slot = ctx.make<ast::LitExpr>(ast::LitExpr::Value { .type = ast::LitExpr::Value::kF32, .value = { .f64 = 1.0 } });
+    }
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+    fmt::println(
+      "{} clones of {} nodes in {:.3f} ms, {:.1f} ns each, {} nodes each",
+      clones,
+      nodes,
+      elapsed.count(),
+      elapsed.count() * 1e6 / clones,
+      (ctx.size() - before - nodes) / clones
+    );
+  }
+
+  // Parses the input 'iterations' times and prints the time, nodes and heap allocations of
+  // a parse, the nodes being dropped before the next one. Allocations are only counted when
+  // built with KSC_COUNT_ALLOCATIONS, which replaces the global 'operator new'.
+  void bench_parse(const std::string& source, size_t iterations) {
+#if defined(KSC_COUNT_ALLOCATIONS)
+    auto allocated = [] { return g_allocations.load(std::memory_order_relaxed); };
+#else
+    auto allocated = [] { return size_t(0); };
+#endif
+
+    ParserOptions options {
+      .error_callback = error_callback
+    };
+
+    size_t nodes = 0;
+    size_t allocations = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < iterations; i++) {
+      auto before = ast::context().size();
+      auto allocated_before = allocated();
+
+      Parser parser(options);
+      auto module = parser.parse(source);
+
+      if (!module) std::exit(1);
+
+      allocations += allocated() - allocated_before;
+      nodes += ast::context().size() - before;
+    }
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+#if defined(KSC_COUNT_ALLOCATIONS)
+    fmt::println(
+      "parse: {:.3f} ms, {} nodes, {:.1f} allocations, {:.2f} per node, {:.1f} MB/s",
+      elapsed.count() / iterations,
+      nodes / iterations,
+      static_cast<double>(allocations) / iterations,
+      static_cast<double>(allocations) / std::max<size_t>(nodes, 1),
+      source.size() * iterations / std::max(elapsed.count(), 1e-9) / 1000.0
+    );
+#else
+    fmt::println(
+      "parse: {:.3f} ms, {} nodes, {:.1f} MB/s, allocations not counted",
+      elapsed.count() / iterations,
+      nodes / iterations,
+      source.size() * iterations / std::max(elapsed.count(), 1e-9) / 1000.0
+    );
+#endif
+  }
+
+  // Times walking a sum of 'nodes' nodes with a 'Traversal', balanced then leaning left so
+  // its depth is half its nodes, and walking the balanced one recursively to compare with.
+  void bench_traverse(size_t nodes) {
+    auto& ctx = ast::context();
+    auto leaves = std::max<size_t>(nodes / 2, 1);
+
+    std::function<ast::CRef<ast::Expr>(size_t)> sum = [&](size_t n) -> ast::CRef<ast::Expr> {
+      if (n == 1)
+        return ctx.make<ast::IdExpr>("a");
+
+      return ctx.make<ast::BinaryExpr>(sum(n / 2), ast::BinaryExpr::Type::kAdd, sum(n - n / 2));
+    };
+
+    auto balanced = sum(leaves);
+
+    ast::CRef<ast::Expr> chain = ctx.make<ast::IdExpr>("a");
+
+    for (size_t i = 1; i < leaves; i++)
+      chain = ctx.make<ast::BinaryExpr>(std::move(chain), ast::BinaryExpr::Type::kAdd, ctx.make<ast::IdExpr>("a"));
+
+    size_t reads = 0;
+
+    Traversal traversal;
+    traversal.post<ast::IdExpr>([&](ast::IdExpr* idexpr) { reads++; });
+
+    std::function<void(ast::Expr*)> recurse = [&](ast::Expr* expr) {
+      base::Match(
+        expr,
+        [&](ast::BinaryExpr* bexpr) {
+          recurse(bexpr->lhs().get());
+          recurse(bexpr->rhs().get());
+        },
+        [&](ast::IdExpr* idexpr) {
+          reads++;
+        },
+        [&](base::Default) {}
+      );
+    };
+
+    // small sums are walked more times, so each size is timed for about as long.
+    auto passes = std::max<size_t>(1000000 / nodes, 1);
+
+    auto per_node = [&](auto&& walk) {
+      reads = 0;
+
+      auto start = std::chrono::steady_clock::now();
+
+      for (size_t i = 0; i < passes; i++)
+        walk();
+
+      std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+      if (reads != leaves * passes) {
+        fmt::println("walked {} reads instead of {}.", reads, leaves * passes);
+        std::exit(1);
+      }
+
+      return elapsed.count() / (passes * (2 * leaves - 1));
+    };
+
+    auto walked = per_node([&]() { traversal.run(balanced.get()); });
+    auto recursed = per_node([&]() { recurse(balanced.get()); });
+    auto deep = per_node([&]() { traversal.run(chain.get()); });
+
+    fmt::println(
+      "{} nodes: {:.1f} ns per node walked, {:.1f} ns recursively, {:.1f} ns at a depth of {}",
+      2 * leaves - 1,
+      walked,
+      recursed,
+      deep,
+      leaves
+    );
+  }
+
+  int start(int argc, char* argv[]) {
+    std::vector<PermutationOption> permutations;
+    size_t num_threads = 0;
+    std::string source = kSampleSource;
+    std::vector<Output> outputs;
+    // the glsl is printed to stdout unless outputs are given with '--emit'.
+    bool print_glsl = true;
+    std::string run_entry;
+    std::array<uint32_t, 3> num_workgroups = { 1, 1, 1 };
+    bool print_bytecode = false;
+    bool run_tests = false;
+    std::string server_path;
+    LoadOptions load;
+    std::string watch_dir;
+    std::string input_path;
+    size_t bench_iterations = 0;
+    size_t repro_iterations = 0;
+    size_t soak_iterations = 0;
+    size_t bench_rewrites = 0;
+    size_t bench_clones = 0;
+    size_t bench_traversals = 0;
+    size_t bench_parses = 0;
+    std::string trace_path;
+
+    for (int i = 1; i < argc; i++) {
+      std::string_view arg = argv[i];
+
+      if (arg == "--permute" && i + 1 < argc) {
+        auto option = parse_permutation(argv[++i]);
+
+        if (!option) {
+          fmt::println("Invalid permutation '{}', expected NAME=v0,v1,...", argv[i]);
+          return 1;
+        }
+
+        permutations.push_back(std::move(option.value()));
+      } else if (arg == "-j" && i + 1 < argc) {
+        num_threads = std::strtoul(argv[++i], nullptr, 10);
+      } else if (arg == "--emit" && i + 1 < argc) {
+        auto output = parse_output(argv[++i]);
+
+        if (!output) {
+          fmt::println("Invalid output '{}', expected TARGET=FILE", argv[i]);
+          return 1;
+        }
+
+        outputs.push_back(std::move(output.value()));
+        print_glsl = false;
+      } else if (arg == "--reflect" && i + 1 < argc) {
+        outputs.push_back(Output { "reflect", argv[++i] });
+      } else if (arg == "--reflect-json" && i + 1 < argc) {
+        outputs.push_back(Output { "reflect-json", argv[++i] });
+      } else if (arg == "--cpp-structs" && i + 1 < argc) {
+        outputs.push_back(Output { "cpp-structs", argv[++i] });
+      } else if (arg == "--hlsl" && i + 1 < argc) {
+        outputs.push_back(Output { "hlsl", argv[++i] });
+      } else if (arg == "--cpp" && i + 1 < argc) {
+        outputs.push_back(Output { "cpp", argv[++i] });
+      } else if (arg == "--run" && i + 1 < argc) {
+        run_entry = argv[++i];
+      } else if (arg == "--workgroups" && i + 1 < argc) {
+        auto workgroups = parse_workgroups(argv[++i]);
+
+        if (!workgroups) {
+          fmt::println("Invalid workgroup count '{}', expected X,Y,Z", argv[i]);
+          return 1;
+        }
+
+        num_workgroups = workgroups.value();
+      } else if (arg == "--bytecode") {
+        print_bytecode = true;
+      } else if (arg == "--test") {
+        run_tests = true;
+      } else if (arg == "--server" && i + 1 < argc) {
+        server_path = argv[++i];
+      } else if (arg == "--load" && i + 1 < argc) {
+        load.path = argv[++i];
+      } else if (arg == "--requests" && i + 1 < argc) {
+        load.requests = std::strtoul(argv[++i], nullptr, 10);
+      } else if (arg == "--connections" && i + 1 < argc) {
+        load.connections = std::strtoul(argv[++i], nullptr, 10);
+      } else if (arg == "--cached") {
+        load.cached = true;
+      } else if (arg == "--interface" && i + 1 < argc) {
+        auto interface = Interface::map(argv[++i], std::nullopt);
+
+        if (!interface) {
+          fmt::println("Unable to read the interface '{}'.", argv[i]);
+          return 1;
+        }
+
+        fmt::print("{}", describe(*interface));
+        return 0;
+      } else if (arg == "--watch" && i + 1 < argc) {
+        watch_dir = argv[++i];
+      } else if (arg == "--check-repro" && i + 1 < argc) {
+        repro_iterations = std::strtoul(argv[++i], nullptr, 10);
+      } else if (arg == "--soak" && i + 1 < argc) {
+        soak_iterations = std::strtoul(argv[++i], nullptr, 10);
+      } else if (arg == "--bench-rewrite" && i + 1 < argc) {
+        bench_rewrites = std::strtoul(argv[++i], nullptr, 10);
+      } else if (arg == "--bench-clone" && i + 1 < argc) {
+        bench_clones = std::strtoul(argv[++i], nullptr, 10);
+      } else if (arg == "--bench-traverse" && i + 1 < argc) {
+        bench_traversals = std::strtoul(argv[++i], nullptr, 10);
+      } else if (arg == "--trace" && i + 1 < argc) {
+        trace_path = argv[++i];
+      } else if (arg == "--bench-parse" && i + 1 < argc) {
+        bench_parses = std::strtoul(argv[++i], nullptr, 10);
+      } else if (arg == "--bench-ast" && i + 1 < argc) {
+        bench_iterations = std::strtoul(argv[++i], nullptr, 10);
+      } else if (arg == "--help" || arg.starts_with("-")) {
+        usage();
+        return arg == "--help" ? 0 : 1;
+      } else {
+        std::ifstream file { std::string(arg) };
+
+        if (!file) {
+          fmt::println("Unable to open '{}'.", arg);
+          return 1;
+        }
+
+        std::stringstream ss;
+        ss << file.rdbuf();
+        source = ss.str();
+        input_path = arg;
+      }
+    }
+
+    TraceOutput trace_output { trace_path };
+
+    if (!trace_path.empty()) {
+      base::trace::set_thread_name("ksc");
+      base::trace::start();
+    }
+
+    if (!server_path.empty()) {
+      Server server(num_threads);
+
+      if (server_path == "-")
+        server.serve(STDIN_FILENO, STDOUT_FILENO);
+      else
+        server.listen(server_path);
+
+      return 0;
+    }
+
+    if (!watch_dir.empty()) {
+      std::vector<std::pair<std::string, std::string>> dirs;
+
+      for (auto& output : outputs)
+        dirs.emplace_back(output.target, output.path);
+
+      if (dirs.empty())
+        dirs.emplace_back("glsl", "-");
+
+      Watcher(watch_dir, std::move(dirs)).run();
+
+      return 0;
+    }
+
+    if (!load.path.empty()) {
+      load.source = source;
+
+      for (auto& output : outputs)
+        load.args.push_back(output.target);
+
+      if (load.args.empty())
+        load.args.push_back("glsl");
+
+      run_load(load);
+
+      return 0;
+    }
+
+    if (repro_iterations)
+      return check_repro(source, input_path, permutations, repro_iterations);
+
+    if (bench_rewrites) {
+      // a tenth and a hundredth of the rewrites first, the time of each should stay the same.
+      for (auto rewrites : { bench_rewrites / 100, bench_rewrites / 10, bench_rewrites })
+        bench_rewrite(std::max<size_t>(rewrites / 2, 1));
+
+      return 0;
+    }
+
+    if (bench_clones) {
+      // the nodes of the sum are twice its leaves, the time of a clone grows with its depth.
+      for (auto nodes : { bench_clones / 100, bench_clones / 10, bench_clones })
+        bench_clone(std::max<size_t>(nodes / 2, 1), 1000);
+
+      return 0;
+    }
+
+    if (bench_traversals) {
+      // the time per node should stay the same whatever the size and the depth of the sum.
+      for (auto nodes : { bench_traversals / 100, bench_traversals / 10, bench_traversals })
+        bench_traverse(std::max<size_t>(nodes, 1));
+
+      return 0;
+    }
+
+    if (soak_iterations) {
+      soak(source, input_path, soak_iterations);
+      return 0;
+    }
+
+    if (bench_parses) {
+      bench_parse(source, bench_parses);
+      return 0;
+    }
+
+    if (bench_iterations) {
+      bench_ast(source, input_path, bench_iterations);
+      return 0;
+    }
+
+    ast::CRef<ast::Module> module;
+
+    // a '.ksla' input is already resolved, it's only loaded back.
+    if (SerializedModule::matches(source)) {
+      auto serialized = SerializedModule::map(input_path);
+
+      if (serialized)
+        module = serialized->load();
+
+      if (!module) {
+        fmt::println("Unable to load the serialized module '{}'.", input_path);
+        return 1;
+      }
+    } else {
+      module = compile(source, ParserOptions {
+        .error_callback = error_callback
+      }, input_path, names(permutations));
+    }
+
+    if (!module) return 1;
+
+    // the glsl on stdout comes out of the same walk as the other source targets.
+    print_glsl = print_glsl && run_entry.empty() && !run_tests && permutations.empty();
+
+    if (print_glsl) {
+      outputs.push_back(Output { "glsl", "-" });
+      fmt::println("GLSL:");
+    }
+
+    std::vector<std::string> targets;
+
+    for (auto& output : outputs)
+      targets.push_back(output.target);
+
+    auto generated = emit(module.get(), targets);
+
+    for (auto& output : outputs)
+      write_output(output, generated[output.target]);
+
+    if (!run_entry.empty()) {
+      auto program = vm::Compiler(module.get()).compile(run_entry);
+
+      if (print_bytecode)
+        fmt::println("{}", vm::disassemble(program));
+
+      run_program(program, num_workgroups);
+
+      return 0;
+    }
+
+    if (run_tests) {
+      size_t failed = 0;
+
+      for (auto& result : TestRunner(module.get()).run_tests()) {
+        fmt::println("{} {} ({} cases)", result.failures.empty() ? "PASS" : "FAIL", result.name, result.cases);
+
+        for (auto& failure : result.failures)
+          fmt::println("  {}", failure);
+
+        failed += result.failures.size();
+      }
+
+      fmt::println("{} failures", failed);
+
+      return failed ? 1 : 0;
+    }
+
+    if (!permutations.empty()) {
+      PermutationCompiler compiler(module.get());
+
+      for (auto& variant : compiler.compile(permutations, num_threads))
+        fmt::println("// variant: {}\n{}", describe(permutations, variant.specialization), variant.glsl);
+
+      return 0;
+    }
 
     return 0;
   }
@@ -0,0 +1,965 @@
+#include "modules.h"
+#include "resolver.h"
+#include "sem.h"
+
+#include "passes/visit.h"
+
+#include "base/trace.h"
+
+#include <fmt/format.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <bit>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+
+namespace kate::tlr {
+  namespace {
+    constexpr uint32_t kVersion = 1;
+
+    struct Header {
+      char magic[4];
+      uint32_t version;
+      uint64_t source_hash;
+      uint32_t num_types;
+      uint32_t num_members;
+      uint32_t num_decls;
+      uint32_t num_args;
+      uint32_t num_deps;
+      uint32_t num_imports;
+      uint32_t strings_size;
+      uint32_t padding;
+    };
+
+    static_assert(sizeof(Header) == 48);
+    // records are read in place.
+    static_assert(std::endian::native == std::endian::little);
+
+    using Names = std::set<std::string, std::less<>>;
+
+    // modules whose interfaces are being compiled by this process and its parents, which
+    // pass it on when they fork, an import of one of them is a cycle.
+    std::set<std::filesystem::path> g_compiling;
+
+    void collect(ast::Type* type, Names& names);
+
+    void collect(ast::CRef<ast::Expr>& expr, Names& names)
+    {
+      if (!expr) return;
+
+      visit_slots(expr, [&](ast::CRef<ast::Expr>& slot) {
+        base::Match(
+          slot.get(),
+          [&](ast::IdExpr* id_expr) {
+            names.emplace(id_expr->ident());
+          },
+          [&](ast::CallExpr* call_expr) {
+            names.emplace(call_expr->id()->ident());
+          },
+          [&](ast::Type* type) {
+            collect(type, names);
+          },
+          [&](base::Default) {}
+        );
+      });
+    }
+
+    void collect(ast::Type* type, Names& names)
+    {
+      base::Match(
+        type,
+        [&](ast::TypeId* type_id) {
+          names.emplace(type_id->id());
+        },
+        [&](ast::ArrayType* array_type) {
+          collect(array_type->type().get(), names);
+          collect(array_type->arraySizeExpr(), names);
+        },
+        [&](base::Default) {}
+      );
+    }
+
+    void collect(ast::List<ast::Attr>& attrs, Names& names)
+    {
+      for (auto& attr : attrs)
+        for (auto& arg : attr->args())
+          collect(arg, names);
+    }
+
+    void collect(ast::Stat* stat, Names& names)
+    {
+      base::Match(
+        stat,
+        [&](ast::BlockStat* block) {
+          for (auto& s : block->stats())
+            collect(s.get(), names);
+        },
+        [&](ast::VarStat* var_stat) {
+          if (var_stat->decl()->type())
+            collect(var_stat->decl()->type().get(), names);
+
+          collect(var_stat->expr(), names);
+        },
+        [&](ast::ExprStat* expr_stat) {
+          collect(expr_stat->expr(), names);
+        },
+        [&](ast::ReturnStat* return_stat) {
+          collect(return_stat->expr(), names);
+        },
+        [&](ast::IfStat* if_stat) {
+          collect(if_stat->condition(), names);
+          collect(if_stat->block().get(), names);
+
+          if (if_stat->elseBlock())
+            collect(if_stat->elseBlock().get(), names);
+        },
+        [&](ast::ForStat* for_stat) {
+          if (for_stat->initializer())
+            collect(for_stat->initializer().get(), names);
+
+          collect(for_stat->condition(), names);
+
+          if (for_stat->continuing())
+            collect(for_stat->continuing().get(), names);
+
+          collect(for_stat->block().get(), names);
+        },
+        [&](ast::WhileStat* while_stat) {
+          collect(while_stat->condition(), names);
+          collect(while_stat->block().get(), names);
+        },
+        [&](base::Default) {}
+      );
+    }
+
+    // the names a declaration refers to: types, functions, constants and resources, and
+    // local variables, which don't match anything exported.
+    void collect(ast::Decl* decl, Names& names)
+    {
+      base::Match(
+        decl,
+        [&](ast::FuncDecl* func) {
+          collect(func->type().get(), names);
+          collect(func->attrs(), names);
+
+          for (auto& arg : func->args()) {
+            collect(arg->type().get(), names);
+            collect(arg->attrs(), names);
+          }
+
+          collect(func->block().get(), names);
+        },
+        [&](ast::StructDecl* struct_) {
+          for (auto& member : struct_->members())
+            collect(member->type().get(), names);
+        },
+        [&](ast::ConstDecl* const_decl) {
+          if (const_decl->type())
+            collect(const_decl->type().get(), names);
+
+          collect(const_decl->expr(), names);
+        },
+        [&](ast::UniformDecl* uniform) {
+          collect(uniform->type().get(), names);
+          collect(uniform->attributes(), names);
+        },
+        [&](ast::BufferDecl* buffer) {
+          collect(buffer->type().get(), names);
+          collect(buffer->attributes(), names);
+        },
+        [&](ast::VarDecl* var_decl) {
+          collect(var_decl->type().get(), names);
+        },
+        [&](base::Default) {}
+      );
+    }
+
+    std::optional<Interface::DeclKind> kind_of(ast::Decl* decl)
+    {
+      return base::Match(
+        decl,
+        [&](ast::StructDecl*) -> std::optional<Interface::DeclKind> {
+          return Interface::DeclKind::kStruct;
+        },
+        [&](ast::FuncDecl*) -> std::optional<Interface::DeclKind> {
+          return Interface::DeclKind::kFunc;
+        },
+        [&](ast::ConstDecl*) -> std::optional<Interface::DeclKind> {
+          return Interface::DeclKind::kConst;
+        },
+        [&](ast::UniformDecl*) -> std::optional<Interface::DeclKind> {
+          return Interface::DeclKind::kUniform;
+        },
+        [&](ast::BufferDecl*) -> std::optional<Interface::DeclKind> {
+          return Interface::DeclKind::kBuffer;
+        },
+        [&](base::Default) -> std::optional<Interface::DeclKind> {
+          return std::nullopt;
+        }
+      );
+    }
+
+    // the records of an interface being built.
+    class Builder {
+    public:
+      Interface::Str add(std::string_view str)
+      {
+        Interface::Str ref { uint32_t(strings.size()), uint32_t(str.size()) };
+        strings.append(str);
+
+        return ref;
+      }
+
+      uint32_t add(types::Type* type)
+      {
+        if (!type) return Interface::kNoType;
+
+        if (auto ref = type->as<types::Ref>())
+          return add(ref->type());
+
+        if (auto it = m_indices.find(type); it != m_indices.end())
+          return it->second;
+
+        Interface::Type entry {
+          .kind = Interface::TypeKind::kVoid,
+          .name = {},
+          .element = Interface::kNoType,
+          .count = 0,
+          .rows = 0,
+          .columns = 0,
+          .first_member = 0,
+          .num_members = 0
+        };
+
+        std::string name = type->mangledName();
+
+        if (auto scalar = type->as<types::Scalar>()) {
+          entry.kind = Interface::TypeKind::kScalar;
+        } else if (auto vec = type->as<types::Vec>()) {
+          entry.kind = Interface::TypeKind::kVec;
+          entry.element = add(vec->type());
+          entry.count = vec->columns();
+        } else if (auto mat = type->as<types::Mat>()) {
+          entry.kind = Interface::TypeKind::kMat;
+          entry.element = add(mat->type());
+          entry.rows = mat->rows();
+          entry.columns = mat->columns();
+
+          // the mangled name of a matrix puts its rows first, ksl names put its columns first.
+          name = fmt::format("{}{}x{}", mat->type()->mangledName(), mat->columns(), mat->rows());
+        } else if (auto array = type->as<types::Array>()) {
+          entry.kind = Interface::TypeKind::kArray;
+          entry.element = add(array->type());
+          entry.count = array->count();
+
+          std::string element_name = "?";
+
+          if (entry.element != Interface::kNoType) {
+            auto& element = this->types[entry.element];
+            element_name = strings.substr(element.name.offset, element.name.size);
+          }
+
+          name = array->count() ? fmt::format("{}[{}]", element_name, array->count()) : element_name + "[]";
+        } else if (auto custom = type->as<types::Custom>()) {
+          entry.kind = Interface::TypeKind::kCustom;
+
+          // members are added once their types are, so they are next to each other.
+          std::vector<uint32_t> member_types;
+
+          for (auto& member : custom->members())
+            member_types.push_back(add(member.type()));
+
+          entry.first_member = members.size();
+          entry.num_members = member_types.size();
+
+          for (size_t i = 0; i < member_types.size(); i++)
+            members.push_back(Interface::Member { add(custom->members()[i].name()), member_types[i] });
+        }
+
+        entry.name = add(name);
+
+        m_indices[type] = this->types.size();
+        this->types.push_back(entry);
+
+        return m_indices[type];
+      }
+
+      std::vector<Interface::Type> types;
+      std::vector<Interface::Member> members;
+      std::vector<Interface::Decl> decls;
+      std::vector<Interface::Arg> args;
+      std::vector<Interface::Str> deps;
+      std::vector<Interface::Str> imports;
+      std::string strings;
+    private:
+      std::unordered_map<types::Type*, uint32_t> m_indices;
+    };
+
+    template<typename T>
+    void append(std::string& out, const std::vector<T>& records)
+    {
+      out.append(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(T));
+    }
+
+    bool write_all(int fd, std::string_view data)
+    {
+      while (!data.empty()) {
+        auto n = ::write(fd, data.data(), data.size());
+
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+
+        data.remove_prefix(n);
+      }
+
+      return true;
+    }
+
+    std::optional<std::string> read_file(const std::filesystem::path& path)
+    {
+      std::ifstream file { path, std::ios::binary };
+
+      if (!file) return std::nullopt;
+
+      std::stringstream ss;
+      ss << file.rdbuf();
+
+      return ss.str();
+    }
+
+    // parses and resolves a module in a forked child and returns its interface.
+    std::optional<std::string> compile_interface(
+      const std::filesystem::path& path,
+      const std::string& source,
+      const ParserOptions& options
+    )
+    {
+      FILE* out = std::tmpfile();
+
+      if (!out) return std::nullopt;
+
+      std::fflush(stdout);
+
+      auto pid = ::fork();
+
+      if (pid == 0) {
+        g_compiling.insert(path.lexically_normal());
+
+        Parser parser(options);
+        auto module = parser.parse(source);
+
+        if (!module) {
+          std::fflush(stdout);
+          ::_exit(1);
+        }
+
+        std::vector<std::pair<ast::Decl*, std::string_view>> exports;
+        std::vector<std::string> imports;
+
+        auto& decls = module->global_declarations();
+
+        for (size_t i = 0; i < decls.size(); i++) {
+          if (auto import = decls[i]->as<ast::ImportDecl>())
+            imports.push_back(import->path());
+          else
+            exports.emplace_back(decls[i].get(), parser.spans()[i]);
+        }
+
+        if (!link_imports(module.get(), path.parent_path(), options)) {
+          std::fflush(stdout);
+          ::_exit(1);
+        }
+
+        Resolver resolver;
+        resolver.resolve(module.get());
+
+        auto ok = write_all(fileno(out), build_interface(exports, imports, hash_source(source)));
+
+        std::fflush(stdout);
+        ::_exit(ok ? 0 : 1);
+      }
+
+      int status = 0;
+
+      if (pid > 0)
+        while (::waitpid(pid, &status, 0) < 0 && errno == EINTR);
+
+      std::optional<std::string> bytes;
+
+      if (pid > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+        std::string data;
+        char chunk[64 * 1024];
+
+        ::lseek(fileno(out), 0, SEEK_SET);
+
+        for (;;) {
+          auto n = ::read(fileno(out), chunk, sizeof(chunk));
+
+          if (n < 0 && errno == EINTR) continue;
+          if (n <= 0) break;
+
+          data.append(chunk, n);
+        }
+
+        bytes = std::move(data);
+      }
+
+      std::fclose(out);
+
+      return bytes;
+    }
+
+    void report(const ParserOptions& options, const std::string& message)
+    {
+      if (options.error_callback)
+        options.error_callback(message);
+      else
+        fmt::println("{}", message);
+    }
+
+    // Pulls the declarations used by a module out of the interfaces it imports, with
+    // what they depend on, in an order where everything is declared before it's used.
+    class Linker {
+    public:
+      Linker(const ParserOptions& options)
+        : m_options { options }
+      {
+      }
+
+      // adds the declarations of the module at 'path' named in 'names' and removes them
+      // from it, names it doesn't declare are looked for in its own imports.
+      bool link(const std::filesystem::path& path, Names& names)
+      {
+        auto key = path.lexically_normal();
+
+        if (m_linking.contains(key)) {
+          report(m_options, fmt::format("Module '{}' imports itself.", key.string()));
+          return false;
+        }
+
+        auto& interface = m_interfaces[key];
+
+        if (!interface) {
+          if (m_options.import_callback)
+            m_options.import_callback(key);
+
+          interface = load_interface(key, m_options);
+
+          if (!interface) return false;
+        }
+
+        // the declarations asked for, and then the declarations they depend on.
+        std::vector<bool> needed(interface->decls().size());
+        std::vector<uint32_t> stack;
+        Names missing;
+
+        for (auto it = names.begin(); it != names.end();) {
+          if (auto index = interface->find(*it)) {
+            stack.push_back(index.value());
+            it = names.erase(it);
+          } else ++it;
+        }
+
+        while (!stack.empty()) {
+          auto index = stack.back();
+          stack.pop_back();
+
+          if (needed[index]) continue;
+
+          needed[index] = true;
+
+          auto& decl = interface->decls()[index];
+
+          for (auto& dep : interface->deps().subspan(decl.first_dep, decl.num_deps)) {
+            auto name = interface->str(dep);
+
+            if (auto dep_index = interface->find(name))
+              stack.push_back(dep_index.value());
+            else
+              missing.emplace(name);
+          }
+        }
+
+        m_linking.insert(key);
+
+        for (auto& import : interface->imports()) {
+          if (missing.empty()) break;
+
+          if (!link(key.parent_path() / interface->str(import), missing)) return false;
+        }
+
+        m_linking.erase(key);
+
+        for (uint32_t i = 0; i < needed.size(); i++)
+          if (needed[i] && m_linked.emplace(interface.get(), i).second) {
+            m_source.append(interface->str(interface->decls()[i].text));
+            m_source.push_back('\n');
+          }
+
+        return true;
+      }
+
+      const std::string& source() const
+      {
+        return m_source;
+      }
+    private:
+      const ParserOptions& m_options;
+
+      std::map<std::filesystem::path, std::unique_ptr<Interface>> m_interfaces;
+      std::set<std::filesystem::path> m_linking;
+      std::set<std::pair<const Interface*, uint32_t>> m_linked;
+
+      std::string m_source;
+    };
+  }
+
+  std::unique_ptr<Interface> Interface::map(
+    const std::filesystem::path& path,
+    std::optional<uint64_t> source_hash
+  )
+  {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0) return nullptr;
+
+    struct stat st;
+
+    if (::fstat(fd, &st) < 0 || st.st_size < ssize_t(sizeof(Header))) {
+      ::close(fd);
+      return nullptr;
+    }
+
+    auto mapping = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+
+    if (mapping == MAP_FAILED) return nullptr;
+
+    std::unique_ptr<Interface> interface(new Interface());
+    interface->m_mapping = mapping;
+    interface->m_size = st.st_size;
+
+    if (!interface->init(static_cast<const uint8_t*>(mapping), st.st_size)) return nullptr;
+
+    if (source_hash && interface->source_hash() != source_hash.value()) return nullptr;
+
+    return interface;
+  }
+
+  std::unique_ptr<Interface> Interface::from_bytes(std::string&& bytes)
+  {
+    std::unique_ptr<Interface> interface(new Interface());
+    interface->m_bytes = std::move(bytes);
+
+    auto data = reinterpret_cast<const uint8_t*>(interface->m_bytes.data());
+
+    if (!interface->init(data, interface->m_bytes.size())) return nullptr;
+
+    return interface;
+  }
+
+  Interface::~Interface()
+  {
+    if (m_mapping)
+      ::munmap(m_mapping, m_size);
+  }
+
+  bool Interface::init(const uint8_t* data, size_t size)
+  {
+    if (size < sizeof(Header)) return false;
+
+    auto header = reinterpret_cast<const Header*>(data);
+
+    if (std::memcmp(header->magic, "KSLI", 4) != 0 || header->version != kVersion) return false;
+
+    uint64_t expected = sizeof(Header) +
+      uint64_t(header->num_types) * sizeof(Type) +
+      uint64_t(header->num_members) * sizeof(Member) +
+      uint64_t(header->num_decls) * sizeof(Decl) +
+      uint64_t(header->num_args) * sizeof(Arg) +
+      uint64_t(header->num_deps) * sizeof(Str) +
+      uint64_t(header->num_imports) * sizeof(Str) +
+      header->strings_size;
+
+    if (expected != size) return false;
+
+    auto ptr = data + sizeof(Header);
+
+    auto take = [&]<typename T>(std::span<const T>& records, uint32_t count) {
+      records = { reinterpret_cast<const T*>(ptr), count };
+      ptr += count * sizeof(T);
+    };
+
+    take(m_types, header->num_types);
+    take(m_members, header->num_members);
+    take(m_decls, header->num_decls);
+    take(m_args, header->num_args);
+    take(m_deps, header->num_deps);
+    take(m_imports, header->num_imports);
+
+    m_data = data;
+    m_size = size;
+    m_strings = { reinterpret_cast<const char*>(ptr), header->strings_size };
+
+    // the records are read in place without further checks, so a file that's truncated,
+    // damaged or crafted must not point outside of the sections.
+    auto valid_str = [&](Str str) {
+      return uint64_t(str.offset) + str.size <= m_strings.size();
+    };
+
+    auto valid_type = [&](uint32_t type) {
+      return type == kNoType || type < m_types.size();
+    };
+
+    auto valid_range = [](uint32_t first, uint32_t count, size_t size) {
+      return uint64_t(first) + count <= size;
+    };
+
+    for (auto& type : m_types) {
+      if (type.kind > TypeKind::kCustom ||
+          !valid_str(type.name) ||
+          !valid_type(type.element) ||
+          !valid_range(type.first_member, type.num_members, m_members.size()))
+        return false;
+    }
+
+    for (auto& member : m_members)
+      if (!valid_str(member.name) || !valid_type(member.type)) return false;
+
+    for (auto& decl : m_decls) {
+      if (decl.kind > DeclKind::kBuffer ||
+          !valid_str(decl.name) ||
+          !valid_str(decl.text) ||
+          !valid_type(decl.type) ||
+          !valid_range(decl.first_arg, decl.num_args, m_args.size()) ||
+          !valid_range(decl.first_dep, decl.num_deps, m_deps.size()))
+        return false;
+    }
+
+    for (auto& arg : m_args)
+      if (!valid_str(arg.name) || !valid_type(arg.type)) return false;
+
+    for (auto& dep : m_deps)
+      if (!valid_str(dep)) return false;
+
+    for (auto& import : m_imports)
+      if (!valid_str(import)) return false;
+
+    for (uint32_t i = 0; i < m_decls.size(); i++)
+      m_names.emplace(str(m_decls[i].name), i);
+
+    return true;
+  }
+
+  uint64_t Interface::source_hash() const
+  {
+    return reinterpret_cast<const Header*>(m_data)->source_hash;
+  }
+
+  std::string_view Interface::str(Str str) const
+  {
+    if (uint64_t(str.offset) + str.size > m_strings.size()) return {};
+
+    return m_strings.substr(str.offset, str.size);
+  }
+
+  std::span<const Interface::Type> Interface::types() const
+  {
+    return m_types;
+  }
+
+  std::span<const Interface::Member> Interface::members() const
+  {
+    return m_members;
+  }
+
+  std::span<const Interface::Decl> Interface::decls() const
+  {
+    return m_decls;
+  }
+
+  std::span<const Interface::Arg> Interface::args() const
+  {
+    return m_args;
+  }
+
+  std::span<const Interface::Str> Interface::deps() const
+  {
+    return m_deps;
+  }
+
+  std::span<const Interface::Str> Interface::imports() const
+  {
+    return m_imports;
+  }
+
+  std::optional<uint32_t> Interface::find(std::string_view name) const
+  {
+    auto it = m_names.find(name);
+
+    return (it != m_names.end()) ? std::optional(it->second) : std::nullopt;
+  }
+
+  uint64_t hash_source(std::string_view source)
+  {
+    // fnv-1a
+    uint64_t hash = 0xcbf29ce484222325;
+
+    for (auto c : source) {
+      hash ^= static_cast<uint8_t>(c);
+      hash *= 0x100000001b3;
+    }
+
+    return hash;
+  }
+
+  std::string build_interface(
+    const std::vector<std::pair<ast::Decl*, std::string_view>>& exports,
+    const std::vector<std::string>& imports,
+    uint64_t source_hash
+  )
+  {
+    Builder builder;
+
+    for (auto& [decl, text] : exports) {
+      auto kind = kind_of(decl);
+
+      if (!kind) continue;
+
+      Interface::Decl entry {
+        .kind = kind.value(),
+        .name = builder.add(decl->name()),
+        .type = builder.add(decl->sem() ? decl->sem()->type() : nullptr),
+        .first_arg = uint32_t(builder.args.size()),
+        .num_args = 0,
+        .first_dep = uint32_t(builder.deps.size()),
+        .num_deps = 0,
+        .text = builder.add(text)
+      };
+
+      if (auto func = decl->as<ast::FuncDecl>()) {
+        for (auto& arg : func->args()) {
+          auto type = builder.add(arg->type()->sem()->type());
+          builder.args.push_back(Interface::Arg { builder.add(arg->name()), type });
+        }
+
+        entry.num_args = func->args().size();
+      }
+
+      Names names;
+      collect(decl, names);
+      names.erase(decl->name());
+
+      for (auto& name : names)
+        builder.deps.push_back(builder.add(name));
+
+      entry.num_deps = names.size();
+
+      builder.decls.push_back(entry);
+    }
+
+    for (auto& import : imports)
+      builder.imports.push_back(builder.add(import));
+
+    Header header {
+      .magic = { 'K', 'S', 'L', 'I' },
+      .version = kVersion,
+      .source_hash = source_hash,
+      .num_types = uint32_t(builder.types.size()),
+      .num_members = uint32_t(builder.members.size()),
+      .num_decls = uint32_t(builder.decls.size()),
+      .num_args = uint32_t(builder.args.size()),
+      .num_deps = uint32_t(builder.deps.size()),
+      .num_imports = uint32_t(builder.imports.size()),
+      .strings_size = uint32_t(builder.strings.size()),
+      .padding = 0
+    };
+
+    std::string out(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    append(out, builder.types);
+    append(out, builder.members);
+    append(out, builder.decls);
+    append(out, builder.args);
+    append(out, builder.deps);
+    append(out, builder.imports);
+    out.append(builder.strings);
+
+    return out;
+  }
+
+  std::unique_ptr<Interface> load_interface(
+    const std::filesystem::path& path,
+    const ParserOptions& options
+  )
+  {
+    auto interface_path = path;
+    interface_path.replace_extension(".ksli");
+
+    if (g_compiling.contains(path.lexically_normal())) {
+      report(options, fmt::format("Module '{}' imports itself.", path.string()));
+      return nullptr;
+    }
+
+    auto source = read_file(path);
+
+    // modules may be shipped as interfaces only.
+    if (!source) {
+      auto interface = Interface::map(interface_path, std::nullopt);
+
+      if (!interface)
+        report(options, fmt::format("Unable to import '{}'.", path.string()));
+
+      return interface;
+    }
+
+    if (auto interface = Interface::map(interface_path, hash_source(source.value())))
+      return interface;
+
+    auto bytes = compile_interface(path, source.value(), options);
+
+    if (!bytes) {
+      report(options, fmt::format("Unable to compile the interface of '{}'.", path.string()));
+      return nullptr;
+    }
+
+    // written to a temporary file renamed over the previous one, so concurrent builds only
+    // ever map whole interfaces. Failing to write it only costs the next build some time.
+    auto temporary = interface_path;
+    temporary += fmt::format(".{}.tmp", ::getpid());
+
+    if (std::ofstream file { temporary, std::ios::binary }; file.write(bytes->data(), bytes->size())) {
+      file.close();
+
+      std::error_code ec;
+      std::filesystem::rename(temporary, interface_path, ec);
+    }
+
+    return Interface::from_bytes(std::move(bytes.value()));
+  }
+
+  bool link_imports(
+    ast::Module* module,
+    const std::filesystem::path& dir,
+    const ParserOptions& options
+  )
+  {
+    TS_TRACE_ZONE("link imports");
+
+    auto& decls = module->global_declarations();
+
+    std::vector<std::string> imports;
+    Names names;
+    Names declared;
+
+    for (auto& decl : decls) {
+      if (auto import = decl->as<ast::ImportDecl>())
+        imports.push_back(import->path());
+      else {
+        collect(decl.get(), names);
+        declared.insert(decl->name());
+      }
+    }
+
+    if (imports.empty()) return true;
+
+    // declarations of the module hide the ones it imports.
+    for (auto& name : declared)
+      names.erase(name);
+
+    Linker linker(options);
+
+    for (auto& import : imports)
+      if (!linker.link(dir / import, names)) return false;
+
+    ast::List<ast::Decl> linked;
+
+    if (!linker.source().empty()) {
+      Parser parser(options);
+      auto imported = parser.parse(linker.source());
+
+      if (!imported) return false;
+
+      linked = std::move(imported->global_declarations());
+    }
+
+    std::set<std::string> private_structs;
+
+    for (auto& decl : linked)
+      if (decl->is<ast::StructDecl>() && decl->name().starts_with("priv_"))
+        private_structs.insert(decl->name());
+
+    // structs declared inline are named after their members, an imported declaration may
+    // already bring the same one.
+    for (auto& decl : decls)
+      if (!decl->is<ast::ImportDecl>() &&
+        !(decl->is<ast::StructDecl>() && private_structs.contains(decl->name())))
+        linked.push_back(std::move(decl));
+
+    decls = std::move(linked);
+
+    return true;
+  }
+
+  std::string describe(const Interface& interface)
+  {
+    auto type_name = [&](uint32_t type) {
+      return type < interface.types().size() ? std::string(interface.str(interface.types()[type].name)) : "?";
+    };
+
+    std::string out;
+
+    for (auto& import : interface.imports())
+      out += fmt::format("import \"{}\";\n", interface.str(import));
+
+    for (auto& decl : interface.decls()) {
+      auto name = interface.str(decl.name);
+
+      switch (decl.kind) {
+        case Interface::DeclKind::kStruct: {
+          out += fmt::format("struct {} {{\n", name);
+
+          if (decl.type < interface.types().size()) {
+            auto& type = interface.types()[decl.type];
+
+            for (auto& member : interface.members().subspan(type.first_member, type.num_members))
+              out += fmt::format("  {}: {}\n", interface.str(member.name), type_name(member.type));
+          }
+
+          out += "}\n";
+          break;
+        }
+        case Interface::DeclKind::kFunc: {
+          std::string args;
+
+          for (auto& arg : interface.args().subspan(decl.first_arg, decl.num_args))
+            args += fmt::format("{}{}: {}", args.empty() ? "" : ", ", interface.str(arg.name), type_name(arg.type));
+
+          out += fmt::format("fn {}({}): {}\n", name, args, type_name(decl.type));
+          break;
+        }
+        case Interface::DeclKind::kConst:
+          out += fmt::format("const {}: {}\n", name, type_name(decl.type));
+          break;
+        case Interface::DeclKind::kUniform:
+          out += fmt::format("uniform {}: {}\n", name, type_name(decl.type));
+          break;
+        case Interface::DeclKind::kBuffer:
+          out += fmt::format("buffer {}: {}\n", name, type_name(decl.type));
+          break;
+      }
+    }
+
+    return out;
+  }
+}
\ No newline at end of file
@@ -0,0 +1,184 @@
+#pragma once
+
+#include "ast.h"
+#include "parser.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace kate::tlr {
+  // Declarations a module exports to the modules importing it, saved next to the module in a
+  // '.ksli' file so importers map it instead of parsing and resolving the module again.
+  //
+  // Each declaration comes with its resolved signature, the names it depends on and its
+  // source text. An importer only parses the text of the declarations it uses, and of what
+  // they depend on, the rest of the module is never looked at.
+  //
+  // The format is made of fixed size records read in place, in this order:
+  //
+  //   header:  'KSLI', u32 version, u64 hash of the source, u32 count of types, members,
+  //            decls, args, deps and imports, u32 size of the strings
+  //   type:    u32 kind, str name, u32 element, u32 count, u32 rows, u32 columns,
+  //            u32 first member, u32 member count
+  //   member:  str name, u32 type
+  //   decl:    u32 kind, str name, u32 type, u32 first arg, u32 arg count, u32 first dep,
+  //            u32 dep count, str text
+  //   arg:     str name, u32 type
+  //   dep:     str name
+  //   import:  str path, relative to the module
+  //   strings
+  //
+  // where 'str' is a u32 offset in the strings and a u32 length, and types are indices in
+  // the type records, 0xffffffff when there's none. Values are little-endian.
+  class Interface {
+  public:
+    static constexpr uint32_t kNoType = 0xffffffff;
+
+    enum class TypeKind : uint32_t {
+      kVoid,
+      kScalar,
+      kVec,
+      kMat,
+      kArray,
+      kCustom
+    };
+
+    enum class DeclKind : uint32_t {
+      kStruct,
+      kFunc,
+      kConst,
+      kUniform,
+      kBuffer
+    };
+
+    struct Str {
+      uint32_t offset;
+      uint32_t size;
+    };
+
+    struct Type {
+      TypeKind kind;
+      // the ksl name of the type, e.g. 'float3x4' or 'Light[4]'.
+      Str name;
+      uint32_t element;
+      // columns of a vector, elements of an array, 0 for unsized arrays.
+      uint32_t count;
+      uint32_t rows;
+      uint32_t columns;
+      uint32_t first_member;
+      uint32_t num_members;
+    };
+
+    struct Member {
+      Str name;
+      uint32_t type;
+    };
+
+    struct Decl {
+      DeclKind kind;
+      Str name;
+      // type of a struct, constant or resource, return type of a function.
+      uint32_t type;
+      uint32_t first_arg;
+      uint32_t num_args;
+      uint32_t first_dep;
+      uint32_t num_deps;
+      Str text;
+    };
+
+    struct Arg {
+      Str name;
+      uint32_t type;
+    };
+
+    // maps an interface file, returns nullptr when it's missing, malformed or, when a hash
+    // is given, built from another source.
+    static std::unique_ptr<Interface> map(
+      const std::filesystem::path& path,
+      std::optional<uint64_t> source_hash
+    );
+
+    static std::unique_ptr<Interface> from_bytes(std::string&& bytes);
+
+    ~Interface();
+
+    Interface(const Interface&) = delete;
+
+    uint64_t source_hash() const;
+
+    std::string_view str(Str str) const;
+
+    std::span<const Type> types() const;
+
+    std::span<const Member> members() const;
+
+    std::span<const Decl> decls() const;
+
+    std::span<const Arg> args() const;
+
+    std::span<const Str> deps() const;
+
+    std::span<const Str> imports() const;
+
+    // index of the declaration named 'name'.
+    std::optional<uint32_t> find(std::string_view name) const;
+  private:
+    Interface() = default;
+
+    // checks the sizes in the header against the size of the data, and that every string,
+    // type index and range of records stays inside its section, then indexes the names.
+    bool init(const uint8_t* data, size_t size);
+
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+
+    void* m_mapping = nullptr;
+    std::string m_bytes;
+
+    std::span<const Type> m_types;
+    std::span<const Member> m_members;
+    std::span<const Decl> m_decls;
+    std::span<const Arg> m_args;
+    std::span<const Str> m_deps;
+    std::span<const Str> m_imports;
+    std::string_view m_strings;
+
+    std::unordered_map<std::string_view, uint32_t> m_names;
+  };
+
+  uint64_t hash_source(std::string_view source);
+
+  // Serializes the declarations of a resolved module, each paired with its source text.
+  std::string build_interface(
+    const std::vector<std::pair<ast::Decl*, std::string_view>>& exports,
+    const std::vector<std::string>& imports,
+    uint64_t source_hash
+  );
+
+  // Loads the interface of the module at 'path'. The '.ksli' file next to it is used when it
+  // was built from the current source, otherwise the module is compiled in a forked child,
+  // so its declarations stay out of the module importing it, and the file is written again.
+  std::unique_ptr<Interface> load_interface(
+    const std::filesystem::path& path,
+    const ParserOptions& options
+  );
+
+  // Replaces the import declarations of a parsed module by the declarations it uses from
+  // the imported modules, paths are relative to 'dir'. Returns false when they don't parse.
+  bool link_imports(
+    ast::Module* module,
+    const std::filesystem::path& dir,
+    const ParserOptions& options
+  );
+
+  // the declarations of an interface, as ksl.
+  std::string describe(const Interface& interface);
+}
\ No newline at end of file
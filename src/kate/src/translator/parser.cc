@@ -1,8 +1,12 @@
 #include "parser.h"
 #include "sem.h"
 
+#include "base/trace.h"
+
 #include <fmt/format.h>
 
+#include <cctype>
+
 namespace kate::tlr {
   Parser::Parser(
     const ParserOptions& options
@@ -13,19 +17,37 @@ namespace kate::tlr {
 
   ast::CRef<ast::Module> Parser::parse(const std::string_view& source) 
   {
-    m_lexer.tokenize(source);
+    TS_TRACE_ZONE("parse");
+
+    m_lexer.tokenize(source, m_options.error_callback);
 
     while (should_continue()) {
+      auto& first = m_lexer[offset + 1];
+
       auto decl = parse_global_declaration();
 
       if (!decl.matched) return {};
 
       m_global_decls.push_back(decl);
+
+      // declarations start and end with punctuation or identifiers, both hold their text.
+      auto& last = m_lexer[offset];
+      auto begin = std::get_if<std::string_view>(&first.value());
+      auto end = std::get_if<std::string_view>(&last.value());
+
+      m_spans.push_back(
+        (begin && end) ? std::string_view(begin->data(), end->data() + end->size() - begin->data()) : std::string_view()
+      );
     }
 
     return ast::context().make<ast::Module>(std::move(m_global_decls));
   }
 
+  const std::vector<std::string_view>& Parser::spans() const
+  {
+    return m_spans;
+  }
+
   Result<ast::CRef<ast::Decl>> Parser::parse_global_declaration()
   {
     auto attrs = parse_attributes();
@@ -48,6 +70,14 @@ namespace kate::tlr {
     if (decl.matched)
       return decl;
 
+    decl = parse_const_decl();
+    if (decl.matched)
+      return decl;
+
+    decl = parse_import_decl();
+    if (decl.matched)
+      return decl;
+
     // if all global declarations failed, then
     // synchronize to the next '}' and fail.
     sync_to(Token::Type::kRBrace);
@@ -198,7 +228,7 @@ namespace kate::tlr {
       if (!matches(Token::Type::kSemicolon))
         return error("missing semicolon after for statement condition.");
 
-      auto continuing = statement();
+      auto continuing = parse_expr_stat();
 
       if (continuing.errored)
         return Failure::kError;
@@ -214,15 +244,11 @@ namespace kate::tlr {
         return error("missing block in for statement.");
 
       return ast::context().make<ast::ForStat>(
-        ast::context().make<ast::ExprStat>(
-          std::move(initializer.value)
-        ),
+        std::move(initializer.value),
         std::move(condition.value),
-        ast::context().make<ast::ExprStat>(
-          std::move(continuing.value)
-        ),
+        std::move(continuing.value),
         std::move(block)
-      );      
+      );
     }
 
     return Failure::kNoMatch;
@@ -279,10 +305,10 @@ namespace kate::tlr {
     return Failure::kError;
   }
 
-  Result<std::vector<ast::CRef<ast::StructMember>>> Parser::struct_members()
+  Result<ast::List<ast::StructMember>> Parser::struct_members()
   {
     if (matches(Token::Type::kLBrace)) {
-      std::vector<ast::CRef<ast::StructMember>> members;
+      ast::List<ast::StructMember> members;
 
       size_t i = 0;
 
@@ -429,6 +455,13 @@ namespace kate::tlr {
 
     if (stat.matched) return std::move(stat);
 
+    // try a break statement.
+    stat = parse_break_stat();
+
+    if (stat.errored) return Failure::kError;
+
+    if (stat.matched) return std::move(stat);
+
     // try a if statement.
     stat = if_statement();
 
@@ -470,7 +503,7 @@ namespace kate::tlr {
 
   Result<ast::CRef<ast::BlockStat>> Parser::parse_block()
   {
-    std::vector<ast::CRef<ast::Stat>> statements;
+    ast::List<ast::Stat> statements;
 
     if (matches(Token::Type::kLBrace)) {
       while (should_continue() && !matches(Token::Type::kRBrace)) {
@@ -490,13 +523,13 @@ namespace kate::tlr {
     return Failure::kNoMatch;
   }
 
-  Result<std::vector<ast::CRef<ast::Expr>>> Parser::parse_expression_list()
+  Result<ast::List<ast::Expr>> Parser::parse_expression_list()
   {
     auto expr = parse_expr();
 
     if (!expr.matched) return Failure::kNoMatch;
 
-    std::vector<ast::CRef<ast::Expr>> expr_list;
+    ast::List<ast::Expr> expr_list;
     expr_list.push_back(std::move(expr.value));
 
     while (matches(Token::Type::kComma)) {
@@ -518,7 +551,7 @@ namespace kate::tlr {
   Result<ast::CRef<ast::ArrayExpr>> Parser::array_expr()
   {
     if (matches(Token::Type::kLeftBracket)) {
-      std::vector<ast::CRef<ast::Expr>> expr_list;
+      ast::List<ast::Expr> expr_list;
 
       for (size_t i = 0; should_continue() && !matches(Token::Type::kRightBracket); i++) {
         if (i > 0)
@@ -749,22 +782,20 @@ namespace kate::tlr {
     while (lookahead && is_operator(*lookahead) && get_precedence(*lookahead) >= min_precedence) {
       auto op = lookahead;
 
-      bool is_index_accessor = false;
-      if (op && op->type() == Token::Type::kLeftBracket) is_index_accessor = true;
+      bool is_index_accessor = op->type() == Token::Type::kLeftBracket;
 
       advance();
 
-      auto rhs_expr = primary_expr();
+      // the index is a whole expression, e.g. 'a[id.x + 1]'.
+      auto rhs_expr = is_index_accessor ? parse_expr() : primary_expr();
 
       if (rhs_expr.errored || !rhs_expr.matched)
           return error("error while parsing expression.");
 
       auto rhs = rhs_expr.unwrap();
 
-      if (is_index_accessor) {
-          matches(Token::Type::kRightBracket);
-          is_index_accessor = false;
-      }
+      if (is_index_accessor && !matches(Token::Type::kRightBracket))
+          return error("missing ']' after index expression.");
 
       lookahead = peek(1);
 
@@ -773,9 +804,6 @@ namespace kate::tlr {
           || (get_associativity(*lookahead) == Associativity::kRight 
                           && get_precedence(*lookahead) == get_precedence(*op))))
       {
-          if (lookahead && lookahead->type() == Token::Type::kLeftBracket)
-              is_index_accessor = true;
-
           auto rhs_expr2 = parse_expression_1(
               std::move(rhs),
               get_precedence(*op) + ((get_precedence(*lookahead) > get_precedence(*op)) ? 1 : 0)
@@ -786,11 +814,6 @@ namespace kate::tlr {
 
           rhs = rhs_expr2;
 
-          if (is_index_accessor) {
-              matches(Token::Type::kRightBracket);
-              is_index_accessor = false;
-          }
-
           lookahead = peek(1);
       }
 
@@ -925,10 +948,10 @@ namespace kate::tlr {
     return expr; 
   }
 
-  Result<std::vector<ast::CRef<ast::Attr>>> Parser::parse_attributes()
+  Result<ast::List<ast::Attr>> Parser::parse_attributes()
   {
     // TODO (Renan): We need to implemenet a synchronization point here.
-    std::vector<ast::CRef<ast::Attr>> attribute_list;
+    ast::List<ast::Attr> attribute_list;
 
     while (matches(Token::Type::kAt)) {
       auto ident = parse_name();
@@ -956,10 +979,14 @@ namespace kate::tlr {
         type = ast::Attr::Type::kInput;
       else if (ident.value == "builtin")
         type = ast::Attr::Type::kBuiltin;
+      else if (ident.value == "test")
+        type = ast::Attr::Type::kTest;
+      else if (ident.value == "case")
+        type = ast::Attr::Type::kCase;
       else 
         return error(fmt::format("unknown attribute '{}'.", ident.value));
 
-      Result<std::vector<ast::CRef<ast::Expr>>> expr_list;
+      Result<ast::List<ast::Expr>> expr_list;
       
       if (matches(Token::Type::kLeftParen)) {
         expr_list = parse_expression_list();
@@ -984,6 +1011,9 @@ namespace kate::tlr {
   Result<ast::CRef<ast::ReturnStat>> Parser::parse_return_stat()
   {
     if (matches("return")) {
+      if (matches(Token::Type::kSemicolon))
+        return ast::context().make<ast::ReturnStat>(ast::CRef<ast::Expr>());
+
       auto expr = parse_expr();
 
       if (expr.errored) return Failure::kError;
@@ -1001,8 +1031,88 @@ namespace kate::tlr {
     return Failure::kNoMatch;
   }
 
+  Result<ast::CRef<ast::BreakStat>> Parser::parse_break_stat()
+  {
+    if (matches("break")) {
+      if (!matches(Token::Type::kSemicolon))
+        return error("missing ';' after 'break' statement.");
+
+      return ast::context().make<ast::BreakStat>();
+    }
+
+    return Failure::kNoMatch;
+  }
+
+  Result<ast::CRef<ast::ImportDecl>> Parser::parse_import_decl()
+  {
+    if (matches("import")) {
+      auto path = matches(Token::Type::kString);
+
+      if (!path || path->is(Token::Type::kEOF))
+        return error("expected the path of the imported file in quotes.");
+
+      if (!matches(Token::Type::kSemicolon))
+        return error("missing ';' after import declaration.");
+
+      return ast::context().make<ast::ImportDecl>(
+        std::string(path->value_as<std::string_view>())
+      );
+    }
+
+    return Failure::kNoMatch;
+  }
+
+  Result<ast::CRef<ast::ConstDecl>> Parser::parse_const_decl()
+  {
+    if (matches("const")) {
+      auto name = parse_name();
+
+      if (name.errored)
+        return Failure::kError;
+
+      if (!name.matched)
+        return error("missing name in constant declaration.");
+
+      ast::CRef<ast::Type> type;
+
+      if (matches(Token::Type::kColon)) {
+        auto type_result = expect_type();
+
+        if (type_result.errored)
+          return Failure::kError;
+
+        if (!type_result.matched)
+          return error("missing type after ':' in constant declaration.");
+
+        type = std::move(type_result.value);
+      }
+
+      if (!matches(Token::Type::kEqual))
+        return error("constants must be initialized with '='.");
+
+      auto initializer = parse_expr();
+
+      if (initializer.errored)
+        return Failure::kError;
+
+      if (!initializer.matched)
+        return error("missing initializer expression in constant declaration.");
+
+      if (!matches(Token::Type::kSemicolon))
+        return error("missing ';' after constant declaration.");
+
+      return ast::context().make<ast::ConstDecl>(
+        name.value,
+        std::move(type),
+        std::move(initializer.value)
+      );
+    }
+
+    return Failure::kNoMatch;
+  }
+
   Result<ast::CRef<ast::UniformDecl>> Parser::parse_uniform_decl(
-    std::vector<ast::CRef<ast::Attr>>& attributes
+    ast::List<ast::Attr>& attributes
   )
   {
     if (matches("uniform")) {
@@ -1039,11 +1149,11 @@ namespace kate::tlr {
   }
 
   Result<ast::CRef<ast::BufferDecl>> Parser::parse_buffer_decl(
-    std::vector<ast::CRef<ast::Attr>>& attributes
+    ast::List<ast::Attr>& attributes
   )
   {
     if (matches("buffer")) {
-      std::vector<ast::CRef<ast::Expr>> expr_list;
+      ast::List<ast::Expr> expr_list;
 
       ast::BufferArgs args;
 
@@ -1091,7 +1201,7 @@ namespace kate::tlr {
   }
 
   Result<ast::CRef<ast::FuncDecl>> Parser::parse_func_decl(
-    std::vector<ast::CRef<ast::Attr>>& attributes
+    ast::List<ast::Attr>& attributes
   )
   {
     if (matches("fn")) {
@@ -1103,9 +1213,12 @@ namespace kate::tlr {
       if (!matches(Token::Type::kLeftParen))
         return error("expected a '(' after function name.");
 
-      std::vector<ast::CRef<ast::FuncArg>> function_args;
+      ast::List<ast::FuncArg> function_args;
 
       while (should_continue() && !matches(Token::Type::kRightParen)) {
+        if (!function_args.empty() && !matches(Token::Type::kComma))
+          return error("missing ',' between function arguments.");
+
         auto attrs = parse_attributes();
 
         if (attrs.errored) return Failure::kError;
@@ -1126,7 +1239,8 @@ namespace kate::tlr {
         function_args.push_back(
           ast::context().make<ast::FuncArg>(
             ident,
-            type
+            type,
+            std::move(attrs.value)
           )
         );
       }
@@ -1159,7 +1273,8 @@ namespace kate::tlr {
         std::move(type),
         function_name,
         std::move(block.value),
-        std::move(function_args)
+        std::move(function_args),
+        std::move(attributes)
       );
     }
 
@@ -1198,21 +1313,38 @@ namespace kate::tlr {
       );
     }
 
+    auto& first = m_lexer[offset + 1];
+
     auto struct_members_ = struct_members();
 
     if (struct_members_.errored) return Failure::kError;
 
     if (struct_members_.matched) {
-      static size_t n = 0;
+      // named after its members, so the name doesn't depend on what was parsed before and the
+      // same struct parsed again, e.g. by a module importing it, gets the same name.
+      auto begin = std::get_if<std::string_view>(&first.value());
+      auto end = std::get_if<std::string_view>(&m_lexer[offset].value());
 
-      auto struct_name = fmt::format("priv_{}", ++n);
+      uint64_t hash = 0xcbf29ce484222325;
 
-      m_global_decls.push_back(
-        ast::context().make<ast::StructDecl>(
-          struct_name,
-          std::move(struct_members_.value)
-        )
-      );
+      if (begin && end)
+        for (auto c : std::string_view(begin->data(), end->data() + end->size() - begin->data()))
+          if (!std::isspace(static_cast<unsigned char>(c)))
+            hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001b3;
+
+      auto struct_name = fmt::format("priv_{:016x}", hash);
+
+      if (m_private_structs.insert(struct_name).second) {
+        m_global_decls.push_back(
+          ast::context().make<ast::StructDecl>(
+            struct_name,
+            std::move(struct_members_.value)
+          )
+        );
+
+        // the struct has no text of its own, it's declared again with the declaration using it.
+        m_spans.emplace_back();
+      }
 
       return static_cast<ast::CRef<ast::Type>>(
         ast::context().make<ast::TypeId>(struct_name)
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <filesystem>
 #include <optional>
 #include <functional>
+#include <unordered_set>
 
 #include "lexer.h"
 #include "ast.h"
@@ -50,6 +52,9 @@ namespace kate::tlr {
 
     struct ParserOptions {
         std::function<void(const std::string_view& error)> error_callback; 
+
+        // called with the path of each module linked into the one compiled, before it's read.
+        std::function<void(const std::filesystem::path& path)> import_callback;
     };
 
     class Parser {
@@ -57,6 +62,9 @@ namespace kate::tlr {
         Parser(const ParserOptions& options);
 
         ast::CRef<ast::Module> parse(const std::string_view& source);
+
+        // source text of each global declaration of the last module parsed, in the same order.
+        const std::vector<std::string_view>& spans() const;
     private:
         enum class Associativity {
           kLeft, kRight
@@ -87,19 +95,25 @@ namespace kate::tlr {
         Result<ast::CRef<ast::Decl>> parse_global_declaration();
 
         Result<ast::CRef<ast::FuncDecl>> parse_func_decl(
-          std::vector<ast::CRef<ast::Attr>>& attributes
+          ast::List<ast::Attr>& attributes
         );
 
         Result<ast::CRef<ast::BufferDecl>> parse_buffer_decl(
-          std::vector<ast::CRef<ast::Attr>>& attributes
+          ast::List<ast::Attr>& attributes
         );
 
         Result<ast::CRef<ast::UniformDecl>> parse_uniform_decl(
-          std::vector<ast::CRef<ast::Attr>>& attributes
+          ast::List<ast::Attr>& attributes
         );
 
+        Result<ast::CRef<ast::ConstDecl>> parse_const_decl();
+
+        Result<ast::CRef<ast::ImportDecl>> parse_import_decl();
+
         Result<ast::CRef<ast::ReturnStat>> parse_return_stat();
 
+        Result<ast::CRef<ast::BreakStat>> parse_break_stat();
+
         Result<ast::CRef<ast::Type>> expect_type();
 
         Result<ast::CRef<ast::Stat>> statement();
@@ -116,13 +130,13 @@ namespace kate::tlr {
 
         Result<ast::CRef<ast::StructDecl>> struct_declaration();
 
-        Result<std::vector<ast::CRef<ast::StructMember>>> struct_members();
+        Result<ast::List<ast::StructMember>> struct_members();
 
         Result<ast::CRef<ast::BlockStat>> parse_block();
 
-        Result<std::vector<ast::CRef<ast::Attr>>> parse_attributes();
+        Result<ast::List<ast::Attr>> parse_attributes();
 
-        Result<std::vector<ast::CRef<ast::Expr>>> parse_expression_list();
+        Result<ast::List<ast::Expr>> parse_expression_list();
 
         Result<ast::CRef<ast::Expr>> parse_expression_1(
           ast::CRef<ast::Expr>&& lhs,
@@ -149,7 +163,12 @@ namespace kate::tlr {
 
         ParserOptions m_options;
 
-      std::vector<ast::CRef<ast::Decl>> m_global_decls;
+      ast::List<ast::Decl> m_global_decls;
+
+        std::vector<std::string_view> m_spans;
+
+        // names of the structs declared inline in a type.
+        std::unordered_set<std::string> m_private_structs;
 
         Lexer m_lexer;
 
@@ -0,0 +1,74 @@
+#include "rewrite.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace kate::tlr {
+  void Rewriter::splice(
+    ast::BlockStat* block,
+    size_t index,
+    ast::List<ast::Stat>&& with
+  )
+  {
+    assert(!ast::context().shared(block));
+
+    auto& splices = m_splices[block];
+
+    if (splices.empty())
+      m_blocks.push_back(block);
+
+    splices.push_back(Splice { index, std::move(with) });
+    m_num_rewrites++;
+  }
+
+  void Rewriter::commit()
+  {
+    for (auto block : m_blocks) {
+      // the block was shared after it was spliced.
+      assert(!ast::context().shared(block));
+
+      auto& splices = m_splices[block];
+
+      std::sort(splices.begin(), splices.end(), [](auto& lhs, auto& rhs) {
+        return lhs.index < rhs.index;
+      });
+
+      auto& stats = block->stats();
+
+      size_t size = stats.size();
+
+      for (auto& splice : splices)
+        size += splice.stats.size() - 1;
+
+      ast::List<ast::Stat> spliced;
+      spliced.reserve(size);
+
+      auto next = splices.begin();
+
+      for (size_t i = 0; i < stats.size(); i++) {
+        if (next == splices.end() || next->index != i) {
+          spliced.push_back(std::move(stats[i]));
+          continue;
+        }
+
+        for (auto& stat : next->stats)
+          spliced.push_back(std::move(stat));
+
+        ++next;
+
+        assert(next == splices.end() || next->index != i);
+      }
+
+      // the statements spliced out are removed with the old list.
+      stats = std::move(spliced);
+    }
+
+    m_blocks.clear();
+    m_splices.clear();
+  }
+
+  size_t Rewriter::num_rewrites() const
+  {
+    return m_num_rewrites;
+  }
+}
\ No newline at end of file
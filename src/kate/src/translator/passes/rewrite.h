@@ -0,0 +1,55 @@
+#pragma once
+
+#include "../ast.h"
+
+#include <cassert>
+#include <unordered_map>
+#include <vector>
+
+namespace kate::tlr {
+  // Rewrites a tree in place for a pass.
+  //
+  // Replacing a node is O(1), the handle of the slot takes the new node. Statements spliced
+  // into a block are recorded and applied when the rewriter commits, in one pass over each
+  // block changed, so a block costs its size once whatever the number of splices in it.
+  //
+  // Nodes written to, the owner of a slot and the blocks spliced, must not be shared with
+  // clones: they're taken through 'ASTContext::mutate' beforehand.
+  class Rewriter {
+  public:
+    // puts 'with' in 'slot' of 'owner', the node it held is removed.
+    template<typename T, typename U>
+    void replace(ast::TreeNode* owner, ast::CRef<T>& slot, ast::CRef<U>&& with)
+    {
+      assert(!ast::context().shared(owner));
+
+      ast::context().replace(slot, std::move(with));
+      m_num_rewrites++;
+    }
+
+    // replaces the statement at 'index' of 'block' by 'with', removing it when 'with' is
+    // empty. Indices are the ones of the block before it's spliced, each statement is spliced
+    // at most once.
+    void splice(
+      ast::BlockStat* block,
+      size_t index,
+      ast::List<ast::Stat>&& with
+    );
+
+    // applies the splices.
+    void commit();
+
+    size_t num_rewrites() const;
+  private:
+    struct Splice {
+      size_t index;
+      ast::List<ast::Stat> stats;
+    };
+
+    // blocks in the order they were first spliced, so they're committed in the same order.
+    std::vector<ast::BlockStat*> m_blocks;
+    std::unordered_map<ast::BlockStat*, std::vector<Splice>> m_splices;
+
+    size_t m_num_rewrites = 0;
+  };
+}
\ No newline at end of file
@@ -0,0 +1,364 @@
+#include "traverse.h"
+
+#include <algorithm>
+
+namespace kate::tlr {
+  namespace {
+    // calls 'fn' with each child of a node.
+    struct Children {
+      void (*fn)(void* data, ast::TreeNode* child);
+      void* data;
+    };
+
+    template<typename T>
+    void add(Children& children, ast::CRef<T>& child)
+    {
+      if (child)
+        children.fn(children.data, child.get());
+    }
+
+    template<typename T>
+    void add(Children& children, ast::List<T>& list)
+    {
+      for (auto& child : list)
+        add(children, child);
+    }
+
+    // the children of each type of node, in the order of the source.
+    struct ChildrenOf {
+      const base::rtti::TypeMetadata* metadata;
+      void (*children)(ast::TreeNode* node, void (*fn)(void* data, ast::TreeNode* child), void* data);
+    };
+
+    template<typename T, typename Fn>
+    constexpr ChildrenOf children_of(Fn)
+    {
+      return ChildrenOf {
+        &InfoStructure<T>::data,
+        [](ast::TreeNode* node, void (*fn)(void* data, ast::TreeNode* child), void* data) {
+          Children children { fn, data };
+          Fn {}(static_cast<T*>(node), children);
+        }
+      };
+    }
+
+    const ChildrenOf kChildren[] = {
+      children_of<ast::Module>([](ast::Module* n, Children& c) { add(c, n->global_declarations()); }),
+      children_of<ast::FuncArg>([](ast::FuncArg* n, Children& c) { add(c, n->attrs()); add(c, n->type()); }),
+      children_of<ast::FuncDecl>([](ast::FuncDecl* n, Children& c) {
+        add(c, n->attrs());
+        add(c, n->args());
+        add(c, n->type());
+        add(c, n->block());
+      }),
+      children_of<ast::VarDecl>([](ast::VarDecl* n, Children& c) { add(c, n->type()); }),
+      children_of<ast::ConstDecl>([](ast::ConstDecl* n, Children& c) { add(c, n->type()); add(c, n->expr()); }),
+      children_of<ast::StructMember>([](ast::StructMember* n, Children& c) { add(c, n->attrs()); add(c, n->type()); }),
+      children_of<ast::StructDecl>([](ast::StructDecl* n, Children& c) { add(c, n->attrs()); add(c, n->members()); }),
+      children_of<ast::BufferDecl>([](ast::BufferDecl* n, Children& c) { add(c, n->attributes()); add(c, n->type()); }),
+      children_of<ast::UniformDecl>([](ast::UniformDecl* n, Children& c) { add(c, n->attributes()); add(c, n->type()); }),
+      children_of<ast::Attr>([](ast::Attr* n, Children& c) { add(c, n->args()); }),
+      children_of<ast::ArrayType>([](ast::ArrayType* n, Children& c) { add(c, n->type()); add(c, n->arraySizeExpr()); }),
+      children_of<ast::UnaryExpr>([](ast::UnaryExpr* n, Children& c) { add(c, n->operand()); }),
+      children_of<ast::BinaryExpr>([](ast::BinaryExpr* n, Children& c) { add(c, n->lhs()); add(c, n->rhs()); }),
+      children_of<ast::CallExpr>([](ast::CallExpr* n, Children& c) { add(c, n->id()); add(c, n->args()); }),
+      children_of<ast::ArrayExpr>([](ast::ArrayExpr* n, Children& c) { add(c, n->items()); }),
+      children_of<ast::BlockStat>([](ast::BlockStat* n, Children& c) { add(c, n->stats()); }),
+      children_of<ast::VarStat>([](ast::VarStat* n, Children& c) { add(c, n->decl()); add(c, n->expr()); }),
+      children_of<ast::ExprStat>([](ast::ExprStat* n, Children& c) { add(c, n->expr()); }),
+      children_of<ast::ReturnStat>([](ast::ReturnStat* n, Children& c) { add(c, n->expr()); }),
+      children_of<ast::IfStat>([](ast::IfStat* n, Children& c) {
+        add(c, n->condition());
+        add(c, n->block());
+        add(c, n->elseBlock());
+      }),
+      children_of<ast::ForStat>([](ast::ForStat* n, Children& c) {
+        add(c, n->initializer());
+        add(c, n->condition());
+        add(c, n->continuing());
+        add(c, n->block());
+      }),
+      children_of<ast::WhileStat>([](ast::WhileStat* n, Children& c) { add(c, n->condition()); add(c, n->block()); }),
+    };
+
+    void no_children(ast::TreeNode* node, void (*fn)(void* data, ast::TreeNode* child), void* data)
+    {
+    }
+
+    // the expression slots of the types of expressions having some.
+    struct SlotsOf {
+      const base::rtti::TypeMetadata* metadata;
+      size_t (*num_slots)(ast::Expr* expr);
+      ast::CRef<ast::Expr>& (*slot)(ast::Expr* expr, size_t index);
+    };
+
+    const SlotsOf kSlots[] = {
+      {
+        &InfoStructure<ast::BinaryExpr>::data,
+        [](ast::Expr* expr) -> size_t {
+          auto type = static_cast<ast::BinaryExpr*>(expr)->type();
+
+          return type == ast::BinaryExpr::Type::kMemberAccess || type == ast::BinaryExpr::Type::kSwizzle ? 1 : 2;
+        },
+        [](ast::Expr* expr, size_t index) -> ast::CRef<ast::Expr>& {
+          auto bexpr = static_cast<ast::BinaryExpr*>(expr);
+
+          return index == 0 ? bexpr->lhs() : bexpr->rhs();
+        }
+      },
+      {
+        &InfoStructure<ast::UnaryExpr>::data,
+        [](ast::Expr* expr) -> size_t { return 1; },
+        [](ast::Expr* expr, size_t index) -> ast::CRef<ast::Expr>& {
+          return static_cast<ast::UnaryExpr*>(expr)->operand();
+        }
+      },
+      {
+        &InfoStructure<ast::CallExpr>::data,
+        [](ast::Expr* expr) { return static_cast<ast::CallExpr*>(expr)->args().size(); },
+        [](ast::Expr* expr, size_t index) -> ast::CRef<ast::Expr>& {
+          return static_cast<ast::CallExpr*>(expr)->args()[index];
+        }
+      },
+      {
+        &InfoStructure<ast::ArrayExpr>::data,
+        [](ast::Expr* expr) { return static_cast<ast::ArrayExpr*>(expr)->items().size(); },
+        [](ast::Expr* expr, size_t index) -> ast::CRef<ast::Expr>& {
+          return static_cast<ast::ArrayExpr*>(expr)->items()[index];
+        }
+      },
+    };
+
+    size_t no_slots(ast::Expr* expr)
+    {
+      return 0;
+    }
+  }
+
+  const Traversal::Entry& Traversal::resolve(const base::rtti::TypeMetadata* metadata)
+  {
+    if (2 * (m_num_entries + 1) > m_entries.size()) {
+      auto entries = std::move(m_entries);
+
+      m_entries.assign(std::max<size_t>(2 * entries.size(), 64), Entry {});
+      m_num_entries = 0;
+
+      for (auto& entry : entries)
+        if (entry.metadata)
+          insert(entry);
+    }
+
+    Entry entry { .metadata = metadata };
+
+    // the handlers of the most derived type, up to the root of the types which is its own base.
+    for (auto type = metadata; type != &InfoStructure<base::rtti::Base>::data && entry.handlers == kNone; type = type->base)
+      for (uint32_t i = 0; i < m_handlers.size(); i++)
+        if (m_handlers[i].metadata == type)
+          entry.handlers = i;
+
+    entry.children = no_children;
+
+    for (auto& of : kChildren)
+      if (of.metadata == metadata)
+        entry.children = of.children;
+
+    entry.num_slots = no_slots;
+
+    for (auto& of : kSlots)
+      if (of.metadata == metadata) {
+        entry.num_slots = of.num_slots;
+        entry.slot = of.slot;
+      }
+
+    return insert(entry);
+  }
+
+  Traversal::Entry& Traversal::insert(const Entry& entry)
+  {
+    auto mask = m_entries.size() - 1;
+    auto i = hash(entry.metadata) & mask;
+
+    while (m_entries[i].metadata)
+      i = (i + 1) & mask;
+
+    m_num_entries++;
+
+    return m_entries[i] = entry;
+  }
+
+  void Traversal::run(ast::TreeNode* node)
+  {
+    m_runs++;
+
+    walk(node);
+
+    // the tasks are dropped once no walk may call them.
+    if (--m_runs == 0)
+      m_tasks.clear();
+  }
+
+  void Traversal::walk(ast::TreeNode* node)
+  {
+    if (m_depth == kMaxRecursion) {
+      iterate(node);
+      return;
+    }
+
+    m_depth++;
+
+    // 'm_entries' grows when a walk below meets a new type.
+    auto& entry = this->entry(node);
+    auto handlers = entry.handlers != kNone ? &m_handlers[entry.handlers] : nullptr;
+    auto children = entry.children;
+
+    auto scheduled = m_scheduled.size();
+    bool walk_children = !handlers || !handlers->pre || handlers->pre(node);
+
+    if (m_scheduled.size() > scheduled)
+      drain(scheduled);
+
+    if (walk_children) {
+      children(node, [](void* data, ast::TreeNode* child) {
+        static_cast<Traversal*>(data)->walk(child);
+      }, this);
+    }
+
+    if (handlers && handlers->post) {
+      handlers->post(node);
+
+      if (m_scheduled.size() > scheduled)
+        drain(scheduled);
+    }
+
+    m_depth--;
+  }
+
+  void Traversal::iterate(ast::TreeNode* node)
+  {
+    auto base = m_stack.size();
+
+    m_stack.push_back(Item { .node = node, .step = Step::kEnter });
+
+    while (m_stack.size() > base) {
+      auto item = m_stack.back();
+      m_stack.pop_back();
+
+      auto scheduled = m_scheduled.size();
+
+      if (item.step == Step::kTask)
+        call(item.task);
+      else {
+        auto& entry = this->entry(item.node);
+        auto handlers = entry.handlers != kNone ? &m_handlers[entry.handlers] : nullptr;
+
+        if (item.step == Step::kExit)
+          handlers->post(item.node);
+        else {
+          auto children = entry.children;
+          bool walk = !handlers || !handlers->pre || handlers->pre(item.node);
+
+          // popped in reverse, what the handler scheduled, the children then the exit.
+          if (handlers && handlers->post)
+            m_stack.push_back(Item { .node = item.node, .step = Step::kExit });
+
+          if (walk) {
+            auto first = m_stack.size();
+
+            children(item.node, [](void* data, ast::TreeNode* child) {
+              static_cast<std::vector<Item>*>(data)->push_back(Item { .node = child, .step = Step::kEnter });
+            }, &m_stack);
+
+            std::reverse(m_stack.begin() + first, m_stack.end());
+          }
+        }
+      }
+
+      for (auto i = m_scheduled.size(); i > scheduled; i--)
+        m_stack.push_back(m_scheduled[i - 1]);
+
+      m_scheduled.resize(scheduled);
+    }
+  }
+
+  void Traversal::drain(size_t base)
+  {
+    // what's walked or called drains what it schedules in turn, the size is back to what it
+    // was once it returns.
+    for (auto i = base; i < m_scheduled.size(); i++) {
+      auto item = m_scheduled[i];
+
+      if (item.step == Step::kTask) {
+        auto scheduled = m_scheduled.size();
+
+        call(item.task);
+        drain(scheduled);
+      } else
+        walk(item.node);
+    }
+
+    m_scheduled.resize(base);
+  }
+
+  void Traversal::call(uint32_t task)
+  {
+    // a copy, the task may schedule others and grow 'm_tasks'.
+    auto copy = m_tasks[task];
+
+    copy.call(copy.data);
+  }
+
+  void Traversal::visit(ast::TreeNode* node)
+  {
+    m_scheduled.push_back(Item { .node = node, .step = Step::kEnter });
+  }
+
+  void Traversal::rewrite(ast::CRef<ast::Expr>& slot, const SlotCallback& cb)
+  {
+    auto& ctx = ast::context();
+    auto base = m_frames.size();
+
+    // the frames are the path from 'slot' to the slot being visited.
+    auto at = [&](size_t i) -> ast::CRef<ast::Expr>& {
+      return m_frames[i].slot ? *m_frames[i].slot : m_frames[i].own;
+    };
+
+    m_frames.push_back(Frame { .slot = &slot });
+
+    while (m_frames.size() > base) {
+      auto top = m_frames.size() - 1;
+      auto& current = at(top);
+      auto expr = current.get();
+      auto entry = this->entry(expr);
+
+      if (m_frames[top].next < entry.num_slots(expr)) {
+        auto index = m_frames[top].next++;
+        auto& child = entry.slot(expr, index);
+
+        if (!child) continue;
+
+        // below a shared node, slots belong to every handle sharing it.
+        if (ctx.shared(current))
+          m_frames.push_back(Frame { .slot = nullptr, .own = ctx.clone(child), .index = index });
+        else
+          m_frames.push_back(Frame { .slot = &child, .index = index });
+
+        continue;
+      }
+
+      cb(current);
+
+      // a handle of its own replaced by 'cb' or below, the parent is copied to hold it.
+      if (!m_frames[top].slot && top > base) {
+        // 'cb' may have rewritten another tree and grown the frames.
+        auto& own = m_frames[top].own;
+        auto& parent = at(top - 1);
+        auto parent_entry = this->entry(parent.get());
+
+        if (own.m_id != parent_entry.slot(parent.get(), m_frames[top].index).m_id)
+          parent_entry.slot(ctx.mutate(parent), m_frames[top].index) = std::move(own);
+      }
+
+      m_frames.pop_back();
+    }
+  }
+}
\ No newline at end of file
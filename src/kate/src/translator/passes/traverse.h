@@ -0,0 +1,200 @@
+#pragma once
+
+#include "../ast.h"
+
+#include <functional>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace kate::tlr {
+  // Walks trees recursively down to a fixed depth, and below it with a stack of its own rather
+  // than the call stack, so the depth of a tree is only bound by memory, e.g. the long chains
+  // of operations of generated shaders, while the shallow trees most shaders are made of don't
+  // pay for the stack.
+  //
+  // Handlers are registered for a type of node, subclasses included, the one of the most
+  // derived type is called. They are found through a small hash table of the types of nodes,
+  // filled the first time a type is met, instead of testing the types of the handlers one
+  // after the other.
+  //
+  // A 'pre' handler is called when a node is reached and returns whether its children are
+  // walked, a 'post' handler once they were. Handlers schedule nodes and functions with 'visit'
+  // and 'then', they are walked and called in that order once the handler returns, before the
+  // children of the node, e.g. to print an operator between two operands. Handlers are all
+  // registered before walking.
+  class Traversal {
+  public:
+    using SlotCallback = std::function<void(ast::CRef<ast::Expr>&)>;
+
+    template<typename T, typename Fn>
+    void pre(Fn&& fn)
+    {
+      handlers<T>().pre = [fn = std::forward<Fn>(fn)](ast::TreeNode* node) mutable {
+        if constexpr (std::is_void_v<std::invoke_result_t<Fn&, T*>>) {
+          fn(static_cast<T*>(node));
+          return true;
+        } else
+          return fn(static_cast<T*>(node));
+      };
+    }
+
+    template<typename T, typename Fn>
+    void post(Fn&& fn)
+    {
+      handlers<T>().post = [fn = std::forward<Fn>(fn)](ast::TreeNode* node) mutable {
+        fn(static_cast<T*>(node));
+      };
+    }
+
+    // walks 'node' and what its handlers schedule. Handlers may walk another tree with it,
+    // e.g. to print a subtree on its own.
+    void run(ast::TreeNode* node);
+
+    // from a handler, walks 'node' after it.
+    void visit(ast::TreeNode* node);
+
+    // From a handler, calls 'fn' after it, and after what it scheduled before. 'fn' is kept in
+    // place rather than in a 'std::function', it's a lambda capturing a few pointers.
+    template<typename Fn>
+    void then(Fn&& fn)
+    {
+      using F = std::decay_t<Fn>;
+
+      static_assert(sizeof(F) <= sizeof(Task::data) && alignof(F) <= alignof(Task));
+      static_assert(std::is_trivially_copyable_v<F> && std::is_trivially_destructible_v<F>);
+
+      Task task { .call = [](void* data) { (*static_cast<F*>(data))(); } };
+      new (task.data) F(std::forward<Fn>(fn));
+
+      m_scheduled.push_back(Item { .node = nullptr, .task = static_cast<uint32_t>(m_tasks.size()), .step = Step::kTask });
+      m_tasks.push_back(task);
+    }
+
+    // Calls 'cb' with each expression slot under 'slot' and 'slot' last, children before their
+    // parent, so 'cb' may replace the node a slot holds. Nodes shared with clones aren't
+    // modified: they are reached through handles of their own and copied only when something
+    // below them was replaced, so a change copies the path to it. The right side of member
+    // accesses and swizzles is a name, it has no slot.
+    void rewrite(ast::CRef<ast::Expr>& slot, const SlotCallback& cb);
+  private:
+    static constexpr uint32_t kNone = std::numeric_limits<uint32_t>::max();
+
+    // depth below which the rest of a tree is walked with 'm_stack'.
+    static constexpr size_t kMaxRecursion = 64;
+
+    struct Handlers {
+      const base::rtti::TypeMetadata* metadata;
+      std::function<bool(ast::TreeNode*)> pre;
+      std::function<void(ast::TreeNode*)> post;
+    };
+
+    // the walk of the nodes of a type, empty without a type.
+    struct Entry {
+      const base::rtti::TypeMetadata* metadata = nullptr;
+      uint32_t handlers = kNone;
+      // calls 'fn' with each child of the node.
+      void (*children)(ast::TreeNode* node, void (*fn)(void* data, ast::TreeNode* child), void* data) = nullptr;
+      size_t (*num_slots)(ast::Expr* expr) = nullptr;
+      ast::CRef<ast::Expr>& (*slot)(ast::Expr* expr, size_t index) = nullptr;
+    };
+
+    enum class Step : uint8_t {
+      kEnter,
+      // the children of the node were walked.
+      kExit,
+      // the function 'task' of 'm_tasks'.
+      kTask
+    };
+
+    struct Item {
+      ast::TreeNode* node;
+      uint32_t task;
+      Step step;
+    };
+
+    struct alignas(void*) Task {
+      void (*call)(void* data);
+      unsigned char data[2 * sizeof(void*)];
+    };
+
+    // a slot on the path being rewritten, the one of its parent or a handle of its own.
+    struct Frame {
+      ast::CRef<ast::Expr>* slot;
+      ast::CRef<ast::Expr> own;
+      uint32_t index;
+      uint32_t next;
+    };
+
+    template<typename T>
+    Handlers& handlers()
+    {
+      auto metadata = &InfoStructure<T>::data;
+
+      // types resolved so far may now have another handler.
+      m_entries.clear();
+      m_num_entries = 0;
+
+      for (auto& h : m_handlers)
+        if (h.metadata == metadata)
+          return h;
+
+      return m_handlers.emplace_back(Handlers { .metadata = metadata });
+    }
+
+    static size_t hash(const base::rtti::TypeMetadata* metadata)
+    {
+      return (reinterpret_cast<uintptr_t>(metadata) * 0x9e3779b97f4a7c15ull) >> 32;
+    }
+
+    // the type is read from the node, which was just reached, rather than from the slot of
+    // the node in the context.
+    const Entry& entry(ast::TreeNode* node)
+    {
+      auto metadata = node->type_metadata;
+      auto mask = m_entries.size() - 1;
+
+      // the bound only stops the probing of an empty table.
+      for (auto i = hash(metadata) & mask; i < m_entries.size(); i = (i + 1) & mask) {
+        if (m_entries[i].metadata == metadata)
+          return m_entries[i];
+
+        if (!m_entries[i].metadata)
+          break;
+      }
+
+      return resolve(metadata);
+    }
+
+    // fills the entry of a type the first time it's met.
+    const Entry& resolve(const base::rtti::TypeMetadata* metadata);
+
+    Entry& insert(const Entry& entry);
+
+    void walk(ast::TreeNode* node);
+
+    // walks 'node' with 'm_stack', past the depth of recursion.
+    void iterate(ast::TreeNode* node);
+
+    // walks and calls what was scheduled after the first 'base' items, in order, then drops it.
+    void drain(size_t base);
+
+    void call(uint32_t task);
+
+    std::vector<Handlers> m_handlers;
+    // a power of two of entries, at most half of them used.
+    std::vector<Entry> m_entries;
+    size_t m_num_entries = 0;
+
+    size_t m_depth = 0;
+    size_t m_runs = 0;
+
+    std::vector<Item> m_stack;
+    // what the handlers being called scheduled, each above what the ones calling them did.
+    std::vector<Item> m_scheduled;
+    std::vector<Task> m_tasks;
+
+    std::vector<Frame> m_frames;
+  };
+}
\ No newline at end of file
@@ -0,0 +1,770 @@
+#include "unroll.h"
+#include "visit.h"
+#include "../comptime.h"
+#include "../sem.h"
+
+#include "base/trace.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+namespace kate::tlr {
+  namespace {
+    // upper bound of iterations simulated when computing a trip count.
+    constexpr uint64_t kMaxSimulatedTripCount = 1 << 16;
+
+    bool is_assignment(ast::BinaryExpr::Type type)
+    {
+      switch (type) {
+        case ast::BinaryExpr::Type::kCompoundAdd:
+        case ast::BinaryExpr::Type::kCompoundSub:
+        case ast::BinaryExpr::Type::kCompoundDiv:
+        case ast::BinaryExpr::Type::kCompoundMul:
+        case ast::BinaryExpr::Type::kCompoundMod:
+        case ast::BinaryExpr::Type::kOrEqual:
+        case ast::BinaryExpr::Type::kXorEqual:
+        case ast::BinaryExpr::Type::kAndEqual:
+        case ast::BinaryExpr::Type::kRightShiftEqual:
+        case ast::BinaryExpr::Type::kLeftShiftEqual:
+        case ast::BinaryExpr::Type::kModulusEqual:
+        case ast::BinaryExpr::Type::kDivideEqual:
+        case ast::BinaryExpr::Type::kMultiplyEqual:
+        case ast::BinaryExpr::Type::kSubtractEqual:
+        case ast::BinaryExpr::Type::kAddEqual:
+        case ast::BinaryExpr::Type::kEqual:
+        case ast::BinaryExpr::Type::kIncrement:
+        case ast::BinaryExpr::Type::kDecrement:
+          return true;
+        default:
+          return false;
+      }
+    }
+
+    bool is_var(ast::Expr* expr, const std::string& var)
+    {
+      auto* idexpr = expr->as<ast::IdExpr>();
+
+      return idexpr && idexpr->ident() == var;
+    }
+
+    std::optional<ast::LitExpr::Value> eval_int(ast::Expr* expr, const comptime::Bindings* consts)
+    {
+      auto value = comptime::eval(expr, consts);
+
+      if (!value || !(value->type & ast::LitExpr::Value::Type::kIntMask))
+        return std::nullopt;
+
+      return value;
+    }
+
+    // the value of an integer literal as a T, if T can hold it.
+    template <typename T>
+    std::optional<T> to(const ast::LitExpr::Value& value)
+    {
+      if (value.type & ast::LitExpr::Value::Type::kUnsignedIntMask) {
+        if (!std::in_range<T>(value.value.u64))
+          return std::nullopt;
+      } else if (!std::in_range<T>(value.value.i64))
+        return std::nullopt;
+
+      return static_cast<T>(value.value.i64);
+    }
+
+    // a step, which must fit an int64_t once negated too.
+    std::optional<int64_t> eval_step(ast::Expr* expr, const comptime::Bindings* consts)
+    {
+      auto value = eval_int(expr, consts);
+
+      if (!value)
+        return std::nullopt;
+
+      auto step = to<int64_t>(value.value());
+
+      if (!step || step.value() == std::numeric_limits<int64_t>::min())
+        return std::nullopt;
+
+      return step;
+    }
+
+    // Moves 'v' by 'step', returns false instead of wrapping when the result
+    // doesn't fit in a T.
+    template <typename T>
+    bool advance(T& v, int64_t step)
+    {
+      if constexpr (std::is_signed_v<T>) {
+        int64_t w = v;
+
+        if (step > 0 ? w > std::numeric_limits<int64_t>::max() - step : w < std::numeric_limits<int64_t>::min() - step)
+          return false;
+
+        w += step;
+
+        if (!std::in_range<T>(w))
+          return false;
+
+        v = static_cast<T>(w);
+      } else {
+        uint64_t w = v;
+        uint64_t magnitude = step < 0 ? 0 - static_cast<uint64_t>(step) : static_cast<uint64_t>(step);
+
+        if (step < 0 ? w < magnitude : w > std::numeric_limits<uint64_t>::max() - magnitude)
+          return false;
+
+        w = step < 0 ? w - magnitude : w + magnitude;
+
+        if (!std::in_range<T>(w))
+          return false;
+
+        v = static_cast<T>(w);
+      }
+
+      return true;
+    }
+
+    // Runs 'for v = start; v <cmp> limit; v += step' in T and returns its trip count,
+    // or std::nullopt if it runs too long or its induction variable would wrap.
+    template <typename T>
+    std::optional<uint64_t> simulate(
+      ast::BinaryExpr::Type cmp,
+      const ast::LitExpr::Value& start,
+      int64_t step,
+      const ast::LitExpr::Value& limit
+    )
+    {
+      auto v = to<T>(start);
+      auto bound = to<T>(limit);
+
+      if (!v || !bound || step == 0)
+        return std::nullopt;
+
+      auto holds = [&](T v) {
+        switch (cmp) {
+          case ast::BinaryExpr::Type::kLessThan:
+            return v < bound.value();
+          case ast::BinaryExpr::Type::kLessThanEqual:
+            return v <= bound.value();
+          case ast::BinaryExpr::Type::kGreaterThan:
+            return v > bound.value();
+          case ast::BinaryExpr::Type::kGreaterThanEqual:
+            return v >= bound.value();
+          default:
+            return v != bound.value();
+        }
+      };
+
+      uint64_t count = 0;
+
+      while (holds(v.value()))
+        if (++count > kMaxSimulatedTripCount || !advance(v.value(), step))
+          return std::nullopt;
+
+      return count;
+    }
+
+    // the type of an induction variable, the one it's declared with or else its initializer's.
+    std::optional<ast::LitExpr::Value::Type> induction_type(
+      ast::VarStat* var_stat,
+      const ast::LitExpr::Value& start
+    )
+    {
+      auto& type = var_stat->decl()->type();
+
+      if (!type)
+        return start.type;
+
+      auto* type_id = type->as<ast::TypeId>();
+
+      if (type_id && type_id->id() == "int")
+        return ast::LitExpr::Value::kI32;
+
+      if (type_id && type_id->id() == "uint")
+        return ast::LitExpr::Value::kU32;
+
+      return std::nullopt;
+    }
+
+    // drops the constants hidden by declarations of a function.
+    void forget_declared(ast::Stat* stat, comptime::Bindings& consts)
+    {
+      base::Match(
+        stat,
+        [&](ast::VarStat* var_stat) {
+          consts.erase(var_stat->decl()->name());
+        },
+        [&](ast::BlockStat* block) {
+          for (auto& s : block->stats())
+            forget_declared(s.get(), consts);
+        },
+        [&](ast::IfStat* if_stat) {
+          forget_declared(if_stat->block().get(), consts);
+
+          if (if_stat->elseBlock())
+            forget_declared(if_stat->elseBlock().get(), consts);
+        },
+        [&](ast::ForStat* for_stat) {
+          if (for_stat->initializer())
+            forget_declared(for_stat->initializer().get(), consts);
+
+          forget_declared(for_stat->block().get(), consts);
+        },
+        [&](ast::WhileStat* while_stat) {
+          forget_declared(while_stat->block().get(), consts);
+        },
+        [&](base::Default) {}
+      );
+    }
+
+    // returns true if the statement contains a 'break' that would leave the loop being unrolled.
+    bool has_loop_break(ast::Stat* stat)
+    {
+      return base::Match(
+        stat,
+        [&](ast::BreakStat* break_stat) {
+          return true;
+        },
+        [&](ast::BlockStat* block) {
+          for (auto& s : block->stats())
+            if (has_loop_break(s.get()))
+              return true;
+
+          return false;
+        },
+        [&](ast::IfStat* if_stat) {
+          return has_loop_break(if_stat->block().get()) ||
+            (if_stat->elseBlock() && has_loop_break(if_stat->elseBlock().get()));
+        },
+        // 'break's inside of nested loops belong to them.
+        [&](base::Default) {
+          return false;
+        }
+      );
+    }
+
+    bool declares(ast::Stat* stat, const std::string& var)
+    {
+      return base::Match(
+        stat,
+        [&](ast::VarStat* var_stat) {
+          return var_stat->decl()->name() == var;
+        },
+        [&](ast::BlockStat* block) {
+          for (auto& s : block->stats())
+            if (declares(s.get(), var))
+              return true;
+
+          return false;
+        },
+        [&](ast::IfStat* if_stat) {
+          return declares(if_stat->block().get(), var) ||
+            (if_stat->elseBlock() && declares(if_stat->elseBlock().get(), var));
+        },
+        [&](ast::ForStat* for_stat) {
+          return (for_stat->initializer() && declares(for_stat->initializer().get(), var)) ||
+            declares(for_stat->block().get(), var);
+        },
+        [&](ast::WhileStat* while_stat) {
+          return declares(while_stat->block().get(), var);
+        },
+        [&](base::Default) {
+          return false;
+        }
+      );
+    }
+
+    bool writes(ast::Stat* stat, const std::string& var)
+    {
+      bool found = false;
+
+      visit_slots(stat, [&](ast::CRef<ast::Expr>& slot) {
+        if (auto* bexpr = slot->as<ast::BinaryExpr>())
+          if (is_assignment(bexpr->type()) && is_var(bexpr->lhs().get(), var))
+            found = true;
+      });
+
+      return found;
+    }
+
+    size_t count_stats(ast::Stat* stat)
+    {
+      return 1 + base::Match(
+        stat,
+        [&](ast::BlockStat* block) {
+          size_t n = 0;
+
+          for (auto& s : block->stats())
+            n += count_stats(s.get());
+
+          return n;
+        },
+        [&](ast::IfStat* if_stat) {
+          return count_stats(if_stat->block().get()) +
+            (if_stat->elseBlock() ? count_stats(if_stat->elseBlock().get()) : 0);
+        },
+        [&](ast::ForStat* for_stat) {
+          return count_stats(for_stat->block().get());
+        },
+        [&](ast::WhileStat* while_stat) {
+          return count_stats(while_stat->block().get());
+        },
+        [&](base::Default) -> size_t {
+          return 0;
+        }
+      );
+    }
+
+    // Returns the step of an induction variable update such as 'i += 1', 'i -= 1' or 'i = i + 1'.
+    std::optional<int64_t> induction_step(
+      ast::Expr* expr,
+      const std::string& var,
+      const comptime::Bindings* consts
+    )
+    {
+      auto* bexpr = expr->as<ast::BinaryExpr>();
+
+      if (!bexpr || !is_var(bexpr->lhs().get(), var))
+        return std::nullopt;
+
+      switch (bexpr->type()) {
+        case ast::BinaryExpr::Type::kAddEqual:
+        case ast::BinaryExpr::Type::kCompoundAdd:
+          return eval_step(bexpr->rhs().get(), consts);
+        case ast::BinaryExpr::Type::kSubtractEqual:
+        case ast::BinaryExpr::Type::kCompoundSub:
+          if (auto step = eval_step(bexpr->rhs().get(), consts))
+            return -step.value();
+
+          return std::nullopt;
+        case ast::BinaryExpr::Type::kEqual:
+          if (auto* rhs = bexpr->rhs()->as<ast::BinaryExpr>()) {
+            if (!is_var(rhs->lhs().get(), var))
+              return std::nullopt;
+
+            auto step = eval_step(rhs->rhs().get(), consts);
+
+            if (!step)
+              return std::nullopt;
+
+            if (rhs->type() == ast::BinaryExpr::Type::kAdd)
+              return step;
+
+            if (rhs->type() == ast::BinaryExpr::Type::kSubtract ||
+                rhs->type() == ast::BinaryExpr::Type::KSub)
+              return -step.value();
+          }
+
+          return std::nullopt;
+        default:
+          return std::nullopt;
+      }
+    }
+
+    ast::CRef<ast::Expr> make_literal(ast::LitExpr::Value::Type type, int64_t v)
+    {
+      ast::LitExpr::Value value;
+
+      memset(&value, 0, sizeof(value));
+
+      value.type = type;
+      value.value.i64 = v;
+
+      return ast::context().make<ast::LitExpr>(value);
+    }
+
+    ast::CRef<ast::Stat> make_update(
+      const std::string& var,
+      ast::BinaryExpr::Type type,
+      ast::CRef<ast::Expr>&& value
+    )
+    {
+      return ast::context().make<ast::ExprStat>(
+        ast::context().make<ast::BinaryExpr>(
+          ast::context().make<ast::IdExpr>(var),
+          type,
+          std::move(value)
+        )
+      );
+    }
+
+    // Clones the first 'count' statements of a loop body into a new block,
+    // replacing every read of 'var' by the expression returned by 'replacement'.
+    ast::CRef<ast::BlockStat> copy_body(
+      ast::List<ast::Stat>& body,
+      size_t count,
+      const std::string& var,
+      const std::function<ast::CRef<ast::Expr>()>& replacement
+    )
+    {
+      ast::List<ast::Stat> stats;
+
+      for (size_t i = 0; i < count; i++)
+        stats.push_back(ast::context().clone(body[i]));
+
+      auto block = ast::context().make<ast::BlockStat>(std::move(stats));
+
+      if (replacement)
+        visit_slots(block.get(), [&](ast::CRef<ast::Expr>& slot) {
+          if (is_var(slot.get(), var))
+            slot = replacement();
+        });
+
+      return block;
+    }
+  }
+
+  LoopUnroller::LoopUnroller(const UnrollOptions& options)
+    : m_options { options }
+  {
+  }
+
+  void LoopUnroller::run(ast::Module* module)
+  {
+    TS_TRACE_ZONE("unroll loops");
+
+    // global constants may bound loops, each can use the previous ones. The specialized ones
+    // are left unknown, and so are the constants using them.
+    comptime::Bindings consts;
+
+    for (auto& decl : module->global_declarations())
+      if (auto* const_decl = decl->as<ast::ConstDecl>()) {
+        auto& specialized = m_options.specialized;
+
+        if (std::find(specialized.begin(), specialized.end(), const_decl->name()) != specialized.end())
+          continue;
+
+        if (auto value = comptime::eval(const_decl->expr().get(), &consts))
+          consts[const_decl->name()] = value.value();
+      }
+
+    for (auto& decl : module->global_declarations())
+      if (auto* func = decl->as<ast::FuncDecl>()) {
+        m_consts = consts;
+
+        for (auto& arg : func->args())
+          m_consts.erase(arg->name());
+
+        forget_declared(func->block().get(), m_consts);
+
+        run(func->block().get());
+      }
+  }
+
+  void LoopUnroller::run(ast::BlockStat* block)
+  {
+    auto& stats = block->stats();
+
+    for (size_t i = 0; i < stats.size(); i++) {
+      // unroll inner loops first, so the size budget of outer loops accounts for them.
+      run(stats[i].get());
+
+      ast::CRef<ast::Stat> unrolled;
+
+      if (auto* for_stat = stats[i]->as<ast::ForStat>())
+        unrolled = unroll(for_stat);
+      else if (auto* while_stat = stats[i]->as<ast::WhileStat>(); while_stat && i > 0)
+        if (auto* var_stat = stats[i - 1]->as<ast::VarStat>())
+          unrolled = unroll(var_stat, while_stat);
+
+      if (unrolled)
+        stats[i] = std::move(unrolled);
+    }
+  }
+
+  void LoopUnroller::run(ast::Stat* stat)
+  {
+    base::Match(
+      stat,
+      [&](ast::BlockStat* block) {
+        run(block);
+      },
+      [&](ast::IfStat* if_stat) {
+        run(if_stat->block().get());
+
+        if (if_stat->elseBlock())
+          run(if_stat->elseBlock().get());
+      },
+      [&](ast::ForStat* for_stat) {
+        run(for_stat->block().get());
+      },
+      [&](ast::WhileStat* while_stat) {
+        run(while_stat->block().get());
+      },
+      [&](base::Default) {}
+    );
+  }
+
+  std::optional<uint64_t> LoopUnroller::trip_count(
+    ast::Expr* condition,
+    const std::string& var,
+    ast::LitExpr::Value::Type type,
+    const ast::LitExpr::Value& start,
+    int64_t step
+  )
+  {
+    auto* bexpr = condition->as<ast::BinaryExpr>();
+
+    if (!bexpr || !is_var(bexpr->lhs().get(), var))
+      return std::nullopt;
+
+    switch (bexpr->type()) {
+      case ast::BinaryExpr::Type::kLessThan:
+      case ast::BinaryExpr::Type::kLessThanEqual:
+      case ast::BinaryExpr::Type::kGreaterThan:
+      case ast::BinaryExpr::Type::kGreaterThanEqual:
+      case ast::BinaryExpr::Type::kNotEqual:
+        break;
+      default:
+        return std::nullopt;
+    }
+
+    auto limit = eval_int(bexpr->rhs().get(), &m_consts);
+
+    if (!limit)
+      return std::nullopt;
+
+    // the loop runs in the type of its induction variable, e.g. a 'uint' never gets below 0.
+    switch (type) {
+      case ast::LitExpr::Value::kI16:
+        return simulate<int16_t>(bexpr->type(), start, step, limit.value());
+      case ast::LitExpr::Value::kI32:
+        return simulate<int32_t>(bexpr->type(), start, step, limit.value());
+      case ast::LitExpr::Value::kI64:
+        return simulate<int64_t>(bexpr->type(), start, step, limit.value());
+      case ast::LitExpr::Value::kU16:
+        return simulate<uint16_t>(bexpr->type(), start, step, limit.value());
+      case ast::LitExpr::Value::kU32:
+        return simulate<uint32_t>(bexpr->type(), start, step, limit.value());
+      case ast::LitExpr::Value::kU64:
+        return simulate<uint64_t>(bexpr->type(), start, step, limit.value());
+      default:
+        return std::nullopt;
+    }
+  }
+
+  ast::CRef<ast::Stat> LoopUnroller::unroll(ast::ForStat* for_stat)
+  {
+    auto* var_stat = for_stat->initializer() ? for_stat->initializer()->as<ast::VarStat>() : nullptr;
+
+    if (!var_stat || !var_stat->expr() || !for_stat->condition() || !for_stat->continuing())
+      return {};
+
+    auto& var = var_stat->decl()->name();
+
+    auto start = eval_int(var_stat->expr().get(), &m_consts);
+
+    if (!start)
+      return {};
+
+    auto type = induction_type(var_stat, start.value());
+
+    if (!type)
+      return {};
+
+    auto step = induction_step(for_stat->continuing()->expr().get(), var, &m_consts);
+
+    if (!step)
+      return {};
+
+    auto trips = trip_count(for_stat->condition().get(), var, type.value(), start.value(), step.value());
+
+    if (!trips)
+      return {};
+
+    auto& body = for_stat->block()->stats();
+
+    for (auto& stat : body)
+      if (has_loop_break(stat.get()) || writes(stat.get(), var) || declares(stat.get(), var))
+        return {};
+
+    return unroll(
+      Induction {
+        .var = var,
+        .type = type.value(),
+        .start = start->value.i64,
+        .step = step.value(),
+        .trip_count = trips.value()
+      },
+      body,
+      body.size(),
+      false
+    );
+  }
+
+  ast::CRef<ast::Stat> LoopUnroller::unroll(
+    ast::VarStat* var_stat,
+    ast::WhileStat* while_stat
+  )
+  {
+    if (!var_stat->expr())
+      return {};
+
+    auto& var = var_stat->decl()->name();
+
+    auto start = eval_int(var_stat->expr().get(), &m_consts);
+
+    if (!start)
+      return {};
+
+    auto type = induction_type(var_stat, start.value());
+
+    if (!type)
+      return {};
+
+    auto& body = while_stat->block()->stats();
+
+    // the induction variable must be updated by the last statement of the body.
+    if (body.empty())
+      return {};
+
+    auto* update = body.back()->as<ast::ExprStat>();
+
+    if (!update)
+      return {};
+
+    auto step = induction_step(update->expr().get(), var, &m_consts);
+
+    if (!step)
+      return {};
+
+    auto trips = trip_count(while_stat->condition().get(), var, type.value(), start.value(), step.value());
+
+    if (!trips)
+      return {};
+
+    for (size_t i = 0; i + 1 < body.size(); i++)
+      if (has_loop_break(body[i].get()) || writes(body[i].get(), var) || declares(body[i].get(), var))
+        return {};
+
+    return unroll(
+      Induction {
+        .var = var,
+        .type = type.value(),
+        .start = start->value.i64,
+        .step = step.value(),
+        .trip_count = trips.value()
+      },
+      body,
+      body.size() - 1,
+      true
+    );
+  }
+
+  ast::CRef<ast::Stat> LoopUnroller::unroll(
+    const Induction& induction,
+    ast::List<ast::Stat>& body,
+    size_t body_count,
+    bool keep_induction_var
+  )
+  {
+    size_t body_size = 0;
+
+    for (size_t i = 0; i < body_count; i++)
+      body_size += count_stats(body[i].get());
+
+    body_size = std::max<size_t>(body_size, 1);
+
+    auto trips = induction.trip_count;
+    auto& var = induction.var;
+
+    // the trip count was simulated without wrapping, neither does any value of the loop.
+    auto value_at = [&](uint64_t iteration) {
+      return static_cast<int64_t>(
+        static_cast<uint64_t>(induction.start) + iteration * static_cast<uint64_t>(induction.step)
+      );
+    };
+
+    auto literal_copy = [&](uint64_t iteration) {
+      return copy_body(body, body_count, var, [&] {
+        return make_literal(induction.type, value_at(iteration));
+      });
+    };
+
+    ast::List<ast::Stat> stats;
+
+    if (trips <= m_options.max_trip_count && trips * body_size <= m_options.max_unrolled_size) {
+      // full unrolling, each copy of the body sees the induction variable as a literal.
+      for (uint64_t i = 0; i < trips; i++)
+        stats.push_back(literal_copy(i));
+    } else if (m_options.partial_factor > 1 &&
+              trips >= 2 * m_options.partial_factor &&
+              m_options.partial_factor * body_size <= m_options.max_unrolled_size) {
+      // partial unrolling, the loop runs 'factor' iterations at a time and
+      // the remaining iterations are peeled after it.
+      auto factor = m_options.partial_factor;
+      auto main_trips = trips - trips % factor;
+
+      // offsets are added or subtracted as positive literals, a negative one would wrap for
+      // unsigned induction variables.
+      bool descending = induction.step < 0;
+      auto magnitude = descending ? -induction.step : induction.step;
+
+      ast::List<ast::Stat> copies;
+
+      for (uint64_t i = 0; i < factor; i++)
+        copies.push_back(
+          copy_body(body, body_count, var, [&]() -> ast::CRef<ast::Expr> {
+            if (i == 0)
+              return ast::context().make<ast::IdExpr>(var);
+
+            return ast::context().make<ast::BinaryExpr>(
+              ast::context().make<ast::IdExpr>(var),
+              descending ? ast::BinaryExpr::Type::kSubtract : ast::BinaryExpr::Type::kAdd,
+              make_literal(induction.type, static_cast<int64_t>(i) * magnitude)
+            );
+          })
+        );
+
+      auto condition = ast::context().make<ast::BinaryExpr>(
+        ast::context().make<ast::IdExpr>(var),
+        induction.step > 0 ? ast::BinaryExpr::Type::kLessThan : ast::BinaryExpr::Type::kGreaterThan,
+        make_literal(induction.type, value_at(main_trips))
+      );
+
+      auto update = make_update(
+        var,
+        descending ? ast::BinaryExpr::Type::kSubtractEqual : ast::BinaryExpr::Type::kAddEqual,
+        make_literal(induction.type, static_cast<int64_t>(factor) * magnitude)
+      );
+
+      if (keep_induction_var) {
+        copies.push_back(std::move(update));
+
+        stats.push_back(
+          ast::context().make<ast::WhileStat>(
+            std::move(condition),
+            ast::context().make<ast::BlockStat>(std::move(copies))
+          )
+        );
+      } else {
+        stats.push_back(
+          ast::context().make<ast::ForStat>(
+            ast::context().make<ast::VarStat>(
+              ast::context().make<ast::VarDecl>(var, ast::CRef<ast::Type>()),
+              make_literal(induction.type, induction.start)
+            ),
+            std::move(condition),
+            update.convertTo<ast::ExprStat>(),
+            ast::context().make<ast::BlockStat>(std::move(copies))
+          )
+        );
+      }
+
+      for (auto i = main_trips; i < trips; i++)
+        stats.push_back(literal_copy(i));
+    } else
+      return {};
+
+    // the induction variable of a 'while' loop outlives it, so it must hold its final value.
+    if (keep_induction_var)
+      stats.push_back(
+        make_update(
+          var,
+          ast::BinaryExpr::Type::kEqual,
+          make_literal(induction.type, value_at(trips))
+        )
+      );
+
+    return ast::context().make<ast::BlockStat>(std::move(stats));
+  }
+}
\ No newline at end of file
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "../ast.h"
+#include "../comptime.h"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace kate::tlr {
+  struct UnrollOptions {
+    // loops with at most this many iterations are fully unrolled.
+    size_t max_trip_count = 16;
+
+    // maximum number of statements an unrolled loop body is allowed to grow to.
+    size_t max_unrolled_size = 256;
+
+    // number of copies of the body made for loops that are too large to be
+    // fully unrolled, a factor of 1 disables partial unrolling.
+    size_t partial_factor = 4;
+
+    // constants taking other values in each variant, the loops they bound are left as is
+    // since the variants are printed from the same tree.
+    std::vector<std::string> specialized;
+  };
+
+  // Unrolls 'for' and 'while' loops whose trip count can be evaluated at compile time.
+  //
+  // It runs on the parsed module before it's resolved, so the statements it generates
+  // are resolved the same way as hand-written ones. Loops may be bounded by global
+  // constants, which it folds itself.
+  class LoopUnroller {
+  public:
+    LoopUnroller(const UnrollOptions& options = {});
+
+    void run(ast::Module* module);
+  private:
+    struct Induction {
+      std::string var;
+      ast::LitExpr::Value::Type type;
+      int64_t start;
+      int64_t step;
+      uint64_t trip_count;
+    };
+
+    void run(ast::BlockStat* block);
+
+    void run(ast::Stat* stat);
+
+    ast::CRef<ast::Stat> unroll(ast::ForStat* for_stat);
+
+    ast::CRef<ast::Stat> unroll(
+      ast::VarStat* var_stat,
+      ast::WhileStat* while_stat
+    );
+
+    ast::CRef<ast::Stat> unroll(
+      const Induction& induction,
+      ast::List<ast::Stat>& body,
+      size_t body_count,
+      bool keep_induction_var
+    );
+
+    std::optional<uint64_t> trip_count(
+      ast::Expr* condition,
+      const std::string& var,
+      ast::LitExpr::Value::Type type,
+      const ast::LitExpr::Value& start,
+      int64_t step
+    );
+
+    UnrollOptions m_options;
+
+    // the global constants visible in the function being unrolled.
+    comptime::Bindings m_consts;
+  };
+}
\ No newline at end of file
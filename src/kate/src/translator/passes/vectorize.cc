@@ -0,0 +1,336 @@
+#include "vectorize.h"
+#include "visit.h"
+#include "../sem.h"
+
+#include "base/trace.h"
+
+#include <cassert>
+#include <fmt/format.h>
+#include <optional>
+
+namespace kate::tlr {
+  namespace {
+    constexpr std::string_view kComponents = "xyzw";
+
+    bool is_arithmetic(ast::BinaryExpr::Type type)
+    {
+      switch (type) {
+        case ast::BinaryExpr::Type::kAdd:
+        case ast::BinaryExpr::Type::KSub:
+        case ast::BinaryExpr::Type::kSubtract:
+        case ast::BinaryExpr::Type::kMul:
+        case ast::BinaryExpr::Type::kMultiply:
+        case ast::BinaryExpr::Type::kDiv:
+        case ast::BinaryExpr::Type::kDivide:
+          return true;
+        default:
+          return false;
+      }
+    }
+
+    // returns true if both expressions compute the same value without side effects.
+    bool same_expr(ast::Expr* lhs, ast::Expr* rhs)
+    {
+      if (auto lid = lhs->as<ast::IdExpr>()) {
+        auto rid = rhs->as<ast::IdExpr>();
+
+        return rid && lid->ident() == rid->ident();
+      }
+
+      if (auto llit = lhs->as<ast::LitExpr>()) {
+        auto rlit = rhs->as<ast::LitExpr>();
+
+        return rlit &&
+          llit->value().type == rlit->value().type &&
+          llit->value().value.u64 == rlit->value().value.u64;
+      }
+
+      if (auto lun = lhs->as<ast::UnaryExpr>()) {
+        auto run = rhs->as<ast::UnaryExpr>();
+
+        return run &&
+          lun->type() == run->type() &&
+          same_expr(lun->operand().get(), run->operand().get());
+      }
+
+      if (auto lbin = lhs->as<ast::BinaryExpr>()) {
+        auto rbin = rhs->as<ast::BinaryExpr>();
+
+        if (!rbin || lbin->type() != rbin->type())
+          return false;
+
+        if (lbin->type() != ast::BinaryExpr::Type::kMemberAccess &&
+            lbin->type() != ast::BinaryExpr::Type::kIndexAccessor &&
+            !is_arithmetic(lbin->type()))
+          return false;
+
+        return same_expr(lbin->lhs().get(), rbin->lhs().get()) &&
+          same_expr(lbin->rhs().get(), rbin->rhs().get());
+      }
+
+      return false;
+    }
+
+    types::Type* type_of(ast::Expr* expr)
+    {
+      return expr->sem() ? expr->sem()->type() : nullptr;
+    }
+
+    ast::CRef<ast::Expr> typed(ast::CRef<ast::Expr>&& expr, types::Type* type)
+    {
+      expr->setSem(type);
+
+      return std::move(expr);
+    }
+
+    // returns the component a lane reads when it's a single component swizzle like 'v.y'.
+    std::optional<size_t> component(ast::Expr* expr)
+    {
+      auto bexpr = expr->as<ast::BinaryExpr>();
+
+      if (!bexpr || bexpr->type() != ast::BinaryExpr::Type::kMemberAccess)
+        return std::nullopt;
+
+      auto lhs_type = type_of(bexpr->lhs().get());
+
+      if (!lhs_type || !lhs_type->is<types::Vec>())
+        return std::nullopt;
+
+      auto swizzle = bexpr->rhs()->as<ast::IdExpr>();
+
+      if (!swizzle || swizzle->ident().size() != 1)
+        return std::nullopt;
+
+      auto index = kComponents.find(swizzle->ident()[0]);
+
+      if (index == std::string_view::npos)
+        return std::nullopt;
+
+      return index;
+    }
+
+    // returns the lanes formed by the same child of every lane.
+    template<typename T, typename F>
+    std::vector<ast::CRef<ast::Expr>*> children(
+      const std::vector<ast::CRef<ast::Expr>*>& lanes,
+      F&& child
+    )
+    {
+      std::vector<ast::CRef<ast::Expr>*> result;
+
+      for (auto lane : lanes)
+        result.push_back(&child((*lane)->template as<T>()));
+
+      return result;
+    }
+  }
+
+  void Vectorizer::run(ast::Module* module)
+  {
+    TS_TRACE_ZONE("vectorize");
+
+    for (auto& decl : module->global_declarations())
+      if (auto func = decl->as<ast::FuncDecl>())
+        visit_slots(func->block().get(), [&](ast::CRef<ast::Expr>& slot) {
+          run(slot);
+        });
+  }
+
+  void Vectorizer::run(ast::CRef<ast::Expr>& slot)
+  {
+    auto callexpr = slot->as<ast::CallExpr>();
+
+    if (!callexpr)
+      return;
+
+    auto vec = types::system().findType(callexpr->id()->ident());
+
+    if (!vec || !vec->is<types::Vec>())
+      return;
+
+    auto& args = callexpr->args();
+
+    ast::List<ast::Expr> packed_args;
+    bool changed = false;
+
+    for (size_t i = 0; i < args.size();) {
+      Lanes lanes;
+
+      for (size_t j = i; j < args.size(); j++)
+        lanes.push_back(&args[j]);
+
+      // take the longest run of arguments starting at 'i' that can be merged.
+      while (lanes.size() >= 2 && !can_pack(lanes, true))
+        lanes.pop_back();
+
+      if (lanes.size() >= 2) {
+        packed_args.push_back(pack(lanes, true));
+        i += lanes.size();
+        changed = true;
+      } else
+        packed_args.push_back(ast::context().clone(args[i++]));
+    }
+
+    if (!changed)
+      return;
+
+    // a constructor left with a single argument of its own type isn't needed anymore.
+    if (packed_args.size() == 1 && type_of(packed_args[0].get()) == vec)
+      slot = std::move(packed_args[0]);
+    else
+      ast::context().mutate(slot)->as<ast::CallExpr>()->args() = std::move(packed_args);
+  }
+
+  Vectorizer::Pack Vectorizer::classify(const Lanes& lanes, bool top)
+  {
+    auto first = lanes[0]->get();
+    auto type = type_of(first);
+
+    if (!type || !type->is<types::Scalar>())
+      return Pack::kNone;
+
+    for (auto lane : lanes)
+      if (type_of(lane->get()) != type)
+        return Pack::kNone;
+
+    auto all_of = [&](auto&& pred) {
+      for (auto lane : lanes)
+        if (!pred(lane->get()))
+          return false;
+
+      return true;
+    };
+
+    if (!top && all_of([&](ast::Expr* expr) { return same_expr(first, expr); }))
+      return Pack::kSplat;
+
+    if (auto first_bexpr = first->as<ast::BinaryExpr>()) {
+      auto same_source = all_of([&](ast::Expr* expr) {
+        return component(expr) &&
+          same_expr(first_bexpr->lhs().get(), expr->as<ast::BinaryExpr>()->lhs().get());
+      });
+
+      if (same_source)
+        return Pack::kSwizzle;
+
+      auto same_op = all_of([&](ast::Expr* expr) {
+        auto bexpr = expr->as<ast::BinaryExpr>();
+
+        return bexpr && bexpr->type() == first_bexpr->type() && is_arithmetic(bexpr->type());
+      });
+
+      if (same_op)
+        return Pack::kBinary;
+    }
+
+    auto all_negated = all_of([&](ast::Expr* expr) {
+      auto uexpr = expr->as<ast::UnaryExpr>();
+
+      return uexpr && uexpr->type() == ast::UnaryExpr::Type::kMinus;
+    });
+
+    if (all_negated)
+      return Pack::kUnary;
+
+    return Pack::kNone;
+  }
+
+  bool Vectorizer::can_pack(const Lanes& lanes, bool top)
+  {
+    switch (classify(lanes, top)) {
+      case Pack::kSwizzle:
+      case Pack::kSplat:
+        return true;
+      case Pack::kBinary: {
+        auto lhs = children<ast::BinaryExpr>(lanes, [](auto* bexpr) -> auto& { return bexpr->lhs(); });
+        auto rhs = children<ast::BinaryExpr>(lanes, [](auto* bexpr) -> auto& { return bexpr->rhs(); });
+
+        // splatting both sides would only replace scalar operations with wider ones.
+        if (classify(lhs, false) == Pack::kSplat && classify(rhs, false) == Pack::kSplat)
+          return false;
+
+        return can_pack(lhs, false) && can_pack(rhs, false);
+      }
+      case Pack::kUnary:
+        return can_pack(
+          children<ast::UnaryExpr>(lanes, [](auto* uexpr) -> auto& { return uexpr->operand(); }),
+          top
+        );
+      default:
+        return false;
+    }
+  }
+
+  ast::CRef<ast::Expr> Vectorizer::pack(const Lanes& lanes, bool top)
+  {
+    auto first = lanes[0]->get();
+    auto type = vec_type(type_of(first), lanes.size());
+
+    switch (classify(lanes, top)) {
+      case Pack::kSplat: {
+        ast::List<ast::Expr> args;
+        args.push_back(ast::context().clone(*lanes[0]));
+
+        return typed(
+          ast::context().make<ast::CallExpr>(
+            ast::context().make<ast::IdExpr>(type->mangledName()),
+            std::move(args)
+          ),
+          type
+        );
+      }
+      case Pack::kSwizzle: {
+        std::string swizzle;
+
+        for (auto lane : lanes)
+          swizzle += kComponents[component(lane->get()).value()];
+
+        ast::CRef<ast::Expr> source = ast::context().clone(first->as<ast::BinaryExpr>()->lhs());
+
+        // reading every component in order is the same as reading the vector itself.
+        if (type_of(source.get()) == type && swizzle == kComponents.substr(0, lanes.size()))
+          return source;
+
+        return typed(
+          ast::context().make<ast::BinaryExpr>(
+            std::move(source),
+            ast::BinaryExpr::Type::kMemberAccess,
+            ast::context().make<ast::IdExpr>(swizzle)
+          ),
+          type
+        );
+      }
+      case Pack::kBinary: {
+        auto op = first->as<ast::BinaryExpr>()->type();
+
+        auto lhs = pack(children<ast::BinaryExpr>(lanes, [](auto* bexpr) -> auto& { return bexpr->lhs(); }), false);
+        auto rhs = pack(children<ast::BinaryExpr>(lanes, [](auto* bexpr) -> auto& { return bexpr->rhs(); }), false);
+
+        return typed(
+          ast::context().make<ast::BinaryExpr>(std::move(lhs), op, std::move(rhs)),
+          type
+        );
+      }
+      case Pack::kUnary: {
+        auto operand = pack(
+          children<ast::UnaryExpr>(lanes, [](auto* uexpr) -> auto& { return uexpr->operand(); }),
+          top
+        );
+
+        return typed(
+          ast::context().make<ast::UnaryExpr>(ast::UnaryExpr::Type::kMinus, std::move(operand)),
+          type
+        );
+      }
+      default:
+        // callers must check the lanes with 'can_pack' first.
+        assert(false);
+        return {};
+    }
+  }
+
+  types::Type* Vectorizer::vec_type(types::Type* scalar, size_t columns)
+  {
+    return types::system().findType(fmt::format("{}{}", scalar->mangledName(), columns));
+  }
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "../ast.h"
+#include "../types.h"
+
+#include <vector>
+
+namespace kate::tlr {
+  // Merges the same scalar operation done on each component of vectors into a single
+  // vector operation, e.g. 'float3(a.x * b.x, a.y * b.y, a.z * b.z)' becomes 'a * b'.
+  //
+  // It runs on the resolved module, so lanes are only merged when they hold scalars of
+  // the same type, and the expressions it generates are typed as they are built.
+  class Vectorizer {
+  public:
+    void run(ast::Module* module);
+  private:
+    // how a group of lanes is merged into a vector.
+    enum class Pack {
+      kNone,
+      kSwizzle,
+      kBinary,
+      kUnary,
+      kSplat
+    };
+
+    using Lanes = std::vector<ast::CRef<ast::Expr>*>;
+
+    void run(ast::CRef<ast::Expr>& slot);
+
+    // 'top' is set for the arguments of the vector constructor itself, where
+    // splatting a value would only make the constructor larger.
+    Pack classify(const Lanes& lanes, bool top);
+
+    bool can_pack(const Lanes& lanes, bool top);
+
+    ast::CRef<ast::Expr> pack(const Lanes& lanes, bool top);
+
+    types::Type* vec_type(types::Type* scalar, size_t columns);
+  };
+}
\ No newline at end of file
@@ -0,0 +1,98 @@
+#include "visit.h"
+#include "traverse.h"
+#include "../sem.h"
+
+#include <type_traits>
+
+namespace kate::tlr {
+  namespace {
+    // Visits the child 'get' returns of the node held by 'slot', or of 'node' when it has no
+    // slot and is modified in place. A node shared by several handles, e.g. by the clones of a
+    // subtree, isn't modified in place: its child is visited through a handle of its own, and
+    // the node is copied when the child was replaced, so only the path to a change is copied.
+    template<typename T, typename U, typename Get, typename Visit>
+    void visit_child(T* node, ast::CRef<U>* slot, Get&& get, Visit&& visit)
+    {
+      auto& ctx = ast::context();
+
+      // a previous child may have copied the node.
+      if (slot)
+        node = (*slot)->template as<T>();
+
+      auto& child = get(node);
+
+      if (!child) return;
+
+      if (!slot || !ctx.shared(*slot)) {
+        visit(child);
+        return;
+      }
+
+      auto copy = ctx.clone(child);
+      visit(copy);
+
+      if (copy.m_id != child.m_id)
+        get(ctx.mutate(*slot)->template as<T>()) = std::move(copy);
+    }
+
+    template<typename U>
+    void visit_stat(ast::Stat* stat, ast::CRef<U>* slot, const ExprSlotCallback& cb)
+    {
+      auto visit = [&](auto& child) {
+        if constexpr (std::is_same_v<std::decay_t<decltype(child)>, ast::CRef<ast::Expr>>)
+          visit_slots(child, cb);
+        else
+          visit_stat(child.get(), &child, cb);
+      };
+
+      base::Match(
+        stat,
+        [&](ast::BlockStat* block) {
+          for (size_t i = 0; i < block->stats().size(); i++)
+            visit_child(block, slot, [i](ast::BlockStat* b) -> auto& { return b->stats()[i]; }, visit);
+        },
+        [&](ast::VarStat* var_stat) {
+          visit_child(var_stat, slot, [](ast::VarStat* v) -> auto& { return v->expr(); }, visit);
+        },
+        [&](ast::ExprStat* expr_stat) {
+          visit_child(expr_stat, slot, [](ast::ExprStat* e) -> auto& { return e->expr(); }, visit);
+        },
+        [&](ast::ReturnStat* return_stat) {
+          visit_child(return_stat, slot, [](ast::ReturnStat* r) -> auto& { return r->expr(); }, visit);
+        },
+        [&](ast::IfStat* if_stat) {
+          visit_child(if_stat, slot, [](ast::IfStat* s) -> auto& { return s->condition(); }, visit);
+          visit_child(if_stat, slot, [](ast::IfStat* s) -> auto& { return s->block(); }, visit);
+          visit_child(if_stat, slot, [](ast::IfStat* s) -> auto& { return s->elseBlock(); }, visit);
+        },
+        [&](ast::ForStat* for_stat) {
+          visit_child(for_stat, slot, [](ast::ForStat* f) -> auto& { return f->initializer(); }, visit);
+          visit_child(for_stat, slot, [](ast::ForStat* f) -> auto& { return f->condition(); }, visit);
+          visit_child(for_stat, slot, [](ast::ForStat* f) -> auto& { return f->continuing(); }, visit);
+          visit_child(for_stat, slot, [](ast::ForStat* f) -> auto& { return f->block(); }, visit);
+        },
+        [&](ast::WhileStat* while_stat) {
+          visit_child(while_stat, slot, [](ast::WhileStat* w) -> auto& { return w->condition(); }, visit);
+          visit_child(while_stat, slot, [](ast::WhileStat* w) -> auto& { return w->block(); }, visit);
+        },
+        [&](base::Default) {}
+      );
+    }
+  }
+
+  void visit_slots(ast::CRef<ast::Expr>& slot, const ExprSlotCallback& cb)
+  {
+    // chains of operations may be deeper than the call stack.
+    Traversal().rewrite(slot, cb);
+  }
+
+  void visit_slots(ast::Stat* stat, const ExprSlotCallback& cb)
+  {
+    visit_stat<ast::Stat>(stat, nullptr, cb);
+  }
+
+  void visit_slots(ast::CRef<ast::BlockStat>& block, const ExprSlotCallback& cb)
+  {
+    visit_stat(block.get(), &block, cb);
+  }
+}
\ No newline at end of file
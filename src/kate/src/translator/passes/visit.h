@@ -0,0 +1,20 @@
+#pragma once
+
+#include "../ast.h"
+
+#include <functional>
+
+namespace kate::tlr {
+  using ExprSlotCallback = std::function<void(ast::CRef<ast::Expr>&)>;
+
+  // Visits every expression slot in post-order, so callbacks are allowed to
+  // replace the node held by the slot. Nodes shared with clones are copied on the
+  // path to a replaced slot instead of being modified, callbacks modifying the node
+  // of a slot in place go through 'ast::ASTContext::mutate'.
+  void visit_slots(ast::CRef<ast::Expr>& slot, const ExprSlotCallback& cb);
+
+  // 'stat' is modified in place, the slot of a block is given to visit a clone.
+  void visit_slots(ast::Stat* stat, const ExprSlotCallback& cb);
+
+  void visit_slots(ast::CRef<ast::BlockStat>& block, const ExprSlotCallback& cb);
+}
\ No newline at end of file
@@ -0,0 +1,239 @@
+#include "permutation.h"
+#include "sem.h"
+
+#include "printers/glsl.h"
+
+#include "base/jobs.h"
+#include "base/trace.h"
+
+#include <fmt/format.h>
+
+#include <charconv>
+#include <cstring>
+#include <thread>
+
+namespace kate::tlr {
+  PermutationCompiler::PermutationCompiler(ast::Module* module)
+    : m_module { module }
+  {
+  }
+
+  std::vector<Variant> PermutationCompiler::compile(
+    const std::vector<PermutationOption>& matrix,
+    size_t num_threads
+  )
+  {
+    TS_TRACE_ZONE("compile variants");
+
+    std::vector<Variant> variants;
+
+    for (auto& specialization : expand(matrix))
+      variants.push_back(
+        Variant {
+          .specialization = std::move(specialization)
+        }
+      );
+
+    if (num_threads == 0)
+      num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+    // each variant is a job, the thread compiling them runs some of them too.
+    base::jobs::Scheduler scheduler(std::min(num_threads, std::max<size_t>(variants.size(), 1)));
+
+    scheduler.parallel_for(0, variants.size(), [&](size_t i) {
+      TS_TRACE_ZONE("print variant");
+
+      GLSLPrinter printer(&variants[i].specialization);
+      printer.print(m_module);
+
+      variants[i].glsl = printer.str();
+    }, 1);
+
+    return variants;
+  }
+
+  std::vector<comptime::Bindings> PermutationCompiler::expand(
+    const std::vector<PermutationOption>& matrix
+  )
+  {
+    std::vector<comptime::Bindings> permutations(1);
+
+    for (auto& option : matrix) {
+      if (option.values.empty()) {
+        error(fmt::format("Option '{}' doesn't have any values.", option.name));
+        return {};
+      }
+
+      std::vector<ast::LitExpr::Value> values;
+
+      for (auto& value : option.values)
+        values.push_back(coerce(option.name, value));
+
+      std::vector<comptime::Bindings> expanded;
+
+      for (auto& permutation : permutations) {
+        for (auto& value : values) {
+          auto p = permutation;
+          p[option.name] = value;
+
+          expanded.push_back(std::move(p));
+        }
+      }
+
+      permutations = std::move(expanded);
+    }
+
+    return permutations;
+  }
+
+  ast::LitExpr::Value PermutationCompiler::coerce(
+    const std::string& name,
+    const ast::LitExpr::Value& value
+  )
+  {
+    ast::ConstDecl* const_decl = nullptr;
+
+    for (auto& decl : m_module->global_declarations())
+      if (auto* c = decl->as<ast::ConstDecl>(); c && c->name() == name)
+        const_decl = c;
+
+    if (!const_decl) {
+      error(fmt::format("Unable to find a constant named '{}' to permute.", name));
+      return value;
+    }
+
+    // the default may use the constants declared before it.
+    auto consts = comptime::consts(m_module);
+    auto default_value = consts.find(name);
+
+    if (default_value == consts.end()) {
+      error(fmt::format("Unable to evaluate the value of constant '{}' to permute.", name));
+      return value;
+    }
+
+    auto v = value;
+    v.type = default_value->second.type;
+
+    // integers are allowed to initialize floating point constants.
+    if (default_value->second.type & ast::LitExpr::Value::Type::kFloatMask) {
+      if (value.type & ast::LitExpr::Value::Type::kSignedIntMask)
+        v.value.f64 = static_cast<double>(value.value.i64);
+      else if (value.type & ast::LitExpr::Value::Type::kUnsignedIntMask)
+        v.value.f64 = static_cast<double>(value.value.u64);
+    } else if (value.type & ast::LitExpr::Value::Type::kFloatMask) {
+      error(
+        fmt::format(
+          "Constant '{}' of type '{}' can't hold a floating point value.",
+          name,
+          const_decl->sem()->type()->mangledName()
+        )
+      );
+    }
+
+    return v;
+  }
+
+  void PermutationCompiler::error(const std::string& err)
+  {
+    fmt::println("{}", err);
+    std::exit(1);
+  }
+
+  std::optional<ast::LitExpr::Value> parse_literal(std::string_view str)
+  {
+    ast::LitExpr::Value value;
+
+    memset(&value, 0, sizeof(value));
+
+    auto* end = str.data() + str.size();
+
+    if (str.find('.') != std::string_view::npos) {
+      auto [ptr, ec] = std::from_chars(str.data(), end, value.value.f64);
+
+      if (ec != std::errc()) return std::nullopt;
+
+      value.type = ast::LitExpr::Value::Type::kF64;
+
+      if (ptr != end && *ptr == 'f') {
+        value.type = ast::LitExpr::Value::Type::kF32;
+        ptr++;
+      }
+
+      return (ptr == end) ? std::optional(value) : std::nullopt;
+    }
+
+    auto [ptr, ec] = std::from_chars(str.data(), end, value.value.i64);
+
+    if (ec != std::errc()) return std::nullopt;
+
+    value.type = ast::LitExpr::Value::Type::kI32;
+
+    if (ptr != end && *ptr == 'u') {
+      value.type = ast::LitExpr::Value::Type::kU32;
+      ptr++;
+    }
+
+    return (ptr == end) ? std::optional(value) : std::nullopt;
+  }
+
+  std::vector<std::string> names(const std::vector<PermutationOption>& permutations)
+  {
+    std::vector<std::string> names;
+
+    for (auto& option : permutations)
+      names.push_back(option.name);
+
+    return names;
+  }
+
+  std::optional<PermutationOption> parse_permutation(std::string_view str)
+  {
+    auto eq = str.find('=');
+
+    if (eq == std::string_view::npos) return std::nullopt;
+
+    PermutationOption option {
+      .name = std::string(str.substr(0, eq))
+    };
+
+    auto values = str.substr(eq + 1);
+
+    while (!values.empty()) {
+      auto comma = values.find(',');
+
+      auto value = parse_literal(values.substr(0, comma));
+
+      if (!value) return std::nullopt;
+
+      option.values.push_back(value.value());
+
+      values = (comma == std::string_view::npos) ? std::string_view() : values.substr(comma + 1);
+    }
+
+    return option;
+  }
+
+  std::string describe(
+    const std::vector<PermutationOption>& permutations,
+    const comptime::Bindings& specialization
+  )
+  {
+    std::string desc;
+
+    for (auto& option : permutations) {
+      auto& name = option.name;
+      auto& value = specialization.at(name);
+
+      if (!desc.empty()) desc += ", ";
+
+      if (value.type & ast::LitExpr::Value::Type::kFloatMask)
+        desc += fmt::format("{}={}", name, value.value.f64);
+      else if (value.type & ast::LitExpr::Value::Type::kUnsignedIntMask)
+        desc += fmt::format("{}={}", name, value.value.u64);
+      else
+        desc += fmt::format("{}={}", name, value.value.i64);
+    }
+
+    return desc;
+  }
+}
\ No newline at end of file
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "ast.h"
+#include "comptime.h"
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace kate::tlr {
+  // values a constant of the module takes across variants.
+  struct PermutationOption {
+    std::string name;
+    std::vector<ast::LitExpr::Value> values;
+  };
+
+  struct Variant {
+    comptime::Bindings specialization;
+    std::string glsl;
+  };
+
+  // Emits one variant per combination of values of a set of constants.
+  //
+  // The module is lexed, parsed and resolved only once, variants are specialized
+  // while being printed and never modify the tree, so they are emitted in parallel.
+  class PermutationCompiler {
+  public:
+    PermutationCompiler(ast::Module* module);
+
+    // 'num_threads' of 0 uses one thread per hardware thread.
+    std::vector<Variant> compile(
+      const std::vector<PermutationOption>& matrix,
+      size_t num_threads = 0
+    );
+  private:
+    std::vector<comptime::Bindings> expand(
+      const std::vector<PermutationOption>& matrix
+    );
+
+    ast::LitExpr::Value coerce(
+      const std::string& name,
+      const ast::LitExpr::Value& value
+    );
+
+    void error(const std::string& err);
+
+    ast::Module* m_module;
+  };
+
+  // Parses a literal the same way the lexer does, e.g. '1', '2u', '1.0' or '0.5f'.
+  std::optional<ast::LitExpr::Value> parse_literal(std::string_view str);
+
+  // names of the permuted constants, for 'compile' to leave the loops they bound.
+  std::vector<std::string> names(const std::vector<PermutationOption>& permutations);
+
+  // parses 'NAME=v0,v1,...'.
+  std::optional<PermutationOption> parse_permutation(std::string_view str);
+
+  // the values of the permuted constants in a variant, e.g. 'QUALITY=1, SHADOWS=0'.
+  std::string describe(
+    const std::vector<PermutationOption>& permutations,
+    const comptime::Bindings& specialization
+  );
+}
\ No newline at end of file
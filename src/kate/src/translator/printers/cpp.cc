@@ -0,0 +1,1334 @@
+#include "cpp.h"
+#include "../comptime.h"
+#include "base/rtti.h"
+
+#include <algorithm>
+#include <cassert>
+#include <fmt/format.h>
+
+namespace kate::tlr {
+  namespace {
+    // types and the thread pool used by generated kernels, guarded so several
+    // generated files can be included by the same translation unit.
+    constexpr const char* kRuntime = R"cpp(#ifndef KSL_CPU_RUNTIME
+#define KSL_CPU_RUNTIME
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace ksl {
+  // vectors are aligned like in buffers but for 3 components, aligned to one so a member can
+  // follow them in the 4th, structs and arrays holding them align them like buffers do.
+  template<typename T, size_t N>
+  struct alignas(sizeof(T) * (N == 3 ? 1 : N)) vec {
+    T v[N] {};
+
+    vec() = default;
+
+    // components are taken in order from scalars and vectors, a single scalar is splatted.
+    template<typename... Args>
+    explicit vec(const Args&... args)
+    {
+      if constexpr (sizeof...(Args) == 1 && (std::is_arithmetic_v<Args> && ...)) {
+        for (auto& c : v)
+          c = static_cast<T>((args, ...));
+      } else {
+        size_t i = 0;
+        (append(i, args), ...);
+      }
+    }
+
+    T& operator[](size_t i) { return v[i]; }
+
+    const T& operator[](size_t i) const { return v[i]; }
+  private:
+    template<typename U>
+    void append(size_t& i, const U& s) { v[i++] = static_cast<T>(s); }
+
+    template<typename U, size_t M>
+    void append(size_t& i, const vec<U, M>& o)
+    {
+      for (size_t j = 0; j < M; j++)
+        v[i++] = static_cast<T>(o.v[j]);
+    }
+  };
+
+  template<typename T>
+  T mod(T a, T b)
+  {
+    if constexpr (std::is_floating_point_v<T>)
+      return std::fmod(a, b);
+    else
+      return a % b;
+  }
+
+#define KSL_VEC_OP(OP, EXPR)                                                                     \
+  template<typename T, size_t N>                                                                 \
+  vec<T, N> operator OP(const vec<T, N>& a, const vec<T, N>& b)                                  \
+  {                                                                                              \
+    vec<T, N> r;                                                                                 \
+    for (size_t i = 0; i < N; i++) { T x = a.v[i], y = b.v[i]; r.v[i] = EXPR; }                  \
+    return r;                                                                                    \
+  }                                                                                              \
+  template<typename T, size_t N>                                                                 \
+  vec<T, N> operator OP(const vec<T, N>& a, std::type_identity_t<T> y)                           \
+  {                                                                                              \
+    vec<T, N> r;                                                                                 \
+    for (size_t i = 0; i < N; i++) { T x = a.v[i]; r.v[i] = EXPR; }                              \
+    return r;                                                                                    \
+  }                                                                                              \
+  template<typename T, size_t N>                                                                 \
+  vec<T, N> operator OP(std::type_identity_t<T> x, const vec<T, N>& b)                           \
+  {                                                                                              \
+    vec<T, N> r;                                                                                 \
+    for (size_t i = 0; i < N; i++) { T y = b.v[i]; r.v[i] = EXPR; }                              \
+    return r;                                                                                    \
+  }                                                                                              \
+  template<typename T, size_t N, typename U>                                                     \
+  vec<T, N>& operator OP##=(vec<T, N>& a, const U& b) { return a = a OP b; }
+
+  KSL_VEC_OP(+, x + y)
+  KSL_VEC_OP(-, x - y)
+  KSL_VEC_OP(*, x * y)
+  KSL_VEC_OP(/, x / y)
+  KSL_VEC_OP(%, mod(x, y))
+
+#undef KSL_VEC_OP
+
+  template<typename T, size_t N>
+  vec<T, N> operator-(const vec<T, N>& a)
+  {
+    vec<T, N> r;
+    for (size_t i = 0; i < N; i++)
+      r.v[i] = -a.v[i];
+    return r;
+  }
+
+  template<size_t... I, typename T, size_t N>
+  vec<T, sizeof...(I)> swizzle(const vec<T, N>& a)
+  {
+    return vec<T, sizeof...(I)>(a.v[I]...);
+  }
+
+  // an array element or a matrix column followed by padding up to its stride in buffers.
+  template<typename T, size_t Stride, bool = (Stride > sizeof(T))>
+  struct padded {
+    T value;
+    uint8_t pad[Stride - sizeof(T)];
+  };
+
+  template<typename T, size_t Stride>
+  struct padded<T, Stride, false> {
+    T value;
+  };
+
+  // column major matrix of 'C' columns and 'R' rows, 'S' bytes apart, columns of 3 rows take 4
+  // like with std430.
+  template<typename T, size_t C, size_t R, size_t S = (R == 3 ? 4 : R) * sizeof(T)>
+  struct mat {
+    padded<vec<T, R>, S> columns[C] {};
+
+    mat() = default;
+
+    // matrices of std140 and std430 convert to each other.
+    template<size_t S2>
+    mat(const mat<T, C, R, S2>& o)
+    {
+      for (size_t i = 0; i < C; i++)
+        columns[i].value = o[i];
+    }
+
+    // a single scalar fills the diagonal, otherwise there's one argument per column.
+    explicit mat(T s)
+    {
+      for (size_t i = 0; i < C && i < R; i++)
+        columns[i].value[i] = s;
+    }
+
+    template<typename... Columns> requires (sizeof...(Columns) == C)
+    explicit mat(const Columns&... cols) : columns { { vec<T, R>(cols) }... } {}
+
+    vec<T, R>& operator[](size_t i) { return columns[i].value; }
+
+    const vec<T, R>& operator[](size_t i) const { return columns[i].value; }
+  };
+
+  template<typename T, size_t C, size_t R, size_t S>
+  vec<T, R> operator*(const mat<T, C, R, S>& m, const vec<T, C>& x)
+  {
+    vec<T, R> r;
+    for (size_t c = 0; c < C; c++)
+      r += m.columns[c].value * x.v[c];
+    return r;
+  }
+
+  template<typename T, size_t K, size_t C, size_t R, size_t S0, size_t S1>
+  mat<T, C, R> operator*(const mat<T, K, R, S0>& a, const mat<T, C, K, S1>& b)
+  {
+    mat<T, C, R> r;
+    for (size_t c = 0; c < C; c++)
+      r.columns[c].value = a * b.columns[c].value;
+    return r;
+  }
+
+  // copies a value read from a uniform, laid out with std140, to the same type with std430.
+  template<typename D, typename S>
+  void convert(D& d, const S& s) { d = s; }
+
+  template<typename D, typename S, size_t N>
+  void convert(D (&d)[N], const S (&s)[N])
+  {
+    for (size_t i = 0; i < N; i++)
+      convert(d[i], s[i]);
+  }
+
+  template<typename D, typename S, size_t Stride>
+  void convert(D& d, const padded<S, Stride>& s) { convert(d, s.value); }
+
+  template<typename D, size_t Stride, typename S>
+  void convert(padded<D, Stride>& d, const S& s) { convert(d.value, s); }
+
+  template<typename D, size_t DStride, typename S, size_t SStride>
+  void convert(padded<D, DStride>& d, const padded<S, SStride>& s) { convert(d.value, s.value); }
+
+#define KSL_VEC_TYPES(NAME, T) \
+  using NAME##2 = vec<T, 2>;   \
+  using NAME##3 = vec<T, 3>;   \
+  using NAME##4 = vec<T, 4>;
+
+  KSL_VEC_TYPES(float, float)
+  KSL_VEC_TYPES(double, double)
+  KSL_VEC_TYPES(int, int32_t)
+  KSL_VEC_TYPES(uint, uint32_t)
+  KSL_VEC_TYPES(half, int16_t)
+  KSL_VEC_TYPES(uhalf, uint16_t)
+
+#undef KSL_VEC_TYPES
+
+  struct Invocation {
+    uint3 global_invocation_id;
+    uint3 local_invocation_id;
+    uint32_t local_invocation_index;
+    uint3 workgroup_id;
+    uint3 num_workgroups;
+  };
+
+  // Threads kept from one dispatch to the next, started by the first dispatch needing them.
+  class Pool {
+  public:
+    static Pool& get()
+    {
+      static Pool pool;
+      return pool;
+    }
+
+    ~Pool()
+    {
+      {
+        std::lock_guard lock(m_mutex);
+        m_stop = true;
+      }
+
+      m_wake.notify_all();
+
+      for (auto& worker : m_workers)
+        worker.join();
+    }
+
+    // Runs 'task' on the calling thread and on 'num_threads - 1' workers, returns once all
+    // of them are done. Dispatches from several threads take turns.
+    template<typename F>
+    void run(size_t num_threads, const F& task)
+    {
+      std::unique_lock lock(m_mutex);
+
+      m_idle.wait(lock, [&] { return !m_busy; });
+      m_busy = true;
+
+      while (m_workers.size() + 1 < num_threads)
+        m_workers.emplace_back([this, generation = m_generation] { work(generation); });
+
+      m_task = [](const void* task) { (*static_cast<const F*>(task))(); };
+      m_context = &task;
+      m_claims = num_threads - 1;
+      m_running = num_threads - 1;
+      m_generation++;
+
+      lock.unlock();
+      m_wake.notify_all();
+
+      task();
+
+      lock.lock();
+      m_done.wait(lock, [&] { return m_running == 0; });
+      m_busy = false;
+
+      lock.unlock();
+      m_idle.notify_one();
+    }
+  private:
+    void work(uint64_t seen)
+    {
+      std::unique_lock lock(m_mutex);
+
+      for (;;) {
+        m_wake.wait(lock, [&] { return m_stop || (m_generation != seen && m_claims > 0); });
+
+        if (m_stop)
+          return;
+
+        seen = m_generation;
+        m_claims--;
+
+        auto task = m_task;
+        auto context = m_context;
+
+        lock.unlock();
+        task(context);
+        lock.lock();
+
+        if (--m_running == 0)
+          m_done.notify_all();
+      }
+    }
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    std::condition_variable m_idle;
+    std::vector<std::thread> m_workers;
+    void (*m_task)(const void*) = nullptr;
+    const void* m_context = nullptr;
+    uint64_t m_generation = 0;
+    size_t m_claims = 0;
+    size_t m_running = 0;
+    bool m_busy = false;
+    bool m_stop = false;
+  };
+
+  // Runs 'kernel' once per invocation of 'num_workgroups' workgroups, workgroups are
+  // spread over 'num_threads' threads of the pool, 0 uses one thread per hardware thread.
+  template<typename F>
+  void dispatch(uint3 num_workgroups, uint3 workgroup_size, size_t num_threads, const F& kernel)
+  {
+    size_t count = size_t(num_workgroups[0]) * num_workgroups[1] * num_workgroups[2];
+
+    if (count == 0)
+      return;
+
+    if (num_threads == 0)
+      num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+    num_threads = std::min(num_threads, count);
+
+    std::atomic<size_t> next_workgroup { 0 };
+
+    auto run = [&] {
+      Invocation invocation;
+      invocation.num_workgroups = num_workgroups;
+
+      for (auto i = next_workgroup++; i < count; i = next_workgroup++) {
+        invocation.workgroup_id = uint3(
+          i % num_workgroups[0],
+          i / num_workgroups[0] % num_workgroups[1],
+          i / (size_t(num_workgroups[0]) * num_workgroups[1])
+        );
+
+        uint32_t index = 0;
+
+        for (uint32_t z = 0; z < workgroup_size[2]; z++)
+          for (uint32_t y = 0; y < workgroup_size[1]; y++)
+            for (uint32_t x = 0; x < workgroup_size[0]; x++) {
+              invocation.local_invocation_id = uint3(x, y, z);
+              invocation.local_invocation_index = index++;
+              invocation.global_invocation_id = invocation.workgroup_id * workgroup_size + invocation.local_invocation_id;
+
+              kernel(invocation);
+            }
+      }
+    };
+
+    if (num_threads == 1)
+      run();
+    else
+      Pool::get().run(num_threads, run);
+  }
+}
+
+#endif
+)cpp";
+
+    constexpr std::string_view kComponents = "xyzw";
+    constexpr std::string_view kColorComponents = "rgba";
+
+    const char* scalar_name(const std::string& name)
+    {
+      if (name == "half")
+        return "int16_t";
+      else if (name == "uhalf")
+        return "uint16_t";
+      else if (name == "int")
+        return "int32_t";
+      else if (name == "uint")
+        return "uint32_t";
+      else if (name == "double")
+        return "double";
+      else if (name == "void")
+        return "void";
+
+      return "float";
+    }
+
+    ast::Attr* find_attr(
+      ast::List<ast::Attr>& attrs,
+      ast::Attr::Type type
+    )
+    {
+      for (auto& attr : attrs)
+        if (attr->type() == type)
+          return attr.get();
+
+      return nullptr;
+    }
+
+    bool is_assignment(ast::BinaryExpr::Type type)
+    {
+      switch (type) {
+        case ast::BinaryExpr::Type::kCompoundAdd:
+        case ast::BinaryExpr::Type::kCompoundSub:
+        case ast::BinaryExpr::Type::kCompoundDiv:
+        case ast::BinaryExpr::Type::kCompoundMul:
+        case ast::BinaryExpr::Type::kCompoundMod:
+        case ast::BinaryExpr::Type::kOrEqual:
+        case ast::BinaryExpr::Type::kXorEqual:
+        case ast::BinaryExpr::Type::kAndEqual:
+        case ast::BinaryExpr::Type::kRightShiftEqual:
+        case ast::BinaryExpr::Type::kLeftShiftEqual:
+        case ast::BinaryExpr::Type::kModulusEqual:
+        case ast::BinaryExpr::Type::kDivideEqual:
+        case ast::BinaryExpr::Type::kMultiplyEqual:
+        case ast::BinaryExpr::Type::kSubtractEqual:
+        case ast::BinaryExpr::Type::kAddEqual:
+        case ast::BinaryExpr::Type::kEqual:
+          return true;
+        default:
+          return false;
+      }
+    }
+
+    const char* operator_token(ast::BinaryExpr::Type type)
+    {
+      switch (type) {
+        case ast::BinaryExpr::Type::kAdd: return " + ";
+        case ast::BinaryExpr::Type::KSub: return " - ";
+        case ast::BinaryExpr::Type::kDiv: return " / ";
+        case ast::BinaryExpr::Type::kMul: return " * ";
+        case ast::BinaryExpr::Type::kMod: return " % ";
+        case ast::BinaryExpr::Type::kCompoundAdd: return " += ";
+        case ast::BinaryExpr::Type::kCompoundSub: return " -= ";
+        case ast::BinaryExpr::Type::kCompoundDiv: return " /= ";
+        case ast::BinaryExpr::Type::kCompoundMul: return " *= ";
+        case ast::BinaryExpr::Type::kCompoundMod: return " %= ";
+        case ast::BinaryExpr::Type::kComma: return ", ";
+        case ast::BinaryExpr::Type::kOrEqual: return " |= ";
+        case ast::BinaryExpr::Type::kXorEqual: return " ^= ";
+        case ast::BinaryExpr::Type::kAndEqual: return " &= ";
+        case ast::BinaryExpr::Type::kRightShiftEqual: return " >>= ";
+        case ast::BinaryExpr::Type::kLeftShiftEqual: return " <<= ";
+        case ast::BinaryExpr::Type::kModulusEqual: return " %= ";
+        case ast::BinaryExpr::Type::kDivideEqual: return " /= ";
+        case ast::BinaryExpr::Type::kMultiplyEqual: return " *= ";
+        case ast::BinaryExpr::Type::kSubtractEqual: return " -= ";
+        case ast::BinaryExpr::Type::kAddEqual: return " += ";
+        case ast::BinaryExpr::Type::kEqual: return " = ";
+        case ast::BinaryExpr::Type::kOrOr: return " || ";
+        case ast::BinaryExpr::Type::kAndAnd: return " && ";
+        case ast::BinaryExpr::Type::kBitOr: return " | ";
+        case ast::BinaryExpr::Type::kBitXor: return " ^ ";
+        case ast::BinaryExpr::Type::kBitAnd: return " & ";
+        case ast::BinaryExpr::Type::kEqualEqual: return " == ";
+        case ast::BinaryExpr::Type::kNotEqual: return " != ";
+        case ast::BinaryExpr::Type::kGreaterThan: return " > ";
+        case ast::BinaryExpr::Type::kGreaterThanEqual: return " >= ";
+        case ast::BinaryExpr::Type::kLessThan: return " < ";
+        case ast::BinaryExpr::Type::kLessThanEqual: return " <= ";
+        case ast::BinaryExpr::Type::kLeftShift: return " << ";
+        case ast::BinaryExpr::Type::kRightShift: return " >> ";
+        case ast::BinaryExpr::Type::kSubtract: return " - ";
+        case ast::BinaryExpr::Type::kMultiply: return " * ";
+        case ast::BinaryExpr::Type::kDivide: return " / ";
+        case ast::BinaryExpr::Type::kModulus: return " % ";
+        case ast::BinaryExpr::Type::kIncrement: return "++";
+        case ast::BinaryExpr::Type::kDecrement: return "--";
+        default:
+          assert(false);
+          return "";
+      }
+    }
+
+    size_t component_index(char c)
+    {
+      if (auto i = kComponents.find(c); i != std::string_view::npos)
+        return i;
+
+      return kColorComponents.find(c);
+    }
+
+    // elements smaller than the stride of their array are printed as 'ksl::padded'.
+    bool padded(types::Array* array, types::Layout layout)
+    {
+      return array->stride(layout) != array->type()->size(layout);
+    }
+
+    // alignment of the C++ type printed for 'type', less than in buffers for 3 components.
+    uint64_t cpp_alignment(types::Type* type, types::Layout layout)
+    {
+      return base::Match(
+        type,
+        [&](types::Vec* vec) {
+          auto component = vec->type()->size(layout);
+          return vec->columns() == 3 ? component : component * vec->columns();
+        },
+        [&](types::Mat* mat) {
+          auto component = mat->type()->size(layout);
+          return mat->rows() == 3 ? component : component * mat->rows();
+        },
+        [&](types::Array* array) {
+          return cpp_alignment(array->type(), layout);
+        },
+        [&](base::Default) {
+          return type->alignment(layout);
+        }
+      );
+    }
+
+    bool same_layouts(types::Type* type);
+
+    // whether std140 and std430 put the members of 'custom' at the same offsets, with the same layouts.
+    bool same_members(types::Custom* custom)
+    {
+      for (size_t i = 0; i < custom->members().size(); i++)
+        if (custom->offset(i, types::Layout::kStd140) != custom->offset(i, types::Layout::kStd430) ||
+            !same_layouts(custom->members()[i].type()))
+          return false;
+
+      return true;
+    }
+
+    // whether std140 and std430 lay out 'type' the same way.
+    bool same_layouts(types::Type* type)
+    {
+      auto std140 = types::Layout::kStd140;
+      auto std430 = types::Layout::kStd430;
+
+      return base::Match(
+        type,
+        [&](types::Mat* mat) {
+          return mat->stride(std140) == mat->stride(std430);
+        },
+        [&](types::Array* array) {
+          return array->stride(std140) == array->stride(std430) && same_layouts(array->type());
+        },
+        [&](types::Custom* custom) {
+          return custom->size(std140) == custom->size(std430) &&
+            custom->alignment(std140) == custom->alignment(std430) &&
+            same_members(custom);
+        },
+        [&](base::Default) {
+          return true;
+        }
+      );
+    }
+  }
+
+  CppPrinter::CppPrinter(const std::string& namespace_name)
+    : m_namespace { namespace_name },
+      m_indent_level { 0 }
+  {
+    m_exprs.pre<ast::BinaryExpr>([this](ast::BinaryExpr* expr) { print(expr); return false; });
+    m_exprs.pre<ast::UnaryExpr>([this](ast::UnaryExpr* expr) { print(expr); return false; });
+    m_exprs.pre<ast::IdExpr>([this](ast::IdExpr* expr) { print(expr); return false; });
+    m_exprs.pre<ast::CallExpr>([this](ast::CallExpr* expr) { print(expr); return false; });
+    m_exprs.pre<ast::LitExpr>([this](ast::LitExpr* expr) { print(expr->value()); return false; });
+    m_exprs.pre<ast::ArrayExpr>([this](ast::ArrayExpr* expr) { print(expr); return false; });
+
+    m_exprs.pre<ast::Expr>([](ast::Expr* expr) {
+      assert(false);
+      return false;
+    });
+  }
+
+  void CppPrinter::print(ast::Module* module)
+  {
+    m_consts = comptime::consts(module);
+
+    for (auto& decl : module->global_declarations())
+      if (auto uniform = decl->as<ast::UniformDecl>()) {
+        m_uniforms.insert(uniform->name());
+        lay_out_std140(uniform->type()->sem()->type(), false);
+      }
+
+    out() << "#pragma once\n\n" << kRuntime << "\n";
+    out() << "namespace " << m_namespace << " {\n";
+
+    m_indent_level++;
+
+    for (auto& decl : module->global_declarations()) {
+      base::Match(
+        decl.get(),
+        [&](ast::StructDecl* struct_) {
+          print(struct_->sem()->type()->as<types::Custom>(), types::Layout::kStd430);
+          out() << "\n";
+        },
+        [&](ast::ConstDecl* const_decl) {
+          print(const_decl);
+        },
+        [&](base::Default) {}
+      );
+    }
+
+    if (!m_std140.empty()) {
+      indent();
+      out() << "namespace std140 {\n";
+
+      m_indent_level++;
+
+      size_t num_structs = 0;
+
+      for (auto& decl : module->global_declarations())
+        if (auto struct_ = decl->as<ast::StructDecl>())
+          if (auto custom = struct_->sem()->type()->as<types::Custom>(); m_std140.contains(custom)) {
+            if (num_structs++ > 0)
+              out() << "\n";
+
+            print(custom, types::Layout::kStd140);
+          }
+
+      m_indent_level--;
+
+      indent();
+      out() << "}\n\n";
+    }
+
+    indent();
+    out() << "struct Shader {\n";
+
+    m_indent_level++;
+
+    for (auto& decl : module->global_declarations()) {
+      base::Match(
+        decl.get(),
+        [&](ast::BufferDecl* buffer) {
+          print(buffer);
+        },
+        [&](ast::UniformDecl* uniform) {
+          print(uniform);
+        },
+        [&](base::Default) {}
+      );
+    }
+
+    // vertex and fragment entry points only run on the gpu.
+    for (auto& decl : module->global_declarations())
+      if (auto func = decl->as<ast::FuncDecl>())
+        if (!find_attr(func->attrs(), ast::Attr::Type::kVertex) &&
+            !find_attr(func->attrs(), ast::Attr::Type::kFragment))
+          print(func);
+
+    m_indent_level--;
+
+    indent();
+    out() << "};\n";
+
+    for (auto& decl : module->global_declarations())
+      if (auto func = decl->as<ast::FuncDecl>())
+        if (find_attr(func->attrs(), ast::Attr::Type::kCompute))
+          print_dispatch(func);
+
+    m_indent_level--;
+
+    out() << "}\n";
+  }
+
+  std::string CppPrinter::str() const
+  {
+    return m_stream.str();
+  }
+
+  std::stringstream& CppPrinter::out()
+  {
+    return m_stream;
+  }
+
+  void CppPrinter::indent()
+  {
+    for (size_t i = 0; i < m_indent_level; i++)
+      out() << "  ";
+  }
+
+  void CppPrinter::error(const std::string& err)
+  {
+    fmt::println("{}", err);
+    std::exit(1);
+  }
+
+  void CppPrinter::print(types::Custom* custom, types::Layout layout)
+  {
+    auto& members = custom->members();
+
+    // members are aligned like in buffers, so they are at the offsets of the layout, and
+    // std140 also aligns the struct to 16 bytes.
+    uint64_t alignment = 1;
+
+    for (auto& m : members)
+      alignment = std::max(alignment, m.type()->alignment(layout));
+
+    indent();
+
+    if (custom->alignment(layout) > alignment)
+      out() << "struct alignas(" << custom->alignment(layout) << ") " << custom->name() << " {\n";
+    else
+      out() << "struct " << custom->name() << " {\n";
+
+    m_indent_level++;
+
+    for (auto& m : members) {
+      auto ty = m.type();
+
+      indent();
+
+      if (ty->alignment(layout) > cpp_alignment(ty, layout))
+        out() << "alignas(" << ty->alignment(layout) << ") ";
+
+      print_type_prefix(ty, layout);
+      out() << " " << m.name();
+      print_type_postfix(ty, layout);
+      out() << ";\n";
+    }
+
+    // values read from uniforms are used as the struct of the rest of the shader.
+    if (layout == types::Layout::kStd140) {
+      auto name = fmt::format("::{}::{}", m_namespace, custom->name());
+
+      out() << "\n";
+      indent();
+      out() << "operator " << name << "() const\n";
+      indent();
+      out() << "{\n";
+
+      m_indent_level++;
+
+      indent();
+      out() << name << " r;\n";
+
+      for (auto& m : members)
+        if (auto array = m.type()->as<types::Array>(); !array || array->count() > 0) {
+          indent();
+          out() << "ksl::convert(r." << m.name() << ", " << m.name() << ");\n";
+        }
+
+      indent();
+      out() << "return r;\n";
+
+      m_indent_level--;
+
+      indent();
+      out() << "}\n";
+    }
+
+    m_indent_level--;
+
+    indent();
+    out() << "};\n\n";
+
+    indent();
+    out() << fmt::format("static_assert(sizeof({}) == {});\n", custom->name(), custom->size(layout));
+
+    for (size_t i = 0; i < members.size(); i++) {
+      if (auto array = members[i].type()->as<types::Array>(); array && array->count() == 0)
+        continue;
+
+      indent();
+      out() << fmt::format(
+        "static_assert(offsetof({}, {}) == {});\n",
+        custom->name(),
+        members[i].name(),
+        custom->offset(i, layout)
+      );
+    }
+  }
+
+  void CppPrinter::print(ast::ConstDecl* const_decl)
+  {
+    indent();
+    out() << "constexpr ";
+    print_type_prefix(const_decl->sem()->type());
+    out() << " " << const_decl->name() << " = ";
+    print(const_decl->expr().get());
+    out() << ";\n\n";
+  }
+
+  void CppPrinter::print(ast::BufferDecl* buffer)
+  {
+    print_binding(
+      buffer->name(),
+      buffer->type()->sem()->type(),
+      buffer->args().access_mode != ast::AccessMode::kRead,
+      types::Layout::kStd430
+    );
+  }
+
+  void CppPrinter::print(ast::UniformDecl* uniform)
+  {
+    print_binding(uniform->name(), uniform->type()->sem()->type(), false, types::Layout::kStd140);
+  }
+
+  void CppPrinter::print_binding(
+    const std::string& name,
+    types::Type* type,
+    bool writable,
+    types::Layout layout
+  )
+  {
+    indent();
+
+    if (!writable)
+      out() << "const ";
+
+    if (auto array = type->as<types::Array>())
+      print_element_prefix(array, layout);
+    else {
+      print_type_prefix(type, layout);
+      m_value_bindings.insert(name);
+    }
+
+    out() << "* " << name << " = nullptr;\n";
+  }
+
+  void CppPrinter::print(ast::FuncDecl* func)
+  {
+    out() << "\n";
+    indent();
+    print_type_prefix(func->type()->sem()->type());
+    out() << " " << func->name() << "(";
+
+    for (size_t i = 0; i < func->args().size(); i++) {
+      if (i > 0) out() << ", ";
+
+      print(func->args()[i].get());
+    }
+
+    // kernels only write to memory through buffers, so every invocation shares the same 'Shader'.
+    out() << ") const ";
+
+    print(func->block().get());
+  }
+
+  void CppPrinter::print(ast::FuncArg* func_arg)
+  {
+    auto ty = func_arg->type()->sem()->type();
+
+    print_type_prefix(ty);
+    out() << " " << func_arg->name();
+    print_type_postfix(ty);
+  }
+
+  void CppPrinter::print_dispatch(ast::FuncDecl* func)
+  {
+    std::array<uint32_t, 3> workgroup_size = { 1, 1, 1 };
+
+    if (auto attr = find_attr(func->attrs(), ast::Attr::Type::kWorkgroupSize)) {
+      for (size_t i = 0; i < attr->args().size() && i < workgroup_size.size(); i++) {
+        auto value = comptime::eval(attr->args()[i].get(), &m_consts);
+
+        if (!value || !(value->type & ast::LitExpr::Value::Type::kIntMask))
+          error(fmt::format("Workgroup size of '{}' must be an integer known at compile time.", func->name()));
+
+        workgroup_size[i] = static_cast<uint32_t>(value->value.u64);
+      }
+    }
+
+    std::vector<std::string> args;
+
+    for (auto& arg : func->args()) {
+      auto builtin = find_attr(arg->attrs(), ast::Attr::Type::kBuiltin);
+
+      if (!builtin)
+        error(fmt::format("Argument '{}' of compute entry point '{}' must be a builtin.", arg->name(), func->name()));
+
+      // '@builtin(name)' or just '@builtin' when the argument is named after it.
+      auto name = arg->name();
+
+      if (!builtin->args().empty())
+        if (auto id = builtin->args()[0]->as<ast::IdExpr>())
+          name = id->ident();
+
+      if (name != "global_invocation_id" &&
+          name != "local_invocation_id" &&
+          name != "local_invocation_index" &&
+          name != "workgroup_id" &&
+          name != "num_workgroups")
+        error(fmt::format("Builtin '{}' is not supported by the C++ backend.", name));
+
+      args.push_back("invocation." + name);
+    }
+
+    out() << "\n";
+    indent();
+    out() << fmt::format(
+      "// runs 'num_workgroups' workgroups of '{}' on 'num_threads' threads, 0 uses one per hardware thread.\n",
+      func->name()
+    );
+
+    indent();
+    out() << fmt::format(
+      "inline void dispatch_{}(const Shader& shader, ksl::uint3 num_workgroups, size_t num_threads = 0)\n",
+      func->name()
+    );
+
+    indent();
+    out() << "{\n";
+
+    m_indent_level++;
+
+    indent();
+    out() << fmt::format(
+      "ksl::dispatch(num_workgroups, ksl::uint3({}u, {}u, {}u), num_threads, [&](const ksl::Invocation& invocation) {{\n",
+      workgroup_size[0],
+      workgroup_size[1],
+      workgroup_size[2]
+    );
+
+    m_indent_level++;
+
+    indent();
+    out() << fmt::format("shader.{}({});\n", func->name(), fmt::join(args, ", "));
+
+    m_indent_level--;
+
+    indent();
+    out() << "});\n";
+
+    m_indent_level--;
+
+    indent();
+    out() << "}\n";
+  }
+
+  void CppPrinter::print(ast::BlockStat* block)
+  {
+    out() << "{\n";
+
+    m_indent_level++;
+
+    for (auto& stat : block->stats())
+      print(stat.get());
+
+    m_indent_level--;
+
+    indent();
+    out() << "}\n";
+  }
+
+  void CppPrinter::print(ast::Stat* stat)
+  {
+    indent();
+
+    base::Match(
+      stat,
+      [&](ast::IfStat* if_stat) {
+        print(if_stat);
+      },
+      [&](ast::ForStat* for_stat) {
+        print(for_stat);
+      },
+      [&](ast::WhileStat* while_stat) {
+        print(while_stat);
+      },
+      [&](ast::BlockStat* block_stat) {
+        print(block_stat);
+      },
+      [&](ast::VarStat* var_stat) {
+        print(var_stat);
+        out() << ";\n";
+      },
+      [&](ast::ExprStat* expr_stat) {
+        print(expr_stat->expr().get());
+        out() << ";\n";
+      },
+      [&](ast::BreakStat* break_stat) {
+        out() << "break;\n";
+      },
+      [&](ast::ReturnStat* return_stat) {
+        print(return_stat);
+        out() << ";\n";
+      },
+      [](base::Default) {
+        assert(false);
+      }
+    );
+  }
+
+  void CppPrinter::print(ast::IfStat* if_stat)
+  {
+    out() << "if (";
+    print(if_stat->condition().get());
+    out() << ") ";
+    print(if_stat->block().get());
+
+    if (if_stat->elseBlock()) {
+      indent();
+      out() << "else ";
+      print(if_stat->elseBlock().get());
+    }
+  }
+
+  void CppPrinter::print(ast::ForStat* for_stat)
+  {
+    out() << "for (";
+
+    if (auto& initializer = for_stat->initializer()) {
+      if (auto var_stat = initializer->as<ast::VarStat>())
+        print(var_stat);
+      else if (auto expr_stat = initializer->as<ast::ExprStat>())
+        print(expr_stat->expr().get());
+    }
+
+    out() << "; ";
+
+    if (for_stat->condition())
+      print(for_stat->condition().get());
+
+    out() << "; ";
+
+    if (for_stat->continuing())
+      print(for_stat->continuing()->expr().get());
+
+    out() << ") ";
+    print(for_stat->block().get());
+  }
+
+  void CppPrinter::print(ast::WhileStat* while_stat)
+  {
+    out() << "while (";
+    print(while_stat->condition().get());
+    out() << ") ";
+    print(while_stat->block().get());
+  }
+
+  void CppPrinter::print(ast::VarStat* var_stat)
+  {
+    auto ty = var_stat->decl()->sem()->type();
+
+    print_type_prefix(ty);
+    out() << " " << var_stat->decl()->name();
+    print_type_postfix(ty);
+
+    if (var_stat->expr()) {
+      out() << " = ";
+      print(var_stat->expr().get());
+    } else
+      out() << " {}";
+  }
+
+  void CppPrinter::print(ast::ReturnStat* return_stat)
+  {
+    out() << "return";
+
+    if (return_stat->expr()) {
+      out() << " ";
+      print(return_stat->expr().get());
+    }
+  }
+
+  void CppPrinter::print(ast::Expr* expr)
+  {
+    m_exprs.run(expr);
+  }
+
+  void CppPrinter::print(const ast::LitExpr::Value& v)
+  {
+    switch (v.type) {
+      case ast::LitExpr::Value::Type::kI16:
+        out() << "int16_t(" << v.value.i64 << ")";
+        break;
+      case ast::LitExpr::Value::Type::kU16:
+        out() << "uint16_t(" << v.value.u64 << ")";
+        break;
+      case ast::LitExpr::Value::Type::kI32:
+        out() << v.value.i64;
+        break;
+      case ast::LitExpr::Value::Type::kU32:
+        out() << v.value.u64 << "u";
+        break;
+      case ast::LitExpr::Value::Type::kI64:
+        out() << v.value.i64 << "ll";
+        break;
+      case ast::LitExpr::Value::Type::kU64:
+        out() << v.value.u64 << "ull";
+        break;
+      case ast::LitExpr::Value::Type::kF32:
+      case ast::LitExpr::Value::Type::kF64: {
+        auto str = fmt::format("{}", v.value.f64);
+
+        // keep the literal a floating point one, '1' would be an integer in C++.
+        if (str.find_first_of(".en") == std::string::npos)
+          str += ".0";
+
+        out() << str;
+
+        if (v.type == ast::LitExpr::Value::Type::kF32)
+          out() << "f";
+
+        break;
+      }
+      default:
+        assert(false);
+    }
+  }
+
+  void CppPrinter::print(ast::BinaryExpr* bexpr)
+  {
+    switch (bexpr->type()) {
+      case ast::BinaryExpr::Type::kMemberAccess:
+      case ast::BinaryExpr::Type::kSwizzle: {
+        auto member = bexpr->rhs()->as<ast::IdExpr>()->ident();
+        auto lhs_type = bexpr->lhs()->sem()->type();
+
+        if (!lhs_type->is<types::Vec>()) {
+          m_exprs.visit(bexpr->lhs().get());
+          m_exprs.then([this, bexpr]() { out() << "." << bexpr->rhs()->as<ast::IdExpr>()->ident(); });
+        } else if (member.size() == 1) {
+          m_exprs.visit(bexpr->lhs().get());
+          m_exprs.then([this, bexpr]() {
+            out() << "[" << component_index(bexpr->rhs()->as<ast::IdExpr>()->ident()[0]) << "]";
+          });
+        } else {
+          out() << "ksl::swizzle<";
+
+          for (size_t i = 0; i < member.size(); i++)
+            out() << (i > 0 ? ", " : "") << component_index(member[i]);
+
+          out() << ">(";
+          m_exprs.visit(bexpr->lhs().get());
+          m_exprs.then([this]() { out() << ")"; });
+        }
+
+        return;
+      }
+      case ast::BinaryExpr::Type::kIndexAccessor: {
+        m_exprs.visit(bexpr->lhs().get());
+        m_exprs.then([this]() { out() << "["; });
+        m_exprs.visit(bexpr->rhs().get());
+
+        auto array = bexpr->lhs()->sem()->type()->as<types::Array>();
+
+        if (array && padded(array, layout_of(bexpr->lhs().get())))
+          m_exprs.then([this]() { out() << "].value"; });
+        else
+          m_exprs.then([this]() { out() << "]"; });
+
+        return;
+      }
+      default:
+        break;
+    }
+
+    // operands are always parenthesized, so precedence is the one of the tree.
+    bool parenthesize = !is_assignment(bexpr->type());
+
+    if (parenthesize) out() << "(";
+
+    m_exprs.visit(bexpr->lhs().get());
+    m_exprs.then([this, bexpr]() { out() << operator_token(bexpr->type()); });
+
+    if (bexpr->rhs())
+      m_exprs.visit(bexpr->rhs().get());
+
+    if (parenthesize)
+      m_exprs.then([this]() { out() << ")"; });
+  }
+
+  void CppPrinter::print(ast::UnaryExpr* uexpr)
+  {
+    switch (uexpr->type()) {
+      case ast::UnaryExpr::Type::kFlip:
+        out() << "(~";
+        break;
+      case ast::UnaryExpr::Type::kMinus:
+        out() << "(-";
+        break;
+      case ast::UnaryExpr::Type::kNot:
+        out() << "(!";
+        break;
+      case ast::UnaryExpr::Type::kPlus:
+        out() << "(+";
+        break;
+    }
+
+    m_exprs.visit(uexpr->operand().get());
+    m_exprs.then([this]() { out() << ")"; });
+  }
+
+  void CppPrinter::print(ast::IdExpr* idexpr)
+  {
+    if (m_value_bindings.contains(idexpr->ident()))
+      out() << "(*" << idexpr->ident() << ")";
+    else
+      out() << idexpr->ident();
+  }
+
+  void CppPrinter::print(ast::ArrayExpr* array_expr)
+  {
+    out() << "{ ";
+
+    auto& items = array_expr->items();
+    auto array = array_expr->sem()->type()->as<types::Array>();
+
+    // padded elements are structs of their own.
+    bool wrap = array && padded(array, types::Layout::kStd430);
+
+    for (size_t i = 0; i < items.size(); i++) {
+      if (i > 0) m_exprs.then([this]() { out() << ", "; });
+      if (wrap) m_exprs.then([this]() { out() << "{ "; });
+
+      m_exprs.visit(items[i].get());
+
+      if (wrap) m_exprs.then([this]() { out() << " }"; });
+    }
+
+    m_exprs.then([this]() { out() << " }"; });
+  }
+
+  void CppPrinter::print(ast::CallExpr* callexpr)
+  {
+    auto type = types::system().findType(callexpr->id()->ident());
+
+    // structs are aggregates, other types have constructors, anything else is a function of the shader.
+    bool aggregate = type && type->is<types::Custom>();
+
+    if (type && !aggregate)
+      print_type_prefix(type);
+    else
+      out() << callexpr->id()->ident();
+
+    out() << (aggregate ? "{ " : "(");
+
+    auto& args = callexpr->args();
+
+    for (size_t i = 0; i < args.size(); i++) {
+      if (i > 0) m_exprs.then([this]() { out() << ", "; });
+
+      m_exprs.visit(args[i].get());
+    }
+
+    if (aggregate)
+      m_exprs.then([this]() { out() << " }"; });
+    else
+      m_exprs.then([this]() { out() << ")"; });
+  }
+
+  void CppPrinter::print_type_prefix(types::Type* type, types::Layout layout)
+  {
+    base::Match(
+      type,
+      [&](types::Array* array) {
+        print_element_prefix(array, layout);
+      },
+      [&](types::Vec* vec) {
+        out() << "ksl::" << vec->mangledName();
+      },
+      [&](types::Mat* mat) {
+        out() << fmt::format(
+          "ksl::mat<{}, {}, {}",
+          scalar_name(mat->type()->mangledName()),
+          mat->columns(),
+          mat->rows()
+        );
+
+        // std140 pads the columns of 2 rows.
+        if (mat->stride(layout) != mat->stride(types::Layout::kStd430))
+          out() << ", " << mat->stride(layout);
+
+        out() << ">";
+      },
+      [&](types::Custom* custom) {
+        if (layout == types::Layout::kStd140 && m_std140.contains(custom))
+          out() << "std140::";
+
+        out() << custom->name();
+      },
+      [&](base::Default) {
+        out() << scalar_name(type->mangledName());
+      }
+    );
+  }
+
+  void CppPrinter::print_type_postfix(types::Type* type, types::Layout layout)
+  {
+    if (auto array = type->as<types::Array>()) {
+      out() << "[" << array->count() << "]";
+
+      if (!padded(array, layout))
+        print_type_postfix(array->type(), layout);
+    }
+  }
+
+  void CppPrinter::print_element_prefix(types::Array* array, types::Layout layout)
+  {
+    if (!padded(array, layout)) {
+      print_type_prefix(array->type(), layout);
+      return;
+    }
+
+    out() << "ksl::padded<";
+    print_type_prefix(array->type(), layout);
+    print_type_postfix(array->type(), layout);
+    out() << ", " << array->stride(layout) << ">";
+  }
+
+  void CppPrinter::lay_out_std140(types::Type* type, bool nested)
+  {
+    if (auto array = type->as<types::Array>()) {
+      lay_out_std140(array->type(), true);
+      return;
+    }
+
+    auto custom = type->as<types::Custom>();
+
+    if (!custom)
+      return;
+
+    // a uniform holding a single struct isn't read past its members, whatever its size.
+    bool same = nested ? same_layouts(custom) : same_members(custom);
+
+    if (!same && m_std140.insert(custom).second)
+      for (auto& member : custom->members())
+        lay_out_std140(member.type(), true);
+  }
+
+  types::Layout CppPrinter::layout_of(ast::Expr* expr)
+  {
+    // members and elements are in the memory of what holds them.
+    while (auto bexpr = expr->as<ast::BinaryExpr>()) {
+      if (bexpr->type() != ast::BinaryExpr::Type::kMemberAccess &&
+          bexpr->type() != ast::BinaryExpr::Type::kIndexAccessor)
+        break;
+
+      expr = bexpr->lhs().get();
+    }
+
+    if (auto idexpr = expr->as<ast::IdExpr>(); idexpr && m_uniforms.contains(idexpr->ident()))
+      return types::Layout::kStd140;
+
+    return types::Layout::kStd430;
+  }
+}
\ No newline at end of file
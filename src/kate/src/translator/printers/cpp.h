@@ -0,0 +1,119 @@
+#pragma once
+
+#include "../ast.h"
+#include "../comptime.h"
+#include "../sem.h"
+#include "../types.h"
+#include "../passes/traverse.h"
+
+#include "base/hash_map.h"
+
+#include <sstream>
+#include <unordered_set>
+
+namespace kate::tlr {
+  // Prints the compute side of a module as portable C++, so kernels run on machines without a gpu.
+  //
+  // Buffers become pointers in a 'Shader' struct holding the functions of the module, and
+  // each '@compute' entry point gets a 'dispatch_<name>' function that runs its workgroups on
+  // a pool of threads. Vectors are printed as 'ksl::vec', fixed size arrays the compiler is
+  // able to map to simd registers. Structs and arrays are laid out like in buffers, so data
+  // is shared with the gpu as it is: std430, and std140 for uniforms, whose structs get a copy
+  // in 'std140' converting to the std430 one when the layouts differ.
+  class CppPrinter {
+  public:
+    CppPrinter(const std::string& namespace_name = "shader");
+
+    void print(ast::Module* module);
+
+    std::string str() const;
+  private:
+    // structs are printed with std430, and with std140 in 'std140' for uniforms it lays out
+    // differently.
+    void print(types::Custom* custom, types::Layout layout);
+
+    void print(ast::ConstDecl* const_decl);
+
+    void print(ast::BufferDecl* buffer);
+
+    void print(ast::UniformDecl* uniform);
+
+    void print(ast::FuncDecl* func);
+
+    void print(ast::FuncArg* func_arg);
+
+    void print(ast::BlockStat* block);
+
+    void print(ast::Stat* stat);
+
+    void print(ast::IfStat* if_stat);
+
+    void print(ast::ForStat* for_stat);
+
+    void print(ast::WhileStat* while_stat);
+
+    void print(ast::VarStat* var_stat);
+
+    void print(ast::ReturnStat* return_stat);
+
+    void print(ast::Expr* expr);
+
+    // The overloads of expressions are the handlers of 'm_exprs', they schedule their
+    // operands instead of printing them.
+
+    void print(const ast::LitExpr::Value& value);
+
+    void print(ast::BinaryExpr* bexpr);
+
+    void print(ast::UnaryExpr* uexpr);
+
+    void print(ast::IdExpr* idexpr);
+
+    void print(ast::ArrayExpr* array_expr);
+
+    void print(ast::CallExpr* callexpr);
+
+    void print_dispatch(ast::FuncDecl* func);
+
+    // buffers holding a single value instead of an array are accessed through a pointer.
+    void print_binding(
+      const std::string& name,
+      types::Type* type,
+      bool writable,
+      types::Layout layout
+    );
+
+    // types are printed with the layout of the memory holding them, std430 but for uniforms.
+    void print_type_prefix(types::Type* type, types::Layout layout = types::Layout::kStd430);
+
+    void print_type_postfix(types::Type* type, types::Layout layout = types::Layout::kStd430);
+
+    // the element of an array, the whole element when it's padded to its stride.
+    void print_element_prefix(types::Array* array, types::Layout layout);
+
+    // adds the structs reached from 'type' that std140 lays out differently to 'm_std140',
+    // 'nested' when 'type' is a member or an element.
+    void lay_out_std140(types::Type* type, bool nested);
+
+    // layout of the memory holding the value of 'expr', std140 for what's read from uniforms.
+    types::Layout layout_of(ast::Expr* expr);
+
+    void indent();
+
+    void error(const std::string& err);
+
+    std::stringstream& out();
+
+    std::string m_namespace;
+    std::stringstream m_stream;
+    std::unordered_set<std::string, base::Hash<std::string>, std::equal_to<>> m_value_bindings;
+    std::unordered_set<std::string, base::Hash<std::string>, std::equal_to<>> m_uniforms;
+    std::unordered_set<types::Custom*> m_std140;
+    size_t m_indent_level;
+
+    // the global constants of the module being printed.
+    comptime::Bindings m_consts;
+
+    Traversal m_exprs;
+  };
+}
\ No newline at end of file
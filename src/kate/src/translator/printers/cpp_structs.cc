@@ -0,0 +1,170 @@
+#include "cpp_structs.h"
+#include "base/rtti.h"
+
+#include <fmt/format.h>
+
+namespace kate::tlr {
+  namespace {
+    const char* namespace_name(types::Layout layout)
+    {
+      switch (layout) {
+        case types::Layout::kStd140:
+          return "std140";
+        case types::Layout::kStd430:
+          return "std430";
+        default:
+          return "scalar";
+      }
+    }
+
+    const char* scalar_name(const std::string& name)
+    {
+      if (name == "half")
+        return "int16_t";
+      else if (name == "uhalf")
+        return "uint16_t";
+      else if (name == "int")
+        return "int32_t";
+      else if (name == "uint")
+        return "uint32_t";
+      else if (name == "double")
+        return "double";
+
+      return "float";
+    }
+  }
+
+  CppStructPrinter::CppStructPrinter(std::vector<types::Layout> layouts)
+    : m_layouts { std::move(layouts) }
+  {
+  }
+
+  void CppStructPrinter::print(ast::Module* module)
+  {
+    out() << "#pragma once\n\n";
+    out() << "#include <cstddef>\n";
+    out() << "#include <cstdint>\n\n";
+    out() << "namespace ksl {\n";
+
+    // elements of arrays whose stride is larger than the element itself.
+    out() << "  template<typename T, size_t Stride>\n";
+    out() << "  struct padded {\n";
+    out() << "    T value;\n";
+    out() << "    uint8_t pad[Stride - sizeof(T)];\n";
+    out() << "  };\n";
+
+    for (auto layout : m_layouts) {
+      out() << "\n  namespace " << namespace_name(layout) << " {\n";
+
+      size_t num_structs = 0;
+
+      for (auto& decl : module->global_declarations())
+        if (auto struct_ = decl->as<ast::StructDecl>()) {
+          if (num_structs++ > 0)
+            out() << "\n";
+
+          print(struct_->sem()->type()->as<types::Custom>(), layout);
+        }
+
+      out() << "  }\n";
+    }
+
+    out() << "}\n";
+  }
+
+  std::string CppStructPrinter::str() const
+  {
+    return m_stream.str();
+  }
+
+  std::stringstream& CppStructPrinter::out()
+  {
+    return m_stream;
+  }
+
+  void CppStructPrinter::print(types::Custom* custom, types::Layout layout)
+  {
+    auto& members = custom->members();
+
+    out() << fmt::format("    struct alignas({}) {} {{\n", custom->alignment(layout), custom->name());
+
+    uint64_t offset = 0;
+    size_t num_pads = 0;
+
+    for (size_t i = 0; i < members.size(); i++) {
+      auto ty = members[i].type();
+
+      if (auto array = ty->as<types::Array>(); array && array->count() == 0) {
+        out() << fmt::format("      // '{}' is unsized, its elements follow the struct.\n", members[i].name());
+        continue;
+      }
+
+      if (custom->offset(i, layout) > offset)
+        out() << fmt::format("      uint8_t _pad{}[{}];\n", num_pads++, custom->offset(i, layout) - offset);
+
+      auto cpp_ty = cpp_type(ty, layout);
+      out() << fmt::format("      {} {}{};\n", cpp_ty.prefix, members[i].name(), cpp_ty.postfix);
+
+      offset = custom->offset(i, layout) + ty->size(layout);
+    }
+
+    out() << "    };\n\n";
+
+    out() << fmt::format("    static_assert(sizeof({}) == {});\n", custom->name(), custom->size(layout));
+
+    for (size_t i = 0; i < members.size(); i++) {
+      if (auto array = members[i].type()->as<types::Array>(); array && array->count() == 0)
+        continue;
+
+      out() << fmt::format(
+        "    static_assert(offsetof({}, {}) == {});\n",
+        custom->name(),
+        members[i].name(),
+        custom->offset(i, layout)
+      );
+    }
+  }
+
+  CppStructPrinter::CppType CppStructPrinter::cpp_type(types::Type* type, types::Layout layout)
+  {
+    return base::Match(
+      type,
+      [&](types::Scalar* scalar) {
+        return CppType { scalar_name(scalar->mangledName()) };
+      },
+      [&](types::Vec* vec) {
+        return CppType {
+          scalar_name(vec->type()->mangledName()),
+          fmt::format("[{}]", vec->columns())
+        };
+      },
+      [&](types::Mat* mat) {
+        // columns may be padded, e.g. to 4 components for a float3x3.
+        return CppType {
+          scalar_name(mat->type()->mangledName()),
+          fmt::format("[{}][{}]", mat->columns(), mat->stride(layout) / mat->type()->size(layout))
+        };
+      },
+      [&](types::Array* array) {
+        auto element = cpp_type(array->type(), layout);
+
+        if (array->stride(layout) == array->type()->size(layout))
+          return CppType {
+            element.prefix,
+            fmt::format("[{}]{}", array->count(), element.postfix)
+          };
+
+        return CppType {
+          fmt::format("padded<{}{}, {}>", element.prefix, element.postfix, array->stride(layout)),
+          fmt::format("[{}]", array->count())
+        };
+      },
+      [&](types::Custom* custom) {
+        return CppType { custom->name() };
+      },
+      [&](base::Default) {
+        return CppType { "uint8_t", fmt::format("[{}]", type->size(layout)) };
+      }
+    );
+  }
+}
\ No newline at end of file
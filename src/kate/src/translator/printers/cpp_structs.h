@@ -0,0 +1,40 @@
+#pragma once
+
+#include "../ast.h"
+#include "../sem.h"
+#include "../types.h"
+
+#include <sstream>
+#include <vector>
+
+namespace kate::tlr {
+  // Prints C++ structs laid out like the structs of a module, with 'static_assert's on
+  // their sizes and member offsets, so data can be copied to gpu buffers as is.
+  //
+  // Each layout is printed in its own namespace: 'ksl::std140', 'ksl::std430' and 'ksl::scalar'.
+  class CppStructPrinter {
+  public:
+    CppStructPrinter(
+      std::vector<types::Layout> layouts = { types::Layout::kStd140, types::Layout::kStd430 }
+    );
+
+    void print(ast::Module* module);
+
+    std::string str() const;
+  private:
+    // a C++ type split around the declared name, e.g. 'float' and '[3]' for a float3.
+    struct CppType {
+      std::string prefix;
+      std::string postfix;
+    };
+
+    void print(types::Custom* custom, types::Layout layout);
+
+    CppType cpp_type(types::Type* type, types::Layout layout);
+
+    std::stringstream& out();
+
+    std::vector<types::Layout> m_layouts;
+    std::stringstream m_stream;
+  };
+}
\ No newline at end of file
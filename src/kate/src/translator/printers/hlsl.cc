@@ -0,0 +1,241 @@
+#include "hlsl.h"
+
+#include <fmt/format.h>
+
+#include <cstdlib>
+
+namespace kate::tlr {
+  namespace {
+    std::unordered_map<std::string, std::string> hlsl_type_names()
+    {
+      // 'half' is the signed 16-bit integer of ksl, hlsl reads it as a 16-bit float.
+      std::unordered_map<std::string, std::string> names = {
+        { "half", "int16_t" },
+        { "uhalf", "uint16_t" }
+      };
+
+      for (auto i = 2; i <= 4; i++) {
+        names[fmt::format("half{}", i)] = fmt::format("int16_t{}", i);
+        names[fmt::format("uhalf{}", i)] = fmt::format("uint16_t{}", i);
+
+        for (auto j = 2; j <= 4; j++) {
+          names[fmt::format("half{}x{}", i, j)] = fmt::format("int16_t{}x{}", i, j);
+          names[fmt::format("uhalf{}x{}", i, j)] = fmt::format("uint16_t{}x{}", i, j);
+        }
+      }
+
+      return names;
+    }
+
+    ast::Attr* find_attr(
+      ast::List<ast::Attr>& attrs,
+      ast::Attr::Type type
+    )
+    {
+      for (auto& attr : attrs)
+        if (attr->type() == type)
+          return attr.get();
+
+      return nullptr;
+    }
+
+    void error(const std::string& err)
+    {
+      fmt::println("{}", err);
+      std::exit(1);
+    }
+
+    // Value of the argument at 'index' of an attribute, std::nullopt when the attribute or
+    // the argument is missing. An argument which isn't an integer known at compile time is
+    // an error, rather than a default the shader didn't ask for.
+    std::optional<uint64_t> attr_value(ast::Attr* attr, const comptime::Bindings& consts, size_t index = 0)
+    {
+      if (!attr || attr->args().size() <= index)
+        return std::nullopt;
+
+      auto value = comptime::eval(attr->args()[index].get(), &consts);
+
+      if (!value || !(value->type & ast::LitExpr::Value::Type::kIntMask))
+        error("Attribute arguments must be integers known at compile time.");
+
+      return value->value.u64;
+    }
+
+    // ': register(t0, space1)' for '@group(1) @binding(0)', nothing when they are missing.
+    std::string register_of(ast::List<ast::Attr>& attrs, const comptime::Bindings& consts, char kind)
+    {
+      auto group = attr_value(find_attr(attrs, ast::Attr::Type::kGroup), consts);
+      auto binding = attr_value(find_attr(attrs, ast::Attr::Type::kBinding), consts);
+
+      if (!group || !binding)
+        return {};
+
+      return fmt::format(" : register({}{}, space{})", kind, binding.value(), group.value());
+    }
+
+    const std::unordered_map<std::string, std::string> kSemantics = {
+      { "global_invocation_id", "SV_DispatchThreadID" },
+      { "local_invocation_id", "SV_GroupThreadID" },
+      { "local_invocation_index", "SV_GroupIndex" },
+      { "workgroup_id", "SV_GroupID" },
+      { "position", "SV_Position" },
+      { "vertex_index", "SV_VertexID" },
+      { "instance_index", "SV_InstanceID" },
+      { "front_facing", "SV_IsFrontFace" }
+    };
+  }
+
+  HLSLDialect::HLSLDialect()
+    : Dialect { hlsl_type_names() }
+  {
+  }
+
+  void HLSLDialect::print_preamble(Sink& sink) const
+  {
+    sink.write("#pragma pack_matrix(row_major)\n\n");
+  }
+
+  void HLSLDialect::print(Sink& sink, ast::UniformDecl* uniform, const comptime::Bindings& consts) const
+  {
+    sink.write(fmt::format("cbuffer {}_block{} {{\n", uniform->name(), register_of(uniform->attributes(), consts, 'b')));
+    sink.indent();
+    sink.write(declare(uniform->sem()->type(), uniform->name()) + ";\n");
+    sink.dedent();
+    sink.write("};\n\n");
+  }
+
+  void HLSLDialect::print(Sink& sink, ast::BufferDecl* buffer, const comptime::Bindings& consts) const
+  {
+    auto type = buffer->sem()->type();
+
+    // buffers are indexed by element, a buffer of a single value has one element.
+    if (auto array = type->as<types::Array>())
+      type = array->type();
+
+    bool read_only = buffer->args().access_mode == ast::AccessMode::kRead;
+
+    sink.write(fmt::format(
+      "{}StructuredBuffer<{}> {}{};\n",
+      read_only ? "" : "RW",
+      type_name(type),
+      buffer->name(),
+      register_of(buffer->attributes(), consts, read_only ? 't' : 'u')
+    ));
+  }
+
+  void HLSLDialect::print_constructor(Sink& sink, ast::StructDecl* struct_) const
+  {
+    // hlsl has no constructors for structs, 'P(x, y)' calls 'make_P(x, y)' instead.
+    auto& members = struct_->members();
+
+    sink.write(fmt::format("\n{} make_{}(", struct_->name(), struct_->name()));
+
+    for (size_t i = 0; i < members.size(); i++)
+      sink.write(fmt::format("{}{}", i > 0 ? ", " : "", declare(members[i]->sem()->type(), fmt::format("member{}", i))));
+
+    sink.write(") {\n");
+    sink.indent();
+    sink.write(fmt::format("{} result;\n", struct_->name()));
+
+    for (size_t i = 0; i < members.size(); i++)
+      sink.write(fmt::format("result.{} = member{};\n", members[i]->name(), i));
+
+    sink.write("return result;\n");
+    sink.dedent();
+    sink.write("}\n");
+  }
+
+  std::string HLSLDialect::construct(
+    ast::CallExpr* call,
+    types::Type* type,
+    const std::vector<std::string>& args
+  ) const
+  {
+    if (type->is<types::Custom>())
+      return Dialect::construct(call, type, args).insert(0, "make_");
+
+    auto arg_type = call->args()[0]->sem()->type();
+
+    // a matrix from a scalar has it on its diagonal, as in glsl: the scalar spread over the
+    // matrix by the cast is multiplied by the identity, so it's evaluated once.
+    if (auto mat = type->as<types::Mat>(); mat && arg_type->is<types::Scalar>()) {
+      // hlsl matrices are the transpose of the ksl ones, the diagonal stays the same.
+      std::string identity;
+
+      for (size_t row = 0; row < mat->columns(); row++)
+        for (size_t column = 0; column < mat->rows(); column++)
+          identity += fmt::format("{}{}", identity.empty() ? "" : ", ", row == column ? 1 : 0);
+
+      auto name = type_name(type);
+
+      return fmt::format("(({})({}) * {}({}))", name, args[0], name, identity);
+    }
+
+    // hlsl has no constructors of vectors from one value, a cast spreads a scalar and
+    // converts a vector.
+    return fmt::format("(({})({}))", type_name(type), args[0]);
+  }
+
+  void HLSLDialect::print_attributes(Sink& sink, ast::FuncDecl* func, const comptime::Bindings& consts) const
+  {
+    if (!find_attr(func->attrs(), ast::Attr::Type::kCompute))
+      return;
+
+    // dimensions left out of '@workgroup_size' are 1.
+    auto workgroup_size = find_attr(func->attrs(), ast::Attr::Type::kWorkgroupSize);
+
+    sink.write(fmt::format(
+      "[numthreads({}, {}, {})]\n",
+      attr_value(workgroup_size, consts, 0).value_or(1),
+      attr_value(workgroup_size, consts, 1).value_or(1),
+      attr_value(workgroup_size, consts, 2).value_or(1)
+    ));
+  }
+
+  std::string HLSLDialect::semantic(ast::FuncArg* arg, const comptime::Bindings& consts) const
+  {
+    if (auto location = attr_value(find_attr(arg->attrs(), ast::Attr::Type::kLocation), consts))
+      return fmt::format(" : TEXCOORD{}", location.value());
+
+    auto builtin = find_attr(arg->attrs(), ast::Attr::Type::kBuiltin);
+
+    if (!builtin)
+      return {};
+
+    // '@builtin(name)' or just '@builtin' when the argument is named after it.
+    auto name = arg->name();
+
+    if (!builtin->args().empty())
+      if (auto id = builtin->args()[0]->as<ast::IdExpr>())
+        name = id->ident();
+
+    auto it = kSemantics.find(name);
+
+    return it != kSemantics.end() ? " : " + it->second : std::string();
+  }
+
+  std::string_view HLSLDialect::const_qualifier() const
+  {
+    return "static const ";
+  }
+
+  std::string HLSLDialect::matrix_product(
+    const std::string& lhs,
+    const std::string& rhs
+  ) const
+  {
+    return fmt::format("mul({}, {})", rhs, lhs);
+  }
+
+  const Dialect& hlsl()
+  {
+    static HLSLDialect dialect;
+
+    return dialect;
+  }
+
+  HLSLPrinter::HLSLPrinter(const comptime::Bindings* specialization)
+    : Printer { { &hlsl() }, specialization }
+  {
+  }
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "printer.h"
+
+namespace kate::tlr {
+  // HLSL for the d3d12 backend.
+  //
+  // Matrices keep their ksl names, so each one is the transpose of the glsl matrix: a
+  // 'float4x3' has 4 rows of 3 columns, products swap their operands and memory is read
+  // with 'row_major' packing, which makes the layout match std140 and std430.
+  class HLSLDialect : public Dialect {
+  public:
+    HLSLDialect();
+
+    void print_preamble(Sink& sink) const override;
+
+    void print(Sink& sink, ast::UniformDecl* uniform, const comptime::Bindings& consts) const override;
+
+    void print(Sink& sink, ast::BufferDecl* buffer, const comptime::Bindings& consts) const override;
+
+    void print_constructor(Sink& sink, ast::StructDecl* struct_) const override;
+
+    std::string construct(
+      ast::CallExpr* call,
+      types::Type* type,
+      const std::vector<std::string>& args
+    ) const override;
+
+    void print_attributes(Sink& sink, ast::FuncDecl* func, const comptime::Bindings& consts) const override;
+
+    std::string semantic(ast::FuncArg* arg, const comptime::Bindings& consts) const override;
+
+    std::string_view const_qualifier() const override;
+
+    std::string matrix_product(
+      const std::string& lhs,
+      const std::string& rhs
+    ) const override;
+  };
+
+  const Dialect& hlsl();
+
+  class HLSLPrinter : public Printer {
+  public:
+    HLSLPrinter(const comptime::Bindings* specialization = nullptr);
+  };
+}
\ No newline at end of file
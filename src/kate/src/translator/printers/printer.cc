@@ -0,0 +1,754 @@
+#include "printer.h"
+#include "base/rtti.h"
+#include "base/trace.h"
+
+#include <fmt/format.h>
+
+#include <cassert>
+#include <utility>
+
+namespace kate::tlr {
+  namespace {
+    std::string_view binary_operator(ast::BinaryExpr::Type type)
+    {
+      switch (type) {
+        case ast::BinaryExpr::Type::kAdd:
+          return " + ";
+        case ast::BinaryExpr::Type::KSub:
+          return " - ";
+        case ast::BinaryExpr::Type::kDiv:
+          return " / ";
+        case ast::BinaryExpr::Type::kMul:
+          return " * ";
+        case ast::BinaryExpr::Type::kMod:
+          return " % ";
+        case ast::BinaryExpr::Type::kMemberAccess:
+          return ".";
+        case ast::BinaryExpr::Type::kSwizzle:
+          return ".";
+        case ast::BinaryExpr::Type::kCompoundAdd:
+          return " += ";
+        case ast::BinaryExpr::Type::kCompoundSub:
+          return " -= ";
+        case ast::BinaryExpr::Type::kCompoundDiv:
+          return " /= ";
+        case ast::BinaryExpr::Type::kCompoundMul:
+          return " *= ";
+        case ast::BinaryExpr::Type::kCompoundMod:
+          return " %= ";
+        case ast::BinaryExpr::Type::kComma:
+          return ", ";
+        case ast::BinaryExpr::Type::kOrEqual:
+          return " |= ";
+        case ast::BinaryExpr::Type::kXorEqual:
+          return " ^= ";
+        case ast::BinaryExpr::Type::kAndEqual:
+          return " &= ";
+        case ast::BinaryExpr::Type::kRightShiftEqual:
+          return " >>= ";
+        case ast::BinaryExpr::Type::kLeftShiftEqual:
+          return " <<= ";
+        case ast::BinaryExpr::Type::kModulusEqual:
+          return " %= ";
+        case ast::BinaryExpr::Type::kDivideEqual:
+          return " /= ";
+        case ast::BinaryExpr::Type::kMultiplyEqual:
+          return " *= ";
+        case ast::BinaryExpr::Type::kSubtractEqual:
+          return " -= ";
+        case ast::BinaryExpr::Type::kAddEqual:
+          return " += ";
+        case ast::BinaryExpr::Type::kEqual:
+          return " = ";
+        case ast::BinaryExpr::Type::kOrOr:
+          return " || ";
+        case ast::BinaryExpr::Type::kAndAnd:
+          return " && ";
+        case ast::BinaryExpr::Type::kBitOr:
+          return " | ";
+        case ast::BinaryExpr::Type::kBitXor:
+          return " ^ ";
+        case ast::BinaryExpr::Type::kBitAnd:
+          return " & ";
+        case ast::BinaryExpr::Type::kEqualEqual:
+          return " == ";
+        case ast::BinaryExpr::Type::kNotEqual:
+          return " != ";
+        case ast::BinaryExpr::Type::kGreaterThan:
+          return " > ";
+        case ast::BinaryExpr::Type::kGreaterThanEqual:
+          return " >= ";
+        case ast::BinaryExpr::Type::kLessThan:
+          return " < ";
+        case ast::BinaryExpr::Type::kLessThanEqual:
+          return " <= ";
+        case ast::BinaryExpr::Type::kLeftShift:
+          return " << ";
+        case ast::BinaryExpr::Type::kRightShift:
+          return " >> ";
+        case ast::BinaryExpr::Type::kSubtract:
+          return " - ";
+        case ast::BinaryExpr::Type::kMultiply:
+          return " * ";
+        case ast::BinaryExpr::Type::kDivide:
+          return " / ";
+        case ast::BinaryExpr::Type::kModulus:
+          return " % ";
+        case ast::BinaryExpr::Type::kIncrement:
+          return "++";
+        case ast::BinaryExpr::Type::kDecrement:
+          return "--";
+        case ast::BinaryExpr::Type::kIndexAccessor:
+          return "[";
+        default:
+          assert(false);
+          return {};
+      }
+    }
+  }
+
+  Sink::Sink()
+    : m_depth { 0 },
+      m_line_start { true }
+  {
+  }
+
+  void Sink::write(std::string_view str)
+  {
+    while (!str.empty()) {
+      auto newline = str.find('\n');
+      auto line = str.substr(0, newline);
+
+      if (m_line_start && !line.empty())
+        m_buffer.append(m_depth * 2, ' ');
+
+      m_buffer += line;
+
+      if (newline == std::string_view::npos) {
+        m_line_start = m_line_start && line.empty();
+        return;
+      }
+
+      m_buffer += '\n';
+      m_line_start = true;
+
+      str.remove_prefix(newline + 1);
+    }
+  }
+
+  void Sink::indent()
+  {
+    m_depth++;
+  }
+
+  void Sink::dedent()
+  {
+    assert(m_depth > 0);
+    m_depth--;
+  }
+
+  const std::string& Sink::str() const
+  {
+    return m_buffer;
+  }
+
+  Dialect::Dialect(std::unordered_map<std::string, std::string>&& type_names)
+  {
+    for (auto& [name, type_name] : type_names)
+      m_type_names.try_emplace(name, std::move(type_name));
+  }
+
+  std::string_view Dialect::type_name(std::string_view name) const
+  {
+    auto it = m_type_names.find(name);
+
+    return it != m_type_names.end() ? it->second : name;
+  }
+
+  std::string Dialect::declare(types::Type* type, const std::string& name) const
+  {
+    std::string postfix;
+
+    while (auto array = type->as<types::Array>()) {
+      postfix += array->count() ? fmt::format("[{}]", array->count()) : "[]";
+      type = array->type();
+    }
+
+    return type_name(type) + " " + name + postfix;
+  }
+
+  std::string Dialect::type_name(types::Type* type) const
+  {
+    while (auto array = type->as<types::Array>())
+      type = array->type();
+
+    // the mangled name of a matrix puts its rows first, ksl names put its columns first.
+    if (auto mat = type->as<types::Mat>())
+      return std::string(type_name(fmt::format("{}{}x{}", mat->type()->mangledName(), mat->columns(), mat->rows())));
+
+    return std::string(type_name(type->mangledName()));
+  }
+
+  std::string Dialect::construct(
+    ast::CallExpr* call,
+    types::Type* type,
+    const std::vector<std::string>& args
+  ) const
+  {
+    std::string str = fmt::format("{}(", type_name(call->id()->ident()));
+
+    for (size_t i = 0; i < args.size(); i++) {
+      if (i > 0) str += ", ";
+      str += args[i];
+    }
+
+    return str + ")";
+  }
+
+  Printer::Printer(
+    std::vector<const Dialect*>&& dialects,
+    const comptime::Bindings* specialization
+  ) : m_specialization { specialization }
+  {
+    for (auto dialect : dialects)
+      m_targets.push_back(Target { dialect, Sink() });
+
+    m_exprs.pre<ast::BinaryExpr>([this](ast::BinaryExpr* expr) { print(expr); return false; });
+    m_exprs.pre<ast::UnaryExpr>([this](ast::UnaryExpr* expr) { print(expr); return false; });
+    m_exprs.pre<ast::IdExpr>([this](ast::IdExpr* expr) { print(expr); return false; });
+    m_exprs.pre<ast::CallExpr>([this](ast::CallExpr* expr) { print(expr); return false; });
+    m_exprs.pre<ast::LitExpr>([this](ast::LitExpr* expr) { print(expr); return false; });
+    m_exprs.pre<ast::TypeId>([this](ast::TypeId* expr) { print(expr); return false; });
+    m_exprs.pre<ast::ArrayType>([this](ast::ArrayType* expr) { print(expr); return false; });
+    m_exprs.pre<ast::ArrayExpr>([this](ast::ArrayExpr* expr) { print(expr); return false; });
+
+    m_exprs.pre<ast::Expr>([](ast::Expr* expr) {
+      assert(false);
+      return false;
+    });
+  }
+
+  void Printer::print(ast::Module* module)
+  {
+    TS_TRACE_ZONE("print");
+
+    m_consts = comptime::consts(module, m_specialization);
+
+    for (auto& target : m_targets)
+      target.dialect->print_preamble(target.sink);
+
+    for (auto& decl : module->global_declarations()) {
+      base::Match(
+        decl.get(),
+        [&](ast::StructDecl* struct_) {
+          print(struct_);
+        },
+        [&](ast::BufferDecl* buffer) {
+          print(buffer);
+        },
+        [&](ast::FuncDecl* func_decl) {
+          print(func_decl);
+        },
+        [&](ast::VarDecl* var_decl) {
+          print(var_decl->type().get());
+        },
+        [&](ast::UniformDecl* uniform_decl) {
+          print(uniform_decl);
+        },
+        [&](ast::ConstDecl* const_decl) {
+          print(const_decl);
+        },
+        [&](base::Default) {
+          assert(false);
+        }
+      );
+
+      write("\n");
+    }
+  }
+
+  std::string Printer::str(size_t index) const
+  {
+    return m_targets[index].sink.str();
+  }
+
+  void Printer::write(std::string_view str)
+  {
+    for (auto& target : m_targets)
+      target.sink.write(str);
+  }
+
+  std::vector<std::string> Printer::capture(const std::function<void()>& fn)
+  {
+    std::vector<Sink> sinks;
+
+    for (auto& target : m_targets)
+      sinks.push_back(std::exchange(target.sink, Sink()));
+
+    fn();
+
+    std::vector<std::string> result;
+
+    for (size_t i = 0; i < m_targets.size(); i++) {
+      result.push_back(m_targets[i].sink.str());
+      m_targets[i].sink = std::move(sinks[i]);
+    }
+
+    return result;
+  }
+
+  void Printer::indent()
+  {
+    for (auto& target : m_targets)
+      target.sink.indent();
+  }
+
+  void Printer::dedent()
+  {
+    for (auto& target : m_targets)
+      target.sink.dedent();
+  }
+
+  void Printer::print_type_name(std::string_view name)
+  {
+    for (auto& target : m_targets)
+      target.sink.write(target.dialect->type_name(name));
+  }
+
+  void Printer::declare(types::Type* type, const std::string& name)
+  {
+    for (auto& target : m_targets)
+      target.sink.write(target.dialect->declare(type, name));
+  }
+
+  void Printer::print(ast::UniformDecl* uniform)
+  {
+    for (auto& target : m_targets)
+      target.dialect->print(target.sink, uniform, m_consts);
+  }
+
+  void Printer::print(ast::BufferDecl* buffer)
+  {
+    for (auto& target : m_targets)
+      target.dialect->print(target.sink, buffer, m_consts);
+  }
+
+  void Printer::print(ast::ConstDecl* const_decl)
+  {
+    for (auto& target : m_targets)
+      target.sink.write(target.dialect->const_qualifier());
+
+    declare(const_decl->sem()->type(), const_decl->name());
+    write(" = ");
+
+    const ast::LitExpr::Value* specialized_value = nullptr;
+
+    if (m_specialization)
+      if (auto it = m_specialization->find(const_decl->name()); it != m_specialization->end())
+        specialized_value = &it->second;
+
+    if (specialized_value)
+      print(*specialized_value);
+    else
+      print(const_decl->expr().get());
+
+    write(";\n");
+  }
+
+  void Printer::print(ast::StructDecl* struct_)
+  {
+    write(fmt::format("struct {} {{\n", struct_->name()));
+    indent();
+
+    for (auto& m : struct_->members()) {
+      declare(m->sem()->type(), m->name());
+      write(";\n");
+    }
+
+    dedent();
+    write("};\n");
+
+    for (auto& target : m_targets)
+      target.dialect->print_constructor(target.sink, struct_);
+  }
+
+  void Printer::print(ast::FuncDecl* func)
+  {
+    for (auto& target : m_targets)
+      target.dialect->print_attributes(target.sink, func, m_consts);
+
+    print(func->type().get());
+    write(fmt::format(" {}(", func->name()));
+
+    for (size_t i = 0; i < func->args().size(); i++) {
+      if (i > 0) write(", ");
+
+      print(func->args()[i].get());
+    }
+
+    write(") ");
+
+    print(func->block().get());
+  }
+
+  void Printer::print(ast::FuncArg* func_arg)
+  {
+    declare(func_arg->type()->sem()->type(), func_arg->name());
+
+    for (auto& target : m_targets)
+      target.sink.write(target.dialect->semantic(func_arg, m_consts));
+  }
+
+  void Printer::print(ast::BlockStat* block)
+  {
+    write("{\n");
+    indent();
+
+    for (auto& stat : block->stats())
+      print(stat.get());
+
+    dedent();
+    write("}\n");
+  }
+
+  void Printer::print(ast::IfStat* if_stat)
+  {
+    // when printing a variant, only the branch taken with its constants is printed.
+    if (m_specialization) {
+      if (auto cond = comptime::eval(if_stat->condition().get(), m_specialization)) {
+        bool taken = (cond->type & ast::LitExpr::Value::Type::kFloatMask) ?
+          cond->value.f64 != 0.0 : cond->value.u64 != 0;
+
+        if (taken)
+          print(if_stat->block().get());
+        else if (if_stat->elseBlock())
+          print(if_stat->elseBlock().get());
+
+        return;
+      }
+    }
+
+    write("if (");
+    print(if_stat->condition().get());
+    write(") ");
+    print(if_stat->block().get());
+
+    if (if_stat->elseBlock()) {
+      write("else ");
+      print(if_stat->elseBlock().get());
+    }
+  }
+
+  void Printer::print(ast::ForStat* for_stat)
+  {
+    write("for (");
+
+    base::Match(
+      for_stat->initializer().get(),
+      [&](ast::VarStat* var_stat) {
+        print_var(var_stat);
+      },
+      [&](ast::ExprStat* expr_stat) {
+        print(expr_stat->expr().get());
+      },
+      [&](base::Default) {
+        assert(false);
+      }
+    );
+
+    write("; ");
+    print(for_stat->condition().get());
+    write("; ");
+    print(for_stat->continuing()->expr().get());
+    write(") ");
+    print(for_stat->block().get());
+  }
+
+  void Printer::print(ast::VarStat* var_stat)
+  {
+    print_var(var_stat);
+    write(";\n");
+  }
+
+  void Printer::print_var(ast::VarStat* var_stat)
+  {
+    declare(var_stat->decl()->sem()->type(), var_stat->decl()->name());
+
+    if (var_stat->expr()) {
+      write(" = ");
+
+      print(var_stat->expr().get());
+    }
+  }
+
+  void Printer::print(ast::ExprStat* expr_stat)
+  {
+    print(expr_stat->expr().get());
+    write(";\n");
+  }
+
+  void Printer::print(ast::BreakStat* break_stat)
+  {
+    write("break;\n");
+  }
+
+  void Printer::print(ast::WhileStat* while_stat)
+  {
+    write("while (");
+    print(while_stat->condition().get());
+    write(") ");
+    print(while_stat->block().get());
+  }
+
+  void Printer::print(ast::ReturnStat* return_stat)
+  {
+    write("return");
+
+    if (return_stat->expr()) {
+      write(" ");
+      print(return_stat->expr().get());
+    }
+
+    write(";\n");
+  }
+
+  void Printer::print(ast::Type* type)
+  {
+    base::Match(
+      type,
+      [&](ast::ArrayType* arrayType) {
+        print(arrayType);
+      },
+      [&](ast::TypeId* typeId) {
+        print(typeId);
+      },
+      [&](base::Default) {
+        assert(false);
+      }
+    );
+  }
+
+  void Printer::print(ast::Stat* stat)
+  {
+    base::Match(
+      stat,
+      [&](ast::IfStat* stat) {
+        print(stat);
+      },
+      [&](ast::ForStat* for_stat) {
+        print(for_stat);
+      },
+      [&](ast::BlockStat* block_stat) {
+        print(block_stat);
+      },
+      [&](ast::VarStat* var_stat) {
+        print(var_stat);
+      },
+      [&](ast::ExprStat* expr_stat) {
+        print(expr_stat);
+      },
+      [&](ast::BreakStat* break_stat) {
+        print(break_stat);
+      },
+      [&](ast::WhileStat* while_stat) {
+        print(while_stat);
+      },
+      [&](ast::ReturnStat* return_stat) {
+        print(return_stat);
+      },
+      [](base::Default) {
+        assert(false);
+      }
+    );
+  }
+
+  void Printer::print(ast::Expr* expr)
+  {
+    m_exprs.run(expr);
+  }
+
+  bool Printer::fold(ast::Expr* expr)
+  {
+    // fold expressions depending on the constants of the variant being printed.
+    if (!m_specialization)
+      return false;
+
+    auto value = comptime::eval(expr, m_specialization);
+
+    if (value)
+      print(value.value());
+
+    return value.has_value();
+  }
+
+  void Printer::print(ast::LitExpr* lit)
+  {
+    print(lit->value());
+  }
+
+  void Printer::print(const ast::LitExpr::Value& v)
+  {
+    if (v.type & ast::LitExpr::Value::Type::kFloatMask)
+      write(fmt::format("{}", v.value.f64));
+    else if (v.type & ast::LitExpr::Value::Type::kSignedIntMask)
+      write(fmt::format("{}", v.value.i64));
+    else if (v.type & ast::LitExpr::Value::Type::kUnsignedIntMask)
+      write(fmt::format("{}", v.value.u64));
+    else
+      assert(false);
+  }
+
+  void Printer::print(ast::BinaryExpr* bexpr)
+  {
+    if (fold(bexpr))
+      return;
+
+    auto lhs_type = bexpr->lhs()->sem() ? bexpr->lhs()->sem()->type() : nullptr;
+
+    if (lhs_type && lhs_type->is<types::Mat>())
+      switch (bexpr->type()) {
+        case ast::BinaryExpr::Type::kMul:
+        case ast::BinaryExpr::Type::kMultiply:
+        case ast::BinaryExpr::Type::kCompoundMul:
+        case ast::BinaryExpr::Type::kMultiplyEqual:
+          print_matrix_product(bexpr);
+          return;
+        default:
+          break;
+      }
+
+    m_exprs.visit(bexpr->lhs().get());
+    m_exprs.then([this, bexpr]() { write(binary_operator(bexpr->type())); });
+
+    // members are printed as they are, even if a constant shares their name.
+    if (bexpr->type() == ast::BinaryExpr::Type::kMemberAccess ||
+        bexpr->type() == ast::BinaryExpr::Type::kSwizzle)
+      m_exprs.then([this, bexpr]() { write(bexpr->rhs()->as<ast::IdExpr>()->ident()); });
+    else
+      m_exprs.visit(bexpr->rhs().get());
+
+    if (bexpr->type() == ast::BinaryExpr::Type::kIndexAccessor)
+      m_exprs.then([this]() { write("]"); });
+  }
+
+  void Printer::print_matrix_product(ast::BinaryExpr* bexpr)
+  {
+    auto lhs = capture([&]() { print(bexpr->lhs().get()); });
+    auto rhs = capture([&]() { print(bexpr->rhs().get()); });
+
+    bool assign = bexpr->type() == ast::BinaryExpr::Type::kCompoundMul ||
+      bexpr->type() == ast::BinaryExpr::Type::kMultiplyEqual;
+
+    // 'a *= b' is printed as 'a = a * b', languages without a product operator need a call.
+    for (size_t i = 0; i < m_targets.size(); i++) {
+      auto& target = m_targets[i];
+
+      if (assign)
+        target.sink.write(lhs[i] + " = ");
+
+      target.sink.write(target.dialect->matrix_product(lhs[i], rhs[i]));
+    }
+  }
+
+  void Printer::print_constructor(ast::CallExpr* callexpr, types::Type* type)
+  {
+    // the printed arguments of each target.
+    std::vector<std::vector<std::string>> args(m_targets.size());
+
+    for (auto& arg : callexpr->args()) {
+      auto printed = capture([&]() { print(arg.get()); });
+
+      for (size_t i = 0; i < m_targets.size(); i++)
+        args[i].push_back(std::move(printed[i]));
+    }
+
+    for (size_t i = 0; i < m_targets.size(); i++)
+      m_targets[i].sink.write(m_targets[i].dialect->construct(callexpr, type, args[i]));
+  }
+
+  void Printer::print(ast::UnaryExpr* uexpr)
+  {
+    if (fold(uexpr))
+      return;
+
+    switch (uexpr->type()) {
+      case ast::UnaryExpr::Type::kFlip:
+        write("~");
+        break;
+      case ast::UnaryExpr::Type::kMinus:
+        write("-");
+        break;
+      case ast::UnaryExpr::Type::kNot:
+        write("!");
+        break;
+      case ast::UnaryExpr::Type::kPlus:
+        write("+");
+        break;
+    }
+
+    m_exprs.visit(uexpr->operand().get());
+  }
+
+  void Printer::print(ast::ArrayExpr* array_expr)
+  {
+    write("{ ");
+
+    auto& items = array_expr->items();
+
+    for (size_t i = 0; i < items.size(); i++) {
+      if (i > 0) m_exprs.then([this]() { write(", "); });
+
+      m_exprs.visit(items[i].get());
+    }
+
+    m_exprs.then([this]() { write(" }"); });
+  }
+
+  void Printer::print(ast::IdExpr* idexpr)
+  {
+    if (fold(idexpr))
+      return;
+
+    write(idexpr->ident());
+  }
+
+  void Printer::print(ast::CallExpr* callexpr)
+  {
+    if (types::system().findType(callexpr->id()->ident()) && callexpr->sem()) {
+      auto type = callexpr->sem()->type();
+      bool from_one = callexpr->args().size() == 1 && (type->is<types::Vec>() || type->is<types::Mat>());
+
+      if (type->is<types::Custom>() || from_one) {
+        print_constructor(callexpr, type);
+        return;
+      }
+    }
+
+    print_type_name(callexpr->id()->ident());
+    write("(");
+
+    auto& args = callexpr->args();
+
+    for (size_t i = 0; i < args.size(); i++) {
+      if (i > 0) m_exprs.then([this]() { write(", "); });
+
+      m_exprs.visit(args[i].get());
+    }
+
+    m_exprs.then([this]() { write(")"); });
+  }
+
+  void Printer::print(ast::ArrayType* array_type)
+  {
+    print(array_type->type().get());
+    write("[");
+    if (auto& size_expr = array_type->arraySizeExpr(); size_expr)
+      print(size_expr.get());
+    write("]");
+  }
+
+  void Printer::print(ast::TypeId* type_id)
+  {
+    print_type_name(type_id->id());
+  }
+}
\ No newline at end of file
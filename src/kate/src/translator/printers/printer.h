@@ -0,0 +1,206 @@
+#pragma once
+
+#include "../ast.h"
+#include "../sem.h"
+#include "../types.h"
+#include "../comptime.h"
+#include "../passes/traverse.h"
+
+#include "base/hash_map.h"
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace kate::tlr {
+  // Buffered output of a target, lines are indented by the depth of the block being printed.
+  class Sink {
+  public:
+    Sink();
+
+    void write(std::string_view str);
+
+    void indent();
+
+    void dedent();
+
+    const std::string& str() const;
+  private:
+    std::string m_buffer;
+    size_t m_depth;
+    bool m_line_start;
+  };
+
+  // What sets a shading language apart, 'Printer' only asks the dialect where targets differ.
+  class Dialect {
+  public:
+    Dialect(std::unordered_map<std::string, std::string>&& type_names);
+
+    virtual ~Dialect() = default;
+
+    // name of a ksl type or constructor, names without an entry are printed as they are.
+    std::string_view type_name(std::string_view name) const;
+
+    // name of a resolved type without its array dimensions.
+    std::string type_name(types::Type* type) const;
+
+    // declaration of a variable, e.g. 'vec3 normals[4]' for a 'float3[4]' in glsl.
+    std::string declare(types::Type* type, const std::string& name) const;
+
+    // printed once before the declarations of the module.
+    virtual void print_preamble(Sink& sink) const {}
+
+    // 'consts' holds the values of the global constants, which attributes may use.
+    virtual void print(Sink& sink, ast::UniformDecl* uniform, const comptime::Bindings& consts) const = 0;
+
+    virtual void print(Sink& sink, ast::BufferDecl* buffer, const comptime::Bindings& consts) const = 0;
+
+    // printed after a struct, e.g. a function building it where the language has no
+    // constructors for structs.
+    virtual void print_constructor(Sink& sink, ast::StructDecl* struct_) const {}
+
+    // A constructor of 'type' called with the printed 'args', 'name(args)' by default. Only
+    // constructors of structs and those of vectors and matrices from one argument, which
+    // languages don't agree on, are asked to the dialect.
+    virtual std::string construct(
+      ast::CallExpr* call,
+      types::Type* type,
+      const std::vector<std::string>& args
+    ) const;
+
+    // printed before the signature of a function, e.g. attributes of entry points.
+    virtual void print_attributes(Sink& sink, ast::FuncDecl* func, const comptime::Bindings& consts) const {}
+
+    // printed after a function argument, e.g. the semantic of a builtin.
+    virtual std::string semantic(ast::FuncArg* arg, const comptime::Bindings& consts) const { return {}; }
+
+    virtual std::string_view const_qualifier() const = 0;
+
+    // product of two matrices from their printed operands.
+    virtual std::string matrix_product(
+      const std::string& lhs,
+      const std::string& rhs
+    ) const = 0;
+  private:
+    base::HashMap<std::string, std::string> m_type_names;
+  };
+
+  // Prints a resolved module as source code of one or more shading languages.
+  //
+  // The tree is walked once whatever the number of dialects, text shared by all of them
+  // is formatted once and appended to the sink of each target, the rest is asked to their
+  // dialect, so printing glsl and hlsl together costs little more than printing one of them.
+  class Printer {
+  public:
+    // 'specialization' holds the values of the constants of the variant being printed,
+    // branches that can't be taken with them are not printed.
+    Printer(
+      std::vector<const Dialect*>&& dialects,
+      const comptime::Bindings* specialization = nullptr
+    );
+
+    Printer(const Printer&) = delete;
+
+    void print(ast::Module* module);
+
+    // output of the dialect at 'index' in the order given to the constructor.
+    std::string str(size_t index = 0) const;
+  private:
+    struct Target {
+      const Dialect* dialect;
+      Sink sink;
+    };
+
+    void print(ast::UniformDecl* uniform);
+
+    void print(ast::ConstDecl* const_decl);
+
+    void print(ast::StructDecl* struct_);
+
+    void print(ast::FuncDecl* func);
+
+    void print(ast::FuncArg* func_arg);
+
+    void print(ast::BufferDecl* buffer);
+
+    void print(ast::BlockStat* block);
+
+    void print(ast::Stat* stat);
+
+    void print(ast::IfStat* if_stat);
+
+    void print(ast::ForStat* for_stat);
+
+    void print(ast::VarStat* var_stat);
+
+    void print(ast::ExprStat* expr_stat);
+
+    void print(ast::BreakStat* break_stat);
+
+    void print(ast::WhileStat* while_stat);
+
+    void print(ast::ReturnStat* return_stat);
+
+    void print(ast::Type* type);
+
+    void print(ast::Expr* expr);
+
+    // prints the value of 'expr' when it only depends on the constants of the variant.
+    bool fold(ast::Expr* expr);
+
+    // The overloads of expressions are the handlers of 'm_exprs', they schedule their
+    // operands instead of printing them.
+
+    void print(ast::LitExpr* lit);
+
+    void print(const ast::LitExpr::Value& value);
+
+    void print(ast::BinaryExpr* bexpr);
+
+    void print(ast::UnaryExpr* uexpr);
+
+    void print(ast::IdExpr* idexpr);
+
+    void print(ast::ArrayExpr* array_expr);
+
+    void print(ast::CallExpr* callexpr);
+
+    void print(ast::ArrayType* array_type);
+
+    void print(ast::TypeId* type_id);
+
+    // prints a variable without the ';', so it also fits the initializer of a 'for'.
+    void print_var(ast::VarStat* var_stat);
+
+    void print_matrix_product(ast::BinaryExpr* bexpr);
+
+    // a call to a constructor the dialects print their own way, see 'Dialect::construct'.
+    void print_constructor(ast::CallExpr* callexpr, types::Type* type);
+
+    // a ksl type name, translated by the dialect of each target.
+    void print_type_name(std::string_view name);
+
+    void declare(types::Type* type, const std::string& name);
+
+    // appends the same text to every target.
+    void write(std::string_view str);
+
+    // runs 'fn' with empty sinks and returns what it printed for each target.
+    std::vector<std::string> capture(const std::function<void()>& fn);
+
+    void indent();
+
+    void dedent();
+
+    const comptime::Bindings* m_specialization;
+
+    // the global constants of the module being printed, with the values of the variant.
+    comptime::Bindings m_consts;
+
+    std::vector<Target> m_targets;
+
+    Traversal m_exprs;
+  };
+}
\ No newline at end of file
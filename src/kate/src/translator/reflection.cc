@@ -0,0 +1,448 @@
+#include "reflection.h"
+#include "comptime.h"
+#include "sem.h"
+
+#include "base/trace.h"
+
+#include <fmt/format.h>
+
+namespace kate::tlr {
+  namespace {
+    constexpr uint32_t kVersion = 1;
+    constexpr uint32_t kNoLocation = 0xffffffff;
+
+    ast::Attr* find_attr(
+      ast::List<ast::Attr>& attrs,
+      ast::Attr::Type type
+    )
+    {
+      for (auto& attr : attrs)
+        if (attr->type() == type)
+          return attr.get();
+
+      return nullptr;
+    }
+
+    template<typename T>
+    void write(std::vector<uint8_t>& out, T value)
+    {
+      for (size_t i = 0; i < sizeof(T); i++)
+        out.push_back(static_cast<uint8_t>(static_cast<uint64_t>(value) >> (i * 8)));
+    }
+
+    void write(std::vector<uint8_t>& out, const std::string& str)
+    {
+      write<uint32_t>(out, str.size());
+      out.insert(out.end(), str.begin(), str.end());
+    }
+
+    const char* to_string(Reflection::ResourceKind kind)
+    {
+      switch (kind) {
+        case Reflection::ResourceKind::kUniformBuffer:
+          return "uniform";
+        case Reflection::ResourceKind::kStorageBuffer:
+          return "storage";
+      }
+
+      return "";
+    }
+
+    const char* to_string(ast::AccessMode access_mode)
+    {
+      switch (access_mode) {
+        case ast::AccessMode::kRead:
+          return "read";
+        case ast::AccessMode::kWrite:
+          return "write";
+        default:
+          return "read_write";
+      }
+    }
+
+    const char* to_string(types::Layout layout)
+    {
+      switch (layout) {
+        case types::Layout::kStd140:
+          return "std140";
+        case types::Layout::kStd430:
+          return "std430";
+        default:
+          return "scalar";
+      }
+    }
+
+    const char* to_string(Reflection::Stage stage)
+    {
+      switch (stage) {
+        case Reflection::Stage::kVertex:
+          return "vertex";
+        case Reflection::Stage::kFragment:
+          return "fragment";
+        case Reflection::Stage::kCompute:
+          return "compute";
+      }
+
+      return "";
+    }
+
+    std::string to_json(const std::vector<Reflection::Variable>& variables)
+    {
+      std::string json;
+
+      for (auto& var : variables) {
+        json += json.empty() ? "\n" : ",\n";
+        json += fmt::format(R"(        {{ "name": "{}", "type": "{}", )", var.name, var.type);
+
+        if (var.location)
+          json += fmt::format(R"("location": {} }})", var.location.value());
+        else
+          json += fmt::format(R"("builtin": "{}" }})", var.builtin);
+      }
+
+      return json.empty() ? "[]" : "[" + json + "\n      ]";
+    }
+  }
+
+  Reflector::Reflector(ast::Module* module)
+    : m_module { module },
+      m_consts { comptime::consts(module) }
+  {
+  }
+
+  Reflection Reflector::reflect()
+  {
+    TS_TRACE_ZONE("reflect");
+
+    Reflection reflection;
+
+    for (auto& decl : m_module->global_declarations()) {
+      base::Match(
+        decl.get(),
+        [&](ast::BufferDecl* buffer) {
+          auto binding = reflect(
+            buffer->name(),
+            buffer->type()->sem()->type(),
+            types::Layout::kStd430,
+            buffer->attributes()
+          );
+
+          binding.kind = Reflection::ResourceKind::kStorageBuffer;
+          binding.access_mode = buffer->args().access_mode;
+
+          reflection.bindings.push_back(std::move(binding));
+        },
+        [&](ast::UniformDecl* uniform) {
+          auto binding = reflect(
+            uniform->name(),
+            uniform->type()->sem()->type(),
+            types::Layout::kStd140,
+            uniform->attributes()
+          );
+
+          binding.kind = Reflection::ResourceKind::kUniformBuffer;
+          binding.access_mode = ast::AccessMode::kRead;
+
+          reflection.bindings.push_back(std::move(binding));
+        },
+        [&](ast::FuncDecl* func) {
+          if (auto entry_point = reflect(func))
+            reflection.entry_points.push_back(std::move(entry_point.value()));
+        },
+        [&](base::Default) {}
+      );
+    }
+
+    return reflection;
+  }
+
+  Reflection::Binding Reflector::reflect(
+    const std::string& name,
+    types::Type* type,
+    types::Layout layout,
+    ast::List<ast::Attr>& attrs
+  )
+  {
+    auto group = find_attr(attrs, ast::Attr::Type::kGroup);
+    auto binding = find_attr(attrs, ast::Attr::Type::kBinding);
+
+    if (!group || !binding)
+      error(fmt::format("Resource '{}' is missing a '@group' or '@binding' attribute.", name));
+
+    Reflection::Binding result {
+      .name = name,
+      .type = type->mangledName(),
+      .group = attr_value(group, 0),
+      .binding = attr_value(binding, 0),
+      .layout = layout,
+      .size = type->size(layout),
+      .stride = 0
+    };
+
+    auto element = type;
+
+    if (auto array = type->as<types::Array>()) {
+      result.stride = array->stride(layout);
+      element = array->type();
+    }
+
+    if (auto custom = element->as<types::Custom>()) {
+      auto& members = custom->members();
+
+      for (size_t i = 0; i < members.size(); i++)
+        result.members.push_back(
+          Reflection::Member {
+            .name = members[i].name(),
+            .type = members[i].type()->mangledName(),
+            .offset = custom->offset(i, layout),
+            .size = members[i].type()->size(layout)
+          }
+        );
+    }
+
+    return result;
+  }
+
+  std::optional<Reflection::EntryPoint> Reflector::reflect(ast::FuncDecl* func)
+  {
+    Reflection::EntryPoint entry_point { .name = func->name() };
+
+    if (find_attr(func->attrs(), ast::Attr::Type::kVertex))
+      entry_point.stage = Reflection::Stage::kVertex;
+    else if (find_attr(func->attrs(), ast::Attr::Type::kFragment))
+      entry_point.stage = Reflection::Stage::kFragment;
+    else if (find_attr(func->attrs(), ast::Attr::Type::kCompute))
+      entry_point.stage = Reflection::Stage::kCompute;
+    else
+      return std::nullopt;
+
+    if (auto workgroup_size = find_attr(func->attrs(), ast::Attr::Type::kWorkgroupSize))
+      for (size_t i = 0; i < entry_point.workgroup_size.size(); i++)
+        entry_point.workgroup_size[i] = attr_value(workgroup_size, i, 1);
+
+    for (auto& arg : func->args())
+      reflect(
+        entry_point.inputs,
+        arg->name(),
+        arg->type()->sem()->type(),
+        arg->attrs()
+      );
+
+    if (auto type = func->type()->sem())
+      reflect(entry_point.outputs, "", type->type(), func->attrs());
+
+    return entry_point;
+  }
+
+  void Reflector::reflect(
+    std::vector<Reflection::Variable>& variables,
+    const std::string& name,
+    types::Type* type,
+    ast::List<ast::Attr>& attrs
+  )
+  {
+    if (!type)
+      return;
+
+    if (auto location = find_attr(attrs, ast::Attr::Type::kLocation)) {
+      variables.push_back(
+        Reflection::Variable {
+          .name = name,
+          .type = type->mangledName(),
+          .location = attr_value(location, 0)
+        }
+      );
+    } else if (auto builtin = find_attr(attrs, ast::Attr::Type::kBuiltin)) {
+      // '@builtin(name)' or just '@builtin' when the variable is named after it.
+      auto builtin_name = name;
+
+      if (!builtin->args().empty())
+        if (auto id = builtin->args()[0]->as<ast::IdExpr>())
+          builtin_name = id->ident();
+
+      variables.push_back(
+        Reflection::Variable {
+          .name = name,
+          .type = type->mangledName(),
+          .builtin = builtin_name
+        }
+      );
+    } else if (auto custom = type->as<types::Custom>()) {
+      if (auto struct_ = find_struct(custom->name()))
+        for (auto& member : struct_->members())
+          reflect(
+            variables,
+            member->name(),
+            member->type()->sem()->type(),
+            member->attrs()
+          );
+    }
+  }
+
+  uint32_t Reflector::attr_value(
+    ast::Attr* attr,
+    size_t index,
+    uint32_t default_value
+  )
+  {
+    if (index >= attr->args().size())
+      return default_value;
+
+    auto value = comptime::eval(attr->args()[index].get(), &m_consts);
+
+    if (!value || !(value->type & ast::LitExpr::Value::Type::kIntMask))
+      error("Attribute arguments must be integers known at compile time.");
+
+    return static_cast<uint32_t>(value->value.u64);
+  }
+
+  ast::StructDecl* Reflector::find_struct(const std::string& name)
+  {
+    for (auto& decl : m_module->global_declarations())
+      if (auto struct_ = decl->as<ast::StructDecl>(); struct_ && struct_->name() == name)
+        return struct_;
+
+    return nullptr;
+  }
+
+  void Reflector::error(const std::string& err)
+  {
+    fmt::println("{}", err);
+    std::exit(1);
+  }
+
+  std::vector<uint8_t> to_binary(const Reflection& reflection)
+  {
+    std::vector<uint8_t> out;
+
+    out.insert(out.end(), { 'K', 'S', 'R', 'F' });
+    write<uint32_t>(out, kVersion);
+    write<uint32_t>(out, reflection.bindings.size());
+    write<uint32_t>(out, reflection.entry_points.size());
+
+    for (auto& binding : reflection.bindings) {
+      write(out, binding.name);
+      write(out, binding.type);
+      write<uint32_t>(out, binding.group);
+      write<uint32_t>(out, binding.binding);
+      write<uint8_t>(out, static_cast<uint8_t>(binding.kind));
+      write<uint8_t>(out, static_cast<uint8_t>(binding.access_mode));
+      write<uint8_t>(out, static_cast<uint8_t>(binding.layout));
+      write<uint64_t>(out, binding.size);
+      write<uint64_t>(out, binding.stride);
+      write<uint32_t>(out, binding.members.size());
+
+      for (auto& member : binding.members) {
+        write(out, member.name);
+        write(out, member.type);
+        write<uint64_t>(out, member.offset);
+        write<uint64_t>(out, member.size);
+      }
+    }
+
+    auto write_variables = [&](const std::vector<Reflection::Variable>& variables) {
+      write<uint32_t>(out, variables.size());
+
+      for (auto& var : variables) {
+        write(out, var.name);
+        write(out, var.type);
+        write<uint32_t>(out, var.location.value_or(kNoLocation));
+        write(out, var.builtin);
+      }
+    };
+
+    for (auto& entry_point : reflection.entry_points) {
+      write(out, entry_point.name);
+      write<uint8_t>(out, static_cast<uint8_t>(entry_point.stage));
+
+      for (auto size : entry_point.workgroup_size)
+        write<uint32_t>(out, size);
+
+      write_variables(entry_point.inputs);
+      write_variables(entry_point.outputs);
+    }
+
+    return out;
+  }
+
+  std::string to_json(const Reflection& reflection)
+  {
+    std::string bindings;
+
+    for (auto& binding : reflection.bindings) {
+      std::string members;
+
+      for (auto& member : binding.members) {
+        members += members.empty() ? "\n" : ",\n";
+        members += fmt::format(
+          R"(        {{ "name": "{}", "type": "{}", "offset": {}, "size": {} }})",
+          member.name,
+          member.type,
+          member.offset,
+          member.size
+        );
+      }
+
+      bindings += bindings.empty() ? "\n" : ",\n";
+      bindings += fmt::format(
+        "    {{\n"
+        R"(      "name": "{}",)" "\n"
+        R"(      "type": "{}",)" "\n"
+        R"(      "group": {},)" "\n"
+        R"(      "binding": {},)" "\n"
+        R"(      "kind": "{}",)" "\n"
+        R"(      "access": "{}",)" "\n"
+        R"(      "layout": "{}",)" "\n"
+        R"(      "size": {},)" "\n"
+        R"(      "stride": {},)" "\n"
+        R"(      "members": {})" "\n"
+        "    }}",
+        binding.name,
+        binding.type,
+        binding.group,
+        binding.binding,
+        to_string(binding.kind),
+        to_string(binding.access_mode),
+        to_string(binding.layout),
+        binding.size,
+        binding.stride,
+        members.empty() ? "[]" : "[" + members + "\n      ]"
+      );
+    }
+
+    std::string entry_points;
+
+    for (auto& entry_point : reflection.entry_points) {
+      entry_points += entry_points.empty() ? "\n" : ",\n";
+      entry_points += fmt::format(
+        "    {{\n"
+        R"(      "name": "{}",)" "\n"
+        R"(      "stage": "{}",)" "\n"
+        R"(      "workgroup_size": [{}, {}, {}],)" "\n"
+        R"(      "inputs": {},)" "\n"
+        R"(      "outputs": {})" "\n"
+        "    }}",
+        entry_point.name,
+        to_string(entry_point.stage),
+        entry_point.workgroup_size[0],
+        entry_point.workgroup_size[1],
+        entry_point.workgroup_size[2],
+        to_json(entry_point.inputs),
+        to_json(entry_point.outputs)
+      );
+    }
+
+    return fmt::format(
+      "{{\n"
+      R"(  "version": {},)" "\n"
+      R"(  "bindings": [{}{}],)" "\n"
+      R"(  "entry_points": [{}{}])" "\n"
+      "}}",
+      kVersion,
+      bindings,
+      bindings.empty() ? "" : "\n  ",
+      entry_points,
+      entry_points.empty() ? "" : "\n  "
+    );
+  }
+}
\ No newline at end of file
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "ast.h"
+#include "comptime.h"
+#include "types.h"
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace kate::tlr {
+  // Binding slots and entry point interfaces of a module, exported next to the
+  // generated code so pipeline layouts can be built without reflecting over the shader.
+  struct Reflection {
+    enum class ResourceKind : uint8_t {
+      kUniformBuffer,
+      kStorageBuffer
+    };
+
+    enum class Stage : uint8_t {
+      kVertex,
+      kFragment,
+      kCompute
+    };
+
+    struct Member {
+      std::string name;
+      std::string type;
+      uint64_t offset;
+      uint64_t size;
+    };
+
+    struct Binding {
+      std::string name;
+      std::string type;
+      uint32_t group;
+      uint32_t binding;
+      ResourceKind kind;
+      ast::AccessMode access_mode;
+      types::Layout layout;
+
+      // size in bytes of the resource, 0 when it's an unsized array.
+      uint64_t size;
+
+      // distance in bytes between elements when the resource is an array, 0 otherwise.
+      uint64_t stride;
+
+      // members of the struct the resource holds, or of its elements.
+      std::vector<Member> members;
+    };
+
+    // a stage input or output, bound either to a location or to a builtin.
+    struct Variable {
+      std::string name;
+      std::string type;
+      std::optional<uint32_t> location;
+      std::string builtin;
+    };
+
+    struct EntryPoint {
+      std::string name;
+      Stage stage;
+      std::array<uint32_t, 3> workgroup_size = { 1, 1, 1 };
+      std::vector<Variable> inputs;
+      std::vector<Variable> outputs;
+    };
+
+    std::vector<Binding> bindings;
+    std::vector<EntryPoint> entry_points;
+  };
+
+  // Collects the reflection of a resolved module.
+  class Reflector {
+  public:
+    Reflector(ast::Module* module);
+
+    Reflection reflect();
+  private:
+    Reflection::Binding reflect(
+      const std::string& name,
+      types::Type* type,
+      types::Layout layout,
+      ast::List<ast::Attr>& attrs
+    );
+
+    std::optional<Reflection::EntryPoint> reflect(ast::FuncDecl* func);
+
+    // adds the variables of 'type', or of its members when it's a struct.
+    void reflect(
+      std::vector<Reflection::Variable>& variables,
+      const std::string& name,
+      types::Type* type,
+      ast::List<ast::Attr>& attrs
+    );
+
+    uint32_t attr_value(
+      ast::Attr* attr,
+      size_t index,
+      uint32_t default_value = 0
+    );
+
+    ast::StructDecl* find_struct(const std::string& name);
+
+    void error(const std::string& err);
+
+    ast::Module* m_module;
+
+    // the global constants of the module, attribute arguments may name them.
+    comptime::Bindings m_consts;
+  };
+
+  // Serializes the reflection into a compact little-endian blob, the format is:
+  //
+  //   header:      'KSRF', u32 version, u32 binding count, u32 entry point count
+  //   binding:     str name, str type, u32 group, u32 binding, u8 kind, u8 access mode,
+  //                u8 layout, u64 size, u64 stride, u32 member count, members
+  //   member:      str name, str type, u64 offset, u64 size
+  //   entry point: str name, u8 stage, u32 workgroup size[3], u32 input count, inputs,
+  //                u32 output count, outputs
+  //   variable:    str name, str type, u32 location (0xffffffff for builtins), str builtin
+  //
+  // where 'str' is a u32 length followed by the characters, without a terminator.
+  std::vector<uint8_t> to_binary(const Reflection& reflection);
+
+  std::string to_json(const Reflection& reflection);
+}
\ No newline at end of file
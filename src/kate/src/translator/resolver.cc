@@ -1,14 +1,50 @@
 #include "resolver.h"
+#include "comptime.h"
+
+#include "base/trace.h"
 
 namespace kate::tlr {
   Resolver::Resolver()
     : m_current_function { nullptr },
       m_currentScope { nullptr }
   {
+    // operands are resolved before their expression, with a stack of the traversal's own as
+    // chains of operations may be deeper than the call stack.
+    m_exprs.pre<ast::BinaryExpr>([this](ast::BinaryExpr* bexpr) {
+      m_exprs.visit(bexpr->lhs().get());
+
+      // the right side of a member access is a member name, not a variable.
+      if (bexpr->type() != ast::BinaryExpr::Type::kMemberAccess &&
+          bexpr->type() != ast::BinaryExpr::Type::kSwizzle)
+        m_exprs.visit(bexpr->rhs().get());
+
+      return false;
+    });
+
+    m_exprs.pre<ast::CallExpr>([this](ast::CallExpr* callexpr) {
+      // the callee is a name, only the arguments are resolved.
+      for (auto& arg : callexpr->args())
+        m_exprs.visit(arg.get());
+
+      return false;
+    });
+
+    m_exprs.post<ast::BinaryExpr>([this](ast::BinaryExpr* bexpr) { resolve(bexpr); });
+    m_exprs.post<ast::UnaryExpr>([this](ast::UnaryExpr* uexpr) { resolve(uexpr); });
+    m_exprs.post<ast::IdExpr>([this](ast::IdExpr* idexpr) { resolve(idexpr); });
+    m_exprs.post<ast::CallExpr>([this](ast::CallExpr* callexpr) { resolve(callexpr); });
+    m_exprs.post<ast::LitExpr>([this](ast::LitExpr* lit) { resolve(lit); });
+    m_exprs.post<ast::ArrayExpr>([this](ast::ArrayExpr* array) { resolve(array); });
+
+    m_exprs.post<ast::Expr>([this](ast::Expr* expr) {
+      error("Unimplemented binary expression.");
+    });
   }
 
   void Resolver::resolve(ast::Module* module)
   {
+    TS_TRACE_ZONE("resolve");
+
     module->setSem(std::make_unique<sem::Module>());
     m_currentScope = &module->sem()->scope();
     
@@ -28,7 +64,13 @@ namespace kate::tlr {
           resolve(var_decl->type().get());
         },
         [&](ast::UniformDecl* uniform_decl) {
-          // ...
+          resolve(uniform_decl);
+        },
+        [&](ast::ConstDecl* const_decl) {
+          resolve(const_decl);
+        },
+        [&](ast::ImportDecl* import) {
+          error(fmt::format("Import of '{}' must be linked before the module is resolved.", import->path()));
         },
         [&](base::Default) {
           assert(false);
@@ -39,7 +81,50 @@ namespace kate::tlr {
 
   void Resolver::resolve(ast::UniformDecl* uniform)
   {
-    resolve(uniform->type().get());
+    uniform->setSem(resolve(uniform->type().get()));
+
+    m_currentScope->addDecl(uniform->sem());
+  }
+
+  void Resolver::resolve(ast::ConstDecl* const_decl)
+  {
+    resolve(const_decl->expr().get());
+
+    auto value = comptime::eval(const_decl->expr().get(), &m_consts);
+
+    if (!value) {
+      error(
+        fmt::format(
+          "Constant '{}' must be initialized with an expression that can be evaluated at compile time.",
+          const_decl->name()
+        )
+      );
+      return;
+    }
+
+    auto* ty = const_decl->expr()->sem()->type();
+
+    if (auto& decl_type = const_decl->type()) {
+      ty = resolve(decl_type.get());
+
+      if (ty != const_decl->expr()->sem()->type()) {
+        error(
+          fmt::format(
+            "Constant '{}' of type '{}' can't be initialized with a '{}'.",
+            const_decl->name(),
+            ty->mangledName(),
+            const_decl->expr()->sem()->type()->mangledName()
+          )
+        );
+        return;
+      }
+    }
+
+    const_decl->setSem(ty);
+
+    m_currentScope->addDecl(const_decl->sem());
+
+    m_consts[const_decl->name()] = value.value();
   }
 
   void Resolver::resolve(ast::StructDecl* struct_)
@@ -61,12 +146,7 @@ namespace kate::tlr {
 
       resolve(m->type().get());
 
-      m->setSem(
-        std::make_unique<sem::Decl>(
-          m.get(),
-          m->type()->sem()->type()
-        )
-      );
+      m->setSem(m->type()->sem()->type());
 
       members.push_back(
         types::Custom::Member(
@@ -77,14 +157,11 @@ namespace kate::tlr {
     }
 
     struct_->setSem(
-      std::make_unique<sem::Decl>(
-        struct_,
-        types::system().addType(
+      types::system().addType(
+        struct_->name(),
+        std::make_unique<types::Custom>(
           struct_->name(),
-          std::make_unique<types::Custom>(
-            struct_->name(),
-            std::move(members)
-          )
+          std::move(members)
         )
       )
     );
@@ -92,15 +169,29 @@ namespace kate::tlr {
 
   void Resolver::resolve(ast::FuncDecl* func)
   {    
+    TS_TRACE_ZONE("resolve function");
+
     m_current_function = func;
 
     resolve(func->type().get());
 
-    for (auto& arg : func->args()) resolve(arg.get());
+    std::vector<sem::Decl> args;
 
-    resolve(func->block().get());
+    auto shadowed = m_shadowed.size();
+
+    for (auto& arg : func->args()) {
+      resolve(arg.get());
+      args.push_back(arg->sem());
+
+      shadow(arg->name());
+    }
 
-    func->setSem(std::make_unique<sem::Decl>(func, func->type()->sem()->type()));
+    // arguments live in the scope of the body, functions declaring the same names don't clash.
+    resolve(func->block().get(), args);
+
+    unshadow(shadowed);
+
+    func->setSem(func->type()->sem()->type());
 
     m_currentScope->addDecl(func->sem());
 
@@ -111,187 +202,94 @@ namespace kate::tlr {
   {
     resolve(func_arg->type().get());
 
-    func_arg->setSem(
-      std::make_unique<sem::Decl>(
-        func_arg, 
-        func_arg->type()->sem()->type()
-      )
-    );
-
-    m_currentScope->addDecl(func_arg->sem());
+    func_arg->setSem(func_arg->type()->sem()->type());
   }
 
-  void Resolver::resolve(ast::BlockStat* block)
+  void Resolver::resolve(ast::BlockStat* block, const std::vector<sem::Decl>& decls)
   {
     auto current_scope = m_currentScope;
 
     auto sem = std::make_unique<sem::BlockStat>();
     sem->scope().setParent(current_scope);
 
+    for (auto decl : decls)
+      sem->scope().addDecl(decl);
+
     m_currentScope = &sem->scope();
     
     block->setSem(std::move(sem));
 
-    for (auto& stat : block->stats()) {
-      base::Match(
-        stat.get(),
-        [&](ast::IfStat* stat) {
-          resolve(stat);
-        },
-        [&](ast::ForStat* for_stat) {
-          resolve(for_stat);
-        },
-        [&](ast::BlockStat* block_stat) {
-          resolve(block_stat);
-        },
-        [&](ast::VarStat* var_stat) {
-          resolve(var_stat);
-        },
-        [&](ast::ExprStat* expr_stat) {
-          resolve(expr_stat);
-        },
-        [&](ast::WhileStat* while_stat) {
-          resolve(while_stat);
-        },
-        [&](ast::ReturnStat* return_stat) {
-          resolve(return_stat);
-        },
-        [](base::Default) {
-          assert(false);
-        }
-      );
-    }
+    auto shadowed = m_shadowed.size();
+
+    for (auto& stat : block->stats())
+      resolve(stat.get());
+
+    unshadow(shadowed);
 
     m_currentScope = current_scope;
   }
 
-  void Resolver::resolve(ast::IfStat* if_stat)
+  void Resolver::shadow(const std::string& name)
   {
-    resolve(if_stat->condition().get());
+    auto it = m_consts.find(name);
 
-    resolve(if_stat->block().get());
+    if (it == m_consts.end())
+      return;
 
-    if (if_stat->elseBlock())
-      resolve(if_stat->elseBlock().get());
+    m_shadowed.emplace_back(it->first, it->second);
+    m_consts.erase(it);
   }
 
-  std::optional<ast::LitExpr::Value> Resolver::comptime_eval(ast::Expr* expr) 
+  void Resolver::unshadow(size_t count)
   {
-    if (auto bexpr = expr->as<ast::BinaryExpr>())
-      return comptime_eval(bexpr);
-    else if (auto litexpr = expr->as<ast::LitExpr>())
-        return litexpr->value();
-    else
-      return std::nullopt;
-  }
-
-  template<typename T>
-  std::optional<T> comptime_binary_expr_eval(ast::BinaryExpr::Type type, T lhs, T rhs) {
-    switch (type) {
-      case ast::BinaryExpr::Type::kAdd:
-        return lhs + rhs;
-      case ast::BinaryExpr::Type::kSubtract:
-        return lhs - rhs;
-      case ast::BinaryExpr::Type::kMul:
-        return lhs * rhs;
-      case ast::BinaryExpr::Type::kDiv:
-        return lhs / rhs;
-      default:
-        if constexpr (std::is_integral_v<T>) {
-          switch (type) {
-            case ast::BinaryExpr::Type::kBitXor:
-              return lhs ^ rhs;
-            case ast::BinaryExpr::Type::kBitOr:
-              return lhs | rhs;
-            case ast::BinaryExpr::Type::kBitAnd:
-              return lhs & rhs;
-          }
-        }
-
-        return std::nullopt;
+    while (m_shadowed.size() > count) {
+      m_consts.insert(std::move(m_shadowed.back()));
+      m_shadowed.pop_back();
     }
   }
 
-  std::optional<ast::LitExpr::Value> Resolver::comptime_eval(ast::BinaryExpr* bexpr) 
+  void Resolver::resolve(ast::Stat* stat)
   {
-    auto lhs_val = comptime_eval(bexpr->lhs().get());
-    
-    if (!lhs_val) 
-      return std::nullopt;
-    
-    auto rhs_val = comptime_eval(bexpr->rhs().get());
-
-    if (!rhs_val) 
-      return std::nullopt;
-
-    ast::LitExpr::Value::Type type;
-
-    // if it's a 'float <expr> float' binary expression
-    if ((lhs_val->type & ast::LitExpr::Value::Type::kFloatMask) &&
-          (rhs_val->type & ast::LitExpr::Value::Type::kFloatMask)) 
-    {
-      // then we check if types are equal
-      if (lhs_val->type == rhs_val->type)
-        type = lhs_val->type;
-      else
-        // if types are not equal then we assume one of them is a 64 bit floating point value. 
-        type = ast::LitExpr::Value::kF64;
+    base::Match(
+      stat,
+      [&](ast::IfStat* stat) {
+        resolve(stat);
+      },
+      [&](ast::ForStat* for_stat) {
+        resolve(for_stat);
+      },
+      [&](ast::BlockStat* block_stat) {
+        resolve(block_stat);
+      },
+      [&](ast::VarStat* var_stat) {
+        resolve(var_stat);
+      },
+      [&](ast::ExprStat* expr_stat) {
+        resolve(expr_stat);
+      },
+      [&](ast::WhileStat* while_stat) {
+        resolve(while_stat);
+      },
+      [&](ast::ReturnStat* return_stat) {
+        resolve(return_stat);
+      },
+      [&](ast::BreakStat* break_stat) {
+        // nothing to resolve here.
+      },
+      [](base::Default) {
+        assert(false);
+      }
+    );
+  }
 
-      auto result = comptime_binary_expr_eval(bexpr->type(), lhs_val->value.f64, lhs_val->value.f64);
+  void Resolver::resolve(ast::IfStat* if_stat)
+  {
+    resolve(if_stat->condition().get());
 
-      if (!result)
-        return std::nullopt;
+    resolve(if_stat->block().get());
 
-      return ast::LitExpr::Value {
-        .type = type,
-        .value.f64 = result.value()
-      };
-    }
-    // if it's a 'int <expr> int' binary expression
-    else if ((lhs_val->type & ast::LitExpr::Value::Type::kIntMask) &&
-          (rhs_val->type & ast::LitExpr::Value::Type::kIntMask)) 
-    {
-      // then we check if types are equal
-      if (lhs_val->type == rhs_val->type)
-        type = lhs_val->type;
-      else
-        // if types are not equal then we assume one of them is a 64 bit signed integer value. 
-        type = ast::LitExpr::Value::kI64;
-
-      auto result = comptime_binary_expr_eval(bexpr->type(), lhs_val->value.i64, lhs_val->value.i64);
-
-      if (!result)
-        return std::nullopt;
-
-      return ast::LitExpr::Value {
-        .type = type,
-        .value.i64 = result.value()
-      };
-    }
-    // if it's a 'uint <expr> uint' binary expression
-    else if ((lhs_val->type & ast::LitExpr::Value::Type::kUnsignedIntMask) &&
-          (rhs_val->type & ast::LitExpr::Value::Type::kUnsignedIntMask)) 
-    {
-      // then we check if types are equal
-      if (lhs_val->type == rhs_val->type)
-        type = lhs_val->type;
-      else
-        // if types are not equal then we assume one of them is a 64 unsigned integer value. 
-        type = ast::LitExpr::Value::kU64;
-
-      auto result = comptime_binary_expr_eval(bexpr->type(), lhs_val->value.u64, lhs_val->value.u64);
-
-      if (!result)
-        return std::nullopt;
-
-      return ast::LitExpr::Value {
-        .type = type,
-        .value.u64 = result.value()
-      };
-    } 
-
-    // compile time evaluation failed.
-    return std::nullopt;
+    if (if_stat->elseBlock())
+      resolve(if_stat->elseBlock().get());
   }
 
   void Resolver::resolve(ast::ForStat* for_stat)
@@ -320,21 +318,9 @@ namespace kate::tlr {
         resolve(expr.get());
 
         auto ty = expr->sem()->type();
-        
-        auto sem_decl = std::make_unique<sem::Decl>(
-          var_stat->decl().get(),
-          ty
-        );
-
-        var_stat->decl()->setSem(std::move(sem_decl));
-
-        auto sem_expr = std::make_unique<sem::Expr>(
-          expr.get()
-        );
 
-        sem_expr->setType(ty);
-
-        var_stat->expr()->setSem(std::move(sem_expr));
+        var_stat->decl()->setSem(ty);
+        expr->setSem(ty);
       } else // If there's no initializer then the statement is invalid.
         error("Variables without a type must have an initializer.");
     } else {
@@ -342,25 +328,15 @@ namespace kate::tlr {
 
       auto* ty = var_stat->decl()->type()->sem()->type();
 
-      auto sem = std::make_unique<sem::Decl>(
-        var_stat->decl().get(), 
-        ty
-      );
-
-      var_stat->decl()->setSem(std::move(sem));
-
-      if (auto& expr = var_stat->expr()) {
-        auto sem_expr = std::make_unique<sem::Expr>(
-          expr.get()
-        );
-
-        sem_expr->setType(ty);
+      var_stat->decl()->setSem(ty);
 
-        var_stat->expr()->setSem(std::move(sem_expr));
-      }
+      if (auto& expr = var_stat->expr())
+        expr->setSem(ty);
     }
 
     m_currentScope->addDecl(var_stat->decl()->sem());
+
+    shadow(var_stat->decl()->name());
   }
 
   void Resolver::resolve(ast::ExprStat* expr_stat)
@@ -377,9 +353,19 @@ namespace kate::tlr {
 
   void Resolver::resolve(ast::ReturnStat* return_stat)
   {
+    auto function_type = m_current_function->type()->sem()->type();
+
+    // a 'return;' is only allowed in functions that don't return anything.
+    if (!return_stat->expr()) {
+      if (!function_type->is<types::Void>())
+        error("Missing expression in 'return' statement of a function that returns a value.");
+
+      return;
+    }
+
     resolve(return_stat->expr().get());
 
-    if (return_stat->expr()->sem()->type()->mangledName() != m_current_function->type()->sem()->type()->mangledName()) {
+    if (return_stat->expr()->sem()->type()->mangledName() != function_type->mangledName()) {
       // TODO: Handle error.
       error("Type mismatch between expression and function return type.");
       return;
@@ -388,7 +374,9 @@ namespace kate::tlr {
 
   void Resolver::resolve(ast::BufferDecl* buffer_decl)
   {
-    resolve(buffer_decl->type().get());
+    buffer_decl->setSem(resolve(buffer_decl->type().get()));
+
+    m_currentScope->addDecl(buffer_decl->sem());
   }
 
   void Resolver::error(const std::string& err)
@@ -422,7 +410,7 @@ namespace kate::tlr {
 
     // If it's an array, check if we have a size.
     if (auto& array_size_expr = array_type->arraySizeExpr()) {
-      array_size = comptime_eval(array_size_expr.get());
+      array_size = comptime::eval(array_size_expr.get(), &m_consts);
 
       if (!array_size) {
         // TODO: Handle error.
@@ -444,15 +432,15 @@ namespace kate::tlr {
     else
       type_name = subty->mangledName() + "[]"; // unsized array.
 
-    if (auto ty = types::system().findType(type_name))
-      return ty;
+    auto ty = types::system().findType(type_name);
 
-    auto ty = types::system().addType(
-      type_name,
-      std::make_unique<types::Array>(subty, array_size ?  array_size->value.u64 : 0)
-    );
+    if (!ty)
+      ty = types::system().addType(
+        type_name,
+        std::make_unique<types::Array>(subty, array_size ?  array_size->value.u64 : 0)
+      );
 
-    array_type->setSem(std::make_unique<sem::Expr>(array_type));
+    array_type->setSem();
 
     array_type->sem()->setType(ty);
 
@@ -462,7 +450,7 @@ namespace kate::tlr {
   types::Type* Resolver::resolve(ast::TypeId* type_id)
   {
     if (auto ty = types::system().findType(type_id->id())) {
-      type_id->setSem(std::make_unique<sem::Expr>(type_id));
+      type_id->setSem();
 
       type_id->sem()->setType(ty);
 
@@ -476,30 +464,7 @@ namespace kate::tlr {
 
   void Resolver::resolve(ast::Expr* expr)
   {
-    base::Match(
-      expr,
-      [&](ast::BinaryExpr* expr) {
-        resolve(expr);
-      },
-      [&](ast::UnaryExpr* expr) {
-        resolve(expr);
-      },
-      [&](ast::IdExpr* expr) {
-        resolve(expr);
-      },
-      [&](ast::CallExpr* expr) {
-        resolve(expr);
-      },
-      [&](ast::LitExpr* expr) {
-        resolve(expr);
-      },
-      [&](ast::ArrayExpr* expr) {
-        resolve(expr);
-      },
-      [&](base::Default) {
-        error("Unimplemented binary expression.");
-      }
-    );
+    m_exprs.run(expr);
   }
 
   void Resolver::resolve(ast::ArrayExpr* expr)
@@ -507,8 +472,6 @@ namespace kate::tlr {
     types::Type* previous_type = nullptr;
 
     for (auto& item : expr->items()) {
-      resolve(item.get());
-
       if (previous_type) {
         if (item->sem()->type() != previous_type) {
           error(
@@ -538,13 +501,13 @@ namespace kate::tlr {
         std::make_unique<types::Array>(previous_type, expr->items().size())
       );
 
-    expr->setSem(std::make_unique<sem::Expr>(expr));
+    expr->setSem();
     expr->sem()->setType(type);
   }
 
   void Resolver::resolve(ast::LitExpr* lit)
   {
-    lit->setSem(std::make_unique<sem::Expr>(lit));
+    lit->setSem();
 
     switch (lit->value().type) {
       case ast::LitExpr::Value::Type::kF32:
@@ -578,8 +541,6 @@ namespace kate::tlr {
 
   void Resolver::resolve(ast::BinaryExpr* bexpr)
   {
-    resolve(bexpr->lhs().get());
-
     if (bexpr->type() == ast::BinaryExpr::Type::kMemberAccess) {   
       if (auto* ident = bexpr->rhs()->as<ast::IdExpr>()) {
         auto* lhs_type = bexpr->lhs()->sem()->type();
@@ -587,7 +548,7 @@ namespace kate::tlr {
         if (auto* user_type = lhs_type->as<types::Custom>()) {
           for (auto& member : user_type->members()) {
             if (member.name() == ident->ident()) {
-              bexpr->setSem(std::make_unique<sem::Expr>(bexpr));
+              bexpr->setSem();
               bexpr->sem()->setType(member.type());
 
               break;
@@ -650,7 +611,7 @@ namespace kate::tlr {
             type = types::system().findType(type_name);
           }
 
-          bexpr->setSem(std::make_unique<sem::Expr>(bexpr));
+          bexpr->setSem();
           bexpr->sem()->setType(type);          
         } else
           error(
@@ -665,9 +626,6 @@ namespace kate::tlr {
       }
     } else if (bexpr->type() == ast::BinaryExpr::Type::kIndexAccessor) {
       if (auto* array_type = bexpr->lhs()->sem()->type()->as<types::Array>()) {
-        // first we need to resolve rhs
-        resolve(bexpr->rhs().get());
-
         // (Renan): this check here must be removed in the long term,
         // because ideally we need to check if the given type is convertible
         // to uint instead.
@@ -680,7 +638,7 @@ namespace kate::tlr {
         // if array is of fixed size,
         if (auto array_size_count = array_type->count()) {
           // then try to resolve index at compile time.
-          if (auto comptime_index = comptime_eval(bexpr->rhs().get())) {
+          if (auto comptime_index = comptime::eval(bexpr->rhs().get(), &m_consts)) {
             // and test if index is out of bounds.
             if (comptime_index.value().value.u64 >= array_size_count) {
               error(
@@ -695,11 +653,9 @@ namespace kate::tlr {
           }          
         }
 
-        bexpr->setSem(std::make_unique<sem::Expr>(bexpr));
+        bexpr->setSem();
         bexpr->sem()->setType(array_type->type());
       } else if (auto* matrix_type = bexpr->lhs()->sem()->type()->as<types::Mat>()) {
-        resolve(bexpr->rhs().get());
-
         // (Renan): this check here must be removed in the long term,
         // because ideally we need to check if the given type is convertible
         // to uint instead.
@@ -710,7 +666,7 @@ namespace kate::tlr {
         }
 
         // try to resolve index at compile time.
-        if (auto comptime_index = comptime_eval(bexpr->rhs().get())) {
+        if (auto comptime_index = comptime::eval(bexpr->rhs().get(), &m_consts)) {
           // and test if index is out of bounds.
           if (comptime_index.value().value.u64 >= matrix_type->columns()) {
             error(
@@ -732,19 +688,17 @@ namespace kate::tlr {
           )
         );  
       
-        bexpr->setSem(std::make_unique<sem::Expr>(bexpr));
+        bexpr->setSem();
         bexpr->sem()->setType(vec_type);
       } else {
         error("Index accessors are only allowed for arrays or matrices.");
         return;
       }
     } else {
-      resolve(bexpr->rhs().get());
-
       auto lhs_type = bexpr->lhs()->sem()->type();
       auto rhs_type = bexpr->rhs()->sem()->type();
 
-      bexpr->setSem(std::make_unique<sem::Expr>(bexpr));
+      bexpr->setSem();
 
       if (lhs_type == rhs_type) {
         bexpr->sem()->setType(lhs_type);
@@ -758,20 +712,23 @@ namespace kate::tlr {
 
   void Resolver::resolve(ast::UnaryExpr* uexpr)
   {
-    resolve(uexpr->operand().get());
-
-    uexpr->setSem(std::make_unique<sem::Expr>(uexpr));
+    uexpr->setSem();
     
     // propagate type of operand
     uexpr->sem()->setType(uexpr->operand()->sem()->type());
   }
 
-  sem::Decl* Resolver::resolve(ast::IdExpr* idexpr)
+  sem::Decl Resolver::resolve(ast::IdExpr* idexpr)
   {
     auto decl = m_currentScope->findDecl(idexpr->ident());
 
-    idexpr->setSem(std::make_unique<sem::Expr>(idexpr));
-    idexpr->sem()->setType(decl->type());
+    if (!decl) {
+      error(fmt::format("Unable to find '{}'.", idexpr->ident()));
+      return {};
+    }
+
+    idexpr->setSem(decl->type());
+    idexpr->sem()->setDecl(decl.decl());
 
     return decl;
   }
@@ -783,9 +740,6 @@ namespace kate::tlr {
 
     auto& call_args = callexpr->args();
 
-    for (auto& arg : call_args)
-      resolve(arg.get());
-
     if (auto* constructor_type = types::system().findType(name)) {
       if (auto* array_type = constructor_type->as<types::Array>()) {
         error("Array constructors are not supported, use the '[ ... ]' syntax instead.");
@@ -882,11 +836,11 @@ namespace kate::tlr {
       }
 
       // If we are here then all previous validations succedded.
-      callexpr->setSem(std::make_unique<sem::Expr>(callexpr));
+      callexpr->setSem();
       callexpr->sem()->setType(constructor_type);
     } else {
       // Otherwise we have a function here.
-      auto* semDecl = m_currentScope->findDecl(name);
+      auto semDecl = m_currentScope->findDecl(name);
 
       if (!semDecl) {
         error(
@@ -931,7 +885,7 @@ namespace kate::tlr {
         }
 
         // If we are here then all previous checks succeded.
-        callexpr->setSem(std::make_unique<sem::Expr>(callexpr));
+        callexpr->setSem();
         callexpr->sem()->setType(func_decl->type()->sem()->type());
       } else {
         error("Error while trying to call a declaration that wasn't a function. Check for name collisions in this scope.");
@@ -1,7 +1,9 @@
 #pragma once
 
 #include "ast.h"
+#include "comptime.h"
 #include "sem.h"
+#include "passes/traverse.h"
 
 #include <optional>
 
@@ -10,27 +12,26 @@ namespace kate::tlr {
   public:
     Resolver();
 
+    Resolver(const Resolver&) = delete;
+
     ~Resolver() = default;
     
     void resolve(ast::Module* module);
   private:
-    std::optional<ast::LitExpr::Value> comptime_eval(
-      ast::BinaryExpr* bexpr
-    );
-
-    std::optional<ast::LitExpr::Value> comptime_eval(
-      ast::Expr* expr
-    );
-
     void resolve(ast::UniformDecl* uniform_);
 
+    void resolve(ast::ConstDecl* const_decl);
+
     void resolve(ast::StructDecl* struct_);
 
     void resolve(ast::FuncDecl* func);
 
     void resolve(ast::FuncArg* func_arg);
 
-    void resolve(ast::BlockStat* block);
+    // 'decls' are visible in the block before its statements, e.g. the arguments of a function.
+    void resolve(ast::BlockStat* block, const std::vector<sem::Decl>& decls = {});
+
+    void resolve(ast::Stat* stat);
 
     void resolve(ast::IfStat* if_stat);
 
@@ -58,7 +59,7 @@ namespace kate::tlr {
 
     void resolve(ast::UnaryExpr* uexpr);
 
-    sem::Decl* resolve(ast::IdExpr* idexpr);
+    sem::Decl resolve(ast::IdExpr* idexpr);
 
     void resolve(ast::CallExpr* callexpr);
 
@@ -70,8 +71,22 @@ namespace kate::tlr {
 
     void error(const std::string& err);
 
+    // hides the constant 'name' until the block declaring it ends.
+    void shadow(const std::string& name);
+
+    // brings back the constants shadowed after the first 'count' ones.
+    void unshadow(size_t count);
+
     sem::Scope* m_currentScope;
 
     ast::FuncDecl* m_current_function;
+
+    // values of the constants visible from the expression being resolved.
+    comptime::Bindings m_consts;
+
+    std::vector<std::pair<std::string, ast::LitExpr::Value>> m_shadowed;
+
+    // the handlers resolving an expression once its operands are.
+    Traversal m_exprs;
   };
 }
\ No newline at end of file
@@ -1,15 +1,24 @@
 #include "sem.h"
 
 namespace kate::tlr::sem {
-  Decl::Decl(ast::Decl* decl, types::Type* type)
-   : m_decl { decl },
-      m_type { type }
+  Decl::Decl(ast::Decl* decl)
+    : m_decl { decl }
   {
   }
 
+  Decl::operator bool() const
+  {
+    return m_decl;
+  }
+
+  Decl* Decl::operator->()
+  {
+    return this;
+  }
+
   types::Type* Decl::type()
   {
-    return m_type;
+    return ast::context().sem().types[ast::ASTContext::row(m_decl)];
   }
 
   std::string_view Decl::name()
@@ -23,19 +32,38 @@ namespace kate::tlr::sem {
   }
 
   Expr::Expr(ast::Expr* expr)
-    : m_expr { expr },
-      m_type { nullptr }
+    : m_expr { expr }
+  {
+  }
+
+  Expr::operator bool() const
   {
+    return m_expr;
+  }
+
+  Expr* Expr::operator->()
+  {
+    return this;
   }
 
   void Expr::setType(types::Type* type)
   {
-    m_type = type;
+    ast::context().sem().types[ast::ASTContext::row(m_expr)] = type;
   }
 
   types::Type* Expr::type()
   {
-    return m_type;
+    return ast::context().sem().types[ast::ASTContext::row(m_expr)];
+  }
+
+  void Expr::setDecl(ast::Decl* decl)
+  {
+    ast::context().sem().decls[ast::ASTContext::row(m_expr)] = decl;
+  }
+
+  ast::Decl* Expr::decl()
+  {
+    return ast::context().sem().decls[ast::ASTContext::row(m_expr)];
   }
 
   Scope::Scope()
@@ -58,18 +86,18 @@ namespace kate::tlr::sem {
     m_parent = parent;
   }
 
-  void Scope::addDecl(Decl* decl)
+  void Scope::addDecl(Decl decl)
   {
     m_decls.push_back(decl);
   }
 
-  Decl* Scope::findDecl(
+  Decl Scope::findDecl(
     const std::string_view& name,
     bool recursive
   )
   {
     for (auto& d : m_decls)
-      if (d->name() == name)
+      if (d.name() == name)
         return d;
 
     if (recursive)
@@ -77,7 +105,7 @@ namespace kate::tlr::sem {
         if (auto d = m_parent->findDecl(name))
           return d;
 
-    return nullptr;
+    return {};
   }
 
   Scope& BlockStat::scope()
@@ -7,9 +7,15 @@
 #include "types.h"
 
 namespace kate::tlr::sem {
+  // Semantic information of a declaration, a view of its row in the columns of the context.
+  // Empty when the declaration isn't resolved.
   class Decl {
   public:
-    Decl(ast::Decl* decl, types::Type* type);
+    Decl(ast::Decl* decl = nullptr);
+
+    explicit operator bool() const;
+
+    Decl* operator->();
 
     std::string_view name();
 
@@ -18,19 +24,28 @@ namespace kate::tlr::sem {
     ast::Decl* decl();
   private:
     ast::Decl* m_decl;
-    types::Type* m_type;
   };
 
+  // Semantic information of an expression, a view of its row in the columns of the context.
+  // Empty when the expression isn't resolved.
   class Expr {
   public:
-    Expr(ast::Expr* expr);
+    Expr(ast::Expr* expr = nullptr);
+
+    explicit operator bool() const;
+
+    Expr* operator->();
 
     void setType(types::Type* type);
 
     types::Type* type();
+
+    // declaration an identifier resolves to.
+    void setDecl(ast::Decl* decl);
+
+    ast::Decl* decl();
   private:
     ast::Expr* m_expr;
-    types::Type* m_type;
   };
 
   class Scope {
@@ -43,16 +58,16 @@ namespace kate::tlr::sem {
 
     void setParent(Scope* parent);
 
-    void addDecl(Decl* decl);
+    void addDecl(Decl decl);
 
-    Decl* findDecl(
+    Decl findDecl(
       const std::string_view& name,
       bool recursive = true
     );
   private:
     Scope* m_parent;
 
-    std::vector<Decl*> m_decls;
+    std::vector<Decl> m_decls;
   };
 
   class BlockStat {
@@ -0,0 +1,922 @@
+#include "serialize.h"
+#include "sem.h"
+
+#include <fmt/format.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <array>
+#include <bit>
+#include <cstring>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+
+namespace kate::tlr {
+  namespace {
+    constexpr uint32_t kVersion = 2;
+
+    struct Header {
+      char magic[4];
+      uint32_t version;
+      uint32_t num_types;
+      uint32_t num_members;
+      uint32_t num_nodes;
+      uint32_t num_children;
+      uint32_t strings_size;
+      uint32_t root;
+    };
+
+    static_assert(sizeof(Header) == 32);
+    static_assert(sizeof(SerializedModule::Node) == 40);
+    // records are read in place.
+    static_assert(std::endian::native == std::endian::little);
+
+    enum class Kind : uint16_t {
+      kModule,
+      kImportDecl,
+      kFuncDecl,
+      kFuncArg,
+      kStructDecl,
+      kStructMember,
+      kConstDecl,
+      kVarDecl,
+      kUniformDecl,
+      kBufferDecl,
+      kAttr,
+      kTypeId,
+      kArrayType,
+      kIdExpr,
+      kLitExpr,
+      kUnaryExpr,
+      kBinaryExpr,
+      kCallExpr,
+      kArrayExpr,
+      kBlockStat,
+      kVarStat,
+      kExprStat,
+      kReturnStat,
+      kBreakStat,
+      kIfStat,
+      kForStat,
+      kWhileStat
+    };
+
+    // nodes of each kind, in the order of 'Kind'.
+    using Nodes = std::tuple<
+      ast::Module,
+      ast::ImportDecl,
+      ast::FuncDecl,
+      ast::FuncArg,
+      ast::StructDecl,
+      ast::StructMember,
+      ast::ConstDecl,
+      ast::VarDecl,
+      ast::UniformDecl,
+      ast::BufferDecl,
+      ast::Attr,
+      ast::TypeId,
+      ast::ArrayType,
+      ast::IdExpr,
+      ast::LitExpr,
+      ast::UnaryExpr,
+      ast::BinaryExpr,
+      ast::CallExpr,
+      ast::ArrayExpr,
+      ast::BlockStat,
+      ast::VarStat,
+      ast::ExprStat,
+      ast::ReturnStat,
+      ast::BreakStat,
+      ast::IfStat,
+      ast::ForStat,
+      ast::WhileStat
+    >;
+
+    static_assert(std::tuple_size_v<Nodes> == size_t(Kind::kWhileStat) + 1);
+
+    // whether the nodes of a valid 'kind' are 'T's, from a table rather than the metadata of
+    // the nodes, 'load' checks every child with it.
+    template<typename T>
+    bool kind_is(uint16_t kind)
+    {
+      static constexpr auto kinds = []<size_t... I>(std::index_sequence<I...>) {
+        return std::array { std::is_base_of_v<T, std::tuple_element_t<I, Nodes>>... };
+      }(std::make_index_sequence<std::tuple_size_v<Nodes>>());
+
+      return kinds[kind];
+    }
+
+    enum class TypeKind : uint32_t {
+      kVoid,
+      kScalar,
+      kVec,
+      kMat,
+      kArray,
+      kCustom
+    };
+
+    // the node had a 'sem' when it was saved.
+    constexpr uint32_t kHasSem = 0x1;
+
+    class Writer {
+    public:
+      uint32_t write(ast::TreeNode* node)
+      {
+        // clones share their subtrees, e.g. the bodies of unrolled loops, a shared node is
+        // written once and its parents refer to the same record.
+        if (auto it = m_node_indices.find(node); it != m_node_indices.end())
+          return it->second;
+
+        SerializedModule::Node record {
+          .kind = 0,
+          .op = 0,
+          .flags = 0,
+          .type = SerializedModule::kNone,
+          .aux = 0,
+          .name = {},
+          .first_child = 0,
+          .num_children = 0,
+          .value = 0
+        };
+
+        std::vector<uint32_t> children;
+
+        auto kind = [&](Kind kind) {
+          record.kind = static_cast<uint16_t>(kind);
+        };
+
+        base::Match(
+          node,
+          [&](ast::Module* module) {
+            kind(Kind::kModule);
+            add(children, module->global_declarations());
+
+            if (module->sem()) record.flags |= kHasSem;
+          },
+          [&](ast::ImportDecl* import) {
+            kind(Kind::kImportDecl);
+            record.name = add(import->path());
+          },
+          [&](ast::FuncDecl* func) {
+            kind(Kind::kFuncDecl);
+            children.push_back(add(func->type()));
+            children.push_back(add(func->block()));
+            add(children, func->args());
+            add(children, func->attrs());
+            record.aux = func->args().size();
+          },
+          [&](ast::FuncArg* arg) {
+            kind(Kind::kFuncArg);
+            children.push_back(add(arg->type()));
+            add(children, arg->attrs());
+          },
+          [&](ast::StructDecl* struct_) {
+            kind(Kind::kStructDecl);
+            add(children, struct_->members());
+            add(children, struct_->attrs());
+            record.aux = struct_->members().size();
+          },
+          [&](ast::StructMember* member) {
+            kind(Kind::kStructMember);
+            children.push_back(add(member->type()));
+            add(children, member->attrs());
+          },
+          [&](ast::ConstDecl* const_decl) {
+            kind(Kind::kConstDecl);
+            children.push_back(add(const_decl->type()));
+            children.push_back(add(const_decl->expr()));
+          },
+          [&](ast::VarDecl* var_decl) {
+            kind(Kind::kVarDecl);
+            children.push_back(add(var_decl->type()));
+          },
+          [&](ast::UniformDecl* uniform) {
+            kind(Kind::kUniformDecl);
+            children.push_back(add(uniform->type()));
+            add(children, uniform->attributes());
+          },
+          [&](ast::BufferDecl* buffer) {
+            kind(Kind::kBufferDecl);
+            record.op = static_cast<uint16_t>(buffer->args().access_mode);
+            children.push_back(add(buffer->type()));
+            add(children, buffer->attributes());
+          },
+          [&](ast::Attr* attr) {
+            kind(Kind::kAttr);
+            record.op = static_cast<uint16_t>(attr->type());
+            add(children, attr->args());
+          },
+          [&](ast::TypeId* type_id) {
+            kind(Kind::kTypeId);
+            record.name = add(type_id->id());
+          },
+          [&](ast::ArrayType* array_type) {
+            kind(Kind::kArrayType);
+            children.push_back(add(array_type->type()));
+            children.push_back(add(array_type->arraySizeExpr()));
+          },
+          [&](ast::IdExpr* id_expr) {
+            kind(Kind::kIdExpr);
+            record.name = add(id_expr->ident());
+          },
+          [&](ast::LitExpr* lit) {
+            kind(Kind::kLitExpr);
+            record.op = static_cast<uint16_t>(lit->value().type);
+            record.value = lit->value().value.u64;
+          },
+          [&](ast::UnaryExpr* uexpr) {
+            kind(Kind::kUnaryExpr);
+            record.op = static_cast<uint16_t>(uexpr->type());
+            children.push_back(add(uexpr->operand()));
+          },
+          [&](ast::BinaryExpr* bexpr) {
+            kind(Kind::kBinaryExpr);
+            record.op = static_cast<uint16_t>(bexpr->type());
+            children.push_back(add(bexpr->lhs()));
+            children.push_back(add(bexpr->rhs()));
+          },
+          [&](ast::CallExpr* call_expr) {
+            kind(Kind::kCallExpr);
+            children.push_back(add(call_expr->id()));
+            add(children, call_expr->args());
+          },
+          [&](ast::ArrayExpr* array_expr) {
+            kind(Kind::kArrayExpr);
+            add(children, array_expr->items());
+          },
+          [&](ast::BlockStat* block) {
+            kind(Kind::kBlockStat);
+            add(children, block->stats());
+
+            if (block->sem()) record.flags |= kHasSem;
+          },
+          [&](ast::VarStat* var_stat) {
+            kind(Kind::kVarStat);
+            children.push_back(add(var_stat->decl()));
+            children.push_back(add(var_stat->expr()));
+          },
+          [&](ast::ExprStat* expr_stat) {
+            kind(Kind::kExprStat);
+            children.push_back(add(expr_stat->expr()));
+          },
+          [&](ast::ReturnStat* return_stat) {
+            kind(Kind::kReturnStat);
+            children.push_back(add(return_stat->expr()));
+          },
+          [&](ast::BreakStat*) {
+            kind(Kind::kBreakStat);
+          },
+          [&](ast::IfStat* if_stat) {
+            kind(Kind::kIfStat);
+            children.push_back(add(if_stat->condition()));
+            children.push_back(add(if_stat->block()));
+            children.push_back(add(if_stat->elseBlock()));
+          },
+          [&](ast::ForStat* for_stat) {
+            kind(Kind::kForStat);
+            children.push_back(add(for_stat->initializer()));
+            children.push_back(add(for_stat->condition()));
+            children.push_back(add(for_stat->continuing()));
+            children.push_back(add(for_stat->block()));
+          },
+          [&](ast::WhileStat* while_stat) {
+            kind(Kind::kWhileStat);
+            children.push_back(add(while_stat->condition()));
+            children.push_back(add(while_stat->block()));
+          },
+          [&](base::Default) {
+            assert(false);
+          }
+        );
+
+        if (auto decl = node->as<ast::Decl>()) {
+          if (!decl->is<ast::ImportDecl>())
+            record.name = add(decl->name());
+
+          if (decl->sem()) {
+            record.flags |= kHasSem;
+            record.type = add(decl->sem()->type());
+          }
+        } else if (auto expr = node->as<ast::Expr>(); expr && expr->sem()) {
+          record.flags |= kHasSem;
+          record.type = add(expr->sem()->type());
+        }
+
+        // Expressions and types without children are values of their name, literal and type,
+        // e.g. the uses of a variable, equal ones are written once and shared too. The
+        // declaration an identifier resolves to isn't saved, so they stay equal once loaded.
+        if (children.empty() && node->is<ast::Expr>()) {
+          auto key = std::tuple(record.kind, record.op, record.flags, record.type, record.name.offset, record.name.size, record.value);
+
+          auto [it, inserted] = m_leaf_indices.try_emplace(key, uint32_t(m_nodes.size()));
+
+          if (!inserted) {
+            m_node_indices.emplace(node, it->second);
+            return it->second;
+          }
+        }
+
+        record.first_child = m_children.size();
+        record.num_children = children.size();
+        m_children.insert(m_children.end(), children.begin(), children.end());
+
+        m_node_indices.emplace(node, uint32_t(m_nodes.size()));
+        m_nodes.push_back(record);
+
+        return m_nodes.size() - 1;
+      }
+
+      std::string finish(uint32_t root)
+      {
+        Header header {
+          .magic = { 'K', 'S', 'L', 'A' },
+          .version = kVersion,
+          .num_types = uint32_t(m_types.size()),
+          .num_members = uint32_t(m_members.size()),
+          .num_nodes = uint32_t(m_nodes.size()),
+          .num_children = uint32_t(m_children.size()),
+          .strings_size = uint32_t(m_strings.size()),
+          .root = root
+        };
+
+        std::string out(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        append(out, m_nodes);
+        append(out, m_types);
+        append(out, m_members);
+        append(out, m_children);
+        out.append(m_strings);
+
+        return out;
+      }
+    private:
+      template<typename T>
+      static void append(std::string& out, const std::vector<T>& records)
+      {
+        out.append(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(T));
+      }
+
+      template<typename T>
+      uint32_t add(ast::CRef<T>& ref)
+      {
+        return ref ? write(ref.get()) : SerializedModule::kNone;
+      }
+
+      template<typename T>
+      void add(std::vector<uint32_t>& children, ast::List<T>& refs)
+      {
+        for (auto& ref : refs)
+          children.push_back(add(ref));
+      }
+
+      SerializedModule::Str add(std::string_view str)
+      {
+        if (auto it = m_string_offsets.find(std::string(str)); it != m_string_offsets.end())
+          return SerializedModule::Str { it->second, uint32_t(str.size()) };
+
+        SerializedModule::Str ref { uint32_t(m_strings.size()), uint32_t(str.size()) };
+        m_strings.append(str);
+        m_string_offsets.emplace(std::string(str), ref.offset);
+
+        return ref;
+      }
+
+      uint32_t add(types::Type* type)
+      {
+        if (!type) return SerializedModule::kNone;
+
+        if (auto ref = type->as<types::Ref>())
+          return add(ref->type());
+
+        if (auto it = m_type_indices.find(type); it != m_type_indices.end())
+          return it->second;
+
+        SerializedModule::Type entry {
+          .kind = static_cast<uint32_t>(TypeKind::kVoid),
+          .name = {},
+          .element = SerializedModule::kNone,
+          .count = 0,
+          .rows = 0,
+          .columns = 0,
+          .first_member = 0,
+          .num_members = 0
+        };
+
+        if (type->is<types::Scalar>()) {
+          entry.kind = static_cast<uint32_t>(TypeKind::kScalar);
+          entry.name = add(type->mangledName());
+        } else if (auto vec = type->as<types::Vec>()) {
+          entry.kind = static_cast<uint32_t>(TypeKind::kVec);
+          entry.element = add(vec->type());
+          entry.count = vec->columns();
+        } else if (auto mat = type->as<types::Mat>()) {
+          entry.kind = static_cast<uint32_t>(TypeKind::kMat);
+          entry.element = add(mat->type());
+          entry.rows = mat->rows();
+          entry.columns = mat->columns();
+        } else if (auto array = type->as<types::Array>()) {
+          entry.kind = static_cast<uint32_t>(TypeKind::kArray);
+          entry.element = add(array->type());
+          entry.count = array->count();
+        } else if (auto custom = type->as<types::Custom>()) {
+          entry.kind = static_cast<uint32_t>(TypeKind::kCustom);
+          entry.name = add(custom->name());
+
+          // members are added once their types are, so they are next to each other.
+          std::vector<uint32_t> member_types;
+
+          for (auto& member : custom->members())
+            member_types.push_back(add(member.type()));
+
+          entry.first_member = m_members.size();
+          entry.num_members = member_types.size();
+
+          for (size_t i = 0; i < member_types.size(); i++)
+            m_members.push_back(SerializedModule::Member { add(custom->members()[i].name()), member_types[i] });
+        }
+
+        m_type_indices[type] = m_types.size();
+        m_types.push_back(entry);
+
+        return m_types.size() - 1;
+      }
+
+      std::vector<SerializedModule::Node> m_nodes;
+      std::vector<SerializedModule::Type> m_types;
+      std::vector<SerializedModule::Member> m_members;
+      std::vector<uint32_t> m_children;
+      std::string m_strings;
+
+      std::unordered_map<ast::TreeNode*, uint32_t> m_node_indices;
+      std::map<std::tuple<uint16_t, uint16_t, uint32_t, uint32_t, uint32_t, uint32_t, uint64_t>, uint32_t> m_leaf_indices;
+      std::unordered_map<types::Type*, uint32_t> m_type_indices;
+      std::unordered_map<std::string, uint32_t> m_string_offsets;
+    };
+  }
+
+  std::unique_ptr<SerializedModule> SerializedModule::map(const std::filesystem::path& path)
+  {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0) return nullptr;
+
+    struct stat st;
+
+    if (::fstat(fd, &st) < 0 || st.st_size < ssize_t(sizeof(Header))) {
+      ::close(fd);
+      return nullptr;
+    }
+
+    auto mapping = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+
+    if (mapping == MAP_FAILED) return nullptr;
+
+    std::unique_ptr<SerializedModule> module(new SerializedModule());
+    module->m_mapping = mapping;
+    module->m_size = st.st_size;
+
+    if (!module->init(static_cast<const uint8_t*>(mapping), st.st_size)) return nullptr;
+
+    return module;
+  }
+
+  std::unique_ptr<SerializedModule> SerializedModule::from_bytes(std::string&& bytes)
+  {
+    std::unique_ptr<SerializedModule> module(new SerializedModule());
+    module->m_bytes = std::move(bytes);
+
+    auto data = reinterpret_cast<const uint8_t*>(module->m_bytes.data());
+
+    if (!module->init(data, module->m_bytes.size())) return nullptr;
+
+    return module;
+  }
+
+  bool SerializedModule::matches(std::string_view data)
+  {
+    return data.starts_with("KSLA");
+  }
+
+  SerializedModule::~SerializedModule()
+  {
+    if (m_mapping)
+      ::munmap(m_mapping, m_size);
+  }
+
+  bool SerializedModule::init(const uint8_t* data, size_t size)
+  {
+    if (size < sizeof(Header)) return false;
+
+    auto header = reinterpret_cast<const Header*>(data);
+
+    if (std::memcmp(header->magic, "KSLA", 4) != 0 || header->version != kVersion) return false;
+
+    uint64_t expected = sizeof(Header) +
+      uint64_t(header->num_nodes) * sizeof(Node) +
+      uint64_t(header->num_types) * sizeof(Type) +
+      uint64_t(header->num_members) * sizeof(Member) +
+      uint64_t(header->num_children) * sizeof(uint32_t) +
+      header->strings_size;
+
+    if (expected != size || header->root >= header->num_nodes) return false;
+
+    auto ptr = data + sizeof(Header);
+
+    auto take = [&]<typename T>(std::span<const T>& records, uint32_t count) {
+      records = { reinterpret_cast<const T*>(ptr), count };
+      ptr += count * sizeof(T);
+    };
+
+    take(m_nodes, header->num_nodes);
+    take(m_types, header->num_types);
+    take(m_members, header->num_members);
+    take(m_children, header->num_children);
+
+    m_strings = { reinterpret_cast<const char*>(ptr), header->strings_size };
+    m_root = header->root;
+
+    // 'load' follows the indices without checking them again, so every record must stay
+    // inside its section. Types and nodes may only refer to the ones before them, which
+    // is how they're written, so a crafted file can't make a type or a node its own child.
+    auto valid_str = [&](Str str) {
+      return uint64_t(str.offset) + str.size <= m_strings.size();
+    };
+
+    auto valid_range = [](uint32_t first, uint32_t count, size_t size) {
+      return uint64_t(first) + count <= size;
+    };
+
+    auto valid_op = [](Kind kind, uint16_t op) {
+      switch (kind) {
+        case Kind::kBufferDecl:
+          return op < uint16_t(ast::AccessMode::kCount);
+        case Kind::kAttr:
+          return op < uint16_t(ast::Attr::Type::kCount);
+        case Kind::kLitExpr:
+          return std::has_single_bit(op) && op <= uint16_t(ast::LitExpr::Value::kF64);
+        case Kind::kUnaryExpr:
+          return op <= uint16_t(ast::UnaryExpr::Type::kFlip);
+        case Kind::kBinaryExpr:
+          return op < uint16_t(ast::BinaryExpr::Type::kCount);
+        default:
+          return true;
+      }
+    };
+
+    for (uint32_t i = 0; i < m_types.size(); i++) {
+      auto& type = m_types[i];
+
+      if (type.kind > uint32_t(TypeKind::kCustom) ||
+          !valid_str(type.name) ||
+          (type.element != kNone && type.element >= i) ||
+          !valid_range(type.first_member, type.num_members, m_members.size()))
+        return false;
+
+      for (auto& member : m_members.subspan(type.first_member, type.num_members))
+        if (!valid_str(member.name) || member.type >= i) return false;
+    }
+
+    for (uint32_t i = 0; i < m_nodes.size(); i++) {
+      auto& node = m_nodes[i];
+
+      if (node.kind > uint16_t(Kind::kWhileStat) ||
+          !valid_op(static_cast<Kind>(node.kind), node.op) ||
+          !valid_str(node.name) ||
+          (node.type != kNone && node.type >= m_types.size()) ||
+          !valid_range(node.first_child, node.num_children, m_children.size()))
+        return false;
+
+      for (auto child : m_children.subspan(node.first_child, node.num_children))
+        if (child != kNone && child >= i) return false;
+    }
+
+    return m_nodes[m_root].kind == uint16_t(Kind::kModule);
+  }
+
+  std::span<const SerializedModule::Node> SerializedModule::nodes() const
+  {
+    return m_nodes;
+  }
+
+  std::string_view SerializedModule::str(Str str) const
+  {
+    if (uint64_t(str.offset) + str.size > m_strings.size()) return {};
+
+    return m_strings.substr(str.offset, str.size);
+  }
+
+  types::Type* SerializedModule::type(uint32_t index, std::vector<types::Type*>& types) const
+  {
+    if (index == kNone) return nullptr;
+
+    if (types[index]) return types[index];
+
+    auto& entry = m_types[index];
+    auto element = type(entry.element, types);
+
+    types::Type* ty = nullptr;
+
+    // types are looked up under the names the resolver registers them with.
+    switch (static_cast<TypeKind>(entry.kind)) {
+      case TypeKind::kVoid:
+        ty = types::system().findType("void");
+        break;
+      case TypeKind::kScalar:
+        ty = types::system().findType(std::string(str(entry.name)));
+        break;
+      case TypeKind::kVec:
+        if (element)
+          ty = types::system().findType(fmt::format("{}{}", element->mangledName(), entry.count));
+        break;
+      case TypeKind::kMat:
+        if (element)
+          ty = types::system().findType(fmt::format("{}{}x{}", element->mangledName(), entry.columns, entry.rows));
+        break;
+      case TypeKind::kArray: {
+        if (!element) break;
+
+        auto name = entry.count
+          ? fmt::format("{}[{}]", element->mangledName(), entry.count)
+          : element->mangledName() + "[]";
+
+        ty = types::system().findType(name);
+
+        if (!ty)
+          ty = types::system().addType(name, std::make_unique<types::Array>(element, entry.count));
+        break;
+      }
+      case TypeKind::kCustom: {
+        auto name = std::string(str(entry.name));
+
+        ty = types::system().findType(name);
+
+        if (ty) break;
+
+        std::vector<types::Custom::Member> members;
+
+        for (auto& member : m_members.subspan(entry.first_member, entry.num_members)) {
+          auto member_type = type(member.type, types);
+
+          if (!member_type) return nullptr;
+
+          members.emplace_back(member_type, std::string(str(member.name)));
+        }
+
+        ty = types::system().addType(name, std::make_unique<types::Custom>(name, std::move(members)));
+        break;
+      }
+    }
+
+    types[index] = ty;
+
+    return ty;
+  }
+
+  ast::CRef<ast::Module> SerializedModule::load() const
+  {
+    auto& ctx = ast::context();
+
+    // The handle of each node until a parent takes it, the parents sharing it then take more
+    // handles of the node. The kind is next to them so a parent checks a child without
+    // reading the child's record again.
+    struct Made {
+      ast::CRef<ast::TreeNode> ref;
+      ast::TreeNode* node = nullptr;
+      uint16_t kind = 0;
+    };
+
+    std::vector<Made> nodes(m_nodes.size());
+    std::vector<types::Type*> types(m_types.size(), nullptr);
+    bool malformed = false;
+
+    for (uint32_t i = 0; i < m_nodes.size(); i++) {
+      auto& record = m_nodes[i];
+
+      auto children = m_children.subspan(record.first_child, record.num_children);
+
+      // children come before their parent, 'init' checked it. A child that's missing when
+      // it's required or of the wrong kind fails the load, the passes expect the tree the
+      // resolver left. A child of several parents is shared by them like a clone.
+      auto child = [&]<typename T>(size_t index, bool required = true) -> ast::CRef<T> {
+        if (index >= children.size() || children[index] == kNone) {
+          malformed |= required;
+          return {};
+        }
+
+        auto& made = nodes[children[index]];
+
+        if (!made.node || !kind_is<T>(made.kind)) {
+          malformed = true;
+          return {};
+        }
+
+        if (made.ref)
+          return made.ref.template convertTo<T>();
+
+        return ctx.clone(static_cast<T*>(made.node));
+      };
+
+      auto list = [&]<typename T>(size_t first, size_t last) {
+        ast::List<T> refs;
+
+        for (size_t index = first; index < std::min(last, children.size()); index++)
+          refs.push_back(child.template operator()<T>(index));
+
+        return refs;
+      };
+
+      auto name = std::string(str(record.name));
+
+      ast::CRef<ast::TreeNode> node;
+
+      switch (static_cast<Kind>(record.kind)) {
+        case Kind::kModule:
+          node = ctx.make<ast::Module>(list.operator()<ast::Decl>(0, children.size()));
+          break;
+        case Kind::kImportDecl:
+          node = ctx.make<ast::ImportDecl>(name);
+          break;
+        case Kind::kFuncDecl:
+          node = ctx.make<ast::FuncDecl>(
+            child.operator()<ast::Type>(0, false),
+            name,
+            child.operator()<ast::BlockStat>(1),
+            list.operator()<ast::FuncArg>(2, 2 + record.aux),
+            list.operator()<ast::Attr>(2 + record.aux, children.size())
+          );
+          break;
+        case Kind::kFuncArg:
+          node = ctx.make<ast::FuncArg>(
+            name,
+            child.operator()<ast::Type>(0),
+            list.operator()<ast::Attr>(1, children.size())
+          );
+          break;
+        case Kind::kStructDecl:
+          node = ctx.make<ast::StructDecl>(
+            name,
+            list.operator()<ast::StructMember>(0, record.aux),
+            list.operator()<ast::Attr>(record.aux, children.size())
+          );
+          break;
+        case Kind::kStructMember:
+          node = ctx.make<ast::StructMember>(
+            child.operator()<ast::Type>(0),
+            name,
+            list.operator()<ast::Attr>(1, children.size())
+          );
+          break;
+        case Kind::kConstDecl:
+          node = ctx.make<ast::ConstDecl>(
+            name,
+            child.operator()<ast::Type>(0, false),
+            child.operator()<ast::Expr>(1)
+          );
+          break;
+        case Kind::kVarDecl:
+          node = ctx.make<ast::VarDecl>(name, child.operator()<ast::Type>(0, false));
+          break;
+        case Kind::kUniformDecl:
+          node = ctx.make<ast::UniformDecl>(
+            child.operator()<ast::Type>(0),
+            name,
+            list.operator()<ast::Attr>(1, children.size())
+          );
+          break;
+        case Kind::kBufferDecl:
+          node = ctx.make<ast::BufferDecl>(
+            name,
+            ast::BufferArgs { .access_mode = static_cast<ast::AccessMode>(record.op) },
+            child.operator()<ast::Type>(0),
+            list.operator()<ast::Attr>(1, children.size())
+          );
+          break;
+        case Kind::kAttr:
+          node = ctx.make<ast::Attr>(
+            static_cast<ast::Attr::Type>(record.op),
+            list.operator()<ast::Expr>(0, children.size())
+          );
+          break;
+        case Kind::kTypeId:
+          node = ctx.make<ast::TypeId>(name);
+          break;
+        case Kind::kArrayType:
+          node = ctx.make<ast::ArrayType>(child.operator()<ast::Type>(0), child.operator()<ast::Expr>(1, false));
+          break;
+        case Kind::kIdExpr:
+          node = ctx.make<ast::IdExpr>(name);
+          break;
+        case Kind::kLitExpr: {
+          ast::LitExpr::Value value;
+          value.type = static_cast<ast::LitExpr::Value::Type>(record.op);
+          value.value.u64 = record.value;
+
+          node = ctx.make<ast::LitExpr>(value);
+          break;
+        }
+        case Kind::kUnaryExpr:
+          node = ctx.make<ast::UnaryExpr>(
+            static_cast<ast::UnaryExpr::Type>(record.op),
+            child.operator()<ast::Expr>(0)
+          );
+          break;
+        case Kind::kBinaryExpr:
+          node = ctx.make<ast::BinaryExpr>(
+            child.operator()<ast::Expr>(0),
+            static_cast<ast::BinaryExpr::Type>(record.op),
+            child.operator()<ast::Expr>(1)
+          );
+          break;
+        case Kind::kCallExpr:
+          node = ctx.make<ast::CallExpr>(
+            child.operator()<ast::IdExpr>(0),
+            list.operator()<ast::Expr>(1, children.size())
+          );
+          break;
+        case Kind::kArrayExpr:
+          node = ctx.make<ast::ArrayExpr>(list.operator()<ast::Expr>(0, children.size()));
+          break;
+        case Kind::kBlockStat:
+          node = ctx.make<ast::BlockStat>(list.operator()<ast::Stat>(0, children.size()));
+          break;
+        case Kind::kVarStat:
+          node = ctx.make<ast::VarStat>(child.operator()<ast::VarDecl>(0), child.operator()<ast::Expr>(1, false));
+          break;
+        case Kind::kExprStat:
+          node = ctx.make<ast::ExprStat>(child.operator()<ast::Expr>(0));
+          break;
+        case Kind::kReturnStat:
+          node = ctx.make<ast::ReturnStat>(child.operator()<ast::Expr>(0, false));
+          break;
+        case Kind::kBreakStat:
+          node = ctx.make<ast::BreakStat>();
+          break;
+        case Kind::kIfStat:
+          node = ctx.make<ast::IfStat>(
+            child.operator()<ast::Expr>(0),
+            child.operator()<ast::BlockStat>(1),
+            child.operator()<ast::BlockStat>(2, false)
+          );
+          break;
+        case Kind::kForStat:
+          node = ctx.make<ast::ForStat>(
+            child.operator()<ast::Stat>(0, false),
+            child.operator()<ast::Expr>(1, false),
+            child.operator()<ast::ExprStat>(2, false),
+            child.operator()<ast::BlockStat>(3)
+          );
+          break;
+        case Kind::kWhileStat:
+          node = ctx.make<ast::WhileStat>(child.operator()<ast::Expr>(0), child.operator()<ast::BlockStat>(1));
+          break;
+        default:
+          return {};
+      }
+
+      if (malformed) return {};
+
+      // the resolver types every declaration and type, the printers rely on it.
+      auto typed = (kind_is<ast::Decl>(record.kind) && !kind_is<ast::ImportDecl>(record.kind)) ||
+        kind_is<ast::Type>(record.kind);
+
+      if (typed && (!(record.flags & kHasSem) || record.type == kNone)) return {};
+
+      auto ptr = node.get();
+
+      if (record.flags & kHasSem) {
+        auto ty = type(record.type, types);
+
+        // a type the file names but this build doesn't know.
+        if (!ty && record.type != kNone) return {};
+
+        if (kind_is<ast::Decl>(record.kind))
+          static_cast<ast::Decl*>(ptr)->setSem(ty);
+        else if (kind_is<ast::Expr>(record.kind))
+          static_cast<ast::Expr*>(ptr)->setSem(ty);
+        else if (kind_is<ast::BlockStat>(record.kind))
+          static_cast<ast::BlockStat*>(ptr)->setSem(std::make_unique<sem::BlockStat>());
+        else if (kind_is<ast::Module>(record.kind))
+          static_cast<ast::Module*>(ptr)->setSem(std::make_unique<sem::Module>());
+      }
+
+      nodes[i] = Made { std::move(node), ptr, record.kind };
+    }
+
+    return nodes[m_root].ref.convertTo<ast::Module>();
+  }
+
+  std::string serialize(ast::Module* module)
+  {
+    Writer writer;
+
+    auto root = writer.write(module);
+
+    return writer.finish(root);
+  }
+}
\ No newline at end of file
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "ast.h"
+#include "types.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace kate::tlr {
+  // A resolved module saved as a '.ksla' file, so tools get the tree and its types back
+  // without running the front-end again.
+  //
+  // Nodes are fixed size records referring to their children, and to their types, by index,
+  // so the file holds no pointers and is read in place from a mapping, without fixing
+  // anything up. Opening it checks that every index and range stays inside its section, and
+  // that nodes and types only refer to the ones before them: children come before their
+  // parent and the module is the last node, so 'load' builds the tree in a single pass over
+  // the records.
+  //
+  // A node is written once however many parents it has: subtrees shared by clones, and equal
+  // expressions without children, e.g. the uses of a variable. Loading makes one node for
+  // the record, shared by its parents like a clone.
+  //
+  //   header:  'KSLA', u32 version, u32 count of types, members, nodes and children,
+  //            u32 size of the strings, u32 index of the module node
+  //   node:    u16 kind, u16 operator, u32 flags, u32 type, u32 aux, str name,
+  //            u32 first child, u32 child count, u64 value
+  //   type:    u32 kind, str name, u32 element, u32 count, u32 rows, u32 columns,
+  //            u32 first member, u32 member count
+  //   member:  str name, u32 type
+  //   child:   u32 node, 0xffffffff for an empty slot
+  //   strings
+  //
+  // where 'str' is a u32 offset in the strings and a u32 length. The operator holds the
+  // kind of operators, attributes, literals and access modes, 'aux' the size of the first
+  // list of children when a node has two of them, e.g. the arguments of a function before
+  // its attributes. Values are little-endian.
+  class SerializedModule {
+  public:
+    static constexpr uint32_t kNone = 0xffffffff;
+
+    struct Str {
+      uint32_t offset;
+      uint32_t size;
+    };
+
+    struct Node {
+      uint16_t kind;
+      uint16_t op;
+      uint32_t flags;
+      // type of the expression or declaration, 'kNone' without one.
+      uint32_t type;
+      uint32_t aux;
+      Str name;
+      uint32_t first_child;
+      uint32_t num_children;
+      // bits of a literal.
+      uint64_t value;
+    };
+
+    struct Type {
+      uint32_t kind;
+      // mangled name of scalars and structs.
+      Str name;
+      uint32_t element;
+      // columns of a vector, elements of an array, 0 for unsized arrays.
+      uint32_t count;
+      uint32_t rows;
+      uint32_t columns;
+      uint32_t first_member;
+      uint32_t num_members;
+    };
+
+    struct Member {
+      Str name;
+      uint32_t type;
+    };
+
+    // returns nullptr when the file is missing or malformed.
+    static std::unique_ptr<SerializedModule> map(const std::filesystem::path& path);
+
+    static std::unique_ptr<SerializedModule> from_bytes(std::string&& bytes);
+
+    // whether 'data' starts like a serialized module.
+    static bool matches(std::string_view data);
+
+    ~SerializedModule();
+
+    SerializedModule(const SerializedModule&) = delete;
+
+    std::span<const Node> nodes() const;
+
+    std::string_view str(Str str) const;
+
+    // builds the tree in the ast context, with the types of its expressions and declarations.
+    // Scopes are only used while resolving, blocks and the module get empty ones.
+    ast::CRef<ast::Module> load() const;
+  private:
+    SerializedModule() = default;
+
+    // checks the header and the records, nothing is read from the data when it fails.
+    bool init(const uint8_t* data, size_t size);
+
+    types::Type* type(uint32_t index, std::vector<types::Type*>& types) const;
+
+    void* m_mapping = nullptr;
+    size_t m_size = 0;
+    std::string m_bytes;
+
+    uint32_t m_root = kNone;
+
+    std::span<const Node> m_nodes;
+    std::span<const Type> m_types;
+    std::span<const Member> m_members;
+    std::span<const uint32_t> m_children;
+    std::string_view m_strings;
+  };
+
+  // Serializes a module, and the types of its resolved expressions and declarations.
+  std::string serialize(ast::Module* module);
+}
\ No newline at end of file
@@ -0,0 +1,623 @@
+#include "server.h"
+#include "driver.h"
+#include "permutation.h"
+#include "types.h"
+
+#include "printers/glsl.h"
+
+#include <fmt/format.h>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+
+namespace kate::tlr {
+  namespace {
+    // responses are cached until there are this many of them, then the cache starts over.
+    constexpr size_t kMaxCacheEntries = 4096;
+
+    // the modification time and size of a file, which change when it's written again.
+    std::string stamp(const std::string& path)
+    {
+      struct stat st;
+
+      if (::stat(path.c_str(), &st) < 0)
+        return "missing";
+
+      return fmt::format("{}.{:09} {}", st.st_mtim.tv_sec, st.st_mtim.tv_nsec, st.st_size);
+    }
+
+    // reads the lines and payloads of messages from a file descriptor.
+    class Reader {
+    public:
+      Reader(int fd)
+        : m_fd { fd },
+          m_offset { 0 }
+      {
+      }
+
+      // reads up to the next '\n', returns false at the end of the stream.
+      bool line(std::string& line)
+      {
+        for (;;) {
+          auto newline = m_buffer.find('\n', m_offset);
+
+          if (newline != std::string::npos) {
+            line.assign(m_buffer, m_offset, newline - m_offset);
+            m_offset = newline + 1;
+            return true;
+          }
+
+          if (!fill()) return false;
+        }
+      }
+
+      bool bytes(size_t size, std::string& bytes)
+      {
+        while (m_buffer.size() - m_offset < size)
+          if (!fill()) return false;
+
+        bytes.assign(m_buffer, m_offset, size);
+        m_offset += size;
+
+        return true;
+      }
+    private:
+      bool fill()
+      {
+        m_buffer.erase(0, m_offset);
+        m_offset = 0;
+
+        char chunk[64 * 1024];
+
+        for (;;) {
+          auto n = ::read(m_fd, chunk, sizeof(chunk));
+
+          if (n < 0 && errno == EINTR) continue;
+          if (n <= 0) return false;
+
+          m_buffer.append(chunk, n);
+          return true;
+        }
+      }
+
+      int m_fd;
+      std::string m_buffer;
+      size_t m_offset;
+    };
+
+    bool write_all(int fd, std::string_view data)
+    {
+      while (!data.empty()) {
+        auto n = ::write(fd, data.data(), data.size());
+
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+
+        data.remove_prefix(n);
+      }
+
+      return true;
+    }
+
+    std::string read_all(int fd)
+    {
+      std::string data;
+      char chunk[64 * 1024];
+
+      ::lseek(fd, 0, SEEK_SET);
+
+      for (;;) {
+        auto n = ::read(fd, chunk, sizeof(chunk));
+
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return data;
+
+        data.append(chunk, n);
+      }
+    }
+
+    std::vector<std::string> split(std::string_view str)
+    {
+      std::vector<std::string> words;
+
+      while (!str.empty()) {
+        auto space = str.find(' ');
+
+        if (space != 0)
+          words.emplace_back(str.substr(0, space));
+
+        str = (space == std::string_view::npos) ? std::string_view() : str.substr(space + 1);
+      }
+
+      return words;
+    }
+
+    std::optional<size_t> parse_size(std::string_view str)
+    {
+      size_t size = 0;
+
+      auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), size);
+
+      if (ec != std::errc() || ptr != str.data() + str.size()) return std::nullopt;
+
+      return size;
+    }
+
+    int connect_to(const std::string& path)
+    {
+      sockaddr_un addr {};
+      addr.sun_family = AF_UNIX;
+
+      if (path.size() >= sizeof(addr.sun_path))
+        return -1;
+
+      std::copy(path.begin(), path.end(), addr.sun_path);
+
+      int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+
+      if (fd < 0) return -1;
+
+      if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        ::close(fd);
+        return -1;
+      }
+
+      return fd;
+    }
+  }
+
+  Server::Server(size_t num_threads)
+    : m_stopping { false }
+  {
+    // clients closing their connection early must not kill the server.
+    std::signal(SIGPIPE, SIG_IGN);
+
+    // built-in types are created once here, children of the server start with them.
+    types::system();
+    glsl();
+
+    if (num_threads == 0)
+      num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+    for (size_t i = 0; i < num_threads; i++)
+      m_workers.emplace_back([this] { work(); });
+  }
+
+  Server::~Server()
+  {
+    {
+      std::lock_guard lock(m_mutex);
+      m_stopping = true;
+    }
+
+    m_condition.notify_all();
+
+    for (auto& worker : m_workers)
+      worker.join();
+  }
+
+  void Server::serve(int in, int out)
+  {
+    auto connection = std::make_shared<Connection>();
+    connection->out = out;
+
+    Reader reader(in);
+    std::string header;
+
+    while (reader.line(header)) {
+      auto words = split(header);
+
+      if (words.empty()) continue;
+
+      auto size = words.size() >= 3 ? parse_size(words[2]) : std::nullopt;
+
+      // the stream can't be followed after a malformed header, so it's the last one read.
+      if (words[0] != "compile" || !size) {
+        auto message = fmt::format("Malformed request '{}', expected 'compile ID SIZE [TARGET]...'.\n", header);
+        auto id = words.size() >= 2 ? words[1] : std::string("-");
+
+        respond(*connection, fmt::format("diagnostics {} {}\n{}done {} error\n", id, message.size(), message, id));
+        break;
+      }
+
+      Request request {
+        .connection = connection,
+        .id = words[1],
+        .args = { words.begin() + 3, words.end() }
+      };
+
+      if (!reader.bytes(size.value(), request.source))
+        break;
+
+      {
+        std::lock_guard lock(m_mutex);
+        connection->pending++;
+        m_queue.push_back(std::move(request));
+      }
+
+      m_condition.notify_all();
+    }
+
+    // responses still being compiled are written before the connection is closed.
+    std::unique_lock lock(m_mutex);
+    m_condition.wait(lock, [&] { return connection->pending == 0; });
+  }
+
+  void Server::listen(const std::string& path)
+  {
+    sockaddr_un addr {};
+    addr.sun_family = AF_UNIX;
+
+    if (path.size() >= sizeof(addr.sun_path))
+      error(fmt::format("Socket path '{}' is too long.", path));
+
+    std::copy(path.begin(), path.end(), addr.sun_path);
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+
+    ::unlink(path.c_str());
+
+    if (fd < 0 ||
+        ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+        ::listen(fd, SOMAXCONN) < 0)
+      error(fmt::format("Unable to listen on '{}': {}.", path, std::strerror(errno)));
+
+    for (;;) {
+      int client = ::accept(fd, nullptr, nullptr);
+
+      if (client < 0) {
+        if (errno == EINTR || errno == ECONNABORTED) continue;
+
+        error(fmt::format("Unable to accept connections on '{}': {}.", path, std::strerror(errno)));
+      }
+
+      std::thread([this, client] {
+        serve(client, client);
+        ::close(client);
+      }).detach();
+    }
+  }
+
+  void Server::work()
+  {
+    for (;;) {
+      Request request;
+
+      {
+        std::unique_lock lock(m_mutex);
+        m_condition.wait(lock, [&] { return m_stopping || !m_queue.empty(); });
+
+        if (m_queue.empty()) return;
+
+        request = std::move(m_queue.front());
+        m_queue.pop_front();
+      }
+
+      handle(request);
+
+      {
+        std::lock_guard lock(m_mutex);
+        request.connection->pending--;
+      }
+
+      m_condition.notify_all();
+    }
+  }
+
+  void Server::handle(Request& request)
+  {
+    std::string key;
+
+    for (auto& arg : request.args)
+      key += arg + '\0';
+
+    key += '\n';
+    key += request.source;
+
+    Result result;
+    bool cached = false;
+
+    {
+      std::lock_guard lock(m_cache_mutex);
+
+      if (auto it = m_cache.find(key); it != m_cache.end()) {
+        result = it->second;
+        cached = true;
+      }
+    }
+
+    // an imported module changed since the response was cached.
+    for (auto& [path, dependency_stamp] : result.dependencies)
+      if (cached && stamp(path) != dependency_stamp)
+        cached = false;
+
+    if (!cached) {
+      result = run(request);
+
+      std::lock_guard lock(m_cache_mutex);
+
+      if (m_cache.size() >= kMaxCacheEntries)
+        m_cache.clear();
+
+      m_cache.insert_or_assign(std::move(key), result);
+    }
+
+    std::string response;
+
+    for (auto& [target, data] : result.outputs)
+      response += fmt::format("output {} {} {}\n", request.id, target, data.size()) + data;
+
+    if (!result.diagnostics.empty())
+      response += fmt::format("diagnostics {} {}\n", request.id, result.diagnostics.size()) + result.diagnostics;
+
+    response += fmt::format("done {} {}\n", request.id, result.ok ? "ok" : "error");
+
+    respond(*request.connection, response);
+  }
+
+  Server::Result Server::run(const Request& request)
+  {
+    Result result;
+
+    // the child writes to files rather than pipes, so it never waits for the server to read.
+    FILE* outputs = std::tmpfile();
+    FILE* diagnostics = std::tmpfile();
+
+    if (!outputs || !diagnostics) {
+      result.diagnostics = "Unable to create the files the compiler writes to.\n";
+
+      if (outputs) std::fclose(outputs);
+      if (diagnostics) std::fclose(diagnostics);
+
+      return result;
+    }
+
+    std::fflush(stdout);
+
+    auto pid = ::fork();
+
+    if (pid == 0) {
+      // diagnostics are printed to stdout, anything written to stderr is kept with them.
+      ::dup2(fileno(diagnostics), STDOUT_FILENO);
+      ::dup2(fileno(diagnostics), STDERR_FILENO);
+
+      run_child(request, fileno(outputs));
+
+      std::fflush(stdout);
+      ::_exit(0);
+    }
+
+    int status = 0;
+
+    if (pid < 0)
+      result.diagnostics = fmt::format("Unable to fork the compiler: {}.\n", std::strerror(errno));
+    else
+      while (::waitpid(pid, &status, 0) < 0 && errno == EINTR);
+
+    result.ok = pid > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    result.diagnostics += read_all(fileno(diagnostics));
+
+    auto data = read_all(fileno(outputs));
+    std::string_view frames = data;
+
+    // 'TARGET SIZE\n' followed by the output of the target.
+    while (!frames.empty()) {
+      auto newline = frames.find('\n');
+      auto words = split(frames.substr(0, newline));
+      auto size = words.size() == 2 ? parse_size(words[1]) : std::nullopt;
+
+      if (newline == std::string_view::npos || !size || frames.size() - newline - 1 < size.value()) {
+        result.ok = false;
+        result.diagnostics += "The compiler stopped while writing its outputs.\n";
+        break;
+      }
+
+      auto payload = frames.substr(newline + 1, size.value());
+
+      // 'PATH\nSTAMP' of a file the compiler read.
+      if (words[0] == "dependency") {
+        auto separator = payload.find('\n');
+
+        result.dependencies.emplace_back(payload.substr(0, separator), payload.substr(separator + 1));
+      } else
+        result.outputs.emplace_back(words[0], std::string(payload));
+
+      frames.remove_prefix(newline + 1 + size.value());
+    }
+
+    std::fclose(outputs);
+    std::fclose(diagnostics);
+
+    return result;
+  }
+
+  void Server::run_child(const Request& request, int out)
+  {
+    std::vector<std::string> targets;
+    std::vector<PermutationOption> permutations;
+
+    for (size_t i = 0; i < request.args.size(); i++) {
+      auto& arg = request.args[i];
+
+      if (arg == "--permute" && i + 1 < request.args.size()) {
+        auto option = parse_permutation(request.args[++i]);
+
+        if (!option) {
+          fmt::println("Invalid permutation '{}', expected NAME=v0,v1,...", request.args[i]);
+          std::exit(1);
+        }
+
+        permutations.push_back(std::move(option.value()));
+      } else if (is_target(arg))
+        targets.push_back(arg);
+      else {
+        fmt::println("Unknown target '{}'.", arg);
+        std::exit(1);
+      }
+    }
+
+    auto write_frame = [&](const std::string& name, const std::string& data) {
+      write_all(out, fmt::format("{} {}\n", name, data.size()));
+      write_all(out, data);
+    };
+
+    // the stamps are taken before the files are read, and written right away, so the
+    // server knows them even when compiling fails.
+    auto dependency = [&](const std::string& path) {
+      write_frame("dependency", path + '\n' + stamp(path));
+    };
+
+    auto module = compile(request.source, ParserOptions {
+      .error_callback = [](const std::string_view& message) {
+        fmt::println("{}", message);
+      },
+      .import_callback = [&](const std::filesystem::path& path) {
+        auto interface_path = path;
+        interface_path.replace_extension(".ksli");
+
+        dependency(path.string());
+        dependency(interface_path.string());
+      }
+    }, {}, names(permutations));
+
+    if (!module) std::exit(1);
+
+    auto generated = emit(module.get(), targets);
+
+    for (auto& target : targets)
+      write_frame(target, generated[target]);
+
+    if (!permutations.empty()) {
+      PermutationCompiler compiler(module.get());
+
+      for (auto& variant : compiler.compile(permutations)) {
+        auto name = "glsl:" + describe(permutations, variant.specialization);
+        std::erase(name, ' ');
+
+        write_frame(name, variant.glsl);
+      }
+    }
+  }
+
+  void Server::respond(Connection& connection, const std::string& response)
+  {
+    std::lock_guard lock(connection.mutex);
+
+    // a client that went away loses its responses, the server keeps going.
+    write_all(connection.out, response);
+  }
+
+  void Server::error(const std::string& err)
+  {
+    fmt::println("{}", err);
+    std::exit(1);
+  }
+
+  void run_load(const LoadOptions& options)
+  {
+    std::vector<double> latencies(options.requests);
+    std::atomic<size_t> next_request { 0 };
+    std::atomic<size_t> failures { 0 };
+
+    auto client = [&] {
+      int fd = connect_to(options.path);
+
+      if (fd < 0) {
+        fmt::println("Unable to connect to '{}': {}.", options.path, std::strerror(errno));
+        std::exit(1);
+      }
+
+      Reader reader(fd);
+      std::string line;
+      std::string payload;
+
+      for (auto i = next_request++; i < options.requests; i = next_request++) {
+        auto source = options.cached ? options.source : fmt::format("// request {}\n{}", i, options.source);
+        auto header = fmt::format("compile {} {}", i, source.size());
+
+        for (auto& arg : options.args)
+          header += " " + arg;
+
+        auto start = std::chrono::steady_clock::now();
+
+        write_all(fd, header + "\n" + source);
+
+        for (;;) {
+          if (!reader.line(line)) {
+            fmt::println("Connection to '{}' closed by the server.", options.path);
+            std::exit(1);
+          }
+
+          auto words = split(line);
+
+          if (words.size() >= 3 && words[0] == "done") {
+            if (words[2] != "ok") failures++;
+            break;
+          }
+
+          auto size = words.empty() ? std::nullopt : parse_size(words.back());
+
+          if (!size || !reader.bytes(size.value(), payload)) {
+            fmt::println("Malformed response '{}'.", line);
+            std::exit(1);
+          }
+        }
+
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        latencies[i] = elapsed.count();
+      }
+
+      ::close(fd);
+    };
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> clients;
+
+    for (size_t i = 0; i < std::max<size_t>(options.connections, 1); i++)
+      clients.emplace_back(client);
+
+    for (auto& thread : clients)
+      thread.join();
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    if (latencies.empty()) return;
+
+    std::sort(latencies.begin(), latencies.end());
+
+    auto percentile = [&](double p) {
+      return latencies[std::min(latencies.size() - 1, static_cast<size_t>(p * latencies.size()))] * 1000.0;
+    };
+
+    fmt::println(
+      "{} requests over {} connections in {:.3f} s, {:.0f} requests/s, {} failed",
+      options.requests,
+      clients.size(),
+      elapsed.count(),
+      options.requests / std::max(elapsed.count(), 1e-9),
+      failures.load()
+    );
+
+    fmt::println(
+      "latency: p50 {:.3f} ms, p90 {:.3f} ms, p99 {:.3f} ms, max {:.3f} ms",
+      percentile(0.5),
+      percentile(0.9),
+      percentile(0.99),
+      latencies.back() * 1000.0
+    );
+  }
+}
\ No newline at end of file
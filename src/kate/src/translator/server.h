@@ -0,0 +1,106 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace kate::tlr {
+  // Compiles shaders sent over a unix domain socket, or stdin and stdout, so build tools
+  // don't pay for a new process, the built-in types and the rtti metadata per shader.
+  //
+  // Messages are a header line, followed by as many bytes as the size it gives:
+  //
+  //   compile ID SIZE [TARGET | --permute NAME=v0,v1,...]...    source of a shader to compile.
+  //   output ID TARGET SIZE                                     output of a target, variants of
+  //                                                             '--permute' are named 'glsl:NAME=v0'.
+  //   diagnostics ID SIZE                                       errors printed while compiling.
+  //   done ID ok|error                                          last message of a request.
+  //
+  // Requests run concurrently on a pool of threads, their responses are written whole so
+  // they never interleave, but may come in any order. Each request is compiled in a forked
+  // child of the server: it starts with everything the server has warmed up, and errors,
+  // which exit the translator, don't bring the server down. Responses are cached by source
+  // and arguments, so rebuilding an unchanged shader doesn't compile it again, as long as
+  // the modules it imports and their '.ksli' files haven't changed either.
+  class Server {
+  public:
+    // 'num_threads' of 0 uses one thread per hardware thread.
+    Server(size_t num_threads = 0);
+
+    ~Server();
+
+    // serves the requests read from 'in' until it's closed, responses are written to 'out'.
+    void serve(int in, int out);
+
+    // serves every connection to a unix domain socket created at 'path'.
+    void listen(const std::string& path);
+  private:
+    struct Connection {
+      int out;
+      std::mutex mutex;
+      // requests read from the connection without a response yet.
+      size_t pending = 0;
+    };
+
+    struct Request {
+      std::shared_ptr<Connection> connection;
+      std::string id;
+      std::vector<std::string> args;
+      std::string source;
+    };
+
+    struct Result {
+      bool ok = false;
+      std::vector<std::pair<std::string, std::string>> outputs;
+      std::string diagnostics;
+      // files the compiler read besides the source, with their stamps when it read them.
+      std::vector<std::pair<std::string, std::string>> dependencies;
+    };
+
+    void work();
+
+    void handle(Request& request);
+
+    // compiles a request in a forked child of the server.
+    Result run(const Request& request);
+
+    // runs in the child, writes the outputs to 'out' as 'TARGET SIZE' frames.
+    static void run_child(const Request& request, int out);
+
+    void respond(Connection& connection, const std::string& response);
+
+    void error(const std::string& err);
+
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::deque<Request> m_queue;
+    bool m_stopping;
+
+    std::mutex m_cache_mutex;
+    std::unordered_map<std::string, Result> m_cache;
+  };
+
+  struct LoadOptions {
+    std::string path;
+    std::string source;
+    std::vector<std::string> args;
+    size_t requests = 1000;
+    size_t connections = 4;
+    // sends the same source every time, so the server answers from its cache, otherwise
+    // each request gets a different comment and is compiled.
+    bool cached = false;
+  };
+
+  // Sends 'requests' compile requests of 'source' to the server listening at 'path' over
+  // 'connections' connections, one request in flight per connection, and prints the
+  // requests per second and the latency percentiles.
+  void run_load(const LoadOptions& options);
+}
\ No newline at end of file
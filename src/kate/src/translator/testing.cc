@@ -0,0 +1,567 @@
+#include "testing.h"
+#include "comptime.h"
+#include "sem.h"
+
+#include "vm/compiler.h"
+#include "vm/machine.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace kate::tlr {
+  namespace {
+    std::optional<vm::Kind> kind(types::Type* type)
+    {
+      if (type->is<types::Vec>() || type->is<types::Mat>())
+        return kind(type->type());
+
+      auto name = type->mangledName();
+
+      if (name == "float")
+        return vm::Kind::kFloat;
+      else if (name == "int")
+        return vm::Kind::kInt;
+      else if (name == "uint")
+        return vm::Kind::kUint;
+
+      return std::nullopt;
+    }
+
+    // kind of each component of 'type' in the order the vm holds them.
+    bool kinds(types::Type* type, std::vector<vm::Kind>& result)
+    {
+      bool supported = true;
+
+      base::Match(
+        type,
+        [&](types::Scalar* scalar) {
+          auto k = kind(scalar);
+
+          if (k) result.push_back(k.value());
+          else supported = false;
+        },
+        [&](types::Vec* vec) {
+          auto k = kind(vec);
+
+          if (k) result.insert(result.end(), vec->columns(), k.value());
+          else supported = false;
+        },
+        [&](types::Mat* mat) {
+          auto k = kind(mat);
+
+          if (k) result.insert(result.end(), mat->columns() * mat->rows(), k.value());
+          else supported = false;
+        },
+        [&](types::Array* array) {
+          for (size_t i = 0; i < array->count() && supported; i++)
+            supported = kinds(array->type(), result);
+        },
+        [&](types::Custom* custom) {
+          for (auto& member : custom->members())
+            if (supported) supported = kinds(member.type(), result);
+        },
+        [&](types::Void*) {},
+        [&](base::Default) {
+          supported = false;
+        }
+      );
+
+      return supported;
+    }
+
+    uint32_t bits(double value, vm::Kind kind)
+    {
+      switch (kind) {
+        case vm::Kind::kFloat:
+          return std::bit_cast<uint32_t>(static_cast<float>(value));
+        case vm::Kind::kInt:
+          return static_cast<uint32_t>(static_cast<int32_t>(value));
+        default:
+          return static_cast<uint32_t>(value);
+      }
+    }
+
+    uint32_t bits(const ast::LitExpr::Value& literal, vm::Kind kind)
+    {
+      if (literal.type & ast::LitExpr::Value::Type::kFloatMask)
+        return bits(literal.value.f64, kind);
+
+      if (kind == vm::Kind::kFloat)
+        return literal.type & ast::LitExpr::Value::Type::kSignedIntMask
+          ? bits(static_cast<double>(literal.value.i64), kind)
+          : bits(static_cast<double>(literal.value.u64), kind);
+
+      // integers of both signs share the same bits.
+      return static_cast<uint32_t>(literal.value.u64);
+    }
+
+    uint32_t convert(uint32_t bits, vm::Kind from, vm::Kind to)
+    {
+      if (from == to || (from != vm::Kind::kFloat && to != vm::Kind::kFloat))
+        return bits;
+
+      if (from == vm::Kind::kFloat)
+        return to == vm::Kind::kInt
+          ? static_cast<uint32_t>(static_cast<int32_t>(std::bit_cast<float>(bits)))
+          : static_cast<uint32_t>(std::bit_cast<float>(bits));
+
+      return from == vm::Kind::kInt
+        ? std::bit_cast<uint32_t>(static_cast<float>(static_cast<int32_t>(bits)))
+        : std::bit_cast<uint32_t>(static_cast<float>(bits));
+    }
+
+    std::string component(uint32_t bits, vm::Kind kind)
+    {
+      switch (kind) {
+        case vm::Kind::kFloat:
+          return fmt::format("{}", std::bit_cast<float>(bits));
+        case vm::Kind::kInt:
+          return fmt::format("{}", static_cast<int32_t>(bits));
+        default:
+          return fmt::format("{}u", bits);
+      }
+    }
+
+    std::string to_string(types::Type* type, const uint32_t*& components)
+    {
+      std::string result;
+
+      auto join = [&](size_t count, auto&& item) {
+        for (size_t i = 0; i < count; i++)
+          result += (i ? ", " : "") + item(i);
+      };
+
+      base::Match(
+        type,
+        [&](types::Scalar* scalar) {
+          result = component(*components++, kind(scalar).value());
+        },
+        [&](types::Vec* vec) {
+          result = vec->mangledName() + "(";
+          join(vec->columns(), [&](size_t) { return component(*components++, kind(vec).value()); });
+          result += ")";
+        },
+        [&](types::Mat* mat) {
+          result = mat->mangledName() + "(";
+          join(mat->columns() * mat->rows(), [&](size_t) { return component(*components++, kind(mat).value()); });
+          result += ")";
+        },
+        [&](types::Array* array) {
+          result = "[";
+          join(array->count(), [&](size_t) { return to_string(array->type(), components); });
+          result += "]";
+        },
+        [&](types::Custom* custom) {
+          result = custom->name() + "(";
+          join(custom->members().size(), [&](size_t i) { return to_string(custom->members()[i].type(), components); });
+          result += ")";
+        },
+        [&](base::Default) {}
+      );
+
+      return result;
+    }
+
+    // evaluates an argument of a vector or matrix constructor with the components it adds.
+    std::optional<TestValue> eval_component(ast::Expr* expr)
+    {
+      if (auto callexpr = expr->as<ast::CallExpr>())
+        if (auto type = types::system().findType(callexpr->id()->ident()))
+          return eval(expr, type);
+
+      auto literal = comptime::eval(expr);
+
+      if (!literal) return std::nullopt;
+
+      if (literal->type & ast::LitExpr::Value::Type::kFloatMask)
+        return TestValue { types::system().findType("float"), { bits(literal.value(), vm::Kind::kFloat) } };
+      else if (literal->type & ast::LitExpr::Value::Type::kSignedIntMask)
+        return TestValue { types::system().findType("int"), { bits(literal.value(), vm::Kind::kInt) } };
+
+      return TestValue { types::system().findType("uint"), { bits(literal.value(), vm::Kind::kUint) } };
+    }
+  }
+
+  TestValue TestValue::of(const std::string& type, const std::vector<double>& components)
+  {
+    TestValue value { types::system().findType(type), {} };
+    std::vector<vm::Kind> component_kinds;
+
+    if (!value.type || !kinds(value.type, component_kinds)) {
+      fmt::println("Type '{}' can't be passed to the vm.", type);
+      std::exit(1);
+    }
+
+    if (component_kinds.size() != components.size()) {
+      fmt::println("'{}' has {} components, {} given.", type, component_kinds.size(), components.size());
+      std::exit(1);
+    }
+
+    for (size_t i = 0; i < components.size(); i++)
+      value.components.push_back(bits(components[i], component_kinds[i]));
+
+    return value;
+  }
+
+  std::string to_string(const TestValue& value)
+  {
+    if (!value.type || value.type->is<types::Void>())
+      return "nothing";
+
+    auto* components = value.components.data();
+
+    return to_string(value.type, components);
+  }
+
+  bool matches(
+    const TestValue& actual,
+    const TestValue& expected,
+    float tolerance
+  ) {
+    std::vector<vm::Kind> component_kinds;
+
+    if (actual.type != expected.type || !kinds(actual.type, component_kinds))
+      return false;
+
+    if (actual.components.size() != component_kinds.size() ||
+        expected.components.size() != component_kinds.size())
+      return false;
+
+    for (size_t i = 0; i < component_kinds.size(); i++) {
+      auto a = actual.components[i];
+      auto e = expected.components[i];
+
+      if (component_kinds[i] != vm::Kind::kFloat) {
+        if (a != e) return false;
+        continue;
+      }
+
+      auto af = std::bit_cast<float>(a);
+      auto ef = std::bit_cast<float>(e);
+
+      if (std::isnan(af) || std::isnan(ef)) {
+        if (std::isnan(af) != std::isnan(ef)) return false;
+        continue;
+      }
+
+      auto scale = std::max({ 1.0f, std::abs(af), std::abs(ef) });
+
+      if (af != ef && std::abs(af - ef) > tolerance * scale)
+        return false;
+    }
+
+    return true;
+  }
+
+  std::optional<TestValue> eval(ast::Expr* expr, types::Type* type)
+  {
+    TestValue result { type, {} };
+
+    if (auto array_expr = expr->as<ast::ArrayExpr>()) {
+      auto array = type->as<types::Array>();
+
+      if (!array || array->count() != array_expr->items().size())
+        return std::nullopt;
+
+      for (auto& item : array_expr->items()) {
+        auto value = eval(item.get(), array->type());
+
+        if (!value) return std::nullopt;
+
+        result.components.insert(result.components.end(), value->components.begin(), value->components.end());
+      }
+
+      return result;
+    }
+
+    auto callexpr = expr->as<ast::CallExpr>();
+
+    // scalars may also be written as a constant expression like '-1.0f' or '1u << 4u'.
+    if (!callexpr || !types::system().findType(callexpr->id()->ident())) {
+      auto k = type->is<types::Scalar>() ? kind(type) : std::nullopt;
+      auto literal = comptime::eval(expr);
+
+      if (!k || !literal) return std::nullopt;
+
+      result.components.push_back(bits(literal.value(), k.value()));
+
+      return result;
+    }
+
+    if (types::system().findType(callexpr->id()->ident()) != type)
+      return std::nullopt;
+
+    auto& args = callexpr->args();
+
+    if (auto custom = type->as<types::Custom>()) {
+      auto& members = custom->members();
+
+      if (args.size() != members.size()) return std::nullopt;
+
+      for (size_t i = 0; i < args.size(); i++) {
+        auto value = eval(args[i].get(), members[i].type());
+
+        if (!value) return std::nullopt;
+
+        result.components.insert(result.components.end(), value->components.begin(), value->components.end());
+      }
+
+      return result;
+    }
+
+    std::vector<vm::Kind> component_kinds;
+
+    if (type->is<types::Array>() || !kinds(type, component_kinds))
+      return std::nullopt;
+
+    auto k = component_kinds.front();
+
+    std::vector<std::pair<uint32_t, vm::Kind>> components;
+
+    for (auto& arg : args) {
+      auto value = eval_component(arg.get());
+      std::vector<vm::Kind> arg_kinds;
+
+      if (!value || !kinds(value->type, arg_kinds)) return std::nullopt;
+
+      for (size_t i = 0; i < arg_kinds.size(); i++)
+        components.emplace_back(value->components[i], arg_kinds[i]);
+    }
+
+    // a single scalar fills a vector, or the diagonal of a matrix.
+    if (components.size() == 1 && component_kinds.size() > 1) {
+      auto s = convert(components[0].first, components[0].second, k);
+
+      if (auto mat = type->as<types::Mat>()) {
+        auto zero = convert(0, vm::Kind::kUint, k);
+
+        for (size_t c = 0; c < mat->columns(); c++)
+          for (size_t r = 0; r < mat->rows(); r++)
+            result.components.push_back(c == r ? s : zero);
+      } else
+        result.components.assign(component_kinds.size(), s);
+
+      return result;
+    }
+
+    if (components.size() != component_kinds.size())
+      return std::nullopt;
+
+    for (auto& [component, from] : components)
+      result.components.push_back(convert(component, from, k));
+
+    return result;
+  }
+
+  TestRunner::TestRunner(ast::Module* module)
+    : m_module { module }
+  {
+  }
+
+  std::vector<TestValue> TestRunner::run(
+    const std::string& function,
+    const std::vector<std::vector<TestValue>>& cases
+  ) {
+    auto program = vm::Compiler(m_module).compile(function);
+
+    vm::Machine machine(program);
+
+    // tests don't own the memory of a dispatch, so buffers and uniforms read as zeros.
+    std::vector<std::vector<uint8_t>> memory;
+
+    for (auto& binding : program.bindings) {
+      auto bytes = binding.type->size(binding.layout);
+
+      if (auto array = binding.type->as<types::Array>(); array && array->count() == 0)
+        bytes = array->stride(binding.layout);
+
+      memory.emplace_back(bytes);
+      machine.bind(binding.name, memory.back().data(), bytes);
+    }
+
+    auto num_inputs = machine.input_components();
+    auto num_outputs = machine.output_components();
+
+    std::vector<uint32_t> inputs;
+    inputs.reserve(cases.size() * num_inputs);
+
+    for (auto& args : cases) {
+      if (args.size() != program.inputs.size())
+        error(fmt::format("'{}' takes {} arguments, {} given.", function, program.inputs.size(), args.size()));
+
+      for (size_t i = 0; i < args.size(); i++) {
+        auto& input = program.inputs[i];
+
+        if (args[i].type != input.type || args[i].components.size() != input.components)
+          error(fmt::format(
+            "Argument '{}' of '{}' is a '{}', not a '{}'.",
+            input.name,
+            function,
+            input.type->mangledName(),
+            args[i].type ? args[i].type->mangledName() : "?"
+          ));
+
+        inputs.insert(inputs.end(), args[i].components.begin(), args[i].components.end());
+      }
+    }
+
+    std::vector<uint32_t> outputs(cases.size() * num_outputs);
+
+    machine.invoke(cases.size(), inputs.data(), outputs.data());
+
+    std::vector<TestValue> results;
+
+    for (size_t i = 0; i < cases.size(); i++)
+      results.push_back(TestValue {
+        program.output.type,
+        { outputs.begin() + i * num_outputs, outputs.begin() + (i + 1) * num_outputs }
+      });
+
+    return results;
+  }
+
+  std::vector<TestResult> TestRunner::run_tests()
+  {
+    std::vector<TestResult> results;
+
+    for (auto& decl : m_module->global_declarations()) {
+      auto func = decl->as<ast::FuncDecl>();
+
+      if (!func) continue;
+
+      auto& attrs = func->attrs();
+
+      auto is_test = std::any_of(attrs.begin(), attrs.end(), [](auto& attr) {
+        return attr->type() == ast::Attr::Type::kTest;
+      });
+
+      if (is_test)
+        results.push_back(run_test(func));
+    }
+
+    return results;
+  }
+
+  TestResult TestRunner::run_test(ast::FuncDecl* func)
+  {
+    auto& params = func->args();
+    auto result_type = func->type()->sem()->type();
+
+    // the expected value of the '@test' attribute applies to cases without one.
+    ast::Expr* default_expected = nullptr;
+    std::vector<ast::Attr*> case_attrs;
+
+    for (auto& attr : func->attrs()) {
+      if (attr->type() == ast::Attr::Type::kTest) {
+        if (attr->args().size() > 1)
+          error(fmt::format("'@test' of '{}' takes at most an expected value.", func->name()));
+
+        if (!attr->args().empty())
+          default_expected = attr->args()[0].get();
+      } else if (attr->type() == ast::Attr::Type::kCase)
+        case_attrs.push_back(attr.get());
+    }
+
+    if (case_attrs.empty() && !params.empty())
+      error(fmt::format("Test '{}' takes arguments, give them with '@case(...)'.", func->name()));
+
+    std::vector<std::vector<TestValue>> cases;
+    std::vector<std::optional<TestValue>> expected;
+
+    auto expect = [&](ast::Expr* expr) {
+      if (!expr) {
+        expected.push_back(std::nullopt);
+        return;
+      }
+
+      auto value = eval(expr, result_type);
+
+      if (!value)
+        error(fmt::format(
+          "Expected value of test '{}' isn't a constant '{}'.",
+          func->name(),
+          result_type->mangledName()
+        ));
+
+      expected.push_back(std::move(value));
+    };
+
+    for (auto attr : case_attrs) {
+      auto& args = attr->args();
+
+      if (args.size() != params.size() && args.size() != params.size() + 1)
+        error(fmt::format(
+          "'@case' of '{}' takes {} arguments and an optional expected value, {} given.",
+          func->name(),
+          params.size(),
+          args.size()
+        ));
+
+      std::vector<TestValue> values;
+
+      for (size_t i = 0; i < params.size(); i++) {
+        auto type = params[i]->type()->sem()->type();
+        auto value = eval(args[i].get(), type);
+
+        if (!value)
+          error(fmt::format(
+            "Argument '{}' of a case of '{}' isn't a constant '{}'.",
+            params[i]->name(),
+            func->name(),
+            type->mangledName()
+          ));
+
+        values.push_back(std::move(value.value()));
+      }
+
+      cases.push_back(std::move(values));
+      expect(args.size() > params.size() ? args.back().get() : default_expected);
+    }
+
+    if (case_attrs.empty()) {
+      cases.emplace_back();
+      expect(default_expected);
+    }
+
+    TestResult result { func->name(), cases.size(), {} };
+
+    auto actual = run(func->name(), cases);
+
+    for (size_t i = 0; i < cases.size(); i++) {
+      bool passed;
+
+      if (expected[i])
+        passed = matches(actual[i], expected[i].value());
+      else
+        passed = std::all_of(actual[i].components.begin(), actual[i].components.end(), [](uint32_t c) {
+          return c != 0;
+        });
+
+      if (passed) continue;
+
+      std::string call = func->name() + "(";
+
+      for (size_t a = 0; a < cases[i].size(); a++)
+        call += (a ? ", " : "") + to_string(cases[i][a]);
+
+      call += ")";
+
+      result.failures.push_back(
+        expected[i]
+          ? fmt::format("{} returned {}, expected {}", call, to_string(actual[i]), to_string(expected[i].value()))
+          : fmt::format("{} returned {}", call, to_string(actual[i]))
+      );
+    }
+
+    return result;
+  }
+
+  void TestRunner::error(const std::string& err)
+  {
+    fmt::println("{}", err);
+    std::exit(1);
+  }
+}
\ No newline at end of file
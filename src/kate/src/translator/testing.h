@@ -0,0 +1,73 @@
+#pragma once
+
+#include "ast.h"
+#include "types.h"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace kate::tlr {
+  // an argument or result of a function run on the cpu.
+  struct TestValue {
+    types::Type* type = nullptr;
+    // 32-bit components in the order the vm holds them, matrices are column major.
+    std::vector<uint32_t> components;
+
+    // builds a value of the type named 'type', e.g. 'TestValue::of("float3", { 1, 2, 3 })'.
+    static TestValue of(const std::string& type, const std::vector<double>& components);
+  };
+
+  std::string to_string(const TestValue& value);
+
+  // floats match within a relative 'tolerance', other components must be equal.
+  bool matches(
+    const TestValue& actual,
+    const TestValue& expected,
+    float tolerance = 1e-5f
+  );
+
+  // evaluates a constant expression of 'type' like 'float2(1.0f, 2.0f)', returns
+  // std::nullopt when it isn't known at compile time.
+  std::optional<TestValue> eval(ast::Expr* expr, types::Type* type);
+
+  struct TestResult {
+    std::string name;
+    size_t cases = 0;
+    // a message for each case that didn't return what was expected.
+    std::vector<std::string> failures;
+  };
+
+  // Runs functions of a resolved module on the cpu through the vm.
+  //
+  // 'run_tests' runs every function marked '@test', written in one of these forms:
+  //
+  //   @test fn f() : T              passes when no component of the result is 0,
+  //                                 e.g. when it returns a comparison.
+  //   @test(v) fn f() : T           passes when the result is 'v'.
+  //   @test @case(a, b, v) @case(c, d, w) fn f(x: A, y: B) : T
+  //                                 passes when f(a, b) is 'v' and f(c, d) is 'w', the
+  //                                 expected value can be left out like above.
+  //
+  // All the cases of a function run in a single batch, 'vm::kLanes' of them at once.
+  // Buffers and uniforms read by tests are bound to zeroed memory.
+  class TestRunner {
+  public:
+    TestRunner(ast::Module* module);
+
+    // runs 'function' once per case, each case holds the arguments of a call.
+    std::vector<TestValue> run(
+      const std::string& function,
+      const std::vector<std::vector<TestValue>>& cases
+    );
+
+    std::vector<TestResult> run_tests();
+  private:
+    TestResult run_test(ast::FuncDecl* func);
+
+    void error(const std::string& err);
+
+    ast::Module* m_module;
+  };
+}
\ No newline at end of file
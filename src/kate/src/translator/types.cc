@@ -1,8 +1,64 @@
 #include "types.h"
 
+#include "base/numeric.h"
+
+#include <algorithm>
 #include <fmt/format.h>
 
 namespace kate::tlr::types {
+  namespace {
+    // std140 rounds the alignment of arrays, structs and matrix columns up to the one of a vec4.
+    uint64_t base_alignment(uint64_t alignment, Layout layout)
+    {
+      return layout == Layout::kStd140 ? std::max<uint64_t>(alignment, 16) : alignment;
+    }
+
+    // two component vectors are aligned to twice their component, three and four component ones to four times.
+    uint64_t vec_alignment(const Type* type, size_t columns, Layout layout)
+    {
+      if (layout == Layout::kScalar)
+        return type->alignment(layout);
+
+      return type->alignment(layout) * (columns == 2 ? 2 : 4);
+    }
+
+    bool same(Type* lhs, Type* rhs)
+    {
+      if (lhs->mangledName() != rhs->mangledName()) return false;
+
+      if (auto lcustom = lhs->as<Custom>()) {
+        auto rcustom = rhs->as<Custom>();
+
+        if (!rcustom || lcustom->members().size() != rcustom->members().size()) return false;
+
+        for (size_t i = 0; i < lcustom->members().size(); i++) {
+          auto& lmember = lcustom->members()[i];
+          auto& rmember = rcustom->members()[i];
+
+          if (lmember.name() != rmember.name() || lmember.type() != rmember.type()) return false;
+        }
+
+        return true;
+      }
+
+      return lhs->type() == rhs->type();
+    }
+
+    // whether 'type' is 'from' or made from it, e.g. an array of it or a struct with a member of its type.
+    bool made_from(Type* type, Type* from)
+    {
+      if (!type) return false;
+
+      if (type == from) return true;
+
+      if (auto custom = type->as<Custom>())
+        for (auto& member : custom->members())
+          if (made_from(member.type(), from)) return true;
+
+      return made_from(type->type(), from);
+    }
+  }
+
   Mat::Mat(
     Type* type,
     size_t rows,
@@ -38,6 +94,22 @@ namespace kate::tlr::types {
     return m_type->numSlots() * m_rows * m_columns;
   }
 
+  // matrices are laid out as an array of column vectors.
+  uint64_t Mat::size(Layout layout) const
+  {
+    return stride(layout) * m_columns;
+  }
+
+  uint64_t Mat::alignment(Layout layout) const
+  {
+    return base_alignment(vec_alignment(m_type, m_rows, layout), layout);
+  }
+
+  uint64_t Mat::stride(Layout layout) const
+  {
+    return base::align_up(m_type->size(layout) * m_rows, alignment(layout));
+  }
+
   Array::Array(Type* type, size_t count)
     : m_count { count },
       m_type { type }
@@ -56,9 +128,28 @@ namespace kate::tlr::types {
 
   std::string Array::mangledName() const
   {
+    if (m_count == 0)
+      return m_type->mangledName() + "[]";
+
     return fmt::format("{}[{}]", m_type->mangledName(), count()); 
   }
 
+  // unsized arrays have no size, only a stride.
+  uint64_t Array::size(Layout layout) const
+  {
+    return stride(layout) * m_count;
+  }
+
+  uint64_t Array::alignment(Layout layout) const
+  {
+    return base_alignment(m_type->alignment(layout), layout);
+  }
+
+  uint64_t Array::stride(Layout layout) const
+  {
+    return base::align_up(m_type->size(layout), alignment(layout));
+  }
+
   Ref::Ref(Type* toType)
     : m_type { toType }
   {
@@ -79,6 +170,16 @@ namespace kate::tlr::types {
     return m_type->type();
   }
 
+  uint64_t Ref::size(Layout layout) const
+  {
+    return m_type->size(layout);
+  }
+
+  uint64_t Ref::alignment(Layout layout) const
+  {
+    return m_type->alignment(layout);
+  }
+
   Custom::Member::Member(Type* type, const std::string& name)
     : m_type { type },
       m_name { name }
@@ -90,7 +191,7 @@ namespace kate::tlr::types {
     return m_name; 
   }
 
-  Type* Custom::Member::type()
+  Type* Custom::Member::type() const
   {
     return m_type;
   }
@@ -101,6 +202,25 @@ namespace kate::tlr::types {
   ) : m_name{ name },
       m_members { std::move(members) }
   {
+    for (size_t i = 0; i < m_layouts.size(); i++) {
+      auto layout = static_cast<Layout>(i);
+      auto& info = m_layouts[i];
+
+      uint64_t offset = 0;
+
+      for (auto& member : m_members) {
+        auto ty = member.type();
+
+        offset = base::align_up(offset, ty->alignment(layout));
+        info.offsets.push_back(offset);
+        info.alignment = std::max(info.alignment, ty->alignment(layout));
+
+        offset += ty->size(layout);
+      }
+
+      info.alignment = base_alignment(info.alignment, layout);
+      info.size = base::align_up(offset, info.alignment);
+    }
   }
 
   const std::string& Custom::Member::name() const
@@ -118,9 +238,31 @@ namespace kate::tlr::types {
     return m_members;
   }
 
+  uint64_t Custom::size(Layout layout) const
+  {
+    return m_layouts[static_cast<size_t>(layout)].size;
+  }
+
+  uint64_t Custom::alignment(Layout layout) const
+  {
+    return m_layouts[static_cast<size_t>(layout)].alignment;
+  }
+
+  uint64_t Custom::offset(size_t index, Layout layout) const
+  {
+    return m_layouts[static_cast<size_t>(layout)].offsets[index];
+  }
+
+  std::string Void::mangledName() const
+  {
+    return "void";
+  }
+
   Mgr::Mgr()
   {
-    m_type_table["half"] = std::make_unique<types::Scalar>("half");
+    m_type_table["void"] = std::make_unique<types::Void>();
+
+    m_type_table["half"] = std::make_unique<types::Scalar>("half", 2);
     
     for (auto i = 2; i <= 4; i++) {
       auto name = fmt::format("half{}", i);
@@ -132,7 +274,7 @@ namespace kate::tlr::types {
       }
     }
 
-    m_type_table["uhalf"] = std::make_unique<types::Scalar>("uhalf");
+    m_type_table["uhalf"] = std::make_unique<types::Scalar>("uhalf", 2);
     
     for (auto i = 2; i <= 4; i++) {
       auto name = fmt::format("uhalf{}", i);
@@ -144,7 +286,7 @@ namespace kate::tlr::types {
       }
     }
 
-    m_type_table["float"] = std::make_unique<types::Scalar>("float");
+    m_type_table["float"] = std::make_unique<types::Scalar>("float", 4);
     
     for (auto i = 2; i <= 4; i++) {
       auto name = fmt::format("float{}", i);
@@ -156,7 +298,7 @@ namespace kate::tlr::types {
       }
     }
 
-    m_type_table["double"] = std::make_unique<types::Scalar>("double");
+    m_type_table["double"] = std::make_unique<types::Scalar>("double", 8);
     
     for (auto i = 2; i <= 4; i++) {
       auto name = fmt::format("double{}", i);
@@ -168,7 +310,7 @@ namespace kate::tlr::types {
       }
     }
 
-    m_type_table["uint"] = std::make_unique<types::Scalar>("uint");
+    m_type_table["uint"] = std::make_unique<types::Scalar>("uint", 4);
     
     for (auto i = 2; i <= 4; i++) {
       auto name = fmt::format("uint{}", i);
@@ -180,7 +322,7 @@ namespace kate::tlr::types {
       }
     }
 
-    m_type_table["int"] = std::make_unique<types::Scalar>("int");
+    m_type_table["int"] = std::make_unique<types::Scalar>("int", 4);
     
     for (auto i = 2; i <= 4; i++) {
       auto name = fmt::format("int{}", i);
@@ -193,7 +335,7 @@ namespace kate::tlr::types {
     }
   }
 
-  types::Type* Mgr::findType(const std::string& type)
+  types::Type* Mgr::findType(std::string_view type)
   {
     auto it = m_type_table.find(type);
 
@@ -206,10 +348,55 @@ namespace kate::tlr::types {
   )
   {
     auto ptr = type.get();
+    auto& entry = m_type_table[name];
+
+    // compiling a module again declares its structs again, the ones that didn't change are kept,
+    // along with the types made from them.
+    if (entry && same(entry.get(), ptr)) return entry.get();
+
+    // types made from the one being replaced, e.g. by an earlier compile, may still be used.
+    if (entry) {
+      auto replaced = std::move(entry);
+      retire(replaced.get());
+      m_retired.push_back(std::move(replaced));
+    }
+
     m_type_table[name] = std::move(type);
     return ptr;
   }
 
+  void Mgr::retire(Type* type)
+  {
+    std::vector<std::string> stale;
+
+    for (auto& [name, entry] : m_type_table)
+      if (entry && entry.get() != type && made_from(entry.get(), type))
+        stale.push_back(name);
+
+    // they are made again, from the new type, the next time they're looked for.
+    for (auto& name : stale) {
+      auto it = m_type_table.find(name);
+
+      if (it == m_type_table.end()) continue;
+
+      auto retired = std::move(it->second);
+      m_type_table.erase(it);
+
+      retire(retired.get());
+      m_retired.push_back(std::move(retired));
+    }
+  }
+
+  void Mgr::collect()
+  {
+    m_retired.clear();
+  }
+
+  size_t Mgr::size() const
+  {
+    return m_type_table.size() + m_retired.size();
+  }
+
   Mgr& system()
   {
     static Mgr mgr;
@@ -242,7 +429,19 @@ namespace kate::tlr::types {
     return m_type->numSlots() * m_columns;
   }
 
-  Scalar::Scalar(const std::string& name) : m_name { name }
+  uint64_t Vec::size(Layout layout) const
+  {
+    return m_type->size(layout) * m_columns;
+  }
+
+  uint64_t Vec::alignment(Layout layout) const
+  {
+    return vec_alignment(m_type, m_columns, layout);
+  }
+
+  Scalar::Scalar(const std::string& name, uint64_t size)
+    : m_name { name },
+      m_size { size }
   {
   }
 
@@ -255,6 +454,16 @@ namespace kate::tlr::types {
   {
     return 1;
   }
+
+  uint64_t Scalar::size(Layout layout) const
+  {
+    return m_size;
+  }
+
+  uint64_t Scalar::alignment(Layout layout) const
+  {
+    return m_size;
+  }
 }
 
 TS_RTTI_TYPE(kate::tlr::types::Type)
@@ -263,4 +472,5 @@ TS_RTTI_TYPE(kate::tlr::types::Array)
 TS_RTTI_TYPE(kate::tlr::types::Vec)
 TS_RTTI_TYPE(kate::tlr::types::Custom)
 TS_RTTI_TYPE(kate::tlr::types::Scalar)
-TS_RTTI_TYPE(kate::tlr::types::Ref)
\ No newline at end of file
+TS_RTTI_TYPE(kate::tlr::types::Ref)
+TS_RTTI_TYPE(kate::tlr::types::Void)
\ No newline at end of file
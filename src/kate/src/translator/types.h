@@ -1,13 +1,24 @@
 #pragma once
 
+#include <array>
 #include <cstddef>
 #include <string>
 #include <memory>
 
+#include "base/hash_map.h"
 #include "base/rtti.h"
 #include "ast.h"
 
 namespace kate::tlr::types {
+  // rules used to lay out types in memory shared with the gpu.
+  enum class Layout {
+    kStd140,
+    kStd430,
+    // scalar block layout, every type is aligned to its components.
+    kScalar,
+    kCount
+  };
+
   class Type : public base::rtti::Castable<Type, base::rtti::Base> {
   public:
     virtual ~Type() = default;
@@ -17,6 +28,12 @@ namespace kate::tlr::types {
     virtual uint64_t numSlots() const { return 0; }
 
     virtual Type* type() { return nullptr; }
+
+    // size in bytes of the type when laid out with the given rules.
+    virtual uint64_t size(Layout layout) const { return 0; }
+
+    // alignment in bytes of the type when laid out with the given rules.
+    virtual uint64_t alignment(Layout layout) const { return 1; }
   };
 
   class Ref : public base::rtti::Castable<Ref, Type> {
@@ -30,6 +47,10 @@ namespace kate::tlr::types {
     Type* type() override;
 
     std::string mangledName() const override;
+
+    uint64_t size(Layout layout) const override;
+
+    uint64_t alignment(Layout layout) const override;
   private:
     Type* m_type;
   };
@@ -49,6 +70,13 @@ namespace kate::tlr::types {
     std::string mangledName() const override;
 
     uint64_t numSlots() const override;
+
+    uint64_t size(Layout layout) const override;
+
+    uint64_t alignment(Layout layout) const override;
+
+    // distance in bytes between two consecutive columns.
+    uint64_t stride(Layout layout) const;
   private:
     Type* m_type;
     size_t m_rows;
@@ -66,6 +94,13 @@ namespace kate::tlr::types {
     Type* type() override;
 
     std::string mangledName() const override;
+
+    uint64_t size(Layout layout) const override;
+
+    uint64_t alignment(Layout layout) const override;
+
+    // distance in bytes between two consecutive elements.
+    uint64_t stride(Layout layout) const;
   private:
     Type* m_type;
     size_t m_count;
@@ -75,13 +110,18 @@ namespace kate::tlr::types {
   public:
     Scalar() = delete;
 
-    Scalar(const std::string& name);
+    Scalar(const std::string& name, uint64_t size);
 
     std::string mangledName() const override;
 
     uint64_t numSlots() const override;
+
+    uint64_t size(Layout layout) const override;
+
+    uint64_t alignment(Layout layout) const override;
   private:
     std::string m_name;
+    uint64_t m_size;
   };
 
   class Vec : public base::rtti::Castable<Vec, Type> {
@@ -97,11 +137,21 @@ namespace kate::tlr::types {
     std::string mangledName() const override;
 
     uint64_t numSlots() const override;
+
+    uint64_t size(Layout layout) const override;
+
+    uint64_t alignment(Layout layout) const override;
   private:
     Type* m_type;
     size_t m_columns;
   };
 
+  // type of functions that don't return anything.
+  class Void : public base::rtti::Castable<Void, Type> {
+  public:
+    std::string mangledName() const override;
+  };
+
   class Custom : public base::rtti::Castable<Custom, Type> {
   public:
     class Member { 
@@ -110,7 +160,7 @@ namespace kate::tlr::types {
 
       Member(Type* type, const std::string& name);
 
-      Type* type();
+      Type* type() const;
 
       const std::string& name() const;
     private:
@@ -130,23 +180,48 @@ namespace kate::tlr::types {
     std::vector<Member>& members();
 
     std::string mangledName() const override;
+
+    uint64_t size(Layout layout) const override;
+
+    uint64_t alignment(Layout layout) const override;
+
+    // offset in bytes of the member at 'index' from the start of the struct.
+    uint64_t offset(size_t index, Layout layout) const;
   private:
+    // members never change once the struct is created, so its layouts are computed upfront.
+    struct LayoutInfo {
+      uint64_t size = 0;
+      uint64_t alignment = 1;
+      std::vector<uint64_t> offsets;
+    };
+
     std::string m_name;
     std::vector<Member> m_members;
+    std::array<LayoutInfo, static_cast<size_t>(Layout::kCount)> m_layouts;
   };
 
   class Mgr {
   public:
     Mgr();
 
-    Type* findType(const std::string& name);
+    Type* findType(std::string_view name);
     
     types::Type* addType(
       const std::string& name,
       std::unique_ptr<Type>&& type
     );
+
+    // frees the types replaced so far, once no tree made before holds them.
+    void collect();
+
+    // number of types, replaced ones included.
+    size_t size() const;
   private:
-    std::unordered_map<std::string, std::unique_ptr<Type>> m_type_table;
+    // drops the types made from 'type', keeping them alive for the trees using them.
+    void retire(Type* type);
+
+    base::HashMap<std::string, std::unique_ptr<Type>> m_type_table;
+    std::vector<std::unique_ptr<Type>> m_retired;
   };
 
   Mgr& system();
@@ -0,0 +1,138 @@
+#include "bytecode.h"
+
+#include <fmt/format.h>
+
+namespace kate::tlr::vm {
+  namespace {
+    constexpr const char* kOpNames[] = {
+      "const", "mov",
+      "add.f", "add.i",
+      "sub.f", "sub.i",
+      "mul.f", "mul.i",
+      "div.f", "div.i", "div.u",
+      "mod.f", "mod.i", "mod.u",
+      "and", "or", "xor",
+      "shl", "shr.i", "shr.u",
+      "neg.f", "neg.i",
+      "not",
+      "bitnot",
+      "eq.f", "eq.i",
+      "ne.f", "ne.i",
+      "lt.f", "lt.i", "lt.u",
+      "le.f", "le.i", "le.u",
+      "land",
+      "lor",
+      "ftoi",
+      "ftou",
+      "itof",
+      "utof",
+      "gather",
+      "scatter",
+      "load",
+      "store",
+      "if",
+      "else",
+      "enter",
+      "leave",
+      "loopcond",
+      "loopback",
+      "kill"
+    };
+
+    static_assert(std::size(kOpNames) == static_cast<size_t>(Op::kCount));
+
+    std::string reg(uint32_t r)
+    {
+      return r == kNoReg ? std::string("-") : fmt::format("r{}", r);
+    }
+  }
+
+  std::string disassemble(const Program& program)
+  {
+    std::string out = fmt::format(
+      "; {}: {} registers, control depth {}, workgroup size ({}, {}, {})\n",
+      program.entry,
+      program.num_registers,
+      program.max_depth,
+      program.workgroup_size[0],
+      program.workgroup_size[1],
+      program.workgroup_size[2]
+    );
+
+    for (size_t i = 0; i < program.bindings.size(); i++)
+      out += fmt::format(
+        "; binding {}: {} {}{}\n",
+        i,
+        program.bindings[i].name,
+        program.bindings[i].type->mangledName(),
+        program.bindings[i].writable ? "" : " (read only)"
+      );
+
+    for (auto& input : program.inputs)
+      out += fmt::format(
+        "; input {}: r{}..r{}{}\n",
+        input.name,
+        input.reg,
+        input.reg + input.components - 1,
+        input.builtin.empty() ? "" : fmt::format(" @builtin({})", input.builtin)
+      );
+
+    if (program.output.components)
+      out += fmt::format("; output: r{}..r{}\n", program.output.reg, program.output.reg + program.output.components - 1);
+
+    for (size_t pc = 0; pc < program.code.size(); pc++) {
+      auto& instr = program.code[pc];
+      auto name = kOpNames[static_cast<size_t>(instr.op)];
+
+      switch (instr.op) {
+        case Op::kConst:
+          out += fmt::format("{:5}  {:10} {}, {:#x}\n", pc, name, reg(instr.dst), instr.a);
+          break;
+        case Op::kGather:
+        case Op::kScatter:
+          out += fmt::format(
+            "{:5}  {:10} {}, r{} + {} * {} (count {})\n",
+            pc, name, reg(instr.dst), instr.a, reg(instr.b), instr.d, instr.c
+          );
+          break;
+        case Op::kLoad:
+        case Op::kStore:
+          out += fmt::format(
+            "{:5}  {:10} {}, binding {} [{} + {}]\n",
+            pc, name, reg(instr.dst), instr.a, reg(instr.b), instr.c
+          );
+          break;
+        case Op::kIf:
+        case Op::kLoopCond:
+          out += fmt::format("{:5}  {:10} {}, @{}\n", pc, name, reg(instr.a), instr.b);
+          break;
+        case Op::kElse:
+        case Op::kLoopBack:
+          out += fmt::format("{:5}  {:10} @{}\n", pc, name, instr.b);
+          break;
+        case Op::kMov:
+        case Op::kNegF:
+        case Op::kNegI:
+        case Op::kNot:
+        case Op::kBitNot:
+        case Op::kFloatToInt:
+        case Op::kFloatToUint:
+        case Op::kIntToFloat:
+        case Op::kUintToFloat:
+          out += fmt::format("{:5}  {:10} {}, {}\n", pc, name, reg(instr.dst), reg(instr.a));
+          break;
+        case Op::kEnter:
+        case Op::kLeave:
+          out += fmt::format("{:5}  {}\n", pc, name);
+          break;
+        case Op::kKill:
+          out += fmt::format("{:5}  {:10} depth {}\n", pc, name, instr.a);
+          break;
+        default:
+          out += fmt::format("{:5}  {:10} {}, {}, {}\n", pc, name, reg(instr.dst), reg(instr.a), reg(instr.b));
+      }
+    }
+
+    return out;
+  }
+}
\ No newline at end of file
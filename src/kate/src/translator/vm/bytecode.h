@@ -0,0 +1,133 @@
+#pragma once
+
+#include "../types.h"
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace kate::tlr::vm {
+  // invocations run together by the vm, one per 32-bit lane of a 256-bit register.
+  constexpr size_t kLanes = 8;
+
+  // marks an unused register operand.
+  constexpr uint32_t kNoReg = UINT32_MAX;
+
+  enum class Kind : uint8_t {
+    kFloat,
+    kInt,
+    kUint
+  };
+
+  // Every register holds one 32-bit component for each lane, so a 'float3' takes three
+  // registers. Instructions only write to the lanes enabled in the execution mask.
+  enum class Op : uint8_t {
+    // dst = a, where 'a' holds the bits of the constant.
+    kConst,
+    // dst = a
+    kMov,
+
+    // dst = a op b, integer variants are shared by signed and unsigned integers
+    // when the result bits are the same.
+    kAddF, kAddI,
+    kSubF, kSubI,
+    kMulF, kMulI,
+    kDivF, kDivI, kDivU,
+    kModF, kModI, kModU,
+    kAnd, kOr, kXor,
+    kShl, kShrI, kShrU,
+
+    // dst = op a
+    kNegF, kNegI,
+    kNot,
+    kBitNot,
+
+    // dst = a op b as an 'int' holding 0 or 1.
+    kEqF, kEqI,
+    kNeF, kNeI,
+    kLtF, kLtI, kLtU,
+    kLeF, kLeI, kLeU,
+    kLogicalAnd,
+    kLogicalOr,
+
+    // dst = kind(a)
+    kFloatToInt,
+    kFloatToUint,
+    kIntToFloat,
+    kUintToFloat,
+
+    // dst = register (a + b * d), where 'b' is an index below 'c', out of bounds reads give 0.
+    kGather,
+    // register (a + b * d) = dst, out of bounds writes are dropped.
+    kScatter,
+
+    // dst = 32 bits of binding 'a' at byte 'b + c', 'b' being a register or 'kNoReg'.
+    // out of bounds reads give 0, out of bounds writes are dropped.
+    kLoad,
+    kStore,
+
+    // Divergent control flow, the control stack saves the mask of enclosing constructs.
+    //
+    // if:    push the mask, keep the lanes where 'a' is not 0, jump to 'b' when none are left.
+    // else:  switch to the lanes that failed the condition, jump to 'b' when none are left.
+    // enter: push the mask, starts a loop or a function.
+    // leave: pop the mask, ends an if, a loop or a function.
+    kIf,
+    kElse,
+    kEnter,
+    kLeave,
+
+    // drop the lanes where 'a' is 0, jump to 'b' when none are left.
+    kLoopCond,
+    // jump to 'b' while some lanes are left.
+    kLoopBack,
+
+    // disable the running lanes until the construct at depth 'a' of the control stack
+    // is left, it's a 'break' when it's a loop and a 'return' when it's a function.
+    kKill,
+
+    kCount
+  };
+
+  struct Instr {
+    Op op;
+    uint32_t dst = kNoReg;
+    uint32_t a = 0;
+    uint32_t b = 0;
+    uint32_t c = 0;
+    uint32_t d = 0;
+  };
+
+  // a buffer or uniform bound from host memory.
+  struct Binding {
+    std::string name;
+    types::Type* type;
+    types::Layout layout;
+    bool writable;
+  };
+
+  // an argument or the return value of the compiled function, held in consecutive registers.
+  struct Param {
+    std::string name;
+    types::Type* type = nullptr;
+    std::string builtin;
+    uint32_t reg = 0;
+    uint32_t components = 0;
+  };
+
+  struct Program {
+    std::string entry;
+    std::vector<Instr> code;
+    uint32_t num_registers = 0;
+    // deepest nesting of ifs, loops and inlined functions.
+    uint32_t max_depth = 0;
+
+    std::vector<Binding> bindings;
+    std::vector<Param> inputs;
+    Param output;
+    std::array<uint32_t, 3> workgroup_size = { 1, 1, 1 };
+  };
+
+  std::string disassemble(const Program& program);
+}
\ No newline at end of file
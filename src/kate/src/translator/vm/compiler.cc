@@ -0,0 +1,1267 @@
+#include "compiler.h"
+#include "../comptime.h"
+#include "../sem.h"
+#include "base/rtti.h"
+
+#include <algorithm>
+#include <bit>
+#include <fmt/format.h>
+
+namespace kate::tlr::vm {
+  namespace {
+    ast::Attr* find_attr(
+      ast::List<ast::Attr>& attrs,
+      ast::Attr::Type type
+    )
+    {
+      for (auto& attr : attrs)
+        if (attr->type() == type)
+          return attr.get();
+
+      return nullptr;
+    }
+
+    // operator applied by a compound assignment, e.g. '+' for '+='.
+    std::optional<ast::BinaryExpr::Type> compound_operator(ast::BinaryExpr::Type type)
+    {
+      switch (type) {
+        case ast::BinaryExpr::Type::kCompoundAdd:
+        case ast::BinaryExpr::Type::kAddEqual:
+          return ast::BinaryExpr::Type::kAdd;
+        case ast::BinaryExpr::Type::kCompoundSub:
+        case ast::BinaryExpr::Type::kSubtractEqual:
+          return ast::BinaryExpr::Type::KSub;
+        case ast::BinaryExpr::Type::kCompoundMul:
+        case ast::BinaryExpr::Type::kMultiplyEqual:
+          return ast::BinaryExpr::Type::kMul;
+        case ast::BinaryExpr::Type::kCompoundDiv:
+        case ast::BinaryExpr::Type::kDivideEqual:
+          return ast::BinaryExpr::Type::kDiv;
+        case ast::BinaryExpr::Type::kCompoundMod:
+        case ast::BinaryExpr::Type::kModulusEqual:
+          return ast::BinaryExpr::Type::kMod;
+        case ast::BinaryExpr::Type::kOrEqual:
+          return ast::BinaryExpr::Type::kBitOr;
+        case ast::BinaryExpr::Type::kXorEqual:
+          return ast::BinaryExpr::Type::kBitXor;
+        case ast::BinaryExpr::Type::kAndEqual:
+          return ast::BinaryExpr::Type::kBitAnd;
+        case ast::BinaryExpr::Type::kLeftShiftEqual:
+          return ast::BinaryExpr::Type::kLeftShift;
+        case ast::BinaryExpr::Type::kRightShiftEqual:
+          return ast::BinaryExpr::Type::kRightShift;
+        default:
+          return std::nullopt;
+      }
+    }
+
+    size_t component_index(char c)
+    {
+      constexpr std::string_view kComponents = "xyzw";
+      constexpr std::string_view kColorComponents = "rgba";
+
+      if (auto i = kComponents.find(c); i != std::string_view::npos)
+        return i;
+
+      return kColorComponents.find(c);
+    }
+
+    std::vector<uint32_t> slice(
+      const std::vector<uint32_t>& regs,
+      size_t first,
+      size_t count
+    )
+    {
+      return std::vector<uint32_t>(regs.begin() + first, regs.begin() + first + count);
+    }
+
+    bool contiguous(const std::vector<uint32_t>& regs)
+    {
+      for (size_t i = 1; i < regs.size(); i++)
+        if (regs[i] != regs[0] + i)
+          return false;
+
+      return true;
+    }
+  }
+
+  Compiler::Compiler(ast::Module* module)
+    : m_module { module },
+      m_next_reg { 0 },
+      m_depth { 0 }
+  {
+  }
+
+  Program Compiler::compile(const std::string& function)
+  {
+    auto func = find_function(function);
+
+    if (!func)
+      error(fmt::format("Unable to find function '{}'.", function));
+
+    m_program = Program { .entry = function };
+    m_frames.clear();
+    m_globals.clear();
+    m_bindings.clear();
+    m_next_reg = 0;
+    m_depth = 0;
+
+    for (auto& decl : m_module->global_declarations())
+      if (decl->is<ast::BufferDecl>() || decl->is<ast::UniformDecl>() || decl->is<ast::ConstDecl>())
+        m_globals[decl->as<ast::Decl>()->name()] = decl->as<ast::Decl>();
+
+    if (auto attr = find_attr(func->attrs(), ast::Attr::Type::kWorkgroupSize)) {
+      auto consts = comptime::consts(m_module);
+
+      for (size_t i = 0; i < attr->args().size() && i < 3; i++) {
+        auto value = comptime::eval(attr->args()[i].get(), &consts);
+
+        if (!value || !(value->type & ast::LitExpr::Value::Type::kIntMask))
+          error(fmt::format("Workgroup size of '{}' must be an integer known at compile time.", function));
+
+        m_program.workgroup_size[i] = static_cast<uint32_t>(value->value.u64);
+      }
+    }
+
+    // the arguments and result of the entry are the registers the machine fills and reads.
+    std::vector<Value> args;
+
+    for (auto& arg : func->args()) {
+      auto value = alloc(arg->type()->sem()->type());
+
+      Param input {
+        .name = arg->name(),
+        .type = value.type,
+        .reg = value.regs.empty() ? 0 : value.regs[0],
+        .components = static_cast<uint32_t>(value.regs.size())
+      };
+
+      // '@builtin(name)' or just '@builtin' when the argument is named after it.
+      if (auto builtin = find_attr(arg->attrs(), ast::Attr::Type::kBuiltin)) {
+        input.builtin = arg->name();
+
+        if (!builtin->args().empty())
+          if (auto id = builtin->args()[0]->as<ast::IdExpr>())
+            input.builtin = id->ident();
+      }
+
+      m_program.inputs.push_back(std::move(input));
+      args.push_back(std::move(value));
+    }
+
+    auto result = alloc(func->type()->sem()->type());
+
+    m_program.output = Param {
+      .name = function,
+      .type = result.type,
+      .reg = result.regs.empty() ? 0 : result.regs[0],
+      .components = static_cast<uint32_t>(result.regs.size())
+    };
+
+    inline_function(func, args, result);
+
+    return std::move(m_program);
+  }
+
+  void Compiler::inline_function(
+    ast::FuncDecl* func,
+    const std::vector<Value>& args,
+    const Value& result
+  )
+  {
+    emit(Op::kEnter, kNoReg);
+    enter();
+
+    Frame frame {
+      .func = func,
+      .result = result,
+      .depth = m_depth - 1
+    };
+
+    frame.scopes.emplace_back();
+
+    for (size_t i = 0; i < args.size(); i++)
+      frame.scopes.back()[func->args()[i]->name()] = Place {
+        .kind = Place::Kind::kRegisters,
+        .type = args[i].type,
+        .regs = args[i].regs
+      };
+
+    m_frames.push_back(std::move(frame));
+
+    compile(func->block().get());
+
+    m_frames.pop_back();
+
+    emit(Op::kLeave, kNoReg);
+    leave();
+  }
+
+  void Compiler::compile(ast::Stat* stat)
+  {
+    auto mark = m_next_reg;
+
+    base::Match(
+      stat,
+      [&](ast::IfStat* if_stat) {
+        compile(if_stat);
+      },
+      [&](ast::ForStat* for_stat) {
+        compile(for_stat);
+      },
+      [&](ast::WhileStat* while_stat) {
+        compile(while_stat);
+      },
+      [&](ast::BlockStat* block_stat) {
+        compile(block_stat);
+      },
+      [&](ast::VarStat* var_stat) {
+        compile(var_stat);
+      },
+      [&](ast::ExprStat* expr_stat) {
+        value(expr_stat->expr().get());
+      },
+      [&](ast::BreakStat* break_stat) {
+        if (frame().loops.empty())
+          error("'break' must be inside of a loop.");
+
+        emit(Op::kKill, kNoReg, frame().loops.back());
+      },
+      [&](ast::ReturnStat* return_stat) {
+        compile(return_stat);
+      },
+      [&](base::Default) {
+        error("Unsupported statement.");
+      }
+    );
+
+    // variables live until the end of their block, temporaries until the end of the statement.
+    if (!stat->is<ast::VarStat>())
+      m_next_reg = mark;
+  }
+
+  void Compiler::compile(ast::BlockStat* block)
+  {
+    auto mark = m_next_reg;
+
+    frame().scopes.emplace_back();
+
+    for (auto& stat : block->stats())
+      compile(stat.get());
+
+    frame().scopes.pop_back();
+
+    m_next_reg = mark;
+  }
+
+  void Compiler::compile(ast::VarStat* var_stat)
+  {
+    auto type = var_stat->decl()->sem()->type();
+    auto var = alloc(type);
+    auto mark = m_next_reg;
+
+    auto init = var_stat->expr() ? value(var_stat->expr().get()) : zero(type);
+
+    if (init.regs.size() != var.regs.size())
+      error(fmt::format("Initializer of '{}' doesn't match its type.", var_stat->decl()->name()));
+
+    for (size_t i = 0; i < var.regs.size(); i++)
+      emit(Op::kMov, var.regs[i], init.regs[i]);
+
+    m_next_reg = mark;
+
+    frame().scopes.back()[var_stat->decl()->name()] = Place {
+      .kind = Place::Kind::kRegisters,
+      .type = type,
+      .regs = std::move(var.regs)
+    };
+  }
+
+  void Compiler::compile(ast::IfStat* if_stat)
+  {
+    auto condition = scalar(value(if_stat->condition().get()));
+    auto if_pc = emit(Op::kIf, kNoReg, condition);
+
+    enter();
+
+    compile(if_stat->block().get());
+
+    if (if_stat->elseBlock()) {
+      auto else_pc = emit(Op::kElse, kNoReg);
+      m_program.code[if_pc].b = else_pc;
+
+      compile(if_stat->elseBlock().get());
+
+      m_program.code[else_pc].b = emit(Op::kLeave, kNoReg);
+    } else
+      m_program.code[if_pc].b = emit(Op::kLeave, kNoReg);
+
+    leave();
+  }
+
+  void Compiler::compile(ast::ForStat* for_stat)
+  {
+    auto mark = m_next_reg;
+
+    frame().scopes.emplace_back();
+
+    if (for_stat->initializer())
+      compile(for_stat->initializer().get());
+
+    compile_loop(
+      for_stat->condition().get(),
+      for_stat->block().get(),
+      for_stat->continuing() ? for_stat->continuing()->expr().get() : nullptr
+    );
+
+    frame().scopes.pop_back();
+
+    m_next_reg = mark;
+  }
+
+  void Compiler::compile(ast::WhileStat* while_stat)
+  {
+    compile_loop(
+      while_stat->condition().get(),
+      while_stat->block().get(),
+      nullptr
+    );
+  }
+
+  void Compiler::compile_loop(
+    ast::Expr* condition,
+    ast::BlockStat* block,
+    ast::Expr* continuing
+  )
+  {
+    emit(Op::kEnter, kNoReg);
+    enter();
+
+    frame().loops.push_back(m_depth - 1);
+
+    auto head = static_cast<uint32_t>(m_program.code.size());
+    auto mark = m_next_reg;
+    std::optional<uint32_t> condition_pc;
+
+    if (condition)
+      condition_pc = emit(Op::kLoopCond, kNoReg, scalar(value(condition)));
+
+    m_next_reg = mark;
+
+    compile(block);
+
+    if (continuing) {
+      value(continuing);
+      m_next_reg = mark;
+    }
+
+    emit(Op::kLoopBack, kNoReg, 0, head);
+
+    auto exit = emit(Op::kLeave, kNoReg);
+
+    if (condition_pc)
+      m_program.code[*condition_pc].b = exit;
+
+    frame().loops.pop_back();
+
+    leave();
+  }
+
+  void Compiler::compile(ast::ReturnStat* return_stat)
+  {
+    if (return_stat->expr()) {
+      auto result = value(return_stat->expr().get());
+      auto& regs = frame().result.regs;
+
+      if (result.regs.size() != regs.size())
+        error(fmt::format("Return value doesn't match the type of '{}'.", frame().func->name()));
+
+      for (size_t i = 0; i < regs.size(); i++)
+        emit(Op::kMov, regs[i], result.regs[i]);
+    }
+
+    emit(Op::kKill, kNoReg, frame().depth);
+  }
+
+  Compiler::Value Compiler::value(ast::Expr* expr)
+  {
+    Value result;
+
+    base::Match(
+      expr,
+      [&](ast::BinaryExpr* bexpr) {
+        result = value(bexpr);
+      },
+      [&](ast::UnaryExpr* uexpr) {
+        result = value(uexpr);
+      },
+      [&](ast::CallExpr* callexpr) {
+        result = value(callexpr);
+      },
+      [&](ast::LitExpr* litexpr) {
+        result = value(litexpr->value());
+      },
+      [&](ast::IdExpr* idexpr) {
+        result = read(place(idexpr));
+      },
+      [&](ast::ArrayExpr* array_expr) {
+        result.type = array_expr->sem()->type();
+
+        for (auto& item : array_expr->items()) {
+          auto item_value = value(item.get());
+          result.regs.insert(result.regs.end(), item_value.regs.begin(), item_value.regs.end());
+        }
+      },
+      [&](base::Default) {
+        error("Unsupported expression.");
+      }
+    );
+
+    return result;
+  }
+
+  Compiler::Value Compiler::value(ast::BinaryExpr* bexpr)
+  {
+    switch (bexpr->type()) {
+      case ast::BinaryExpr::Type::kMemberAccess:
+      case ast::BinaryExpr::Type::kSwizzle:
+      case ast::BinaryExpr::Type::kIndexAccessor:
+        return read(place(bexpr));
+      case ast::BinaryExpr::Type::kEqual: {
+        auto rhs = value(bexpr->rhs().get());
+
+        write(place(bexpr->lhs().get()), rhs);
+
+        return rhs;
+      }
+      case ast::BinaryExpr::Type::kIncrement:
+      case ast::BinaryExpr::Type::kDecrement: {
+        auto target = place(bexpr->lhs().get());
+        auto current = read(target);
+        auto one = kind(current.type) == Kind::kFloat ? std::bit_cast<uint32_t>(1.0f) : 1u;
+
+        auto result = arithmetic(
+          bexpr->type() == ast::BinaryExpr::Type::kIncrement
+            ? ast::BinaryExpr::Type::kAdd
+            : ast::BinaryExpr::Type::KSub,
+          current,
+          Value { current.type, std::vector<uint32_t>(current.regs.size(), constant(one)) }
+        );
+
+        write(target, result);
+
+        return result;
+      }
+      case ast::BinaryExpr::Type::kComma:
+        value(bexpr->lhs().get());
+
+        return value(bexpr->rhs().get());
+      default:
+        break;
+    }
+
+    if (auto op = compound_operator(bexpr->type())) {
+      auto target = place(bexpr->lhs().get());
+      auto rhs = value(bexpr->rhs().get());
+      auto result = arithmetic(*op, read(target), rhs);
+
+      write(target, result);
+
+      return result;
+    }
+
+    auto lhs = value(bexpr->lhs().get());
+    auto rhs = value(bexpr->rhs().get());
+
+    return arithmetic(bexpr->type(), lhs, rhs);
+  }
+
+  Compiler::Value Compiler::arithmetic(
+    ast::BinaryExpr::Type type,
+    const Value& lhs,
+    const Value& rhs
+  )
+  {
+    if (lhs.regs.size() != rhs.regs.size())
+      error("Operands of binary expressions must have the same number of components.");
+
+    auto k = kind(lhs.type);
+
+    // a product of matrices is the one of linear algebra, other operators work on each component.
+    if (auto mat = lhs.type->as<types::Mat>();
+        mat && (type == ast::BinaryExpr::Type::kMul || type == ast::BinaryExpr::Type::kMultiply)) {
+      if (mat->rows() != mat->columns())
+        error(fmt::format("Can't multiply '{}' by itself.", mat->mangledName()));
+
+      auto n = mat->rows();
+      auto result = alloc(lhs.type);
+      auto mul = k == Kind::kFloat ? Op::kMulF : Op::kMulI;
+      auto add = k == Kind::kFloat ? Op::kAddF : Op::kAddI;
+      auto product = alloc();
+
+      for (size_t c = 0; c < n; c++)
+        for (size_t r = 0; r < n; r++) {
+          auto dst = result.regs[c * n + r];
+
+          for (size_t i = 0; i < n; i++) {
+            emit(mul, i == 0 ? dst : product, lhs.regs[i * n + r], rhs.regs[c * n + i]);
+
+            if (i > 0)
+              emit(add, dst, dst, product);
+          }
+        }
+
+      return result;
+    }
+
+    auto pick = [&](Op f, Op i, Op u) {
+      return k == Kind::kFloat ? f : (k == Kind::kInt ? i : u);
+    };
+
+    auto integer = [&](Op op) {
+      if (k == Kind::kFloat)
+        error(fmt::format("Operator is not supported for '{}'.", lhs.type->mangledName()));
+
+      return op;
+    };
+
+    Op op;
+    bool swap = false;
+    bool boolean = false;
+
+    switch (type) {
+      case ast::BinaryExpr::Type::kAdd: op = pick(Op::kAddF, Op::kAddI, Op::kAddI); break;
+      case ast::BinaryExpr::Type::KSub:
+      case ast::BinaryExpr::Type::kSubtract: op = pick(Op::kSubF, Op::kSubI, Op::kSubI); break;
+      case ast::BinaryExpr::Type::kMul:
+      case ast::BinaryExpr::Type::kMultiply: op = pick(Op::kMulF, Op::kMulI, Op::kMulI); break;
+      case ast::BinaryExpr::Type::kDiv:
+      case ast::BinaryExpr::Type::kDivide: op = pick(Op::kDivF, Op::kDivI, Op::kDivU); break;
+      case ast::BinaryExpr::Type::kMod:
+      case ast::BinaryExpr::Type::kModulus: op = pick(Op::kModF, Op::kModI, Op::kModU); break;
+      case ast::BinaryExpr::Type::kBitAnd: op = integer(Op::kAnd); break;
+      case ast::BinaryExpr::Type::kBitOr: op = integer(Op::kOr); break;
+      case ast::BinaryExpr::Type::kBitXor: op = integer(Op::kXor); break;
+      case ast::BinaryExpr::Type::kLeftShift: op = integer(Op::kShl); break;
+      case ast::BinaryExpr::Type::kRightShift: op = integer(pick(Op::kShrI, Op::kShrI, Op::kShrU)); break;
+      case ast::BinaryExpr::Type::kEqualEqual: op = pick(Op::kEqF, Op::kEqI, Op::kEqI); boolean = true; break;
+      case ast::BinaryExpr::Type::kNotEqual: op = pick(Op::kNeF, Op::kNeI, Op::kNeI); boolean = true; break;
+      case ast::BinaryExpr::Type::kLessThan: op = pick(Op::kLtF, Op::kLtI, Op::kLtU); boolean = true; break;
+      case ast::BinaryExpr::Type::kLessThanEqual: op = pick(Op::kLeF, Op::kLeI, Op::kLeU); boolean = true; break;
+      case ast::BinaryExpr::Type::kGreaterThan: op = pick(Op::kLtF, Op::kLtI, Op::kLtU); boolean = swap = true; break;
+      case ast::BinaryExpr::Type::kGreaterThanEqual: op = pick(Op::kLeF, Op::kLeI, Op::kLeU); boolean = swap = true; break;
+      case ast::BinaryExpr::Type::kAndAnd: op = Op::kLogicalAnd; boolean = true; break;
+      case ast::BinaryExpr::Type::kOrOr: op = Op::kLogicalOr; boolean = true; break;
+      default:
+        error("Unsupported binary operator.");
+        return {};
+    }
+
+    // comparisons and logical operators give an 'int' holding 0 or 1, like in 'comptime'.
+    auto result_type = lhs.type;
+
+    if (boolean)
+      result_type = types::system().findType(
+        lhs.regs.size() == 1 ? std::string("int") : fmt::format("int{}", lhs.regs.size())
+      );
+
+    auto result = alloc(result_type);
+
+    for (size_t i = 0; i < result.regs.size(); i++)
+      emit(op, result.regs[i], swap ? rhs.regs[i] : lhs.regs[i], swap ? lhs.regs[i] : rhs.regs[i]);
+
+    return result;
+  }
+
+  Compiler::Value Compiler::value(ast::UnaryExpr* uexpr)
+  {
+    auto operand = value(uexpr->operand().get());
+    auto k = kind(operand.type);
+
+    Op op;
+
+    switch (uexpr->type()) {
+      case ast::UnaryExpr::Type::kPlus:
+        return operand;
+      case ast::UnaryExpr::Type::kMinus:
+        op = k == Kind::kFloat ? Op::kNegF : Op::kNegI;
+        break;
+      case ast::UnaryExpr::Type::kNot:
+        op = Op::kNot;
+        break;
+      case ast::UnaryExpr::Type::kFlip:
+        if (k == Kind::kFloat)
+          error(fmt::format("Operator '~' is not supported for '{}'.", operand.type->mangledName()));
+
+        op = Op::kBitNot;
+        break;
+    }
+
+    auto result = alloc(operand.type);
+
+    for (size_t i = 0; i < result.regs.size(); i++)
+      emit(op, result.regs[i], operand.regs[i]);
+
+    return result;
+  }
+
+  Compiler::Value Compiler::value(ast::CallExpr* callexpr)
+  {
+    auto name = callexpr->id()->ident();
+
+    std::vector<Value> args;
+
+    for (auto& arg : callexpr->args())
+      args.push_back(value(arg.get()));
+
+    if (auto type = types::system().findType(name))
+      return construct(type, std::move(args));
+
+    auto func = find_function(name);
+
+    if (!func)
+      error(fmt::format("Unable to find function '{}'.", name));
+
+    return call(func, std::move(args));
+  }
+
+  Compiler::Value Compiler::value(const ast::LitExpr::Value& literal)
+  {
+    // literals take the 32-bit type of their family, so '1.0' can initialize a 'float'.
+    if (literal.type & ast::LitExpr::Value::Type::kFloatMask)
+      return Value {
+        types::system().findType("float"),
+        { constant(std::bit_cast<uint32_t>(static_cast<float>(literal.value.f64))) }
+      };
+    else if (literal.type & ast::LitExpr::Value::Type::kSignedIntMask)
+      return Value {
+        types::system().findType("int"),
+        { constant(static_cast<uint32_t>(literal.value.i64)) }
+      };
+
+    return Value {
+      types::system().findType("uint"),
+      { constant(static_cast<uint32_t>(literal.value.u64)) }
+    };
+  }
+
+  Compiler::Value Compiler::construct(types::Type* type, std::vector<Value>&& args)
+  {
+    Value result { type, {} };
+
+    if (type->is<types::Custom>()) {
+      for (auto& arg : args)
+        result.regs.insert(result.regs.end(), arg.regs.begin(), arg.regs.end());
+
+      if (result.regs.size() != components(type))
+        error(fmt::format("Arguments don't match the members of '{}'.", type->mangledName()));
+
+      return result;
+    }
+
+    auto n = components(type);
+    auto k = kind(type);
+
+    // a single scalar fills a vector, or the diagonal of a matrix.
+    if (args.size() == 1 && args[0].regs.size() == 1 && n > 1) {
+      auto s = convert(args[0].regs[0], kind(args[0].type), k);
+
+      if (auto mat = type->as<types::Mat>()) {
+        auto zero = constant(0);
+
+        for (size_t c = 0; c < mat->columns(); c++)
+          for (size_t r = 0; r < mat->rows(); r++)
+            result.regs.push_back(c == r ? s : zero);
+      } else
+        result.regs.assign(n, s);
+
+      return result;
+    }
+
+    for (auto& arg : args)
+      for (auto reg : arg.regs)
+        result.regs.push_back(convert(reg, kind(arg.type), k));
+
+    if (result.regs.size() != n)
+      error(fmt::format("Arguments don't match the components of '{}'.", type->mangledName()));
+
+    return result;
+  }
+
+  uint32_t Compiler::convert(uint32_t reg, Kind from, Kind to)
+  {
+    // integers of both signs share the same bits.
+    if (from == to || (from != Kind::kFloat && to != Kind::kFloat))
+      return reg;
+
+    Op op;
+
+    if (from == Kind::kFloat)
+      op = to == Kind::kInt ? Op::kFloatToInt : Op::kFloatToUint;
+    else
+      op = from == Kind::kInt ? Op::kIntToFloat : Op::kUintToFloat;
+
+    auto result = alloc();
+    emit(op, result, reg);
+
+    return result;
+  }
+
+  Compiler::Value Compiler::call(ast::FuncDecl* func, std::vector<Value>&& args)
+  {
+    for (auto& frame : m_frames)
+      if (frame.func == func)
+        error(fmt::format("Recursive call to '{}' is not supported.", func->name()));
+
+    if (args.size() != func->args().size())
+      error(fmt::format("Wrong number of arguments to '{}'.", func->name()));
+
+    auto result = alloc(func->type()->sem()->type());
+
+    // arguments are copied, the callee is free to assign to them.
+    std::vector<Value> params;
+
+    for (size_t i = 0; i < args.size(); i++) {
+      auto param = alloc(func->args()[i]->type()->sem()->type());
+
+      if (param.regs.size() != args[i].regs.size())
+        error(fmt::format("Argument '{}' of '{}' has the wrong type.", func->args()[i]->name(), func->name()));
+
+      for (size_t j = 0; j < param.regs.size(); j++)
+        emit(Op::kMov, param.regs[j], args[i].regs[j]);
+
+      params.push_back(std::move(param));
+    }
+
+    auto mark = m_next_reg;
+
+    inline_function(func, params, result);
+
+    m_next_reg = mark;
+
+    return result;
+  }
+
+  Compiler::Place Compiler::place(ast::Expr* expr)
+  {
+    if (auto idexpr = expr->as<ast::IdExpr>()) {
+      auto place = find(idexpr->ident());
+
+      if (!place)
+        error(fmt::format("Unable to find '{}'.", idexpr->ident()));
+
+      return std::move(*place);
+    }
+
+    if (auto bexpr = expr->as<ast::BinaryExpr>()) {
+      switch (bexpr->type()) {
+        case ast::BinaryExpr::Type::kMemberAccess:
+        case ast::BinaryExpr::Type::kSwizzle:
+          return member(place(bexpr->lhs().get()), bexpr);
+        case ast::BinaryExpr::Type::kIndexAccessor:
+          return index(place(bexpr->lhs().get()), bexpr->rhs().get());
+        default:
+          break;
+      }
+    }
+
+    // anything else is a temporary value.
+    auto result = value(expr);
+
+    return Place {
+      .kind = Place::Kind::kRegisters,
+      .type = result.type,
+      .regs = std::move(result.regs),
+      .writable = false
+    };
+  }
+
+  Compiler::Place Compiler::member(Place&& base, ast::BinaryExpr* bexpr)
+  {
+    auto name = bexpr->rhs()->as<ast::IdExpr>()->ident();
+
+    if (auto custom = base.type->as<types::Custom>()) {
+      auto& members = custom->members();
+      size_t first = 0;
+
+      for (size_t i = 0; i < members.size(); i++) {
+        auto type = members[i].type();
+        auto count = components(type);
+
+        if (members[i].name() != name) {
+          first += count;
+          continue;
+        }
+
+        if (base.kind == Place::Kind::kMemory)
+          base.offset += custom->offset(i, base.layout);
+        else
+          base.regs = slice(base.regs, first, count);
+
+        base.type = type;
+
+        return std::move(base);
+      }
+
+      error(fmt::format("Unable to find member '{}' in '{}'.", name, custom->name()));
+    }
+
+    auto vec = base.type->as<types::Vec>();
+
+    if (!vec)
+      error(fmt::format("'.' accessors are not supported for '{}'.", base.type->mangledName()));
+
+    // components of memory are picked from their offsets.
+    if (base.kind == Place::Kind::kMemory && base.regs.empty())
+      memory_offsets(vec, base.layout, 0, base.regs);
+
+    std::vector<uint32_t> regs;
+
+    for (auto c : name) {
+      auto i = component_index(c);
+
+      if (i >= vec->columns())
+        error(fmt::format("Swizzle '{}' is not supported for type '{}'.", c, vec->mangledName()));
+
+      regs.push_back(base.regs[i]);
+    }
+
+    base.regs = std::move(regs);
+    base.type = name.size() == 1
+      ? vec->type()
+      : types::system().findType(fmt::format("{}{}", vec->type()->mangledName(), name.size()));
+
+    return std::move(base);
+  }
+
+  Compiler::Place Compiler::index(Place&& base, ast::Expr* index_expr)
+  {
+    types::Type* element;
+    uint32_t count;
+    uint64_t stride;
+
+    if (auto array = base.type->as<types::Array>()) {
+      element = array->type();
+      count = static_cast<uint32_t>(array->count());
+      stride = array->stride(base.layout);
+    } else if (auto mat = base.type->as<types::Mat>()) {
+      element = types::system().findType(fmt::format("{}{}", mat->type()->mangledName(), mat->rows()));
+      count = static_cast<uint32_t>(mat->columns());
+      stride = mat->stride(base.layout);
+    } else {
+      error("Index accessors are only allowed for arrays or matrices.");
+      return {};
+    }
+
+    auto element_components = base.kind == Place::Kind::kMemory ? 0 : components(element);
+
+    if (auto constant_index = comptime::eval(index_expr)) {
+      auto i = constant_index->value.u64;
+
+      if (count && i >= count)
+        error(fmt::format("Index '{}' is out of bounds for '{}'.", i, base.type->mangledName()));
+
+      if (base.kind == Place::Kind::kMemory)
+        base.offset += i * stride;
+      else
+        base.regs = slice(base.regs, i * element_components, element_components);
+
+      base.type = element;
+
+      return std::move(base);
+    }
+
+    auto i = scalar(value(index_expr));
+
+    if (base.kind == Place::Kind::kMemory) {
+      auto offset = alloc();
+
+      emit(Op::kMulI, offset, i, constant(static_cast<uint32_t>(stride)));
+
+      if (base.offset_reg != kNoReg)
+        emit(Op::kAddI, offset, offset, base.offset_reg);
+
+      base.offset_reg = offset;
+      base.type = element;
+
+      return std::move(base);
+    }
+
+    // elements picked at runtime are read from consecutive registers, an element of
+    // an element picked at runtime is read from a copy.
+    bool writable = base.writable;
+
+    if (base.kind == Place::Kind::kIndexed || !contiguous(base.regs)) {
+      auto copy = read(base);
+      auto regs = alloc(base.type);
+
+      for (size_t j = 0; j < regs.regs.size(); j++)
+        emit(Op::kMov, regs.regs[j], copy.regs[j]);
+
+      base.regs = std::move(regs.regs);
+      writable = false;
+    }
+
+    Place place {
+      .kind = Place::Kind::kIndexed,
+      .type = element,
+      .base = base.regs.empty() ? 0 : base.regs[0],
+      .index = i,
+      .count = count,
+      .stride = element_components,
+      .writable = writable
+    };
+
+    for (uint32_t j = 0; j < element_components; j++)
+      place.regs.push_back(j);
+
+    return place;
+  }
+
+  Compiler::Value Compiler::read(const Place& place)
+  {
+    Value result { place.type, {} };
+
+    switch (place.kind) {
+      case Place::Kind::kRegisters:
+        result.regs = place.regs;
+        break;
+      case Place::Kind::kIndexed:
+        for (auto offset : place.regs) {
+          auto reg = alloc();
+
+          emit(Op::kGather, reg, place.base + offset, place.index, place.count, place.stride);
+          result.regs.push_back(reg);
+        }
+        break;
+      case Place::Kind::kMemory: {
+        auto offsets = place.regs;
+
+        if (offsets.empty())
+          memory_offsets(place.type, place.layout, 0, offsets);
+
+        for (auto offset : offsets) {
+          auto reg = alloc();
+
+          emit(Op::kLoad, reg, place.binding, place.offset_reg, static_cast<uint32_t>(place.offset + offset));
+          result.regs.push_back(reg);
+        }
+        break;
+      }
+    }
+
+    return result;
+  }
+
+  void Compiler::write(const Place& place, const Value& value)
+  {
+    if (!place.writable)
+      error("Expression is not assignable.");
+
+    switch (place.kind) {
+      case Place::Kind::kRegisters: {
+        if (place.regs.size() != value.regs.size())
+          error("Assigned value doesn't match the type of its destination.");
+
+        auto source = value.regs;
+
+        // 'v = v.yx' reads components after they're written, so they're copied first.
+        for (size_t i = 0; i < source.size(); i++) {
+          if (source[i] == place.regs[i])
+            continue;
+
+          if (std::find(place.regs.begin(), place.regs.end(), source[i]) != place.regs.end()) {
+            for (auto& reg : source) {
+              auto copy = alloc();
+              emit(Op::kMov, copy, reg);
+              reg = copy;
+            }
+
+            break;
+          }
+        }
+
+        for (size_t i = 0; i < source.size(); i++)
+          if (source[i] != place.regs[i])
+            emit(Op::kMov, place.regs[i], source[i]);
+
+        break;
+      }
+      case Place::Kind::kIndexed:
+        if (place.regs.size() != value.regs.size())
+          error("Assigned value doesn't match the type of its destination.");
+
+        for (size_t i = 0; i < value.regs.size(); i++)
+          emit(Op::kScatter, value.regs[i], place.base + place.regs[i], place.index, place.count, place.stride);
+        break;
+      case Place::Kind::kMemory: {
+        auto offsets = place.regs;
+
+        if (offsets.empty())
+          memory_offsets(place.type, place.layout, 0, offsets);
+
+        if (offsets.size() != value.regs.size())
+          error("Assigned value doesn't match the type of its destination.");
+
+        for (size_t i = 0; i < offsets.size(); i++)
+          emit(Op::kStore, value.regs[i], place.binding, place.offset_reg, static_cast<uint32_t>(place.offset + offsets[i]));
+        break;
+      }
+    }
+  }
+
+  void Compiler::memory_offsets(
+    types::Type* type,
+    types::Layout layout,
+    uint64_t offset,
+    std::vector<uint32_t>& offsets
+  )
+  {
+    base::Match(
+      type,
+      [&](types::Scalar* scalar) {
+        kind(scalar);
+        offsets.push_back(static_cast<uint32_t>(offset));
+      },
+      [&](types::Vec* vec) {
+        for (size_t i = 0; i < vec->columns(); i++)
+          memory_offsets(vec->type(), layout, offset + i * vec->type()->size(layout), offsets);
+      },
+      [&](types::Mat* mat) {
+        auto column = types::system().findType(fmt::format("{}{}", mat->type()->mangledName(), mat->rows()));
+
+        for (size_t i = 0; i < mat->columns(); i++)
+          memory_offsets(column, layout, offset + i * mat->stride(layout), offsets);
+      },
+      [&](types::Array* array) {
+        if (array->count() == 0)
+          error("Arrays without a size can only be accessed by index.");
+
+        for (size_t i = 0; i < array->count(); i++)
+          memory_offsets(array->type(), layout, offset + i * array->stride(layout), offsets);
+      },
+      [&](types::Custom* custom) {
+        for (size_t i = 0; i < custom->members().size(); i++)
+          memory_offsets(custom->members()[i].type(), layout, offset + custom->offset(i, layout), offsets);
+      },
+      [&](base::Default) {
+        error(fmt::format("Type '{}' is not supported by the vm.", type->mangledName()));
+      }
+    );
+  }
+
+  Compiler::Value Compiler::zero(types::Type* type)
+  {
+    // zero bits are a zero of every kind.
+    auto n = components(type);
+
+    return Value { type, std::vector<uint32_t>(n, n ? constant(0) : 0) };
+  }
+
+  uint32_t Compiler::constant(uint32_t bits)
+  {
+    auto reg = alloc();
+    emit(Op::kConst, reg, bits);
+
+    return reg;
+  }
+
+  uint32_t Compiler::scalar(const Value& value)
+  {
+    if (value.regs.size() != 1)
+      error(fmt::format("Expected a scalar, but got a '{}'.", value.type->mangledName()));
+
+    return value.regs[0];
+  }
+
+  Compiler::Value Compiler::alloc(types::Type* type)
+  {
+    Value value { type, {} };
+
+    for (uint32_t i = 0; i < components(type); i++)
+      value.regs.push_back(alloc());
+
+    return value;
+  }
+
+  uint32_t Compiler::alloc()
+  {
+    auto reg = m_next_reg++;
+
+    m_program.num_registers = std::max(m_program.num_registers, m_next_reg);
+
+    return reg;
+  }
+
+  uint32_t Compiler::emit(
+    Op op,
+    uint32_t dst,
+    uint32_t a,
+    uint32_t b,
+    uint32_t c,
+    uint32_t d
+  )
+  {
+    m_program.code.push_back(Instr { op, dst, a, b, c, d });
+
+    return static_cast<uint32_t>(m_program.code.size() - 1);
+  }
+
+  void Compiler::enter()
+  {
+    m_depth++;
+    m_program.max_depth = std::max(m_program.max_depth, m_depth);
+  }
+
+  void Compiler::leave()
+  {
+    m_depth--;
+  }
+
+  uint32_t Compiler::components(types::Type* type)
+  {
+    uint32_t count = 0;
+
+    base::Match(
+      type,
+      [&](types::Scalar* scalar) {
+        kind(scalar);
+        count = 1;
+      },
+      [&](types::Vec* vec) {
+        kind(vec);
+        count = static_cast<uint32_t>(vec->columns());
+      },
+      [&](types::Mat* mat) {
+        kind(mat);
+        count = static_cast<uint32_t>(mat->columns() * mat->rows());
+      },
+      [&](types::Array* array) {
+        if (array->count() == 0)
+          error("Arrays without a size can only be accessed by index.");
+
+        count = static_cast<uint32_t>(array->count()) * components(array->type());
+      },
+      [&](types::Custom* custom) {
+        for (auto& member : custom->members())
+          count += components(member.type());
+      },
+      [&](types::Void*) {
+        count = 0;
+      },
+      [&](base::Default) {
+        error(fmt::format("Type '{}' is not supported by the vm.", type->mangledName()));
+      }
+    );
+
+    return count;
+  }
+
+  Kind Compiler::kind(types::Type* type)
+  {
+    if (type->is<types::Vec>() || type->is<types::Mat>())
+      return kind(type->type());
+
+    auto name = type->mangledName();
+
+    if (name == "float")
+      return Kind::kFloat;
+    else if (name == "int")
+      return Kind::kInt;
+    else if (name == "uint")
+      return Kind::kUint;
+
+    // lanes are 32 bits wide.
+    error(fmt::format("Type '{}' is not supported by the vm.", name));
+
+    return Kind::kFloat;
+  }
+
+  std::optional<Compiler::Place> Compiler::find(std::string_view name)
+  {
+    if (!m_frames.empty()) {
+      auto& scopes = frame().scopes;
+
+      for (auto scope = scopes.rbegin(); scope != scopes.rend(); scope++)
+        if (auto it = scope->find(name); it != scope->end())
+          return it->second;
+    }
+
+    auto it = m_globals.find(name);
+
+    if (it == m_globals.end())
+      return std::nullopt;
+
+    if (auto buffer = it->second->as<ast::BufferDecl>())
+      return Place {
+        .kind = Place::Kind::kMemory,
+        .type = buffer->type()->sem()->type(),
+        .binding = binding(buffer),
+        .layout = types::Layout::kStd430,
+        .writable = buffer->args().access_mode != ast::AccessMode::kRead
+      };
+
+    if (auto uniform = it->second->as<ast::UniformDecl>())
+      return Place {
+        .kind = Place::Kind::kMemory,
+        .type = uniform->type()->sem()->type(),
+        .binding = binding(uniform),
+        .layout = types::Layout::kStd140,
+        .writable = false
+      };
+
+    // constants are evaluated where they're used.
+    auto const_decl = it->second->as<ast::ConstDecl>();
+    auto result = value(const_decl->expr().get());
+
+    return Place {
+      .kind = Place::Kind::kRegisters,
+      .type = result.type,
+      .regs = std::move(result.regs),
+      .writable = false
+    };
+  }
+
+  uint32_t Compiler::binding(ast::Decl* decl)
+  {
+    if (auto it = m_bindings.find(decl); it != m_bindings.end())
+      return it->second;
+
+    Binding binding {
+      .name = decl->name(),
+      .type = decl->sem()->type(),
+      .layout = decl->is<ast::UniformDecl>() ? types::Layout::kStd140 : types::Layout::kStd430,
+      .writable = false
+    };
+
+    if (auto buffer = decl->as<ast::BufferDecl>())
+      binding.writable = buffer->args().access_mode != ast::AccessMode::kRead;
+
+    auto index = static_cast<uint32_t>(m_program.bindings.size());
+
+    m_program.bindings.push_back(std::move(binding));
+    m_bindings[decl] = index;
+
+    return index;
+  }
+
+  ast::FuncDecl* Compiler::find_function(std::string_view name)
+  {
+    for (auto& decl : m_module->global_declarations())
+      if (auto func = decl->as<ast::FuncDecl>(); func && func->name() == name)
+        return func;
+
+    return nullptr;
+  }
+
+  Compiler::Frame& Compiler::frame()
+  {
+    return m_frames.back();
+  }
+
+  void Compiler::error(const std::string& err)
+  {
+    fmt::println("{}", err);
+    std::exit(1);
+  }
+}
\ No newline at end of file
@@ -0,0 +1,187 @@
+#pragma once
+
+#include "../ast.h"
+#include "../types.h"
+#include "bytecode.h"
+
+#include "base/hash_map.h"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace kate::tlr::vm {
+  // Lowers a function of a resolved module, and everything it calls, to register bytecode.
+  //
+  // Calls are inlined, so the program of a function is self-contained. Its arguments
+  // and return value live in registers the caller fills and reads, see 'Program::inputs'.
+  class Compiler {
+  public:
+    Compiler(ast::Module* module);
+
+    Program compile(const std::string& function);
+  private:
+    // a value spread over registers, one per component.
+    struct Value {
+      types::Type* type;
+      std::vector<uint32_t> regs;
+    };
+
+    // where an assignable expression lives.
+    struct Place {
+      enum class Kind {
+        // 'regs' holds the register of each component.
+        kRegisters,
+        // an element picked at runtime out of 'count' elements of 'stride' registers starting
+        // at 'base', 'regs' holds the offset of each component from the start of the element.
+        kIndexed,
+        // 'offset' bytes plus the runtime offset in 'offset_reg' into 'binding', 'regs' holds
+        // the offsets of the components relative to it when they are picked by a swizzle.
+        kMemory
+      };
+
+      Kind kind;
+      types::Type* type;
+      std::vector<uint32_t> regs;
+
+      uint32_t base = 0;
+      uint32_t index = kNoReg;
+      uint32_t count = 0;
+      uint32_t stride = 0;
+
+      uint32_t binding = 0;
+      uint32_t offset_reg = kNoReg;
+      uint64_t offset = 0;
+      types::Layout layout = types::Layout::kStd430;
+      bool writable = true;
+    };
+
+    struct Frame {
+      ast::FuncDecl* func;
+      Value result;
+      // index in the control stack of the function and of the loops being compiled.
+      uint32_t depth;
+      std::vector<uint32_t> loops;
+      std::vector<base::HashMap<std::string, Place>> scopes;
+    };
+
+    void compile(ast::Stat* stat);
+
+    void compile(ast::BlockStat* block);
+
+    void compile(ast::VarStat* var_stat);
+
+    void compile(ast::IfStat* if_stat);
+
+    void compile(ast::ForStat* for_stat);
+
+    void compile(ast::WhileStat* while_stat);
+
+    void compile(ast::ReturnStat* return_stat);
+
+    // lowers the loop shared by 'for' and 'while', 'continuing' may be null.
+    void compile_loop(
+      ast::Expr* condition,
+      ast::BlockStat* block,
+      ast::Expr* continuing
+    );
+
+    Value value(ast::Expr* expr);
+
+    Value value(ast::BinaryExpr* bexpr);
+
+    Value value(ast::UnaryExpr* uexpr);
+
+    Value value(ast::CallExpr* callexpr);
+
+    Value value(const ast::LitExpr::Value& literal);
+
+    // evaluates a binary operator on each component, or as a product for matrices.
+    Value arithmetic(
+      ast::BinaryExpr::Type type,
+      const Value& lhs,
+      const Value& rhs
+    );
+
+    Value construct(types::Type* type, std::vector<Value>&& args);
+
+    Value call(ast::FuncDecl* func, std::vector<Value>&& args);
+
+    // compiles the body of 'func' in a new frame, its arguments and result are in registers.
+    void inline_function(
+      ast::FuncDecl* func,
+      const std::vector<Value>& args,
+      const Value& result
+    );
+
+    uint32_t convert(uint32_t reg, Kind from, Kind to);
+
+    Place place(ast::Expr* expr);
+
+    Place member(Place&& base, ast::BinaryExpr* bexpr);
+
+    Place index(Place&& base, ast::Expr* index);
+
+    Value read(const Place& place);
+
+    void write(const Place& place, const Value& value);
+
+    // offsets in bytes of each component of 'type' when laid out in memory.
+    void memory_offsets(
+      types::Type* type,
+      types::Layout layout,
+      uint64_t offset,
+      std::vector<uint32_t>& offsets
+    );
+
+    // assigns the value a variable of 'type' gets before being initialized.
+    Value zero(types::Type* type);
+
+    uint32_t constant(uint32_t bits);
+
+    uint32_t scalar(const Value& value);
+
+    Value alloc(types::Type* type);
+
+    uint32_t alloc();
+
+    uint32_t emit(
+      Op op,
+      uint32_t dst,
+      uint32_t a = 0,
+      uint32_t b = 0,
+      uint32_t c = 0,
+      uint32_t d = 0
+    );
+
+    void enter();
+
+    void leave();
+
+    // number of 32-bit components of a type, e.g. 12 for a 'float4x3'.
+    uint32_t components(types::Type* type);
+
+    Kind kind(types::Type* type);
+
+    // finds a variable, argument or binding visible from the function being compiled.
+    std::optional<Place> find(std::string_view name);
+
+    // index of a buffer or uniform in 'Program::bindings', added the first time it's used.
+    uint32_t binding(ast::Decl* decl);
+
+    ast::FuncDecl* find_function(std::string_view name);
+
+    Frame& frame();
+
+    void error(const std::string& err);
+
+    ast::Module* m_module;
+    Program m_program;
+    std::vector<Frame> m_frames;
+    base::HashMap<std::string, ast::Decl*> m_globals;
+    base::HashMap<ast::Decl*, uint32_t> m_bindings;
+    // registers are released in stack order when statements and scopes end.
+    uint32_t m_next_reg;
+    uint32_t m_depth;
+  };
+}
\ No newline at end of file
@@ -0,0 +1,460 @@
+#include "machine.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <fmt/format.h>
+#include <limits>
+#include <type_traits>
+
+// the lane loops are built a second time for avx2 where gcc and clang can target it per function.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define KATE_VM_AVX2
+#define KATE_VM_INLINE __attribute__((always_inline)) inline
+#else
+#define KATE_VM_INLINE inline
+#endif
+
+namespace kate::tlr::vm {
+  namespace {
+    template<typename T, typename R>
+    T lane(const R& reg, size_t l)
+    {
+      if constexpr (std::is_same_v<T, float>)
+        return reg.f[l];
+      else if constexpr (std::is_same_v<T, int32_t>)
+        return reg.i[l];
+      else
+        return reg.u[l];
+    }
+
+    template<typename T>
+    uint32_t to_bits(T value)
+    {
+      if constexpr (std::is_same_v<T, float>)
+        return std::bit_cast<uint32_t>(value);
+      else
+        return static_cast<uint32_t>(value);
+    }
+
+    // Writes 'f(lane)' to the lanes of 'mask', the other lanes keep their value. The
+    // results are computed before any is written, so the loops are vectorized even
+    // though 'dst' may be one of the operands.
+    template<typename R, typename M, typename F>
+    KATE_VM_INLINE void apply(R& dst, const M& mask, F f)
+    {
+      uint32_t values[kLanes];
+      uint32_t enabled[kLanes];
+
+      for (size_t l = 0; l < kLanes; l++) {
+        values[l] = to_bits(f(l));
+        enabled[l] = mask[l];
+      }
+
+      for (size_t l = 0; l < kLanes; l++)
+        dst.u[l] = (values[l] & enabled[l]) | (dst.u[l] & ~enabled[l]);
+    }
+
+    template<typename T, typename R, typename M, typename F>
+    KATE_VM_INLINE void unary(R& dst, const R& a, const M& mask, F f)
+    {
+      apply(dst, mask, [&](size_t l) { return f(lane<T>(a, l)); });
+    }
+
+    template<typename T, typename R, typename M, typename F>
+    KATE_VM_INLINE void binary(R& dst, const R& a, const R& b, const M& mask, F f)
+    {
+      apply(dst, mask, [&](size_t l) { return f(lane<T>(a, l), lane<T>(b, l)); });
+    }
+
+    template<typename M>
+    bool any(const M& mask)
+    {
+      uint32_t bits = 0;
+
+      for (size_t l = 0; l < kLanes; l++)
+        bits |= mask[l];
+
+      return bits != 0;
+    }
+
+    // float to integer conversions saturate and turn NaN into 0, so they don't depend on the host.
+    template<typename T>
+    T saturate(float value)
+    {
+      if (std::isnan(value))
+        return 0;
+
+      if (value <= static_cast<float>(std::numeric_limits<T>::min()))
+        return std::numeric_limits<T>::min();
+
+      if (value >= static_cast<float>(std::numeric_limits<T>::max()))
+        return std::numeric_limits<T>::max();
+
+      return static_cast<T>(value);
+    }
+  }
+
+  Machine::Machine(const Program& program)
+    : m_program { program },
+      m_memory(program.bindings.size()),
+      m_regs(program.num_registers),
+      m_control(program.max_depth)
+  {
+  }
+
+  void Machine::bind(
+    const std::string& name,
+    void* data,
+    size_t size
+  )
+  {
+    for (size_t i = 0; i < m_program.bindings.size(); i++)
+      if (m_program.bindings[i].name == name) {
+        m_memory[i] = Memory { static_cast<uint8_t*>(data), size };
+        return;
+      }
+
+    error(fmt::format("'{}' doesn't use a binding named '{}'.", m_program.entry, name));
+  }
+
+  uint32_t Machine::input_components() const
+  {
+    uint32_t count = 0;
+
+    for (auto& input : m_program.inputs)
+      count += input.components;
+
+    return count;
+  }
+
+  uint32_t Machine::output_components() const
+  {
+    return m_program.output.components;
+  }
+
+  void Machine::invoke(
+    size_t count,
+    const uint32_t* inputs,
+    uint32_t* outputs
+  )
+  {
+    auto num_inputs = input_components();
+    auto num_outputs = output_components();
+
+    for (size_t first = 0; first < count; first += kLanes) {
+      auto lanes = std::min(kLanes, count - first);
+
+      Mask mask {};
+
+      // inputs are transposed, so each register holds a component of every invocation.
+      for (size_t l = 0; l < lanes; l++) {
+        auto* input = inputs + (first + l) * num_inputs;
+
+        for (auto& param : m_program.inputs)
+          for (uint32_t c = 0; c < param.components; c++)
+            m_regs[param.reg + c].u[l] = *input++;
+
+        mask[l] = ~0u;
+      }
+
+      run(mask);
+
+      for (size_t l = 0; l < lanes; l++)
+        for (uint32_t c = 0; c < num_outputs; c++)
+          outputs[(first + l) * num_outputs + c] = m_regs[m_program.output.reg + c].u[l];
+    }
+  }
+
+  void Machine::dispatch(std::array<uint32_t, 3> num_workgroups)
+  {
+    for (auto& input : m_program.inputs)
+      if (input.builtin.empty())
+        error(fmt::format("Argument '{}' of '{}' must be a builtin to be dispatched.", input.name, m_program.entry));
+
+    auto& size = m_program.workgroup_size;
+    uint64_t invocations_per_workgroup = uint64_t(size[0]) * size[1] * size[2];
+    uint64_t count = invocations_per_workgroup * num_workgroups[0] * num_workgroups[1] * num_workgroups[2];
+
+    // invocations run in the order of their global index, batches may span workgroups.
+    for (uint64_t first = 0; first < count; first += kLanes) {
+      auto lanes = std::min<uint64_t>(kLanes, count - first);
+
+      Mask mask {};
+
+      for (size_t l = 0; l < lanes; l++) {
+        auto invocation = first + l;
+        auto workgroup = invocation / invocations_per_workgroup;
+        auto local_index = static_cast<uint32_t>(invocation % invocations_per_workgroup);
+
+        std::array<uint32_t, 3> workgroup_id = {
+          static_cast<uint32_t>(workgroup % num_workgroups[0]),
+          static_cast<uint32_t>(workgroup / num_workgroups[0] % num_workgroups[1]),
+          static_cast<uint32_t>(workgroup / (uint64_t(num_workgroups[0]) * num_workgroups[1]))
+        };
+
+        std::array<uint32_t, 3> local_id = {
+          local_index % size[0],
+          local_index / size[0] % size[1],
+          local_index / (size[0] * size[1])
+        };
+
+        for (auto& input : m_program.inputs) {
+          const uint32_t* values;
+          std::array<uint32_t, 3> global_id;
+
+          if (input.builtin == "global_invocation_id") {
+            for (size_t i = 0; i < 3; i++)
+              global_id[i] = workgroup_id[i] * size[i] + local_id[i];
+
+            values = global_id.data();
+          } else if (input.builtin == "local_invocation_id")
+            values = local_id.data();
+          else if (input.builtin == "local_invocation_index")
+            values = &local_index;
+          else if (input.builtin == "workgroup_id")
+            values = workgroup_id.data();
+          else if (input.builtin == "num_workgroups")
+            values = num_workgroups.data();
+          else {
+            error(fmt::format("Builtin '{}' is not supported by the vm.", input.builtin));
+            return;
+          }
+
+          for (uint32_t c = 0; c < input.components && c < 3; c++)
+            m_regs[input.reg + c].u[l] = values[c];
+        }
+
+        mask[l] = ~0u;
+      }
+
+      run(mask);
+    }
+  }
+
+  void Machine::run(Mask mask)
+  {
+#if defined(KATE_VM_AVX2)
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+
+    if (avx2) {
+      run_avx2(mask);
+      return;
+    }
+#endif
+
+    run_baseline(mask);
+  }
+
+  void Machine::run_baseline(Mask mask)
+  {
+    execute(mask);
+  }
+
+#if defined(KATE_VM_AVX2)
+  __attribute__((target("avx2"))) void Machine::run_avx2(Mask mask)
+  {
+    execute(mask);
+  }
+#else
+  void Machine::run_avx2(Mask mask)
+  {
+    execute(mask);
+  }
+#endif
+
+  // inlined into both versions of 'run', so its loops are vectorized for each isa.
+  KATE_VM_INLINE void Machine::execute(Mask mask)
+  {
+    for (size_t i = 0; i < m_memory.size(); i++)
+      if (!m_memory[i].data)
+        error(fmt::format("Binding '{}' of '{}' is not bound.", m_program.bindings[i].name, m_program.entry));
+
+    auto& code = m_program.code;
+    auto* regs = m_regs.data();
+    size_t depth = 0;
+
+    for (size_t pc = 0; pc < code.size();) {
+      auto& in = code[pc++];
+
+      auto& dst = regs[in.dst == kNoReg ? 0 : in.dst];
+      auto& a = regs[in.a < m_regs.size() ? in.a : 0];
+      auto& b = regs[in.b < m_regs.size() ? in.b : 0];
+
+      switch (in.op) {
+        case Op::kConst:
+          apply(dst, mask, [&](size_t) { return in.a; });
+          break;
+        case Op::kMov:
+          unary<uint32_t>(dst, a, mask, [](uint32_t x) { return x; });
+          break;
+
+        case Op::kAddF: binary<float>(dst, a, b, mask, [](float x, float y) { return x + y; }); break;
+        case Op::kAddI: binary<uint32_t>(dst, a, b, mask, [](uint32_t x, uint32_t y) { return x + y; }); break;
+        case Op::kSubF: binary<float>(dst, a, b, mask, [](float x, float y) { return x - y; }); break;
+        case Op::kSubI: binary<uint32_t>(dst, a, b, mask, [](uint32_t x, uint32_t y) { return x - y; }); break;
+        case Op::kMulF: binary<float>(dst, a, b, mask, [](float x, float y) { return x * y; }); break;
+        case Op::kMulI: binary<uint32_t>(dst, a, b, mask, [](uint32_t x, uint32_t y) { return x * y; }); break;
+        case Op::kDivF: binary<float>(dst, a, b, mask, [](float x, float y) { return x / y; }); break;
+
+        // integer division by 0 gives 0 instead of trapping.
+        case Op::kDivI:
+          binary<int32_t>(dst, a, b, mask, [](int32_t x, int32_t y) {
+            return y == 0 ? 0 : (y == -1 ? static_cast<int32_t>(0u - static_cast<uint32_t>(x)) : x / y);
+          });
+          break;
+        case Op::kDivU:
+          binary<uint32_t>(dst, a, b, mask, [](uint32_t x, uint32_t y) { return y == 0 ? 0 : x / y; });
+          break;
+        case Op::kModF:
+          binary<float>(dst, a, b, mask, [](float x, float y) { return std::fmod(x, y); });
+          break;
+        case Op::kModI:
+          binary<int32_t>(dst, a, b, mask, [](int32_t x, int32_t y) { return y == 0 || y == -1 ? 0 : x % y; });
+          break;
+        case Op::kModU:
+          binary<uint32_t>(dst, a, b, mask, [](uint32_t x, uint32_t y) { return y == 0 ? 0 : x % y; });
+          break;
+
+        case Op::kAnd: binary<uint32_t>(dst, a, b, mask, [](uint32_t x, uint32_t y) { return x & y; }); break;
+        case Op::kOr: binary<uint32_t>(dst, a, b, mask, [](uint32_t x, uint32_t y) { return x | y; }); break;
+        case Op::kXor: binary<uint32_t>(dst, a, b, mask, [](uint32_t x, uint32_t y) { return x ^ y; }); break;
+        case Op::kShl: binary<uint32_t>(dst, a, b, mask, [](uint32_t x, uint32_t y) { return x << (y & 31); }); break;
+        case Op::kShrI: binary<int32_t>(dst, a, b, mask, [](int32_t x, int32_t y) { return x >> (y & 31); }); break;
+        case Op::kShrU: binary<uint32_t>(dst, a, b, mask, [](uint32_t x, uint32_t y) { return x >> (y & 31); }); break;
+
+        case Op::kNegF: unary<float>(dst, a, mask, [](float x) { return -x; }); break;
+        case Op::kNegI: unary<uint32_t>(dst, a, mask, [](uint32_t x) { return 0u - x; }); break;
+        case Op::kNot: unary<uint32_t>(dst, a, mask, [](uint32_t x) { return uint32_t(x == 0); }); break;
+        case Op::kBitNot: unary<uint32_t>(dst, a, mask, [](uint32_t x) { return ~x; }); break;
+
+        case Op::kEqF: binary<float>(dst, a, b, mask, [](float x, float y) { return uint32_t(x == y); }); break;
+        case Op::kEqI: binary<uint32_t>(dst, a, b, mask, [](uint32_t x, uint32_t y) { return uint32_t(x == y); }); break;
+        case Op::kNeF: binary<float>(dst, a, b, mask, [](float x, float y) { return uint32_t(x != y); }); break;
+        case Op::kNeI: binary<uint32_t>(dst, a, b, mask, [](uint32_t x, uint32_t y) { return uint32_t(x != y); }); break;
+        case Op::kLtF: binary<float>(dst, a, b, mask, [](float x, float y) { return uint32_t(x < y); }); break;
+        case Op::kLtI: binary<int32_t>(dst, a, b, mask, [](int32_t x, int32_t y) { return uint32_t(x < y); }); break;
+        case Op::kLtU: binary<uint32_t>(dst, a, b, mask, [](uint32_t x, uint32_t y) { return uint32_t(x < y); }); break;
+        case Op::kLeF: binary<float>(dst, a, b, mask, [](float x, float y) { return uint32_t(x <= y); }); break;
+        case Op::kLeI: binary<int32_t>(dst, a, b, mask, [](int32_t x, int32_t y) { return uint32_t(x <= y); }); break;
+        case Op::kLeU: binary<uint32_t>(dst, a, b, mask, [](uint32_t x, uint32_t y) { return uint32_t(x <= y); }); break;
+        case Op::kLogicalAnd:
+          binary<uint32_t>(dst, a, b, mask, [](uint32_t x, uint32_t y) { return uint32_t(x != 0 && y != 0); });
+          break;
+        case Op::kLogicalOr:
+          binary<uint32_t>(dst, a, b, mask, [](uint32_t x, uint32_t y) { return uint32_t(x != 0 || y != 0); });
+          break;
+
+        case Op::kFloatToInt: unary<float>(dst, a, mask, [](float x) { return saturate<int32_t>(x); }); break;
+        case Op::kFloatToUint: unary<float>(dst, a, mask, [](float x) { return saturate<uint32_t>(x); }); break;
+        case Op::kIntToFloat: unary<int32_t>(dst, a, mask, [](int32_t x) { return static_cast<float>(x); }); break;
+        case Op::kUintToFloat: unary<uint32_t>(dst, a, mask, [](uint32_t x) { return static_cast<float>(x); }); break;
+
+        case Op::kGather:
+          apply(dst, mask, [&](size_t l) {
+            auto index = regs[in.b].u[l];
+
+            return index < in.c ? regs[in.a + index * in.d].u[l] : 0u;
+          });
+          break;
+        case Op::kScatter:
+          for (size_t l = 0; l < kLanes; l++) {
+            auto index = regs[in.b].u[l];
+
+            if (mask[l] && index < in.c)
+              regs[in.a + index * in.d].u[l] = dst.u[l];
+          }
+          break;
+        case Op::kLoad: {
+          auto& memory = m_memory[in.a];
+
+          for (size_t l = 0; l < kLanes; l++) {
+            if (!mask[l])
+              continue;
+
+            uint64_t offset = uint64_t(in.b == kNoReg ? 0 : regs[in.b].u[l]) + in.c;
+            uint32_t value = 0;
+
+            if (offset + sizeof(value) <= memory.size)
+              memcpy(&value, memory.data + offset, sizeof(value));
+
+            dst.u[l] = value;
+          }
+          break;
+        }
+        case Op::kStore: {
+          auto& memory = m_memory[in.a];
+
+          for (size_t l = 0; l < kLanes; l++) {
+            if (!mask[l])
+              continue;
+
+            uint64_t offset = uint64_t(in.b == kNoReg ? 0 : regs[in.b].u[l]) + in.c;
+
+            if (offset + sizeof(uint32_t) <= memory.size)
+              memcpy(memory.data + offset, &dst.u[l], sizeof(uint32_t));
+          }
+          break;
+        }
+
+        case Op::kIf: {
+          auto& control = m_control[depth++];
+          control.saved = mask;
+
+          for (size_t l = 0; l < kLanes; l++) {
+            uint32_t taken = a.u[l] != 0 ? ~0u : 0u;
+
+            control.other[l] = mask[l] & ~taken;
+            mask[l] &= taken;
+          }
+
+          if (!any(mask))
+            pc = in.b;
+          break;
+        }
+        case Op::kElse:
+          mask = m_control[depth - 1].other;
+
+          if (!any(mask))
+            pc = in.b;
+          break;
+        case Op::kEnter:
+          m_control[depth++] = Control { mask, {} };
+          break;
+        case Op::kLeave:
+          mask = m_control[--depth].saved;
+          break;
+        case Op::kLoopCond:
+          for (size_t l = 0; l < kLanes; l++)
+            mask[l] &= a.u[l] != 0 ? ~0u : 0u;
+
+          if (!any(mask))
+            pc = in.b;
+          break;
+        case Op::kLoopBack:
+          if (any(mask))
+            pc = in.b;
+          break;
+        case Op::kKill:
+          // the lanes stay disabled when the constructs in between are left.
+          for (size_t i = in.a + 1; i < depth; i++)
+            for (size_t l = 0; l < kLanes; l++) {
+              m_control[i].saved[l] &= ~mask[l];
+              m_control[i].other[l] &= ~mask[l];
+            }
+
+          mask = {};
+          break;
+        default:
+          error("Invalid instruction.");
+      }
+    }
+  }
+
+  void Machine::error(const std::string& err)
+  {
+    fmt::println("{}", err);
+    std::exit(1);
+  }
+}
\ No newline at end of file
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "bytecode.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace kate::tlr::vm {
+  // Runs a program on the cpu, 'kLanes' invocations at a time.
+  //
+  // Invocations of a batch run in lockstep, each instruction is applied to every lane
+  // enabled in the execution mask with plain loops the compiler turns into simd code,
+  // 256-bit wide on x86 cpus supporting avx2.
+  // Lanes leave the mask while they run the other side of a branch, after a 'break' or
+  // a 'return', so results only depend on the inputs and the bound memory.
+  class Machine {
+  public:
+    Machine(const Program& program);
+
+    // binds host memory to a buffer or uniform of the program, laid out with 'Binding::layout'.
+    void bind(
+      const std::string& name,
+      void* data,
+      size_t size
+    );
+
+    // Runs 'count' invocations of the function, the inputs of invocation 'i' start at
+    // 'inputs + i * input_components()', its outputs at 'outputs + i * output_components()'.
+    // Components are 32-bit values in the order of the registers of 'Program::inputs'.
+    void invoke(
+      size_t count,
+      const uint32_t* inputs,
+      uint32_t* outputs
+    );
+
+    // runs 'num_workgroups' workgroups of a compute entry point, its arguments must be builtins.
+    void dispatch(std::array<uint32_t, 3> num_workgroups);
+
+    uint32_t input_components() const;
+
+    uint32_t output_components() const;
+  private:
+    struct alignas(32) Reg {
+      union {
+        float f[kLanes];
+        int32_t i[kLanes];
+        uint32_t u[kLanes];
+      };
+    };
+
+    using Mask = std::array<uint32_t, kLanes>;
+
+    struct Memory {
+      uint8_t* data = nullptr;
+      size_t size = 0;
+    };
+
+    struct Control {
+      Mask saved;
+      Mask other;
+    };
+
+    // runs the program on the lanes of 'mask', inputs and outputs are in 'm_regs'.
+    void run(Mask mask);
+
+    // 'run' built for the baseline isa and for avx2, it picks the one the cpu supports.
+    void run_baseline(Mask mask);
+
+    void run_avx2(Mask mask);
+
+    void execute(Mask mask);
+
+    void error(const std::string& err);
+
+    const Program& m_program;
+    std::vector<Memory> m_memory;
+    std::vector<Reg> m_regs;
+    std::vector<Control> m_control;
+  };
+}
\ No newline at end of file
@@ -0,0 +1,377 @@
+#include "watch.h"
+#include "driver.h"
+#include "types.h"
+
+#include "printers/glsl.h"
+
+#include <fmt/format.h>
+
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace kate::tlr {
+  namespace {
+    // events arriving this close to each other are one change, editors save in several steps.
+    constexpr int kSettleMs = 2;
+
+    constexpr uint32_t kEvents =
+      IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE;
+
+    // each target needs its own extension, or its output would overwrite the source.
+    constexpr std::array<std::pair<std::string_view, std::string_view>, 7> kExtensions = {{
+      { "glsl", ".glsl" },
+      { "hlsl", ".hlsl" },
+      { "reflect", ".refl" },
+      { "reflect-json", ".json" },
+      { "cpp", ".cc" },
+      { "cpp-structs", ".h" },
+      { "ast", ".ksla" }
+    }};
+
+    const std::string_view* extension_of(std::string_view target)
+    {
+      for (auto& [name, extension] : kExtensions)
+        if (name == target)
+          return &extension;
+
+      return nullptr;
+    }
+
+    bool is_shader(const std::filesystem::path& path)
+    {
+      return path.extension() == ".ksl";
+    }
+
+    // the files named by 'import "FILE";' lines, relative to the directory of the source.
+    std::vector<std::filesystem::path> scan_imports(
+      const std::filesystem::path& path,
+      std::string_view source
+    )
+    {
+      std::vector<std::filesystem::path> imports;
+
+      while (!source.empty()) {
+        auto newline = source.find('\n');
+        auto line = source.substr(0, newline);
+
+        source = (newline == std::string_view::npos) ? std::string_view() : source.substr(newline + 1);
+
+        auto start = line.find_first_not_of(" \t");
+
+        if (start == std::string_view::npos || line.substr(start, 8) != "import \"") continue;
+
+        line.remove_prefix(start + 8);
+
+        auto quote = line.find('"');
+
+        if (quote != std::string_view::npos)
+          imports.push_back((path.parent_path() / line.substr(0, quote)).lexically_normal());
+      }
+
+      return imports;
+    }
+
+    // writes next to 'path' first, then renames over it.
+    bool replace_file(const std::filesystem::path& path, const std::string& data)
+    {
+      auto temporary = path;
+      temporary += fmt::format(".{}.tmp", ::getpid());
+
+      {
+        std::ofstream file { temporary, std::ios::binary };
+        file.write(data.data(), data.size());
+
+        if (!file) return false;
+      }
+
+      std::error_code ec;
+      std::filesystem::rename(temporary, path, ec);
+
+      return !ec;
+    }
+  }
+
+  Watcher::Watcher(
+    const std::filesystem::path& root,
+    std::vector<std::pair<std::string, std::string>>&& outputs
+  )
+    : m_root { root.lexically_normal() },
+      m_outputs { std::move(outputs) },
+      m_fd { ::inotify_init1(IN_CLOEXEC) }
+  {
+    if (m_fd < 0)
+      error(fmt::format("Unable to watch '{}': {}.", root.string(), std::strerror(errno)));
+
+    for (auto& [target, dir] : m_outputs)
+      if (!extension_of(target))
+        error(fmt::format("The target '{}' can't be watched, it has no file extension.", target));
+
+    // built-in types are created once here, the children building shaders start with them.
+    types::system();
+    glsl();
+  }
+
+  Watcher::~Watcher()
+  {
+    ::close(m_fd);
+  }
+
+  void Watcher::run()
+  {
+    std::set<std::filesystem::path> changed;
+
+    watch(m_root, changed);
+    rebuild(changed);
+
+    for (;;)
+      rebuild(wait());
+  }
+
+  void Watcher::watch(const std::filesystem::path& dir, std::set<std::filesystem::path>& changed)
+  {
+    int wd = ::inotify_add_watch(m_fd, dir.c_str(), kEvents);
+
+    if (wd < 0)
+      error(fmt::format("Unable to watch '{}': {}.", dir.string(), std::strerror(errno)));
+
+    m_dirs[wd] = dir;
+
+    std::error_code ec;
+
+    for (auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+      auto path = entry.path().lexically_normal();
+
+      if (entry.is_directory())
+        watch(path, changed);
+      else if (is_shader(path)) {
+        update(path);
+        changed.insert(path);
+      }
+    }
+  }
+
+  void Watcher::update(const std::filesystem::path& path)
+  {
+    std::ifstream stream { path };
+
+    if (!stream) {
+      remove(path);
+      return;
+    }
+
+    std::stringstream ss;
+    ss << stream.rdbuf();
+
+    auto& file = m_files[path];
+
+    for (auto& import : file.imports)
+      m_dependents[import].erase(path);
+
+    file.source = ss.str();
+    file.imports = scan_imports(path, file.source);
+
+    for (auto& import : file.imports)
+      m_dependents[import].insert(path);
+  }
+
+  void Watcher::remove(const std::filesystem::path& path)
+  {
+    auto it = m_files.find(path);
+
+    if (it == m_files.end()) return;
+
+    for (auto& import : it->second.imports)
+      m_dependents[import].erase(path);
+
+    m_files.erase(it);
+  }
+
+  std::set<std::filesystem::path> Watcher::wait()
+  {
+    std::set<std::filesystem::path> changed;
+    alignas(inotify_event) char buffer[64 * 1024];
+
+    pollfd pfd { .fd = m_fd, .events = POLLIN };
+    int timeout = -1;
+
+    // blocks until the first event, then reads until the events settle.
+    while (changed.empty() || ::poll(&pfd, 1, timeout) > 0) {
+      auto n = ::read(m_fd, buffer, sizeof(buffer));
+
+      if (n < 0 && errno == EINTR) continue;
+
+      if (n <= 0)
+        error(fmt::format("Unable to read the changes of '{}': {}.", m_root.string(), std::strerror(errno)));
+
+      for (char* ptr = buffer; ptr < buffer + n;) {
+        auto event = reinterpret_cast<inotify_event*>(ptr);
+        ptr += sizeof(inotify_event) + event->len;
+
+        // events were dropped, everything is read again.
+        if (event->mask & IN_Q_OVERFLOW) {
+          watch(m_root, changed);
+          continue;
+        }
+
+        auto dir = m_dirs.find(event->wd);
+
+        if (event->mask & IN_IGNORED) {
+          if (dir != m_dirs.end()) m_dirs.erase(dir);
+          continue;
+        }
+
+        if (dir == m_dirs.end() || event->len == 0) continue;
+
+        auto path = (dir->second / event->name).lexically_normal();
+
+        if (event->mask & IN_ISDIR) {
+          if (event->mask & (IN_CREATE | IN_MOVED_TO))
+            watch(path, changed);
+        } else if (is_shader(path)) {
+          if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+            remove(path);
+          else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+            update(path);
+          else
+            continue;
+
+          changed.insert(path);
+        }
+      }
+
+      timeout = kSettleMs;
+    }
+
+    return changed;
+  }
+
+  void Watcher::rebuild(const std::set<std::filesystem::path>& changed)
+  {
+    auto start = std::chrono::steady_clock::now();
+
+    // the changed files and everything importing them.
+    std::set<std::filesystem::path> dirty;
+    std::vector<std::filesystem::path> stack(changed.begin(), changed.end());
+
+    while (!stack.empty()) {
+      auto path = std::move(stack.back());
+      stack.pop_back();
+
+      if (!dirty.insert(path).second) continue;
+
+      if (auto it = m_dependents.find(path); it != m_dependents.end())
+        stack.insert(stack.end(), it->second.begin(), it->second.end());
+    }
+
+    std::vector<std::pair<pid_t, std::filesystem::path>> children;
+
+    std::fflush(stdout);
+
+    for (auto& path : dirty) {
+      auto file = m_files.find(path);
+
+      if (file == m_files.end()) continue;
+
+      auto pid = ::fork();
+
+      if (pid == 0) {
+        auto status = build(path, file->second);
+
+        std::fflush(stdout);
+        ::_exit(status);
+      }
+
+      if (pid < 0)
+        fmt::println("Unable to fork the compiler for '{}': {}.", path.string(), std::strerror(errno));
+      else
+        children.emplace_back(pid, path);
+    }
+
+    size_t failed = 0;
+
+    for (auto& [pid, path] : children) {
+      int status = 0;
+
+      while (::waitpid(pid, &status, 0) < 0 && errno == EINTR);
+
+      if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        failed++;
+    }
+
+    if (children.empty()) return;
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    fmt::println(
+      "rebuilt {} of {} shaders in {:.3f} ms, {} failed",
+      children.size(),
+      m_files.size(),
+      elapsed.count() * 1000.0,
+      failed
+    );
+
+    // the log is followed while it's written, e.g. by the editor.
+    std::fflush(stdout);
+  }
+
+  int Watcher::build(const std::filesystem::path& path, const File& file)
+  {
+    auto module = compile(file.source, ParserOptions {
+      .error_callback = [&](const std::string_view& message) {
+        fmt::println("{}: {}", path.string(), message);
+      }
+    }, path);
+
+    if (!module) return 1;
+
+    std::vector<std::string> targets;
+
+    for (auto& [target, dir] : m_outputs)
+      targets.push_back(target);
+
+    auto generated = emit(module.get(), targets);
+
+    for (auto& [target, dir] : m_outputs) {
+      auto output = output_path(path, target, dir);
+
+      std::error_code ec;
+      std::filesystem::create_directories(output.parent_path(), ec);
+
+      if (!replace_file(output, generated[target])) {
+        fmt::println("Unable to write '{}'.", output.string());
+        return 1;
+      }
+    }
+
+    return 0;
+  }
+
+  std::filesystem::path Watcher::output_path(
+    const std::filesystem::path& path,
+    const std::string& target,
+    const std::string& dir
+  ) const
+  {
+    auto output = (dir == "-") ? path : std::filesystem::path(dir) / path.lexically_relative(m_root);
+
+    // the constructor rejected targets without an extension.
+    output.replace_extension(*extension_of(target));
+
+    return output;
+  }
+
+  void Watcher::error(const std::string& err)
+  {
+    fmt::println("{}", err);
+    std::exit(1);
+  }
+}
\ No newline at end of file
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <filesystem>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace kate::tlr {
+  // Rebuilds the shaders of a directory as they are saved, for engines hot-reloading them.
+  //
+  // Directories are watched with inotify. A change rebuilds the file and every file importing
+  // it, directly or not, the rest of the tree is left alone. Each rebuilt file compiles in its
+  // own forked child, all of them at once, so a shader with errors only prints them. Outputs
+  // are written to a temporary file renamed over the previous one, a reader never sees them
+  // half written.
+  class Watcher {
+  public:
+    // 'outputs' pairs targets with the directory their files are written to, a directory of
+    // '-' writes them next to their source.
+    Watcher(
+      const std::filesystem::path& root,
+      std::vector<std::pair<std::string, std::string>>&& outputs
+    );
+
+    ~Watcher();
+
+    // builds every shader, then rebuilds them as they change, never returns.
+    void run();
+  private:
+    struct File {
+      std::string source;
+      // files named by the 'import' declarations of the source.
+      std::vector<std::filesystem::path> imports;
+    };
+
+    // watches 'dir' and the directories below it, adds their shaders to 'changed'.
+    void watch(const std::filesystem::path& dir, std::set<std::filesystem::path>& changed);
+
+    // reads the source of a file and the files it imports.
+    void update(const std::filesystem::path& path);
+
+    void remove(const std::filesystem::path& path);
+
+    // waits for the next changes, events arriving together are handled as one change.
+    std::set<std::filesystem::path> wait();
+
+    // rebuilds the files in 'changed' and the files depending on them.
+    void rebuild(const std::set<std::filesystem::path>& changed);
+
+    // runs in the child, returns its exit code.
+    int build(const std::filesystem::path& path, const File& file);
+
+    std::filesystem::path output_path(
+      const std::filesystem::path& path,
+      const std::string& target,
+      const std::string& dir
+    ) const;
+
+    void error(const std::string& err);
+
+    std::filesystem::path m_root;
+    std::vector<std::pair<std::string, std::string>> m_outputs;
+
+    int m_fd;
+    std::unordered_map<int, std::filesystem::path> m_dirs;
+
+    std::map<std::filesystem::path, File> m_files;
+    // files importing each file, which may not exist yet.
+    std::map<std::filesystem::path, std::set<std::filesystem::path>> m_dependents;
+  };
+}
\ No newline at end of file
@@ -1,9 +1,12 @@
 #include <iostream>
+#include <string>
 #include <thread>
 
 #include <kate/adapter.h>
 #include <kate/device.h>
 
+#include "base/trace.h"
+
 #include <SDL3/SDL.h>
 #include <SDL3/SDL_video.h>
 
@@ -11,7 +14,36 @@
 #   include <X11/Xlib.h>
 #endif
 
+namespace {
+  // writes the trace of the run to 'path' once the engine is done.
+  struct TraceOutput {
+    std::string path;
+
+    ~TraceOutput() {
+      if (path.empty()) return;
+
+      base::trace::stop();
+
+      if (!base::trace::write_chrome_json(path))
+        std::cerr << "Unable to write the trace to '" << path << "'." << std::endl;
+    }
+  };
+}
+
 int main(int argc, char* argv[]) {
+  // '--trace FILE' writes the zones of the run to FILE as a Chrome trace, they are compiled in
+  // by building with TS_TRACE.
+  TraceOutput trace_output;
+
+  for (int i = 1; i < argc; i++)
+    if (std::string(argv[i]) == "--trace" && i + 1 < argc)
+      trace_output.path = argv[++i];
+
+  if (!trace_output.path.empty()) {
+    base::trace::set_thread_name("main");
+    base::trace::start();
+  }
+
   SDL_Init(SDL_INIT_VIDEO);
 
   auto* window = SDL_CreateWindow("hello!", 200, 200, SDL_WINDOW_RESIZABLE);